@@ -71,6 +71,10 @@ it is recommended that you use the Qt Mobility <A HREF="http://doc.qt.nokia.com/
     <TD>MeeGo::QmHeartbeat</TD>
     <TD>provides system heartbeat service.</TD>
 </TR>
+<TR>
+    <TD>MeeGo::QmIPCStatistics</TD>
+    <TD>provides statistics of the D-Bus calls of the library.</TD>
+</TR>
 <TR>
     <TD>MeeGo::QmKeys</TD>
     <TD>provides access to hardware key states.</TD>
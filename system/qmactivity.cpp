@@ -27,10 +27,9 @@
  */
 #include "qmactivity.h"
 #include "qmactivity_p.h"
+#include "qmsignalhub_p.h"
 
-#include <QDBusConnection>
 #include <QDBusMessage>
-#include <QDBusReply>
 
 namespace MeeGo {
 
@@ -40,6 +39,8 @@ QmActivity::QmActivity(QObject *parent)
 
     connect(priv, SIGNAL(activityChanged(MeeGo::QmActivity::Activity)),
             this, SIGNAL(activityChanged(MeeGo::QmActivity::Activity)));
+    connect(priv, SIGNAL(activityReceived(MeeGo::QmActivity::Activity)),
+            this, SIGNAL(activityReceived(MeeGo::QmActivity::Activity)));
 }
 
 QmActivity::~QmActivity() {
@@ -47,6 +48,8 @@ QmActivity::~QmActivity() {
 
     disconnect(priv, SIGNAL(activityChanged(MeeGo::QmActivity::Activity)),
                this, SIGNAL(activityChanged(MeeGo::QmActivity::Activity)));
+    disconnect(priv, SIGNAL(activityReceived(MeeGo::QmActivity::Activity)),
+               this, SIGNAL(activityReceived(MeeGo::QmActivity::Activity)));
 
     MEEGO_UNINITIALIZE(QmActivity);
 }
@@ -60,12 +63,12 @@ void QmActivity::connectNotify(const char *signal) {
     if (QLatin1String(signal) == QLatin1String(QMetaObject::normalizedSignature(SIGNAL(activityChanged(MeeGo::QmActivity::Activity))))) {
         if (0 == priv->connectCount[SIGNAL_INACTIVITY]) {
             #if HAVE_MCE
-                QDBusConnection::systemBus().connect(MCE_SERVICE,
-                                                     MCE_SIGNAL_PATH,
-                                                     MCE_SIGNAL_IF,
-                                                     MCE_INACTIVITY_SIG,
-                                                     priv,
-                                                     SLOT(slotActivityChanged(bool)));
+                QmSignalHub::connect(MCE_SERVICE,
+                                     MCE_SIGNAL_PATH,
+                                     MCE_SIGNAL_IF,
+                                     MCE_INACTIVITY_SIG,
+                                     priv,
+                                     SLOT(slotActivityChanged(bool)));
             #endif
         }
         priv->connectCount[SIGNAL_INACTIVITY]++;
@@ -82,12 +85,12 @@ void QmActivity::disconnectNotify(const char *signal) {
 
         if (0 == priv->connectCount[SIGNAL_INACTIVITY]) {
             #if HAVE_MCE
-                QDBusConnection::systemBus().disconnect(MCE_SERVICE,
-                                                        MCE_SIGNAL_PATH,
-                                                        MCE_SIGNAL_IF,
-                                                        MCE_INACTIVITY_SIG,
-                                                        priv,
-                                                        SLOT(slotActivityChanged(bool)));
+                QmSignalHub::disconnect(MCE_SERVICE,
+                                        MCE_SIGNAL_PATH,
+                                        MCE_SIGNAL_IF,
+                                        MCE_INACTIVITY_SIG,
+                                        priv,
+                                        SLOT(slotActivityChanged(bool)));
             #endif
         }
     }
@@ -96,14 +99,23 @@ void QmActivity::disconnectNotify(const char *signal) {
 QmActivity::Activity QmActivity::get() const {
     QmActivity::Activity status = Inactive;
     #if HAVE_MCE
-        QDBusReply<bool> inactivityStatusReply = QDBusConnection::systemBus().call(
-                                                     QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH, MCE_REQUEST_IF,
-                                                                                    MCE_INACTIVITY_STATUS_GET));
-        if (!inactivityStatusReply.isValid()) {
-            return status;
+        MEEGO_PRIVATE_CONST(QmActivity)
+
+        bool inactivityStatus;
+        QList<QVariant> cached;
+
+        if (priv->cached
+            && QmSignalHub::cached(MCE_SERVICE, MCE_SIGNAL_PATH, MCE_SIGNAL_IF, MCE_INACTIVITY_SIG, cached)
+            && cached.count() == 1) {
+            inactivityStatus = cached[0].toBool();
+        } else {
+            QList<QVariant> resp = priv->requestIf->get(MCE_INACTIVITY_STATUS_GET);
+            if (resp.isEmpty()) {
+                return status;
+            }
+
+            inactivityStatus = resp[0].toBool();
         }
-
-        bool inactivityStatus = inactivityStatusReply.value();
         if (!inactivityStatus) {
             status = Active;
         }
@@ -111,4 +123,38 @@ QmActivity::Activity QmActivity::get() const {
     return status;
 }
 
+void QmActivity::getAsync() {
+    #if HAVE_MCE
+        MEEGO_PRIVATE(QmActivity)
+        QObject::connect(priv->requestIf->getAsync(MCE_INACTIVITY_STATUS_GET),
+                         SIGNAL(finished(QDBusPendingCallWatcher*)),
+                         priv, SLOT(didReceiveActivity(QDBusPendingCallWatcher*)));
+    #else
+        /* Never from within the call, as with the bus */
+        qRegisterMetaType<MeeGo::QmActivity::Activity>("MeeGo::QmActivity::Activity");
+        QMetaObject::invokeMethod(this, "activityReceived", Qt::QueuedConnection,
+                                  Q_ARG(MeeGo::QmActivity::Activity, Inactive));
+    #endif
+}
+
+void QmActivity::setCached(bool cached) {
+    MEEGO_PRIVATE(QmActivity)
+
+    QMutexLocker locker(&priv->connectMutex);
+
+    if (priv->cached == cached)
+        return;
+    priv->cached = cached;
+
+    #if HAVE_MCE
+        if (cached) {
+            QmSignalHub::mirror(MCE_SERVICE, MCE_SIGNAL_PATH, MCE_SIGNAL_IF, MCE_INACTIVITY_SIG, priv,
+                                QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH,
+                                                               MCE_REQUEST_IF, MCE_INACTIVITY_STATUS_GET));
+        } else {
+            QmSignalHub::unmirror(MCE_SERVICE, MCE_SIGNAL_PATH, MCE_SIGNAL_IF, MCE_INACTIVITY_SIG, priv);
+        }
+    #endif
+}
+
 }
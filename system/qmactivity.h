@@ -80,6 +80,22 @@ public:
      */
     Activity get() const;
 
+    /*!
+     * @brief Enables or disables the cached mode of get().
+     * In the cached mode get() returns the last activity state seen from
+     * the inactivity signal of MCE without a round trip to MCE. The state
+     * is prefetched asynchronously when the mode is enabled.
+     * @param cached True to enable, false to disable the cached mode
+     */
+    void setCached(bool cached);
+
+    /*!
+     * @brief Gets the current activity state without blocking.
+     * The activityReceived() signal is sent when the state has been
+     * retrieved, with QmActivity::Inactive in case of an error, as by get().
+     */
+    void getAsync();
+
 Q_SIGNALS:
     /*!
      * @brief Sent when activity state has changed.
@@ -88,6 +104,12 @@ Q_SIGNALS:
      */
     void activityChanged(MeeGo::QmActivity::Activity activity);
 
+    /*!
+     * @brief Sent when the activity state requested with getAsync() has been retrieved.
+     * @param activity The current activity state
+     */
+    void activityReceived(MeeGo::QmActivity::Activity activity);
+
 protected:
     void connectNotify(const char *signal);
     void disconnectNotify(const char *signal);
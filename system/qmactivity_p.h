@@ -31,6 +31,7 @@
 #define QMACTIVITY_P_H
 
 #include "qmactivity.h"
+#include "qmipcinterface_p.h"
 
 #include <QMutex>
 
@@ -51,16 +52,26 @@ namespace MeeGo
     public:
         QMutex connectMutex;
         size_t connectCount[1];
+        bool cached;
+        QmIPCInterface *requestIf;
 
         QmActivityPrivate() {
             connectCount[SIGNAL_INACTIVITY] = 0;
+            cached = false;
+
+            requestIf = 0;
+            #if HAVE_MCE
+                requestIf = new QmIPCInterface(MCE_SERVICE, MCE_REQUEST_PATH, MCE_REQUEST_IF);
+            #endif
         }
 
         ~QmActivityPrivate() {
+            delete requestIf, requestIf = 0;
         }
 
     Q_SIGNALS:
         void activityChanged(MeeGo::QmActivity::Activity);
+        void activityReceived(MeeGo::QmActivity::Activity);
 
     public Q_SLOTS:
 
@@ -71,6 +82,17 @@ namespace MeeGo
                 emit activityChanged(QmActivity::Active);
             }
         }
+
+        void didReceiveActivity(QDBusPendingCallWatcher *call) {
+            QList<QVariant> resp = QmIPCInterface::results(call);
+            call->deleteLater();
+
+            if (resp.count() == 1 && !resp[0].toBool()) {
+                emit activityReceived(QmActivity::Active);
+            } else {
+                emit activityReceived(QmActivity::Inactive);
+            }
+        }
     };
 }
 
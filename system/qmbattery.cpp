@@ -33,10 +33,15 @@
 
 #include "qmbattery.h"
 #include "qmbattery_p.h"
+#include "qmbmetransport_p.h"
+#include "qmipcinterface_p.h"
 
 #include <QDBusMetaType>
 #include <QDBusInterface>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
 #include <QDBusReply>
+#include <QDBusServiceWatcher>
 #include <QDebug>
 #include <QSocketNotifier>
 #include <QTimer>
@@ -50,8 +55,12 @@ extern "C" {
 }
 
 #define BMECLI_TIMEOUT 3000  /* ms */
+#define BMECURRENT_MAX_DRAIN 64 /* messages per wakeup */
 #define BMECURRENT_TIMEOUT 5010
-#define STAT_EXPIRATION_TIMEOUT 5 /* seconds */
+#define CHARGER_SETTLE_TIMEOUT 4000 /* ms, USB 100 mA to 500 mA negotiation */
+#define STAT_EXPIRATION_TIMEOUT 5 /* seconds, values changing without events */
+#define STAT_FALLBACK_TIMEOUT  60 /* seconds, in case a BME event gets lost */
+#define MODEL_SAVE_DELAY 5000 /* ms, from the first change to the write of the model */
 
 #define DEFAULT_TALK_CURRENT   300 /* mA */
 #define DEFAULT_ACTIVE_CURRENT 150 /* mA */
@@ -72,6 +81,10 @@ extern "C" {
 
 #define USETIME_METHOD_GET_CURRENT "getCurrent"
 
+/* The modes of requestRemainingTimes() and the currents used if not known */
+static const int usetimeModes[] = { USETIME_MODE_TALK, USETIME_MODE_ACTIVE, USETIME_MODE_IDLE };
+static const int usetimeDefaults[] = { DEFAULT_TALK_CURRENT, DEFAULT_ACTIVE_CURRENT, DEFAULT_IDLE_CURRENT };
+
 
 #define dbg(a) qDebug() << __PRETTY_FUNCTION__ << ": " << a
 
@@ -130,7 +143,12 @@ class EmIpc : public EmHandle<EmIpc>
     friend class EmHandle<EmIpc>;
 public:
 
-    EmIpc() : EmHandle<EmIpc>(), sd_(-1), restart_count_(0) {}
+    EmIpc()
+        : EmHandle<EmIpc>(),
+          transport_(QmBmeTransport::instance()),
+          sd_(-1),
+          restart_count_(0)
+    { }
 
     bool query(const void *msg1, int len1, void *msg2 = NULL, int len2 = -1)
     {
@@ -142,7 +160,7 @@ public:
 	int tries = 0;
 	while (true) {
 	    tries++;
-	    if (::bmeipc_query(sd_, msg1, len1, msg2, len2) >= 0)
+	    if (transport_->query(sd_, msg1, len1, msg2, len2) >= 0)
 		return true;
 	    if (errno == EIO)
 		restart_count_++;
@@ -164,16 +182,17 @@ private:
 
     inline void open_()
     {
-        sd_ = ::bmeipc_open();
+        sd_ = transport_->open();
     }
 
     inline void close_()
     {
-        ::bmeipc_close(sd_);
+        transport_->close(sd_);
         sd_ = -1;
     }
 
 
+    QmBmeTransport *transport_;
     int sd_;
     int restart_count_;
 };
@@ -186,6 +205,7 @@ class EmEvents : public EmHandle<EmEvents>
 public:
     EmEvents(int mask = -1)
         : EmHandle<EmEvents>(),
+          transport_(QmBmeTransport::instance()),
           sd_(-1),
           mask_(mask)
     { }
@@ -196,7 +216,7 @@ public:
             return BMEVENT_ERROR;
         }
 
-        int res = ::bmeipc_eread(sd_);
+        int res = transport_->eread(sd_);
         if (res == BMEVENT_ERROR) {
             qDebug() << "bmeipc_eread returned error" << strerror(errno);
         }
@@ -211,7 +231,7 @@ private:
 
     inline void open_()
     {
-        sd_ = ::bmeipc_eopen(mask_);
+        sd_ = transport_->eopen(mask_);
         if (is_opened())
             notifier_.reset(new QSocketNotifier(sd_, QSocketNotifier::Read));
     }
@@ -219,10 +239,11 @@ private:
     inline void close_()
     {
         notifier_.reset(0);
-        ::bmeipc_eclose(sd_);
+        transport_->eclose(sd_);
         sd_ = -1;
     }
 
+    QmBmeTransport *transport_;
     int sd_;
     int mask_;
     QScopedPointer<QSocketNotifier> notifier_;
@@ -244,33 +265,47 @@ public:
 
     inline bool is_opened() { return mq_ >= 0; }
 
-    bool measure(int &current)
+    /*
+     * Receives all the pending messages. The queue is non-blocking, so this
+     * returns when it is empty.
+     *
+     * @return Number of samples appended to the vector
+     */
+    int measure(QVector<QmBatteryMeasurement> &samples)
     {
-        current = 0;
-
         if (!is_opened())
-            return false;
-
-        int n;
-        bmeipc_meas_t msg;
-        n = mq_receive(mq_, (char *)&msg, sizeof(msg), 0);
-        
-        if (0 > n) {
-            qDebug() << "failed to receive message: "
-                     << strerror(errno);
-        } else if (n != sizeof(msg)) {
-            qDebug() << "bad message size: need "
-                     << sizeof (msg) << ", got " << n;
-        } else if (MEASUREMENTS_ERROR == msg.state) {
-            qDebug() << " error message received";
-        } else if (MEASUREMENTS_OFF == msg.state) {
-            qDebug() << "measurements are off";
-        } else {
-            DUMP_MSG(msg);
-            current = msg.bat_current;
-            return true;
+            return 0;
+
+        int count = 0;
+        for (int i = 0; i < BMECURRENT_MAX_DRAIN; i++) {
+            bmeipc_meas_t msg;
+            int n = mq_receive(mq_, (char *)&msg, sizeof(msg), 0);
+
+            if (0 > n) {
+                if (errno != EAGAIN)
+                    qDebug() << "failed to receive message: "
+                             << strerror(errno);
+                break;
+            } else if (n != sizeof(msg)) {
+                qDebug() << "bad message size: need "
+                         << sizeof (msg) << ", got " << n;
+            } else if (MEASUREMENTS_ERROR == msg.state) {
+                qDebug() << " error message received";
+            } else if (MEASUREMENTS_OFF == msg.state) {
+                qDebug() << "measurements are off";
+            } else {
+                DUMP_MSG(msg);
+                QmBatteryMeasurement sample;
+                sample.timestamp = (quint64)msg.timestamp.tv_sec * 1000000ULL
+                    + msg.timestamp.tv_usec;
+                sample.current = msg.bat_current;
+                sample.voltage = msg.bat_voltage;
+                sample.temperature = msg.bat_temp;
+                samples.append(sample);
+                count++;
+            }
         }
-        return false;
+        return count;
     }
 
     QSocketNotifier const* notifier() const { return notifier_.data(); }
@@ -317,7 +352,7 @@ private:
         if (!request_measurements_(period_))
             return;
 
-        mq_ = mq_open(BMEIPC_MQNAME, O_RDONLY);
+        mq_ = QmBmeTransport::instance()->mqOpen();
         if (!is_opened())
             return;
 
@@ -352,24 +387,188 @@ private:
 };
 
 
+/*------------ bmestat_t translation ------------*/
+
+static QmBattery::BatteryState toBatteryState(int state)
+{
+    switch (state) {
+    case BATTERY_STATE_EMPTY:
+        return QmBattery::StateEmpty;
+    case BATTERY_STATE_LOW:
+        return QmBattery::StateLow;
+    case BATTERY_STATE_OK:
+        return QmBattery::StateOK;
+    case BATTERY_STATE_FULL:
+        return QmBattery::StateFull;
+    case BATTERY_STATE_ERROR:
+    default:
+        return QmBattery::StateError;
+    }
+}
+
+static QmBattery::ChargerType toChargerType(int type)
+{
+    switch (type) {
+    case CHARGER_TYPE_USB100MA:
+        return QmBattery::USB_100mA;
+    case CHARGER_TYPE_USB500MA:
+        return QmBattery::USB_500mA;
+    case CHARGER_TYPE_USBWALL:
+    case CHARGER_TYPE_DYNAMO:
+        return QmBattery::Wall;
+    case CHARGER_TYPE_NONE:
+        return QmBattery::None;
+    case CHARGER_TYPE_ERROR:
+    default:
+        return QmBattery::Unknown;
+    }
+}
+
+static QmBattery::ChargingState toChargingState(int state)
+{
+    switch (state) {
+    case CHARGING_STATE_STOPPED:
+        return QmBattery::StateNotCharging;
+    case CHARGING_STATE_STARTED:
+        return QmBattery::StateCharging;
+    case CHARGING_STATE_ERROR:
+    default:
+        return QmBattery::StateChargingFailed;
+    }
+}
+
+static QmBattery::BatteryCondition toBatteryCondition(int condition)
+{
+    switch (condition) {
+    case BATTERY_CONDITION_GOOD:
+        return QmBattery::ConditionGood;
+    case BATTERY_CONDITION_POOR:
+        return QmBattery::ConditionPoor;
+    default:
+        return QmBattery::ConditionUnknown;
+    }
+}
+
+static int toRemainingChargingTime(int state, int minutes)
+{
+    if (state == CHARGING_STATE_STARTED) {
+        return minutes * 60;
+    } else {
+        return -1;
+    }
+}
+
+/*------------ class QmBatteryUsetimeWorker ------------*/
+
+QmBatteryUsetimeWorker::QmBatteryUsetimeWorker(QmBatteryPrivate *priv)
+    : priv_(priv),
+      stopping_(false)
+{
+}
+
+QmBatteryUsetimeWorker::~QmBatteryUsetimeWorker()
+{
+    {
+        QMutexLocker locker(&mutex_);
+        stopping_ = true;
+        changed_.wakeAll();
+    }
+    wait();
+}
+
+void QmBatteryUsetimeWorker::request(QmBattery::RemainingTimeMode psMode,
+                                     const int currents[3])
+{
+    Job job;
+    job.psMode = psMode;
+    for (int i = 0; i < 3; i++)
+        job.currents[i] = currents[i];
+
+    QMutexLocker locker(&mutex_);
+    jobs_.append(job);
+    changed_.wakeAll();
+    if (!isRunning())
+        start();
+}
+
+void QmBatteryUsetimeWorker::run()
+{
+    QMutexLocker locker(&mutex_);
+    while (!stopping_) {
+        if (jobs_.isEmpty()) {
+            changed_.wait(&mutex_);
+            continue;
+        }
+        Job job = jobs_.takeFirst();
+        locker.unlock();
+
+        int times[3];
+        for (int i = 0; i < 3; i++)
+            times[i] = priv_->remainingTime_(usetimeModes[i], job.psMode,
+                                             job.currents[i], usetimeDefaults[i]);
+        QMetaObject::invokeMethod(priv_, "onRemainingTimes", Qt::QueuedConnection,
+                                  Q_ARG(int, (int)job.psMode), Q_ARG(int, times[0]),
+                                  Q_ARG(int, times[1]), Q_ARG(int, times[2]));
+        locker.relock();
+    }
+}
+
+/*
+ * One discharge model per process, fed by every QmBattery with the raw
+ * coulomb counter, which is the same for all of them. modelMutex guards
+ * the model, modelFileMutex orders the writes of its file, which are made
+ * with no other lock held.
+ */
+static QMutex modelMutex;
+static QMutex modelFileMutex;
+
+static QmBatteryModel &sharedModel()
+{
+    static QmBatteryModel model;
+    return model;
+}
+
 /*------------ class QmBatteryPrivate ------------*/
 QmBatteryPrivate::QmBatteryPrivate()
 	: parent_(0),
-      is_data_actual_(false),
-      cache_expire_(QDateTime::currentDateTime()),
+      stat_seq_(0),
+      stat_events_(1),
+      stat_cc_offset_(0),
+      stat_time_(0),
+      stat_generation_(0),
+      ipc_mutex_(QMutex::Recursive),
       cc_offset_(0),
       prev_cc_restart_count_(-1),
       ipc_(new EmIpc()),
       events_(new EmEvents())
 {
     memset(&stat_, 0, sizeof(stat_));
-    timer = new QTimer();
-    connect(timer, SIGNAL(timeout()), this, SLOT(waitForUSB500mA()));
-    usb100ma_emit_delayed = 0;
+    charger_negotiation_ = ChargerSettled;
+    charger_timer_.setSingleShot(true);
+    charger_timer_.setInterval(CHARGER_SETTLE_TIMEOUT);
+    connect(&charger_timer_, SIGNAL(timeout()), this, SLOT(onChargerSettled()));
+    model_timer_.setSingleShot(true);
+    model_timer_.setInterval(MODEL_SAVE_DELAY);
+    connect(&model_timer_, SIGNAL(timeout()), this, SLOT(saveModel()));
+
+    usetime_unknown_ = false;
+    usetime_generation_ = 0;
+    invalidateUsetimeCache_();
+    for (int i = 0; i < USETIME_CACHE_SIZE; i++) {
+        usetime_pending_[i] = false;
+        requested_current_[i].valid = false;
+    }
+    requested_times_[0] = requested_times_[1] = false;
+
+    usetime_watcher_ = new QDBusServiceWatcher(USETIME_SERVICE, QDBusConnection::systemBus(),
+                                               QDBusServiceWatcher::WatchForRegistration, this);
+    connect(usetime_watcher_, SIGNAL(serviceRegistered(const QString&)),
+            this, SLOT(onUsetimeRegistered(const QString&)));
 }
 
 QmBatteryPrivate::~QmBatteryPrivate() {
-    delete timer;
+    usetime_worker_.reset(0);
+    saveModel();
 }
 
 bool QmBatteryPrivate::init(QmBattery *parent)
@@ -385,76 +584,295 @@ bool QmBatteryPrivate::init(QmBattery *parent)
     return true;
 }
 
-void QmBatteryPrivate::queryStat_() const
-{
-    QDateTime now(QDateTime::currentDateTime());
-
-    if (!is_data_actual_ || now >= cache_expire_) {
-        if (!ipc_->open())
-	    return;
-
-	int prev_cc = stat_[COULOMB_COUNTER];
-	
-	bmeipc_msg_t request;
-	request.type = BME_SYSMSG_GETSTAT;
-	request.subtype = 0;
-	if (!ipc_->query(&request, sizeof(request), &stat_, sizeof(stat_)))
-	    return;
-	    
-	is_data_actual_ = true;
-        cache_expire_ = now.addSecs(STAT_EXPIRATION_TIMEOUT);
-
-	if (prev_cc_restart_count_ != ipc_->restart_count()) {
-	    /* 
-	     * BME has re-started. Adjust the coulomb counter offset to hide
-	     * counter reset.
-	     *
-	     * @note: All the coulombs since the previous call have been lost,
-	     *        but let's consider that acceptable.
-	     */
-	    cc_offset_ += (prev_cc - stat_[COULOMB_COUNTER]);
-	    qDebug() << "CC reset, prev_cc:" << prev_cc
-		     << "new_cc" << stat_[COULOMB_COUNTER]
-		     << "new offset:" << cc_offset_;
-	    prev_cc_restart_count_ = ipc_->restart_count();
-	}
+time_t QmBatteryPrivate::monotonicTime_()
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0)
+        return 0;
+    return ts.tv_sec;
+}
+
+bool QmBatteryPrivate::isVolatileStat_(int index)
+{
+    /* These change continuously, BME does not send events for them */
+    switch (index) {
+    case BATTERY_VOLT_NOW:
+    case BATTERY_CURRENT:
+    case BATTERY_CAPA_NOW:
+    case COULOMB_COUNTER:
+        return true;
+    default:
+        return false;
     }
 }
 
+int QmBatteryPrivate::readBegin_() const
+{
+    int seq;
+    while ((seq = stat_seq_) & 1)
+        QThread::yieldCurrentThread();
+    __sync_synchronize();
+    return seq;
+}
+
+bool QmBatteryPrivate::readRetry_(int seq) const
+{
+    __sync_synchronize();
+    return stat_seq_ != seq;
+}
+
+bool QmBatteryPrivate::isFresh_(bool isVolatile) const
+{
+    time_t time;
+    int generation, seq;
+    do {
+        seq = readBegin_();
+        time = stat_time_;
+        generation = stat_generation_;
+    } while (readRetry_(seq));
+
+    /* An event arrived after the cached stat was queried */
+    if (generation != stat_events_)
+        return false;
+
+    /*
+     * The cache is invalidated by BME events (see onEmEvent). The timeouts
+     * only guard the values BME does not send events for and the case of
+     * a lost event, or no event socket at all.
+     */
+    time_t timeout = STAT_FALLBACK_TIMEOUT;
+    if (isVolatile || !events_->is_opened())
+        timeout = STAT_EXPIRATION_TIMEOUT;
+    return monotonicTime_() - time < timeout;
+}
+
+void QmBatteryPrivate::queryStat_(bool isVolatile) const
+{
+    if (isFresh_(isVolatile))
+        return;
+
+    QMutexLocker locker(&ipc_mutex_);
+
+    /* Another thread may have refreshed the cache while this one waited */
+    if (isFresh_(isVolatile))
+        return;
+
+    if (!ipc_->open())
+        return;
+
+    /*
+     * The result is published with the events seen before the query, an
+     * event arriving during the query leaves it stale.
+     */
+    int generation = stat_events_;
+    __sync_synchronize();
+
+    bmestat_t stat;
+    bmeipc_msg_t request;
+    request.type = BME_SYSMSG_GETSTAT;
+    request.subtype = 0;
+    if (!ipc_->query(&request, sizeof(request), &stat, sizeof(stat)))
+        return;
+
+    /* Only refreshes write stat_, and they hold ipc_mutex_ */
+    int prev_cc = stat_[COULOMB_COUNTER];
+
+    if (prev_cc_restart_count_ != ipc_->restart_count()) {
+        /*
+         * BME has re-started. Adjust the coulomb counter offset to hide
+         * counter reset.
+         *
+         * @note: All the coulombs since the previous call have been lost,
+         *        but let's consider that acceptable.
+         */
+        cc_offset_ += (prev_cc - stat[COULOMB_COUNTER]);
+        qDebug() << "CC reset, prev_cc:" << prev_cc
+                 << "new_cc" << stat[COULOMB_COUNTER]
+                 << "new offset:" << cc_offset_;
+        prev_cc_restart_count_ = ipc_->restart_count();
+    }
+
+    time_t now = monotonicTime_();
+
+    stat_seq_.ref();
+    memcpy(&stat_, &stat, sizeof(stat_));
+    stat_cc_offset_ = cc_offset_;
+    stat_time_ = now;
+    stat_generation_ = generation;
+    stat_seq_.ref();
+
+    bool learned;
+    {
+        QMutexLocker modelLocker(&modelMutex);
+        learned = sharedModel().update(stat[BATTERY_LEVEL_PCT], stat[BATTERY_CAPA_NOW],
+                                       stat[COULOMB_COUNTER],
+                                       stat[CHARGING_STATE] != CHARGING_STATE_STARTED, now);
+    }
+
+    /* The getter may run on any thread, the file is written by the event loop */
+    if (learned)
+        QMetaObject::invokeMethod(const_cast<QmBatteryPrivate*>(this), "scheduleModelSave",
+                                  Qt::QueuedConnection);
+}
+
+void QmBatteryPrivate::scheduleModelSave()
+{
+    if (!model_timer_.isActive())
+        model_timer_.start();
+}
+
+void QmBatteryPrivate::saveModel()
+{
+    model_timer_.stop();
+
+    QMutexLocker fileLocker(&modelFileMutex);
+    QMutexLocker locker(&modelMutex);
+    if (!sharedModel().takeChanged())
+        return;
+    QmBatteryModel model(sharedModel());
+    locker.unlock();
+
+    model.save();
+}
+
 void QmBatteryPrivate::saveStat_()
 {
-    queryStat_();
-    memcpy(&saved_stat_, &stat_, sizeof(saved_stat_));
+    int cc_offset;
+    getStats(saved_stat_, cc_offset);
 }
 
 int QmBatteryPrivate::getStat(int index) const
 {
-    queryStat_();
-    return stat_[index];
+    queryStat_(isVolatileStat_(index));
+
+    int value, seq;
+    do {
+        seq = readBegin_();
+        value = stat_[index];
+    } while (readRetry_(seq));
+    return value;
 }
 
 int QmBatteryPrivate::getCumulativeBatteryCurrent()
 {
-    return getStat(COULOMB_COUNTER) + cc_offset_;
+    queryStat_(true);
+
+    int value, seq;
+    do {
+        seq = readBegin_();
+        value = stat_[COULOMB_COUNTER] + stat_cc_offset_;
+    } while (readRetry_(seq));
+    return value;
 }
 
-int QmBatteryPrivate::getAverageCurrent(int usageMode,
-					QmBattery::RemainingTimeMode psMode,
-					int defaultCurrent) const
+void QmBatteryPrivate::getStats(bmestat_t &stat, int &cc_offset) const
+{
+    queryStat_(true);
+
+    int seq;
+    do {
+        seq = readBegin_();
+        memcpy(&stat, &stat_, sizeof(stat));
+        cc_offset = stat_cc_offset_;
+    } while (readRetry_(seq));
+}
+
+int QmBatteryPrivate::usetimeCacheIndex_(int usageMode,
+                                         QmBattery::RemainingTimeMode psMode)
+{
+    int index = (usageMode - USETIME_MODE_IDLE) * 2;
+    if (psMode == QmBattery::PowersaveMode)
+        index++;
+    return index;
+}
+
+void QmBatteryPrivate::invalidateUsetimeCache_()
+{
+    QMutexLocker locker(&ipc_mutex_);
+    usetime_generation_++;
+    for (int i = 0; i < USETIME_CACHE_SIZE; i++) {
+        usetime_current_[i].valid = false;
+        remaining_time_[i].valid = false;
+    }
+}
+
+int QmBatteryPrivate::usetimeCurrent_(int usageMode,
+                                      QmBattery::RemainingTimeMode psMode) const
 {
-    int result = makeUsetimeQuery(USETIME_METHOD_GET_CURRENT,
-				  usageMode, psMode);
+    UsetimeCacheEntry &entry = usetime_current_[usetimeCacheIndex_(usageMode, psMode)];
+    int generation;
+    {
+        QMutexLocker locker(&ipc_mutex_);
+        if (entry.valid)
+            return entry.value;
+        if (usetime_unknown_)
+            return -1;
+        generation = usetime_generation_;
+    }
+
+    /* The D-Bus call blocks, ipc_mutex_ must not be held across it */
+    int value = makeUsetimeQuery(USETIME_METHOD_GET_CURRENT, usageMode, psMode);
+
+    QMutexLocker locker(&ipc_mutex_);
+    if (generation == usetime_generation_) {
+        entry.value = value;
+        entry.valid = true;
+    }
+    return value;
+}
+
+int QmBatteryPrivate::averageCurrent_(int usageMode, int usetimeCurrent,
+                                      int defaultCurrent) const
+{
+    int result = usetimeCurrent;
+    if (result < 0) {
+        /* No usetime daemon, use what has been learned on this device */
+        QMutexLocker locker(&modelMutex);
+        if (usageMode == USETIME_MODE_IDLE)
+            result = sharedModel().averageCurrent(QmBatteryModel::Idle);
+        else if (usageMode == USETIME_MODE_ACTIVE)
+            result = sharedModel().averageCurrent(QmBatteryModel::Active);
+    }
     if (result < 0)
 	result = defaultCurrent;
-    
+
     return result;
 }
 
-int QmBatteryPrivate::getRemainingTime(int usageMode,
-				       QmBattery::RemainingTimeMode psMode,
-				       int defaultCurrent) const
+int QmBatteryPrivate::getAverageCurrent(int usageMode,
+					QmBattery::RemainingTimeMode psMode,
+					int defaultCurrent) const
 {
-    int current = getAverageCurrent(usageMode, psMode, defaultCurrent);
+    return averageCurrent_(usageMode, usetimeCurrent_(usageMode, psMode), defaultCurrent);
+}
+
+int QmBatteryPrivate::remainingTime_(int usageMode,
+                                     QmBattery::RemainingTimeMode psMode,
+                                     int usetimeCurrent, int defaultCurrent) const
+{
+    QMutexLocker locker(&ipc_mutex_);
+    UsetimeCacheEntry &entry = remaining_time_[usetimeCacheIndex_(usageMode, psMode)];
+    if (entry.valid)
+        return entry.value;
+
+    int current = averageCurrent_(usageMode, usetimeCurrent, defaultCurrent);
+
+    if (usetimeCurrent < 0) {
+        /* Without the usetime daemon the learned discharge curve is used */
+        int time;
+        {
+            QMutexLocker modelLocker(&modelMutex);
+            time = sharedModel().remainingTime(current);
+        }
+        if (time >= 0) {
+            entry.value = time;
+            entry.valid = true;
+            return time;
+        }
+    }
+
+    if (!ipc_->open())
+        return -1;
 
     union emsg_usetime_info msg;
     memset(&msg, 0, sizeof(msg));
@@ -469,16 +887,29 @@ int QmBatteryPrivate::getRemainingTime(int usageMode,
     qDebug() << __FUNCTION__ << usageMode << psMode
 	     << "current (mA):" << current
 	     << "remaining time (s):" << msg.reply.time;
-    
+
+    entry.value = msg.reply.time;
+    entry.valid = true;
     return msg.reply.time;
 }
 
-int QmBatteryPrivate::makeUsetimeQuery(const QString& method, int usageMode,
-				       QmBattery::RemainingTimeMode psMode)
-    const
+int QmBatteryPrivate::getRemainingTime(int usageMode,
+				       QmBattery::RemainingTimeMode psMode,
+				       int defaultCurrent) const
+{
+    {
+        QMutexLocker locker(&ipc_mutex_);
+        UsetimeCacheEntry &entry = remaining_time_[usetimeCacheIndex_(usageMode, psMode)];
+        if (entry.valid)
+            return entry.value;
+    }
+    return remainingTime_(usageMode, psMode, usetimeCurrent_(usageMode, psMode),
+                          defaultCurrent);
+}
+
+QDBusMessage QmBatteryPrivate::usetimeMessage_(const QString& method, int usageMode,
+                                              QmBattery::RemainingTimeMode psMode)
 {
-    int result = -1;
-    
     QDBusMessage msg = QDBusMessage::createMethodCall(
 	USETIME_SERVICE, USETIME_PATH, USETIME_IF, method);
     
@@ -489,31 +920,148 @@ int QmBatteryPrivate::makeUsetimeQuery(const QString& method, int usageMode,
     else 
 	args << 0;
     msg.setArguments(args);
-    
-    QDBusReply<int> tReply = QDBusConnection::systemBus().call(msg);
-    if(tReply.isValid()) {
-	result = tReply.value();
-    } else {
-	/**
-	 * @note The following error means that the usetime package
-	 *       is not installed or that the usetime daemon is not
-	 *       running.
-	 *
-	 * 4 QDBusError::ServiceUnknown
-	 * "org.freedesktop.DBus.Error.ServiceUnknown"
-	 * "The name com.nokia.usetime was not provided by any
-	 * .service files"
-	 */
-	qDebug() << "No use time estimate available"
-		 << method << usageMode << psMode;
-	if (tReply.error().isValid()) {
-	    qDebug() << tReply.error().type()
-		     << tReply.error().name()
-		     << tReply.error().message();
-	}
+    return msg;
+}
+
+void QmBatteryPrivate::usetimeError_(const QDBusError& error, int usageMode,
+                                     QmBattery::RemainingTimeMode psMode) const
+{
+    /**
+     * @note The following error means that the usetime package
+     *       is not installed or that the usetime daemon is not
+     *       running.
+     *
+     * 4 QDBusError::ServiceUnknown
+     * "org.freedesktop.DBus.Error.ServiceUnknown"
+     * "The name com.nokia.usetime was not provided by any
+     * .service files"
+     *
+     * It is remembered until the service gets registered, so that a
+     * missing daemon costs one call instead of one per query.
+     */
+    qDebug() << "No use time estimate available" << usageMode << psMode;
+    if (error.isValid()) {
+        qDebug() << error.type() << error.name() << error.message();
+        if (error.type() == QDBusError::ServiceUnknown)
+            usetime_unknown_ = true;
     }
-    
-    return result;
+}
+
+int QmBatteryPrivate::makeUsetimeQuery(const QString& method, int usageMode,
+				       QmBattery::RemainingTimeMode psMode)
+    const
+{
+    QDBusReply<int> tReply = QmIPCInterface::callMessage(
+        usetimeMessage_(method, usageMode, psMode));
+    if (tReply.isValid())
+	return tReply.value();
+
+    QMutexLocker locker(&ipc_mutex_);
+    usetimeError_(tReply.error(), usageMode, psMode);
+    return -1;
+}
+
+void QmBatteryPrivate::requestRemainingTimes(QmBattery::RemainingTimeMode psMode)
+{
+    QMutexLocker locker(&ipc_mutex_);
+    requested_times_[psMode == QmBattery::PowersaveMode ? 1 : 0] = true;
+
+    for (unsigned i = 0; i < sizeof(usetimeModes) / sizeof(usetimeModes[0]); i++) {
+        int index = usetimeCacheIndex_(usetimeModes[i], psMode);
+        UsetimeCacheEntry &carried = requested_current_[index];
+        if (carried.valid || usetime_pending_[index])
+            continue;
+        if (usetime_unknown_ || usetime_current_[index].valid) {
+            carried.value = usetime_unknown_ ? -1 : usetime_current_[index].value;
+            carried.valid = true;
+            continue;
+        }
+
+        QDBusPendingCallWatcher *watcher = QmIPCInterface::asyncCallMessage(
+            usetimeMessage_(USETIME_METHOD_GET_CURRENT, usetimeModes[i], psMode), this);
+        watcher->setProperty("usageMode", usetimeModes[i]);
+        watcher->setProperty("psMode", (int)psMode);
+        watcher->setProperty("generation", usetime_generation_);
+        connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)),
+                this, SLOT(onUsetimeReply(QDBusPendingCallWatcher*)));
+        usetime_pending_[index] = true;
+    }
+
+    // Results are always delivered from the event loop
+    QTimer::singleShot(0, this, SLOT(completeRemainingTimes()));
+}
+
+void QmBatteryPrivate::onUsetimeReply(QDBusPendingCallWatcher *watcher)
+{
+    int usageMode = watcher->property("usageMode").toInt();
+    QmBattery::RemainingTimeMode psMode =
+        (QmBattery::RemainingTimeMode)watcher->property("psMode").toInt();
+    int index = usetimeCacheIndex_(usageMode, psMode);
+
+    QDBusPendingReply<int> reply = *watcher;
+    QMutexLocker locker(&ipc_mutex_);
+    int value = -1;
+    if (reply.isValid())
+        value = reply.value();
+    else
+        usetimeError_(reply.error(), usageMode, psMode);
+
+    /* The request completes with the reply even if the cache was invalidated */
+    requested_current_[index].value = value;
+    requested_current_[index].valid = true;
+    if (watcher->property("generation").toInt() == usetime_generation_) {
+        usetime_current_[index].value = value;
+        usetime_current_[index].valid = true;
+    }
+    usetime_pending_[index] = false;
+    locker.unlock();
+    watcher->deleteLater();
+
+    completeRemainingTimes();
+}
+
+void QmBatteryPrivate::completeRemainingTimes()
+{
+    for (int ps = 0; ps < 2; ps++) {
+        QMutexLocker locker(&ipc_mutex_);
+        if (!requested_times_[ps])
+            continue;
+
+        QmBattery::RemainingTimeMode psMode =
+            ps ? QmBattery::PowersaveMode : QmBattery::NormalMode;
+        int currents[3];
+        bool ready = true;
+        for (int i = 0; i < 3; i++) {
+            UsetimeCacheEntry &carried = requested_current_[usetimeCacheIndex_(usetimeModes[i], psMode)];
+            ready = ready && carried.valid;
+            currents[i] = carried.value;
+        }
+        if (!ready)
+            continue;
+
+        requested_times_[ps] = false;
+        for (int i = 0; i < 3; i++)
+            requested_current_[usetimeCacheIndex_(usetimeModes[i], psMode)].valid = false;
+        locker.unlock();
+
+        // The BME use time query blocks, it is made by the worker
+        if (usetime_worker_.isNull())
+            usetime_worker_.reset(new QmBatteryUsetimeWorker(this));
+        usetime_worker_->request(psMode, currents);
+    }
+}
+
+void QmBatteryPrivate::onRemainingTimes(int psMode, int talk, int active, int idle)
+{
+    emit parent_->remainingTimesAvailable((QmBattery::RemainingTimeMode)psMode,
+                                          talk, active, idle);
+}
+
+void QmBatteryPrivate::onUsetimeRegistered(const QString &/*service*/)
+{
+    QMutexLocker locker(&ipc_mutex_);
+    usetime_unknown_ = false;
+    invalidateUsetimeCache_();
 }
 
 
@@ -562,85 +1110,141 @@ bool QmBatteryPrivate::stopCurrentMeasurement()
 
 void QmBatteryPrivate::onMeasurement(int /*socket*/)
 {
-    bool rc;
-    int current;
-
     if (measurements_.isNull()) {
         qWarning() << "onMeasurement: null";
         return;
     }
 
-    rc = measurements_->measure(current);
-    emit parent_->batteryCurrent(current);
+    QVector<QmBatteryMeasurement> samples;
+    if (measurements_->measure(samples) == 0)
+        return;
+
+    foreach (const QmBatteryMeasurement &sample, samples) {
+        emit parent_->batteryCurrent(sample.current);
+    }
+    emit parent_->batteryMeasurements(samples);
 }
 
-void QmBatteryPrivate::emitEventBatmon_()
+void QmBatteryPrivate::emitEventBatmon_(const bmestat_t &stat)
 {
-    queryStat_();
-
     bool is_level_changed 
-        = (saved_stat_[BATTERY_LEVEL_PCT] != stat_[BATTERY_LEVEL_PCT]
-           || saved_stat_[BATTERY_LEVEL_NOW] != stat_[BATTERY_LEVEL_NOW]);
+        = (saved_stat_[BATTERY_LEVEL_PCT] != stat[BATTERY_LEVEL_PCT]
+           || saved_stat_[BATTERY_LEVEL_NOW] != stat[BATTERY_LEVEL_NOW]);
 
-    bool is_state_changed = (saved_stat_[BATTERY_STATE] != stat_[BATTERY_STATE]);
+    bool is_state_changed = (saved_stat_[BATTERY_STATE] != stat[BATTERY_STATE]);
 
     // No signal for charging time changed, emit RemainingCapacityChanged
     bool is_charging_time_changed = (saved_stat_[CHARGING_TIME] !=
-				     stat_[CHARGING_TIME]);
+				     stat[CHARGING_TIME]);
 
     if (is_level_changed || is_state_changed || is_charging_time_changed)
-        saveStat_();
+        memcpy(&saved_stat_, &stat, sizeof(saved_stat_));
 
     if (is_level_changed || is_charging_time_changed) {
         emit parent_->batteryRemainingCapacityChanged
-            (stat_[BATTERY_LEVEL_PCT], stat_[BATTERY_LEVEL_NOW]);
+            (stat[BATTERY_LEVEL_PCT], stat[BATTERY_LEVEL_NOW]);
         /* ToDo: Depreciated, remove when possible */
-        emit parent_->batteryEnergyLevelChanged(stat_[BATTERY_LEVEL_PCT]);
+        emit parent_->batteryEnergyLevelChanged(stat[BATTERY_LEVEL_PCT]);
     }
 
     if (is_state_changed)
-        emit parent_->batteryStateChanged((QmBattery::BatteryState)stat_[BATTERY_STATE]);
+        emit parent_->batteryStateChanged((QmBattery::BatteryState)stat[BATTERY_STATE]);
+}
+
+void QmBatteryPrivate::onChargerChanged_(const bmestat_t &stat)
+{
+    QmBattery::ChargerType type = toChargerType(stat[CHARGER_TYPE]);
+
+    if (type == QmBattery::USB_100mA) {
+        /*
+         * A USB host gives 100 mA until the device has been configured,
+         * usually raised to 500 mA within a few seconds. Report it right
+         * away, but as settled only if nothing better turns up.
+         */
+        if (charger_negotiation_ != ChargerNegotiating) {
+            charger_negotiation_ = ChargerNegotiating;
+            charger_timer_.start();
+        }
+        emit parent_->chargerEvent(type);
+        return;
+    }
+
+    charger_timer_.stop();
+    charger_negotiation_ = ChargerSettled;
+    emit parent_->chargerEvent(type);
+    emit parent_->chargerSettled(type);
 }
 
-void QmBatteryPrivate::waitForUSB500mA()
+void QmBatteryPrivate::onChargerSettled()
 {
-    // USB 500 event didn't come. Emit the delayed signals.
-    timer->stop();
-    emit parent_->chargerEvent(parent_->getChargerType());
-    emit parent_->chargingStateChanged(parent_->getChargingState());
+    if (charger_negotiation_ != ChargerNegotiating)
+        return;
+    charger_negotiation_ = ChargerSettled;
+
+    bmestat_t stat;
+    int cc_offset;
+    getStats(stat, cc_offset);
+
+    emit parent_->chargerSettled(toChargerType(stat[CHARGER_TYPE]));
 }
 
 void QmBatteryPrivate::onEmEvent(int /*socket*/)
 {
-    is_data_actual_ = false;
+    stat_events_.ref();
     int events = events_->read();
+    if (events == BMEVENT_ERROR) {
+        /* The connection is lost when BME restarts, subscribe again */
+        events_->close();
+        if (events_->open())
+            connect(events_->notifier(), SIGNAL(activated(int))
+                    , this, SLOT(onEmEvent(int)));
+        return;
+    }
+    if (!((BMEVENT_CHARGER | BMEVENT_CHARGE | BMEVENT_BATMON) & events))
+        return;
+
+    /* The use time estimates depend on the battery level and charger */
+    if ((BMEVENT_CHARGER | BMEVENT_BATMON) & events)
+        invalidateUsetimeCache_();
+
+    /* Everything below is derived from one stat query */
+    bmestat_t stat;
+    int cc_offset;
+    getStats(stat, cc_offset);
+
     if (BMEVENT_CHARGER & events) {
         qDebug() << "BMEVENT_CHARGER";
-        switch (getStat(CHARGER_TYPE)) {
-        case CHARGER_TYPE_USB100MA:
-            timer->start(4000);
-            break;
-        default:
-            if (timer->isActive()) timer->stop();
-            emit parent_->chargerEvent(parent_->getChargerType());
-            if (usb100ma_emit_delayed == 1) {
-                emit parent_->chargingStateChanged(parent_->getChargingState());
-                usb100ma_emit_delayed = 0;
-            }
-        }
+        onChargerChanged_(stat);
     }
     if (BMEVENT_CHARGE & events) {
         qDebug() << "BMEVENT_CHARGING";
-        //when usb100ma_emit_delayed is 1, means we missed one charging state signal. when timer is active, means waiting for usb500
-        if (timer->isActive()) { usb100ma_emit_delayed = 1; return;}
-        emit parent_->chargingStateChanged(parent_->getChargingState());
+        emit parent_->chargingStateChanged(toChargingState(stat[CHARGING_STATE]));
     }
     if (BMEVENT_BATMON & events) {
         qDebug() << "BMEVENT_BATMON";
-        emitEventBatmon_();
+        emitEventBatmon_(stat);
     }
 }
 
+/*------------ class QmBatterySnapshot Implementation ------------*/
+
+QmBatterySnapshot::QmBatterySnapshot()
+    : nominalCapacity(0),
+      batteryState(QmBattery::StateError),
+      remainingCapacitymAh(0),
+      remainingCapacityPct(0),
+      remainingCapacityBars(0),
+      maxBars(0),
+      voltage(0),
+      batteryCurrent(0),
+      cumulativeBatteryCurrent(0),
+      chargerType(QmBattery::Unknown),
+      chargingState(QmBattery::StateChargingFailed),
+      remainingChargingTime(-1),
+      batteryCondition(QmBattery::ConditionUnknown)
+{
+}
+
 /*------------ class QmBattery Implementation ------------*/
 
 QmBattery::QmBattery(QObject *parent)
@@ -661,6 +1265,8 @@ QmBattery::QmBattery(QObject *parent)
         ("MeeGo::QmBattery::RemainingTimeMode");
     qRegisterMetaType < Period >
         ("MeeGo::QmBattery::Period");
+    qRegisterMetaType < QVector<QmBatteryMeasurement> >
+        ("QVector<MeeGo::QmBatteryMeasurement>");
 
     /* Depreceated, use BatteryState */
     qRegisterMetaType < Level >
@@ -676,19 +1282,7 @@ int QmBattery::getNominalCapacity() const
 
 QmBattery::BatteryState QmBattery::getBatteryState() const
 {
-    switch (pimpl_->getStat(BATTERY_STATE)) {
-    case BATTERY_STATE_EMPTY:
-        return StateEmpty;
-    case BATTERY_STATE_LOW:
-        return StateLow;
-    case BATTERY_STATE_OK:
-        return StateOK;
-    case BATTERY_STATE_FULL:
-        return StateFull;
-    case BATTERY_STATE_ERROR:
-    default:
-        return StateError;
-    }
+    return toBatteryState(pimpl_->getStat(BATTERY_STATE));
 }
 
 int QmBattery::getRemainingCapacitymAh() const
@@ -728,42 +1322,23 @@ int QmBattery::getCumulativeBatteryCurrent() const
 
 QmBattery::ChargerType QmBattery::getChargerType() const
 {
-    switch (pimpl_->getStat(CHARGER_TYPE)) {
-    case CHARGER_TYPE_USB100MA:
-        return USB_100mA;
-    case CHARGER_TYPE_USB500MA:
-        return USB_500mA;
-    case CHARGER_TYPE_USBWALL:
-    case CHARGER_TYPE_DYNAMO:
-        return Wall;
-    case CHARGER_TYPE_NONE:
-        return None;
-    case CHARGER_TYPE_ERROR:
-    default:
-        return Unknown;
-    }
+    return toChargerType(pimpl_->getStat(CHARGER_TYPE));
 }
 
 QmBattery::ChargingState QmBattery::getChargingState() const
 {
-    switch (pimpl_->getStat(CHARGING_STATE)) {
-    case CHARGING_STATE_STOPPED:
-        return StateNotCharging;
-    case CHARGING_STATE_STARTED:
-        return StateCharging;
-    case CHARGING_STATE_ERROR:
-    default:
-        return StateChargingFailed;
-    }
+    return toChargingState(pimpl_->getStat(CHARGING_STATE));
 }
 
 int QmBattery::getRemainingChargingTime() const
 {
-    if (pimpl_->getStat(CHARGING_STATE) == CHARGING_STATE_STARTED) {
-	return pimpl_->getStat(CHARGING_TIME) * 60;
-    } else {
-	return -1;
-    }
+    int state = pimpl_->getStat(CHARGING_STATE);
+    return toRemainingChargingTime(state, pimpl_->getStat(CHARGING_TIME));
+}
+
+void QmBattery::requestRemainingTimes(RemainingTimeMode mode)
+{
+    pimpl_->requestRemainingTimes(mode);
 }
 
 bool QmBattery::startCurrentMeasurement(Period rate)
@@ -814,14 +1389,31 @@ int QmBattery::getRemainingIdleTime(QmBattery::RemainingTimeMode mode) const
 
 QmBattery::BatteryCondition QmBattery::getBatteryCondition() const
 {
-    switch (pimpl_->getStat(BATTERY_CONDITION)) {
-    case BATTERY_CONDITION_GOOD:
-	return ConditionGood;
-    case BATTERY_CONDITION_POOR:
-	return ConditionPoor;
-    default:
-	return ConditionUnknown;
-    }
+    return toBatteryCondition(pimpl_->getStat(BATTERY_CONDITION));
+}
+
+QmBatterySnapshot QmBattery::snapshot() const
+{
+    bmestat_t stat;
+    int cc_offset;
+    pimpl_->getStats(stat, cc_offset);
+
+    QmBatterySnapshot result;
+    result.nominalCapacity = stat[BATTERY_CAPA_MAX];
+    result.batteryState = toBatteryState(stat[BATTERY_STATE]);
+    result.remainingCapacitymAh = stat[BATTERY_CAPA_NOW];
+    result.remainingCapacityPct = stat[BATTERY_LEVEL_PCT];
+    result.remainingCapacityBars = stat[BATTERY_LEVEL_NOW];
+    result.maxBars = stat[BATTERY_LEVEL_MAX];
+    result.voltage = stat[BATTERY_VOLT_NOW];
+    result.batteryCurrent = stat[BATTERY_CURRENT];
+    result.cumulativeBatteryCurrent = stat[COULOMB_COUNTER] + cc_offset;
+    result.chargerType = toChargerType(stat[CHARGER_TYPE]);
+    result.chargingState = toChargingState(stat[CHARGING_STATE]);
+    result.remainingChargingTime = toRemainingChargingTime(stat[CHARGING_STATE],
+                                                           stat[CHARGING_TIME]);
+    result.batteryCondition = toBatteryCondition(stat[BATTERY_CONDITION]);
+    return result;
 }
 
 int QmBattery::getBatteryEnergyLevel() const
@@ -40,12 +40,29 @@
 #include "system_global.h"
 #include <QList>
 #include <QScopedPointer>
+#include <QVector>
 
 QT_BEGIN_HEADER
 
 namespace MeeGo {
 
 class QmBatteryPrivate;
+class QmBatterySnapshot;
+
+/*!
+ * @scope Nokia Meego
+ *
+ * @class QmBatteryMeasurement
+ * @brief One sample of the battery current measurement.
+ */
+class QmBatteryMeasurement
+{
+public:
+    quint64 timestamp; //!< Time of the sample as reported by BME (us)
+    int current;       //!< Battery current (mA), positive when discharging
+    int voltage;       //!< Battery voltage (mV)
+    int temperature;   //!< Battery temperature (K)
+};
 
 /*!
  *
@@ -53,6 +70,19 @@ class QmBatteryPrivate;
  *
  * @class QmBattery
  * @brief QmBattery provides information on device battery status.
+ *
+ * The average currents and remaining times come from the usetime daemon
+ * when it is available. Otherwise they are estimated from a discharge
+ * model QmBattery learns on the device and keeps in
+ * ~/.qmsystem2/battery-model, or from fixed defaults until the model has
+ * learned enough. The QmBattery objects of a process share the model, it
+ * is written a few seconds after it changed, from the event loop of the
+ * thread a QmBattery was created in, and when a QmBattery is destroyed.
+ *
+ * The getters and snapshot() may be called from any thread. Battery status
+ * is cached and refreshed from the battery management daemon by one thread
+ * at a time, other readers never block on the refresh. Signals are emitted
+ * in the thread the QmBattery object lives in.
  */
 class MEEGO_SYSTEM_EXPORT QmBattery : public QObject
 {
@@ -253,7 +283,8 @@ public:
     /*!
      * @brief Starts the battery current measurement.
      *
-     * @param rate  The rate of sending the signal (batteryCurrent)
+     * @param rate  The rate of sending the signals (batteryCurrent,
+     *              batteryMeasurements)
      *              Use enums (RATE_250ms, RATE_1000ms, RATE_5000ms)
      *
      * @retval  TRUE   success
@@ -329,6 +360,18 @@ public:
      */
     int getRemainingIdleTime(RemainingTimeMode mode) const;
 
+    /*!
+     * @brief Requests the remaining talk, active and idle times without
+     * blocking.
+     * @details The result is sent with remainingTimesAvailable() from the
+     * event loop, also when it is already known. The usetime daemon is
+     * called asynchronously and BME is queried from a worker thread.
+     *
+     * @param mode: (PowersaveMode/Normal ) mode in which the remaining
+     *               times are to be estimated.
+     */
+    void requestRemainingTimes(RemainingTimeMode mode);
+
     /*!
      * @brief Gets the battery condition.
      *
@@ -336,6 +379,16 @@ public:
      */
     BatteryCondition getBatteryCondition() const;
 
+    /*!
+     * @brief Gets the values of all the battery status getters at once.
+     * @details The values are taken from one battery status query, so they
+     * are consistent with each other, which is not guaranteed when calling
+     * the individual getters one after another.
+     *
+     * @return The battery status as QmBatterySnapshot
+     */
+    QmBatterySnapshot snapshot() const;
+
     /*!
      * @deprecated Deprecated, use getRemainingCapacityPct()
      */
@@ -378,10 +431,23 @@ Q_SIGNALS:
     /*!
      * @brief Sent when a charger event has occurred (charger plugged / unplugged).
      *
+     * A USB charger is first reported as USB_100mA, which changes to
+     * USB_500mA a moment later if the USB host allows it. See
+     * chargerSettled().
+     *
      * @param chargerType  The new connected charger type (or None)
      */
     void chargerEvent(MeeGo::QmBattery::ChargerType chargerType);
 
+    /*!
+     * @brief Sent when the charger type is final, right after chargerEvent()
+     * or, for USB_100mA, when the USB current negotiation has not raised it
+     * within a few seconds.
+     *
+     * @param chargerType  The connected charger type (or None)
+     */
+    void chargerSettled(MeeGo::QmBattery::ChargerType chargerType);
+
     /*!
      * @brief Sent at desired interval when battery current measurement is enabled
      * (see startCurrentMeasurement)
@@ -390,6 +456,28 @@ Q_SIGNALS:
      */
     void batteryCurrent(int current);
 
+    /*!
+     * @brief Sent when battery current measurement is enabled (see
+     * startCurrentMeasurement) with all the samples received since the
+     * previous emission, oldest first.
+     *
+     * @details batteryCurrent(int) is still sent for each of the samples.
+     *
+     * @param measurements The received samples
+     */
+    void batteryMeasurements(const QVector<MeeGo::QmBatteryMeasurement> &measurements);
+
+    /*!
+     * @brief Sent in reply to requestRemainingTimes().
+     *
+     * @param mode       The mode the times were estimated in
+     * @param talkTime   Talk time in seconds or -1 if not known
+     * @param activeTime Active time in seconds or -1 if not known
+     * @param idleTime   Idle time in seconds or -1 if not known
+     */
+    void remainingTimesAvailable(MeeGo::QmBattery::RemainingTimeMode mode,
+                                 int talkTime, int activeTime, int idleTime);
+
     /*!
      * @deprecated Deprecated, use batteryRemainingCapacityChanged(int, int)
      */
@@ -411,6 +499,35 @@ private:
     QScopedPointer<QmBatteryPrivate> pimpl_;
 };
 
+/*!
+ * @scope Nokia Meego
+ *
+ * @class QmBatterySnapshot
+ * @brief Battery status returned by QmBattery::snapshot().
+ *
+ * Each field holds the value the QmBattery getter of the same name would
+ * return.
+ */
+class MEEGO_SYSTEM_EXPORT QmBatterySnapshot
+{
+public:
+    QmBatterySnapshot();
+
+    int nominalCapacity;                          //!< See QmBattery::getNominalCapacity()
+    QmBattery::BatteryState batteryState;         //!< See QmBattery::getBatteryState()
+    int remainingCapacitymAh;                     //!< See QmBattery::getRemainingCapacitymAh()
+    int remainingCapacityPct;                     //!< See QmBattery::getRemainingCapacityPct()
+    int remainingCapacityBars;                    //!< See QmBattery::getRemainingCapacityBars()
+    int maxBars;                                  //!< See QmBattery::getMaxBars()
+    int voltage;                                  //!< See QmBattery::getVoltage()
+    int batteryCurrent;                           //!< See QmBattery::getBatteryCurrent()
+    int cumulativeBatteryCurrent;                 //!< See QmBattery::getCumulativeBatteryCurrent()
+    QmBattery::ChargerType chargerType;           //!< See QmBattery::getChargerType()
+    QmBattery::ChargingState chargingState;       //!< See QmBattery::getChargingState()
+    int remainingChargingTime;                    //!< See QmBattery::getRemainingChargingTime()
+    QmBattery::BatteryCondition batteryCondition; //!< See QmBattery::getBatteryCondition()
+};
+
 } // MeeGo namespace
 
 QT_END_HEADER
@@ -35,30 +35,73 @@
 
 #include <QtCore/qobject.h>
 #include <QThread>
-#include <QDateTime>
+#include <QAtomicInt>
+#include <QMutex>
 #include <QScopedPointer>
 #include <QTimer>
+#include <QWaitCondition>
+#include <QDBusMessage>
+#include <QDBusError>
 
 #include <mqueue.h>
 #include <time.h>
 #include <sys/time.h>
 #include <sys/poll.h>
 #include "qmbattery.h"
+#include "qmbatterymodel_p.h"
 
 extern "C" {
 #include "bme/bmeipc.h"
 }
 
+class QDBusPendingCallWatcher;
+class QDBusServiceWatcher;
+
+/* Use time estimates cached for each usage mode and power save mode */
+#define USETIME_CACHE_SIZE 6
+
 namespace MeeGo {
 
 class EmIpc;
 class EmEvents;
 class EmCurrentMeasurement;
+class QmBatteryPrivate;
+
+/*
+ * Computes the remaining times of requestRemainingTimes() outside the
+ * thread of QmBattery, as the EM_BATTERY_USETIME_REQ query of BME blocks.
+ * The results are sent back to the QmBatteryPrivate through its event loop.
+ */
+class QmBatteryUsetimeWorker : public QThread
+{
+public:
+    QmBatteryUsetimeWorker(QmBatteryPrivate *priv);
+    ~QmBatteryUsetimeWorker();
+
+    /* currents are the talk, active and idle replies of the usetime daemon */
+    void request(QmBattery::RemainingTimeMode psMode, const int currents[3]);
+
+protected:
+    void run();
+
+private:
+    struct Job {
+        QmBattery::RemainingTimeMode psMode;
+        int currents[3];
+    };
+
+    QmBatteryPrivate *priv_;
+    QMutex mutex_;
+    QWaitCondition changed_;
+    QList<Job> jobs_;
+    bool stopping_;
+};
 
 class QmBatteryPrivate : public QObject
 {
     Q_OBJECT
     MEEGO_DECLARE_PUBLIC(QmBattery)
+    friend class QmBatteryUsetimeWorker;
 
 public:
     QmBatteryPrivate();
@@ -71,29 +114,74 @@ public:
 
     int getStat(int) const;
     int getCumulativeBatteryCurrent();
+    void getStats(bmestat_t &stat, int &cc_offset) const;
     int getAverageCurrent(int usageMode, QmBattery::RemainingTimeMode psMode,
 			  int defaultCurrent) const;
     int getRemainingTime(int usageMode, QmBattery::RemainingTimeMode psMode,
 			 int defaultCurrent) const;
+    void requestRemainingTimes(QmBattery::RemainingTimeMode psMode);
 
 private Q_SLOTS:
     void onEmEvent(int);
     void onMeasurement(int);
-    void waitForUSB500mA();
+    void onChargerSettled();
+    void onUsetimeReply(QDBusPendingCallWatcher *watcher);
+    void onUsetimeRegistered(const QString &service);
+    void completeRemainingTimes();
+    void onRemainingTimes(int psMode, int talk, int active, int idle);
+    void scheduleModelSave();
+    void saveModel();
 
 private:
-    void queryStat_() const;
-    void emitEventBatmon_();
+    void queryStat_(bool isVolatile = false) const;
+    bool isFresh_(bool isVolatile) const;
+    int readBegin_() const;
+    bool readRetry_(int seq) const;
+    static bool isVolatileStat_(int index);
+    static time_t monotonicTime_();
+    void emitEventBatmon_(const bmestat_t &stat);
+    void onChargerChanged_(const bmestat_t &stat);
     void saveStat_();
 
+    int usetimeCurrent_(int usageMode, QmBattery::RemainingTimeMode psMode) const;
+    int averageCurrent_(int usageMode, int usetimeCurrent, int defaultCurrent) const;
+    int remainingTime_(int usageMode, QmBattery::RemainingTimeMode psMode,
+                       int usetimeCurrent, int defaultCurrent) const;
     int makeUsetimeQuery(const QString& method, int usageMode,
 			 QmBattery::RemainingTimeMode psMode) const;
+    static QDBusMessage usetimeMessage_(const QString& method, int usageMode,
+                                        QmBattery::RemainingTimeMode psMode);
+    void usetimeError_(const QDBusError& error, int usageMode,
+                       QmBattery::RemainingTimeMode psMode) const;
+    static int usetimeCacheIndex_(int usageMode, QmBattery::RemainingTimeMode psMode);
+    void invalidateUsetimeCache_();
 
     QmBattery *parent_;
 
+    /*
+     * The stat cache can be read from any thread without locking. It is
+     * published with a sequence lock: stat_seq_ is odd while a refresh
+     * writes stat_, stat_cc_offset_, stat_time_ and stat_generation_, and
+     * readers retry if it changed during their read. Refreshes are
+     * serialized by ipc_mutex_.
+     *
+     * BME events count up stat_events_. A refresh publishes the count it
+     * saw before its query, so the cache is fresh only if no event has
+     * arrived since then.
+     */
+    mutable QAtomicInt stat_seq_;
+    QAtomicInt stat_events_;
     mutable bmestat_t stat_;
-    mutable bool is_data_actual_;
-    mutable QDateTime cache_expire_;
+    mutable int stat_cc_offset_;
+    mutable time_t stat_time_; /* CLOCK_MONOTONIC seconds of the last query */
+    mutable int stat_generation_; /* stat_events_ before the last query */
+
+    /*
+     * Guards ipc_ and everything below that getters on other threads may
+     * touch: the coulomb counter offset and the use time caches. It is
+     * never held across a D-Bus call, nor while the model file is written.
+     */
+    mutable QMutex ipc_mutex_;
 
     mutable int cc_offset_;
     mutable int prev_cc_restart_count_;
@@ -102,8 +190,37 @@ private:
     QScopedPointer<EmIpc> ipc_;
     QScopedPointer<EmEvents> events_;
     QScopedPointer<EmCurrentMeasurement> measurements_;
-    QTimer *timer;
-    int usb100ma_emit_delayed;
+
+    /*
+     * A USB charger is first reported at 100 mA and changes to 500 mA when
+     * the host has configured the device. Every charger event is reported
+     * right away, the 100 mA type settles when charger_timer_ expires
+     * without a change.
+     */
+    enum ChargerNegotiation {
+        ChargerSettled,
+        ChargerNegotiating
+    };
+    ChargerNegotiation charger_negotiation_;
+    QTimer charger_timer_;
+
+    /* Delays the write of the shared discharge model after it learned */
+    QTimer model_timer_;
+
+    struct UsetimeCacheEntry {
+        bool valid;
+        int value;
+    };
+    mutable UsetimeCacheEntry usetime_current_[USETIME_CACHE_SIZE];
+    mutable UsetimeCacheEntry remaining_time_[USETIME_CACHE_SIZE];
+    mutable bool usetime_unknown_; /* usetime daemon is not available */
+    int usetime_generation_; /* counts the invalidations of the caches */
+    bool usetime_pending_[USETIME_CACHE_SIZE];
+    bool requested_times_[2];
+    /* The usetime daemon replies for the requested times, kept until completion */
+    UsetimeCacheEntry requested_current_[USETIME_CACHE_SIZE];
+    QScopedPointer<QmBatteryUsetimeWorker> usetime_worker_;
+    QDBusServiceWatcher *usetime_watcher_;
 };
 
 } /* MeeGo */
@@ -143,11 +143,41 @@ namespace MeeGo
         return 0;
     }
 
+    void QmBattery::requestRemainingTimes(RemainingTimeMode mode)
+    {
+        qRegisterMetaType<RemainingTimeMode>("MeeGo::QmBattery::RemainingTimeMode");
+        QMetaObject::invokeMethod(this, "remainingTimesAvailable", Qt::QueuedConnection,
+                                  Q_ARG(MeeGo::QmBattery::RemainingTimeMode, mode),
+                                  Q_ARG(int, 0), Q_ARG(int, 0), Q_ARG(int, 0));
+    }
+
     QmBattery::BatteryCondition QmBattery::getBatteryCondition() const
     {
         return QmBattery::ConditionUnknown;
     }
 
+    QmBatterySnapshot::QmBatterySnapshot()
+        : nominalCapacity(0),
+          batteryState(QmBattery::StateError),
+          remainingCapacitymAh(0),
+          remainingCapacityPct(0),
+          remainingCapacityBars(0),
+          maxBars(0),
+          voltage(0),
+          batteryCurrent(0),
+          cumulativeBatteryCurrent(0),
+          chargerType(QmBattery::Unknown),
+          chargingState(QmBattery::StateChargingFailed),
+          remainingChargingTime(0),
+          batteryCondition(QmBattery::ConditionUnknown)
+    {
+    }
+
+    QmBatterySnapshot QmBattery::snapshot() const
+    {
+        return QmBatterySnapshot();
+    }
+
     int QmBattery::getBatteryEnergyLevel() const
     {
         return 0;
@@ -0,0 +1,241 @@
+/*!
+ * @file qmbatterymodel.cpp
+ * @brief QmBatteryModel
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#include "qmbatterymodel_p.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MODEL_FILE_ENV     "QMSYSTEM_BATTERY_MODEL_FILE"
+#define MODEL_FILE_DEFAULT "/.qmsystem2/battery-model"
+#define MODEL_VERSION      1
+
+/* Weight of a new observation in the moving averages */
+#define MODEL_ALPHA        0.2
+/* Average currents below this are considered idle use (mA) */
+#define MODEL_IDLE_CURRENT 30
+/* Larger level drops between two updates are not trusted (%) */
+#define MODEL_MAX_DROP     5
+/* Sanity limit for one percent of the battery (mAh) */
+#define MODEL_MAX_MAH_PER_PCT 1000.0
+
+namespace MeeGo {
+
+static inline int bucketOf(int pct)
+{
+    int bucket = pct * BATTERY_MODEL_BUCKETS / 100;
+    if (bucket < 0)
+        return 0;
+    if (bucket >= BATTERY_MODEL_BUCKETS)
+        return BATTERY_MODEL_BUCKETS - 1;
+    return bucket;
+}
+
+static inline void smooth(double &average, double value)
+{
+    if (average <= 0.0)
+        average = value;
+    else
+        average += MODEL_ALPHA * (value - average);
+}
+
+QmBatteryModel::QmBatteryModel()
+    : changed_(false), pct_(-1), capa_(0), refPct_(-1), refCapa_(0), refCc_(0), refTime_(0)
+{
+    const char *env = getenv(MODEL_FILE_ENV);
+    if (env && *env) {
+        path_ = QString::fromLocal8Bit(env);
+    } else {
+        path_ = QDir::homePath() + MODEL_FILE_DEFAULT;
+    }
+
+    for (int i = 0; i < BATTERY_MODEL_BUCKETS; i++)
+        mAhPerPct_[i] = 0.0;
+    for (int i = 0; i < UsageCount; i++)
+        current_[i] = 0.0;
+
+    load();
+}
+
+bool QmBatteryModel::update(int pct, int capa, int cc, bool discharging, time_t now)
+{
+    pct_ = pct;
+    capa_ = capa;
+
+    if (!discharging || refPct_ < 0 || pct > refPct_ || cc < refCc_) {
+        /*
+         * Start over. The reference is not at a level drop, or the
+         * coulomb counter was reset by a BME restart, so the next drop
+         * only moves the reference to it.
+         */
+        refPct_ = pct;
+        refCapa_ = capa;
+        refCc_ = cc;
+        refTime_ = 0;
+        return false;
+    }
+
+    if (pct == refPct_)
+        return false;
+
+    int drop = refPct_ - pct;
+    bool learned = false;
+    double mAh = (cc - refCc_) / 3600.0;
+    if (mAh <= 0.0 && refCapa_ > capa) {
+        /* No coulomb counter, take the estimate of BME */
+        mAh = refCapa_ - capa;
+    }
+    if (refTime_ != 0 && drop <= MODEL_MAX_DROP && mAh > 0.0
+        && mAh / drop <= MODEL_MAX_MAH_PER_PCT) {
+        int first = bucketOf(pct);
+        int last = bucketOf(refPct_ - 1);
+        for (int i = first; i <= last; i++)
+            smooth(mAhPerPct_[i], mAh / drop);
+
+        if (now > refTime_) {
+            double current = mAh * 3600.0 / (now - refTime_);
+            Usage usage = current < MODEL_IDLE_CURRENT ? Idle : Active;
+            smooth(current_[usage], current);
+        }
+        learned = true;
+        changed_ = true;
+    }
+
+    refPct_ = pct;
+    refCapa_ = capa;
+    refCc_ = cc;
+    refTime_ = now > 0 ? now : 1;
+    return learned;
+}
+
+int QmBatteryModel::averageCurrent(Usage usage) const
+{
+    if (current_[usage] <= 0.0)
+        return -1;
+    return (int)(current_[usage] + 0.5);
+}
+
+int QmBatteryModel::remainingTime(int current) const
+{
+    if (pct_ < 0 || current <= 0)
+        return -1;
+
+    /* Levels not learned yet are estimated with the average of the others */
+    double sum = 0.0;
+    int learned = 0;
+    for (int i = 0; i < BATTERY_MODEL_BUCKETS; i++) {
+        if (mAhPerPct_[i] > 0.0) {
+            sum += mAhPerPct_[i];
+            learned++;
+        }
+    }
+    if (learned == 0)
+        return capa_ > 0 ? (int)((qint64)capa_ * 3600 / current) : -1;
+    double fallback = sum / learned;
+
+    double mAh = 0.0;
+    int width = 100 / BATTERY_MODEL_BUCKETS;
+    for (int i = 0; i < BATTERY_MODEL_BUCKETS && i * width < pct_; i++) {
+        int pcts = qMin(pct_ - i * width, width);
+        mAh += pcts * (mAhPerPct_[i] > 0.0 ? mAhPerPct_[i] : fallback);
+    }
+
+    return (int)(mAh * 3600.0 / current);
+}
+
+bool QmBatteryModel::takeChanged()
+{
+    bool changed = changed_;
+    changed_ = false;
+    return changed;
+}
+
+void QmBatteryModel::load()
+{
+    QFile file(path_);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return;
+
+    QTextStream in(&file);
+    int version = 0;
+    double mAhPerPct[BATTERY_MODEL_BUCKETS];
+    double current[UsageCount];
+
+    in >> version;
+    for (int i = 0; i < BATTERY_MODEL_BUCKETS; i++)
+        in >> mAhPerPct[i];
+    for (int i = 0; i < UsageCount; i++)
+        in >> current[i];
+
+    if (in.status() != QTextStream::Ok || version != MODEL_VERSION) {
+        qWarning() << "QmBatteryModel: ignoring invalid" << path_;
+        return;
+    }
+
+    for (int i = 0; i < BATTERY_MODEL_BUCKETS; i++)
+        mAhPerPct_[i] = qBound(0.0, mAhPerPct[i], MODEL_MAX_MAH_PER_PCT);
+    for (int i = 0; i < UsageCount; i++)
+        current_[i] = qMax(0.0, current[i]);
+}
+
+bool QmBatteryModel::save() const
+{
+    QFileInfo info(path_);
+    if (!QDir().mkpath(info.absolutePath())) {
+        qWarning() << "QmBatteryModel: cannot create" << info.absolutePath();
+        return false;
+    }
+
+    QString tmpPath = path_ + ".tmp";
+    QFile file(tmpPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        qWarning() << "QmBatteryModel: cannot write" << tmpPath;
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << MODEL_VERSION;
+    for (int i = 0; i < BATTERY_MODEL_BUCKETS; i++)
+        out << " " << mAhPerPct_[i];
+    for (int i = 0; i < UsageCount; i++)
+        out << " " << current_[i];
+    out << "\n";
+    out.flush();
+    file.close();
+
+    if (file.error() != QFile::NoError
+        || ::rename(QFile::encodeName(tmpPath).constData(),
+                    QFile::encodeName(path_).constData()) != 0) {
+        qWarning() << "QmBatteryModel: cannot save" << path_;
+        QFile::remove(tmpPath);
+        return false;
+    }
+    return true;
+}
+
+} // MeeGo namespace
@@ -0,0 +1,130 @@
+/*!
+ * @file qmbatterymodel_p.h
+ * @brief Contains QmBatteryModel, the learned battery discharge model
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   @scope Private
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#ifndef QMBATTERYMODEL_P_H
+#define QMBATTERYMODEL_P_H
+
+#include <QString>
+#include <time.h>
+
+/* Number of battery level ranges the discharge curve is split into */
+#define BATTERY_MODEL_BUCKETS 10
+
+namespace MeeGo
+{
+
+    /**
+     * Discharge model of the device battery, learned online while the
+     * battery discharges.
+     *
+     * Every time the battery level percentage drops, the charge taken
+     * from the coulomb counter since the previous drop gives the mAh that
+     * one percent was worth at that level, and the elapsed time the
+     * average current. Both are smoothed with an exponentially weighted
+     * moving average: the mAh per percent for each tenth of the battery
+     * level (the discharge curve), the current separately for idle and for
+     * active use.
+     *
+     * BATTERY_CAPA_NOW, the charge BME estimates to be left, answers the
+     * remaining time until a level drop has been learned, and gives the
+     * charge of a drop when the coulomb counter does not move.
+     *
+     * The model is loaded from $QMSYSTEM_BATTERY_MODEL_FILE, or
+     * ~/.qmsystem2/battery-model if the variable is not set. update() only
+     * marks it changed, the owner writes it back with save() when it sees
+     * fit, outside of its locks.
+     */
+    class QmBatteryModel
+    {
+    public:
+        enum Usage {
+            Idle = 0,
+            Active,
+            UsageCount
+        };
+
+        QmBatteryModel();
+
+        /**
+         * Feeds the current battery status into the model. Cheap when the
+         * level has not changed.
+         *
+         * @param pct         Battery level (%)
+         * @param capa        Remaining charge estimated by BME (mAh)
+         * @param cc          Coulomb counter of BME (mAs). It starts over
+         *                    when BME restarts, a decrease drops the level
+         *                    drop in progress.
+         * @param discharging False while a charger is charging the battery
+         * @param now         CLOCK_MONOTONIC seconds
+         * @return True if the model learned from the update.
+         */
+        bool update(int pct, int capa, int cc, bool discharging, time_t now);
+
+        /**
+         * @return The learned average current (mA) for the usage, or -1 if
+         *         not learned yet.
+         */
+        int averageCurrent(Usage usage) const;
+
+        /**
+         * @param current Average current (mA) to estimate with
+         * @return Seconds until the battery is empty at the level of the
+         *         latest update, or -1 if neither the curve nor the
+         *         remaining charge is known.
+         */
+        int remainingTime(int current) const;
+
+        /**
+         * @return True if the model changed since the last call. Called
+         *         before saving a copy taken at the same time.
+         */
+        bool takeChanged();
+
+        /**
+         * Writes the model to its file.
+         *
+         * @return False if the file could not be written.
+         */
+        bool save() const;
+
+    private:
+        void load();
+
+        QString path_;
+        bool changed_;
+
+        double mAhPerPct_[BATTERY_MODEL_BUCKETS]; /* 0 if not learned */
+        double current_[UsageCount];              /* mA, 0 if not learned */
+
+        int pct_;          /* latest level, -1 if unknown */
+        int capa_;         /* latest remaining charge (mAh) */
+        int refPct_;       /* level, charge and time when the level last dropped */
+        int refCapa_;
+        int refCc_;
+        time_t refTime_;
+    };
+
+} // MeeGo namespace
+
+#endif // QMBATTERYMODEL_P_H
@@ -0,0 +1,228 @@
+/*!
+ * @file qmbmetransport.cpp
+ * @brief QmBmeTransport
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#include "qmbmetransport_p.h"
+
+#include <QDebug>
+#include <QFile>
+
+extern "C" {
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "bme/bmeipc.h"
+}
+
+#define BMESIM_TIMEOUT 3000 /* ms */
+
+namespace MeeGo {
+
+/*------------ class QmBmeIpcTransport ------------*/
+
+class QmBmeIpcTransport : public QmBmeTransport
+{
+public:
+    int open() { return ::bmeipc_open(); }
+
+    int query(int sd, const void *msg1, int len1, void *msg2, int len2)
+    {
+        return ::bmeipc_query(sd, msg1, len1, msg2, len2);
+    }
+
+    void close(int sd) { ::bmeipc_close(sd); }
+
+    int eopen(int mask) { return ::bmeipc_eopen(mask); }
+    int eread(int sd) { return ::bmeipc_eread(sd); }
+    void eclose(int sd) { ::bmeipc_eclose(sd); }
+
+    mqd_t mqOpen() { return ::mq_open(BMEIPC_MQNAME, O_RDONLY | O_NONBLOCK); }
+};
+
+#ifdef QMSYSTEM_BMESIM
+
+/*------------ class QmBmeSimTransport ------------*/
+
+class QmBmeSimTransport : public QmBmeTransport
+{
+public:
+    QmBmeSimTransport(const QString &dir) : dir_(dir)
+    {
+        qDebug() << "QmBattery: using the simulated BME in" << dir;
+    }
+
+    int open() { return connect_(BMESIM_IPC_SOCKET); }
+
+    int query(int sd, const void *msg1, int len1, void *msg2, int len2)
+    {
+        QmBmeSimHeader header;
+        header.length = len1;
+        header.replyLength = (msg2 && len2 > 0) ? len2 : 0;
+
+        /* A lost connection means that the simulator has restarted */
+        if (!write_(sd, &header, sizeof(header)) || !write_(sd, msg1, len1)) {
+            errno = EIO;
+            return -1;
+        }
+        if (header.replyLength == 0)
+            return 0;
+
+        qint32 status;
+        if (!read_(sd, &status, sizeof(status)))
+            return -1;
+        if (status < 0) {
+            errno = -status;
+            return -1;
+        }
+        if (!read_(sd, msg2, len2))
+            return -1;
+        return len2;
+    }
+
+    void close(int sd) { ::close(sd); }
+
+    int eopen(int mask)
+    {
+        int sd = connect_(BMESIM_EVENT_SOCKET);
+        if (sd < 0)
+            return -1;
+
+        qint32 value = mask;
+        if (!write_(sd, &value, sizeof(value))) {
+            ::close(sd);
+            return -1;
+        }
+        return sd;
+    }
+
+    int eread(int sd)
+    {
+        qint32 events;
+        if (!read_(sd, &events, sizeof(events)))
+            return BMEVENT_ERROR;
+        return events;
+    }
+
+    void eclose(int sd) { ::close(sd); }
+
+    mqd_t mqOpen()
+    {
+        return ::mq_open(qmBmeSimQueueName(dir_).toLocal8Bit().constData(),
+                         O_RDONLY | O_NONBLOCK);
+    }
+
+private:
+    int connect_(const char *name)
+    {
+        QByteArray path = QFile::encodeName(dir_ + "/" + name);
+
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= (int)sizeof(addr.sun_path)) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        strcpy(addr.sun_path, path.constData());
+
+        int sd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (sd < 0)
+            return -1;
+        fcntl(sd, F_SETFD, FD_CLOEXEC);
+        if (::connect(sd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+            int error = errno;
+            ::close(sd);
+            errno = error;
+            return -1;
+        }
+        return sd;
+    }
+
+    static bool write_(int sd, const void *data, int len)
+    {
+        const char *p = (const char *)data;
+        while (len > 0) {
+            ssize_t n = ::send(sd, p, len, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            p += n;
+            len -= n;
+        }
+        return true;
+    }
+
+    static bool read_(int sd, void *data, int len)
+    {
+        char *p = (char *)data;
+        while (len > 0) {
+            struct pollfd pfd = { sd, POLLIN, 0 };
+            int ready = ::poll(&pfd, 1, BMESIM_TIMEOUT);
+            if (ready < 0 && errno == EINTR)
+                continue;
+            if (ready == 0) {
+                errno = ETIMEDOUT;
+                return false;
+            }
+            ssize_t n = ready < 0 ? -1 : ::recv(sd, p, len, 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0) {
+                errno = EIO;
+                return false;
+            }
+            p += n;
+            len -= n;
+        }
+        return true;
+    }
+
+    QString dir_;
+};
+
+#endif /* QMSYSTEM_BMESIM */
+
+/*------------ class QmBmeTransport ------------*/
+
+static QmBmeTransport* createTransport()
+{
+#ifdef QMSYSTEM_BMESIM
+    const char *dir = getenv(BMESIM_ENV);
+    if (dir && *dir)
+        return new QmBmeSimTransport(QString::fromLocal8Bit(dir));
+#endif
+    return new QmBmeIpcTransport();
+}
+
+QmBmeTransport* QmBmeTransport::instance()
+{
+    /* Chosen once per process */
+    static QmBmeTransport *transport = createTransport();
+    return transport;
+}
+
+} // MeeGo namespace
@@ -0,0 +1,95 @@
+/*!
+ * @file qmbmetransport_p.h
+ * @brief Contains QmBmeTransport, the connection to the battery management daemon
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   @scope Private
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#ifndef QMBMETRANSPORT_P_H
+#define QMBMETRANSPORT_P_H
+
+#include <QDir>
+#include <QString>
+#include <QtGlobal>
+
+#include <mqueue.h>
+
+/*
+ * If set, QmBattery talks to a simulated BME listening in the directory
+ * the variable names instead of the real one. Only in the host builds
+ * made with CONFIG+=bmesim, which define QMSYSTEM_BMESIM.
+ */
+#define BMESIM_ENV         "QMSYSTEM_BME_SIMULATOR"
+#define BMESIM_IPC_SOCKET  "bmesrv"
+#define BMESIM_EVENT_SOCKET "bmevents"
+
+namespace MeeGo
+{
+    /*
+     * The simulator protocol. Every request is a header followed by
+     * 'length' bytes of a bmeipc message. If 'replyLength' is not zero the
+     * simulator answers with a status, zero or a negated errno, followed
+     * by 'replyLength' bytes on success. The events socket takes the event
+     * mask from the client and then sends the event bits as they occur.
+     */
+    struct QmBmeSimHeader
+    {
+        qint32 length;
+        qint32 replyLength;
+    };
+
+    /* The measurement queue name of the simulator in the directory */
+    static inline QString qmBmeSimQueueName(const QString &dir)
+    {
+        return QString("/qmbmesim-%1").arg(qHash(QDir(dir).absolutePath()), 0, 16);
+    }
+
+    /**
+     * The calls of libbmeipc that QmBattery uses, so that they can be
+     * served by something else than the BME server.
+     */
+    class QmBmeTransport
+    {
+    public:
+        virtual ~QmBmeTransport() {}
+
+        /* As bmeipc_open(), bmeipc_query() and bmeipc_close() */
+        virtual int open() = 0;
+        virtual int query(int sd, const void *msg1, int len1, void *msg2, int len2) = 0;
+        virtual void close(int sd) = 0;
+
+        /* As bmeipc_eopen(), bmeipc_eread() and bmeipc_eclose() */
+        virtual int eopen(int mask) = 0;
+        virtual int eread(int sd) = 0;
+        virtual void eclose(int sd) = 0;
+
+        /* Opens the current measurement queue for non-blocking reading */
+        virtual mqd_t mqOpen() = 0;
+
+        /**
+         * @return The simulator transport if built with QMSYSTEM_BMESIM
+         *         and $QMSYSTEM_BME_SIMULATOR is set, libbmeipc otherwise.
+         */
+        static QmBmeTransport* instance();
+    };
+
+} // MeeGo namespace
+
+#endif // QMBMETRANSPORT_P_H
@@ -27,12 +27,11 @@
    </p>
  */
 #include "qmcabc.h"
+#include "qmcabc_p.h"
 
 #include "qmsysteminformation.h"
 
-#include <QDBusConnection>
 #include <QDBusMessage>
-#include <QDBusReply>
 
 #if HAVE_MCE
 
@@ -103,11 +102,8 @@ bool QmCABC::set(Mode mode)
         return success;
     }
 
-    QDBusMessage cabcModeSetCall = QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH, MCE_REQUEST_IF,
-                                                                  MCE_CABC_MODE_REQ);
-    cabcModeSetCall << cabcString;
-
-    (void)QDBusConnection::systemBus().call(cabcModeSetCall, QDBus::NoBlock);
+    QmIPCInterface requestIf(MCE_SERVICE, MCE_REQUEST_PATH, MCE_REQUEST_IF);
+    requestIf.callAsynchronously(MCE_CABC_MODE_REQ, cabcString);
     success = true;
 #endif /* HAVE_MCE */
 
@@ -119,17 +115,57 @@ QmCABC::Mode QmCABC::get() const
     QmCABC::Mode mode = Off;
 
 #if HAVE_MCE
-    QDBusReply<QString> reply = QDBusConnection::systemBus().call(
-                                    QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH, MCE_REQUEST_IF,
-                                                                   MCE_CABC_MODE_GET));
-    if (!reply.isValid()) {
+    QmIPCInterface requestIf(MCE_SERVICE, MCE_REQUEST_PATH, MCE_REQUEST_IF);
+    QList<QVariant> resp = requestIf.get(MCE_CABC_MODE_GET);
+    if (resp.isEmpty()) {
         return mode;
     }
 
-    (void)cabcStringToMode(reply.value(), mode);
+    (void)cabcStringToMode(resp[0].toString(), mode);
 #endif /* HAVE_MCE */
 
     return mode;
 }
 
+void QmCABC::getAsync()
+{
+    qRegisterMetaType<MeeGo::QmCABC::Mode>("MeeGo::QmCABC::Mode");
+
+#if HAVE_MCE
+    (void)new QmCABCModeCall(this);
+#else
+    QMetaObject::invokeMethod(this, "modeReceived", Qt::QueuedConnection,
+                              Q_ARG(MeeGo::QmCABC::Mode, Off));
+#endif /* HAVE_MCE */
+}
+
+#if HAVE_MCE
+
+/*------------ class QmCABCModeCall ------------*/
+
+QmCABCModeCall::QmCABCModeCall(QmCABC *cabc)
+    : QObject(cabc),
+      requestIf(MCE_SERVICE, MCE_REQUEST_PATH, MCE_REQUEST_IF)
+{
+    connect(requestIf.getAsync(MCE_CABC_MODE_GET), SIGNAL(finished(QDBusPendingCallWatcher*)),
+            this, SLOT(didReceiveMode(QDBusPendingCallWatcher*)));
+}
+
+void QmCABCModeCall::didReceiveMode(QDBusPendingCallWatcher *call)
+{
+    QmCABC::Mode mode = QmCABC::Off;
+
+    QList<QVariant> resp = QmIPCInterface::results(call);
+    if (!resp.isEmpty()) {
+        (void)cabcStringToMode(resp[0].toString(), mode);
+    }
+
+    /* The watcher goes with the interface */
+    deleteLater();
+    QMetaObject::invokeMethod(parent(), "modeReceived", Qt::DirectConnection,
+                              Q_ARG(MeeGo::QmCABC::Mode, mode));
+}
+
+#endif /* HAVE_MCE */
+
 }  //MeeGo namespace
@@ -70,6 +70,13 @@ public:
      */
     Mode get() const;
 
+    /**
+     * Gets the current CABC mode without blocking. The modeReceived signal
+     * is emitted from the event loop when the mode has been retrieved, with
+     * QmCABC::Off in case of an error, as by get().
+     */
+    void getAsync();
+
     /**
      * Requests to set the CABC mode. The system does not guarantee that
      * the CABC mode will be set according to the request. The applications
@@ -80,6 +87,13 @@ public:
      * @return bool TRUE if a valid mode was requested, FALSE otherwise
      */
     bool set(Mode mode);
+
+Q_SIGNALS:
+    /**
+     * Sent when the CABC mode requested with getAsync() has been retrieved.
+     * @param mode CABC mode
+     */
+    void modeReceived(MeeGo::QmCABC::Mode mode);
 };
 
 } // namespace MeeGo
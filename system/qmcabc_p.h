@@ -0,0 +1,53 @@
+/*!
+ * @file qmcabc_p.h
+ * @brief Contains QmCABCModeCall
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   @scope Private
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#ifndef QMCABC_P_H
+#define QMCABC_P_H
+
+#include "qmcabc.h"
+#include "qmipcinterface_p.h"
+
+namespace MeeGo
+{
+    /*
+     * A getAsync() call of QmCABC, parented to it so that QmCABC keeps its
+     * layout. Emits modeReceived() of the QmCABC when the reply arrives and
+     * deletes itself.
+     */
+    class QmCABCModeCall : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        QmCABCModeCall(QmCABC *cabc);
+
+    private Q_SLOTS:
+        void didReceiveMode(QDBusPendingCallWatcher *call);
+
+    private:
+        QmIPCInterface requestIf;
+    };
+}
+
+#endif // QMCABC_P_H
@@ -26,6 +26,7 @@
  */
 #include "qmcallstate.h"
 #include "qmcallstate_p.h"
+#include "qmsignalhub_p.h"
 
 namespace MeeGo {
 
@@ -34,6 +35,8 @@ QmCallState::QmCallState(QObject *parent) : QObject(parent) {
 
     connect(priv, SIGNAL(stateChanged(MeeGo::QmCallState::State, MeeGo::QmCallState::Type)),
             this, SIGNAL(stateChanged(MeeGo::QmCallState::State,MeeGo::QmCallState::Type)));
+    connect(priv, SIGNAL(stateReceived(MeeGo::QmCallState::State, MeeGo::QmCallState::Type)),
+            this, SIGNAL(stateReceived(MeeGo::QmCallState::State,MeeGo::QmCallState::Type)));
 }
 
 QmCallState::~QmCallState() {
@@ -41,6 +44,8 @@ QmCallState::~QmCallState() {
 
     disconnect(priv, SIGNAL(stateChanged(MeeGo::QmCallState::State, MeeGo::QmCallState::Type)),
                this, SIGNAL(stateChanged(MeeGo::QmCallState::State,MeeGo::QmCallState::Type)));
+    disconnect(priv, SIGNAL(stateReceived(MeeGo::QmCallState::State, MeeGo::QmCallState::Type)),
+               this, SIGNAL(stateReceived(MeeGo::QmCallState::State,MeeGo::QmCallState::Type)));
 
     MEEGO_UNINITIALIZE(QmCallState);
 }
@@ -54,12 +59,12 @@ void QmCallState::connectNotify(const char *signal) {
     if (QLatin1String(signal) == QLatin1String(QMetaObject::normalizedSignature(SIGNAL(stateChanged(MeeGo::QmCallState::State, MeeGo::QmCallState::Type))))) {
         if (0 == priv->connectCount[SIGNAL_CALL_STATE]) {
             #if HAVE_MCE
-                QDBusConnection::systemBus().connect(MCE_SERVICE,
-                                                     MCE_SIGNAL_PATH,
-                                                     MCE_SIGNAL_IF,
-                                                     MCE_CALL_STATE_SIG,
-                                                     priv,
-                                                     SLOT(callStateChanged(const QString&, const QString&)));
+                QmSignalHub::connect(MCE_SERVICE,
+                                     MCE_SIGNAL_PATH,
+                                     MCE_SIGNAL_IF,
+                                     MCE_CALL_STATE_SIG,
+                                     priv,
+                                     SLOT(callStateChanged(const QString&, const QString&)));
             #endif
         }
         priv->connectCount[SIGNAL_CALL_STATE]++;
@@ -76,12 +81,12 @@ void QmCallState::disconnectNotify(const char *signal) {
 
         if (0 == priv->connectCount[SIGNAL_CALL_STATE]) {
             #if HAVE_MCE
-                QDBusConnection::systemBus().disconnect(MCE_SERVICE,
-                                                        MCE_SIGNAL_PATH,
-                                                        MCE_SIGNAL_IF,
-                                                        MCE_CALL_STATE_SIG,
-                                                        priv,
-                                                        SLOT(callStateChanged(const QString&, const QString&)));
+                QmSignalHub::disconnect(MCE_SERVICE,
+                                        MCE_SIGNAL_PATH,
+                                        MCE_SIGNAL_IF,
+                                        MCE_CALL_STATE_SIG,
+                                        priv,
+                                        SLOT(callStateChanged(const QString&, const QString&)));
             #endif
         }
     }
@@ -95,7 +100,9 @@ QmCallState::State QmCallState::getState() const {
         QString state;
 
         QList<QVariant> resp;
-        resp = priv->requestIf->get(MCE_CALL_STATE_GET);
+        if (!priv->cached
+            || !QmSignalHub::cached(MCE_SERVICE, MCE_SIGNAL_PATH, MCE_SIGNAL_IF, MCE_CALL_STATE_SIG, resp))
+            resp = priv->requestIf->get(MCE_CALL_STATE_GET);
 
         if (resp.count() != 2) {
             return Error;
@@ -122,7 +129,9 @@ QmCallState::Type QmCallState::getType() const {
         QString type;
 
         QList<QVariant> resp;
-        resp = priv->requestIf->get(MCE_CALL_STATE_GET);
+        if (!priv->cached
+            || !QmSignalHub::cached(MCE_SERVICE, MCE_SIGNAL_PATH, MCE_SIGNAL_IF, MCE_CALL_STATE_SIG, resp))
+            resp = priv->requestIf->get(MCE_CALL_STATE_GET);
 
         if (resp.count() != 2)
             return Unknown;
@@ -138,6 +147,42 @@ QmCallState::Type QmCallState::getType() const {
     return mType;
 }
 
+void QmCallState::getStateAsync() {
+    #if HAVE_MCE
+        MEEGO_PRIVATE(QmCallState)
+        QObject::connect(priv->requestIf->getAsync(MCE_CALL_STATE_GET),
+                         SIGNAL(finished(QDBusPendingCallWatcher*)),
+                         priv, SLOT(didReceiveCallState(QDBusPendingCallWatcher*)));
+    #else
+        /* Never from within the call, as with the bus */
+        qRegisterMetaType<MeeGo::QmCallState::State>("MeeGo::QmCallState::State");
+        qRegisterMetaType<MeeGo::QmCallState::Type>("MeeGo::QmCallState::Type");
+        QMetaObject::invokeMethod(this, "stateReceived", Qt::QueuedConnection,
+                                  Q_ARG(MeeGo::QmCallState::State, Error),
+                                  Q_ARG(MeeGo::QmCallState::Type, Unknown));
+    #endif
+}
+
+void QmCallState::setCached(bool cached) {
+    MEEGO_PRIVATE(QmCallState)
+
+    QMutexLocker locker(&priv->connectMutex);
+
+    if (priv->cached == cached)
+        return;
+    priv->cached = cached;
+
+    #if HAVE_MCE
+        if (cached) {
+            QmSignalHub::mirror(MCE_SERVICE, MCE_SIGNAL_PATH, MCE_SIGNAL_IF, MCE_CALL_STATE_SIG, priv,
+                                QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH,
+                                                               MCE_REQUEST_IF, MCE_CALL_STATE_GET));
+        } else {
+            QmSignalHub::unmirror(MCE_SERVICE, MCE_SIGNAL_PATH, MCE_SIGNAL_IF, MCE_CALL_STATE_SIG, priv);
+        }
+    #endif
+}
+
 bool QmCallState::setState(QmCallState::State state, QmCallState::Type type) {
     #if HAVE_MCE
         MEEGO_PRIVATE(QmCallState)
@@ -91,6 +91,22 @@ public:
      */
     QmCallState::Type getType() const;
 
+    /**
+     * Enables or disables the cached mode of getState() and getType().
+     * In the cached mode the getters return the last call state seen from
+     * the call state signal of MCE without a round trip to MCE. The state
+     * is prefetched asynchronously when the mode is enabled.
+     * @param cached True to enable, false to disable the cached mode
+     */
+    void setCached(bool cached);
+
+    /**
+     * Gets the current call state and type without blocking. The
+     * stateReceived() signal is sent when they have been retrieved, with
+     * QmCallState::Error and QmCallState::Unknown in case of an error.
+     */
+    void getStateAsync();
+
     /**
      * Sets the current call state and type.
      * @credential mce::CallStateControl Resource token required to set the call state.
@@ -108,6 +124,13 @@ Q_SIGNALS:
      */
     void stateChanged(MeeGo::QmCallState::State state, MeeGo::QmCallState::Type type);
 
+    /**
+     * Sent when the call state requested with getStateAsync() has been retrieved.
+     * @param state Current call state
+     * @param type  Current call type
+     */
+    void stateReceived(MeeGo::QmCallState::State state, MeeGo::QmCallState::Type type);
+
 protected:
     void connectNotify(const char *signal);
     void disconnectNotify(const char *signal);
@@ -54,6 +54,7 @@ namespace MeeGo
                                                MCE_REQUEST_IF);
             #endif
             connectCount[SIGNAL_CALL_STATE] = 0;
+            cached = false;
         }
 
         ~QmCallStatePrivate() {
@@ -65,16 +66,19 @@ namespace MeeGo
         QmIPCInterface *requestIf;
         QMutex connectMutex;
         size_t connectCount[1];
+        bool cached;
 
     Q_SIGNALS:
         void stateChanged(MeeGo::QmCallState::State state, MeeGo::QmCallState::Type type);
+        void stateReceived(MeeGo::QmCallState::State state, MeeGo::QmCallState::Type type);
 
-    public Q_SLOTS:
-        void callStateChanged(const QString& state, const QString& type) {
-            #if HAVE_MCE
-                QmCallState::State mState = QmCallState::Error;
-                QmCallState::Type mType = QmCallState::Unknown;
+    public:
+        static void stringsToState(const QString& state, const QString& type,
+                                   QmCallState::State& mState, QmCallState::Type& mType) {
+            mState = QmCallState::Error;
+            mType = QmCallState::Unknown;
 
+            #if HAVE_MCE
                 if (state == MCE_CALL_STATE_ACTIVE)
                     mState = QmCallState::Active;
                 else if (state == MCE_CALL_STATE_SERVICE)
@@ -86,13 +90,32 @@ namespace MeeGo
                     mType = QmCallState::Normal;
                 else if (type == MCE_EMERGENCY_CALL)
                     mType = QmCallState::Emergency;
-
-                emit stateChanged(mState, mType);
             #else
                 Q_UNUSED(state);
                 Q_UNUSED(type);
             #endif
         }
+
+    public Q_SLOTS:
+        void callStateChanged(const QString& state, const QString& type) {
+            QmCallState::State mState;
+            QmCallState::Type mType;
+
+            stringsToState(state, type, mState, mType);
+            emit stateChanged(mState, mType);
+        }
+
+        void didReceiveCallState(QDBusPendingCallWatcher *call) {
+            QList<QVariant> resp = QmIPCInterface::results(call);
+            call->deleteLater();
+
+            QmCallState::State mState = QmCallState::Error;
+            QmCallState::Type mType = QmCallState::Unknown;
+
+            if (resp.count() == 2)
+                stringsToState(resp[0].toString(), resp[1].toString(), mState, mType);
+            emit stateReceived(mState, mType);
+        }
     };
 }
 #endif // QMCALLSTATE_P_H
@@ -53,6 +53,9 @@ namespace MeeGo {
         }
         QmCompassPrivate *priv = reinterpret_cast<QmCompassPrivate*>(priv_ptr);
         Compass value = priv->sensorIfc->get();
+        if (priv->checkCaughtUp(value.data().level_) && priv->haveFallbackReading) {
+            return priv->fallbackReading;
+        }
         QmCompassReading output;
         output.timestamp = value.data().timestamp_;
         output.degrees = value.data().degrees_;
@@ -63,6 +63,12 @@ namespace MeeGo {
      * each axis simultaneously. Rotating one's wrist for 2-3 rounds with
      * the device in hand usually is enough. Fast changes in the magnetic
      * environment may cause the calibration level to drop.
+     *
+     * The last good magnetometer calibration is stored on disk. When the
+     * compass is started, the heading is computed in-library from the stored
+     * calibration until sensord has calibrated itself, so a usable heading
+     * is available right away. During that time level reports the level
+     * the stored calibration was taken at.
      * 
      * To get measurements and change sensor settings, the client must
      * open a session (and call start() for data). Details can be found
@@ -29,6 +29,9 @@
 #define QMCOMPASS_P_H
 
 #include "qmcompass.h"
+#include "qmaccelerometer.h"
+#include "qmmagnetometer.h"
+#include "qmmagneticcalibration_p.h"
 #include "qmsensor.h"
 #include "qmsensor_p.h"
 #include "sensord/compasssensor_i.h"
@@ -48,12 +51,105 @@ namespace MeeGo
     public:
         CompassSensorChannelInterface* sensorIfc;
 
-        QmCompassPrivate(QmCompass *compass) : QmSensorPrivate(compass), sensorIfc(NULL)
+        /* True once sensord calibration has reached the stored level in this session */
+        bool caughtUp;
+
+        /* Sensors used for computing the heading from the stored calibration */
+        QmMagnetometer *fallbackMagnetometer;
+        QmAccelerometer *fallbackAccelerometer;
+        QmAccelerometerReading gravity;
+        bool haveGravity;
+        QmCompassReading fallbackReading;
+        bool haveFallbackReading;
+
+        QmCompassPrivate(QmCompass *compass) : QmSensorPrivate(compass), sensorIfc(NULL),
+            caughtUp(false), fallbackMagnetometer(NULL), fallbackAccelerometer(NULL),
+            haveGravity(false), haveFallbackReading(false)
         {
         }
 
         ~QmCompassPrivate() {
             closeSession();
+            stopFallback();
+        }
+
+        bool start()
+        {
+            if (!QmSensorPrivate::start()) {
+                return false;
+            }
+            caughtUp = false;
+            if (QmMagneticCalibration::instance().isValid()) {
+                startFallback();
+            }
+            return true;
+        }
+
+        bool stop()
+        {
+            stopFallback();
+            return QmSensorPrivate::stop();
+        }
+
+        /**
+         * Until sensord calibration catches up with the stored one, the
+         * heading is computed in-library from the magnetometer, which
+         * applies the stored calibration, and the accelerometer.
+         */
+        void startFallback()
+        {
+            if (fallbackMagnetometer) {
+                return;
+            }
+
+            fallbackMagnetometer = new QmMagnetometer(this);
+            fallbackAccelerometer = new QmAccelerometer(this);
+
+            if (fallbackMagnetometer->requestSession(QmSensor::SessionTypeListen) == QmSensor::SessionTypeNone ||
+                fallbackAccelerometer->requestSession(QmSensor::SessionTypeListen) == QmSensor::SessionTypeNone) {
+                qWarning("QmCompass: stored calibration not applied, no magnetometer or accelerometer");
+                stopFallback();
+                return;
+            }
+
+            connect(fallbackMagnetometer, SIGNAL(dataAvailable(const MeeGo::QmMagnetometerReading&)),
+                    this, SLOT(slotFallbackMagnetometer(const MeeGo::QmMagnetometerReading&)));
+            connect(fallbackAccelerometer, SIGNAL(dataAvailable(const MeeGo::QmAccelerometerReading&)),
+                    this, SLOT(slotFallbackAccelerometer(const MeeGo::QmAccelerometerReading&)));
+
+            if (!fallbackMagnetometer->start() || !fallbackAccelerometer->start()) {
+                stopFallback();
+            }
+        }
+
+        void stopFallback()
+        {
+            // The sensors are deleted later, this may be called from their signals
+            if (fallbackMagnetometer) {
+                fallbackMagnetometer->stop();
+                fallbackMagnetometer->deleteLater();
+                fallbackMagnetometer = NULL;
+            }
+            if (fallbackAccelerometer) {
+                fallbackAccelerometer->stop();
+                fallbackAccelerometer->deleteLater();
+                fallbackAccelerometer = NULL;
+            }
+            haveGravity = false;
+            haveFallbackReading = false;
+        }
+
+        /**
+         * @return True if sensord readings are to be replaced by the
+         *         in-library heading.
+         */
+        bool checkCaughtUp(int level)
+        {
+            if (!caughtUp && level >= QmMagneticCalibration::instance().level()) {
+                caughtUp = true;
+                stopFallback();
+            }
+            return !caughtUp && fallbackMagnetometer != NULL;
         }
 
         bool init()
@@ -114,12 +210,38 @@ namespace MeeGo
 
         void slotDataAvailable(const Compass& value)
         {
+            if (checkCaughtUp(value.data().level_)) {
+                return;
+            }
+
             QmCompassReading output;
             output.timestamp = value.data().timestamp_;
             output.degrees = (value.data().degrees_ + 90) % 360;
             output.level = value.data().level_;
             emit dataAvailable(output);
         }
+
+        void slotFallbackAccelerometer(const MeeGo::QmAccelerometerReading& value)
+        {
+            gravity = value;
+            haveGravity = true;
+        }
+
+        void slotFallbackMagnetometer(const MeeGo::QmMagnetometerReading& value)
+        {
+            if (!haveGravity || caughtUp) {
+                return;
+            }
+
+            fallbackReading.timestamp = value.timestamp;
+            fallbackReading.degrees = QmMagneticCalibration::azimuth(value, gravity);
+            fallbackReading.level = value.level;
+            haveFallbackReading = true;
+
+            QmCompassReading output = fallbackReading;
+            output.degrees = (output.degrees + 90) % 360;
+            emit dataAvailable(output);
+        }
     };
 
     // ------------------ END PRIVATE CLASS DEFINITION ------------------ //
@@ -28,9 +28,8 @@
  */
 #include "qmdevicemode.h"
 #include "qmdevicemode_p.h"
+#include "qmsignalhub_p.h"
 
-#include <QDBusConnection>
-#include <QDBusReply>
 #include <QDBusMessage>
 
 /*
@@ -92,24 +91,24 @@ namespace MeeGo
         if (QLatin1String(signal) == QLatin1String(QMetaObject::normalizedSignature(SIGNAL(deviceModeChanged(MeeGo::QmDeviceMode::DeviceMode))))) {
             if (0 == priv->connectCount[SIGNAL_DEVICE_MODE]) {
                 #if HAVE_MCE
-                    QDBusConnection::systemBus().connect(MCE_SERVICE,
-                                                         MCE_SIGNAL_PATH,
-                                                         MCE_SIGNAL_IF,
-                                                         MCE_RADIO_STATES_SIG,
-                                                         priv,
-                                                         SLOT(deviceModeChangedSlot(const quint32)));
+                    QmSignalHub::connect(MCE_SERVICE,
+                                         MCE_SIGNAL_PATH,
+                                         MCE_SIGNAL_IF,
+                                         MCE_RADIO_STATES_SIG,
+                                         priv,
+                                         SLOT(deviceModeChangedSlot(const quint32)));
                 #endif
             }
             priv->connectCount[SIGNAL_DEVICE_MODE]++;
         } else if (QLatin1String(signal) == QLatin1String(QMetaObject::normalizedSignature(SIGNAL(devicePSMStateChanged(MeeGo::QmDeviceMode::PSMState))))) {
             if (0 == priv->connectCount[SIGNAL_PSM_MODE]) {
                 #if HAVE_MCE
-                    QDBusConnection::systemBus().connect(MCE_SERVICE,
-                                                         MCE_SIGNAL_PATH,
-                                                         MCE_SIGNAL_IF,
-                                                         MCE_PSM_STATE_SIG,
-                                                         priv,
-                                                         SLOT(devicePSMChangedSlot(bool)));
+                    QmSignalHub::connect(MCE_SERVICE,
+                                         MCE_SIGNAL_PATH,
+                                         MCE_SIGNAL_IF,
+                                         MCE_PSM_STATE_SIG,
+                                         priv,
+                                         SLOT(devicePSMChangedSlot(bool)));
                 #endif
             }
             priv->connectCount[SIGNAL_PSM_MODE]++;
@@ -127,12 +126,12 @@ namespace MeeGo
 
             if (0 == priv->connectCount[SIGNAL_DEVICE_MODE]) {
                 #if HAVE_MCE
-                    QDBusConnection::systemBus().disconnect(MCE_SERVICE,
-                                                            MCE_SIGNAL_PATH,
-                                                            MCE_SIGNAL_IF,
-                                                            MCE_RADIO_STATES_SIG,
-                                                            priv,
-                                                            SLOT(deviceModeChangedSlot(const quint32)));
+                    QmSignalHub::disconnect(MCE_SERVICE,
+                                            MCE_SIGNAL_PATH,
+                                            MCE_SIGNAL_IF,
+                                            MCE_RADIO_STATES_SIG,
+                                            priv,
+                                            SLOT(deviceModeChangedSlot(const quint32)));
                 #endif
             }
         } else if (QLatin1String(signal) == QLatin1String(QMetaObject::normalizedSignature(SIGNAL(devicePSMStateChanged(MeeGo::QmDeviceMode::PSMState))))) {
@@ -140,12 +139,12 @@ namespace MeeGo
 
             if (0 == priv->connectCount[SIGNAL_PSM_MODE]) {
                 #if HAVE_MCE
-                    QDBusConnection::systemBus().disconnect(MCE_SERVICE,
-                                                            MCE_SIGNAL_PATH,
-                                                            MCE_SIGNAL_IF,
-                                                            MCE_PSM_STATE_SIG,
-                                                            priv,
-                                                            SLOT(devicePSMChangedSlot(bool)));
+                    QmSignalHub::disconnect(MCE_SERVICE,
+                                            MCE_SIGNAL_PATH,
+                                            MCE_SIGNAL_IF,
+                                            MCE_PSM_STATE_SIG,
+                                            priv,
+                                            SLOT(devicePSMChangedSlot(bool)));
                 #endif
             }
         }
@@ -156,11 +155,16 @@ namespace MeeGo
         #if HAVE_MCE
             MEEGO_PRIVATE_CONST(QmDeviceMode)
 
-            QDBusReply<quint32> radioStatesReply = QDBusConnection::systemBus().call(
-                                                       QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH,
-                                                                                      MCE_REQUEST_IF, MCE_RADIO_STATES_GET));
-            if (radioStatesReply.isValid()) {
-                deviceMode = priv->radioStateToDeviceMode(radioStatesReply.value());
+            QList<QVariant> cached;
+            if (priv->cached
+                && QmSignalHub::cached(MCE_SERVICE, MCE_SIGNAL_PATH, MCE_SIGNAL_IF, MCE_RADIO_STATES_SIG, cached)
+                && cached.count() == 1) {
+                return priv->radioStateToDeviceMode(cached[0].toUInt());
+            }
+
+            QList<QVariant> resp = priv->requestIf->get(MCE_RADIO_STATES_GET);
+            if (!resp.isEmpty()) {
+                deviceMode = priv->radioStateToDeviceMode(resp[0].toUInt());
             }
         #endif
         return deviceMode;
@@ -171,16 +175,45 @@ namespace MeeGo
         #if HAVE_MCE
             MEEGO_PRIVATE_CONST(QmDeviceMode)
 
-            QDBusReply<bool> psmModeReply = QDBusConnection::systemBus().call(
-                                                QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH,
-                                                                               MCE_REQUEST_IF, MCE_PSM_STATE_GET));
-            if (psmModeReply.isValid()) {
-                psmState = priv->psmStateToModeEnum(psmModeReply.value());
+            QList<QVariant> cached;
+            if (priv->cached
+                && QmSignalHub::cached(MCE_SERVICE, MCE_SIGNAL_PATH, MCE_SIGNAL_IF, MCE_PSM_STATE_SIG, cached)
+                && cached.count() == 1) {
+                return priv->psmStateToModeEnum(cached[0].toBool());
+            }
+
+            QList<QVariant> resp = priv->requestIf->get(MCE_PSM_STATE_GET);
+            if (!resp.isEmpty()) {
+                psmState = priv->psmStateToModeEnum(resp[0].toBool());
             }
         #endif
         return psmState;
     }
 
+    void QmDeviceMode::setCached(bool cached) {
+        MEEGO_PRIVATE(QmDeviceMode)
+
+        QMutexLocker locker(&priv->connectMutex);
+
+        if (priv->cached == cached)
+            return;
+        priv->cached = cached;
+
+        #if HAVE_MCE
+            if (cached) {
+                QmSignalHub::mirror(MCE_SERVICE, MCE_SIGNAL_PATH, MCE_SIGNAL_IF, MCE_RADIO_STATES_SIG, priv,
+                                    QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH,
+                                                                   MCE_REQUEST_IF, MCE_RADIO_STATES_GET));
+                QmSignalHub::mirror(MCE_SERVICE, MCE_SIGNAL_PATH, MCE_SIGNAL_IF, MCE_PSM_STATE_SIG, priv,
+                                    QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH,
+                                                                   MCE_REQUEST_IF, MCE_PSM_STATE_GET));
+            } else {
+                QmSignalHub::unmirror(MCE_SERVICE, MCE_SIGNAL_PATH, MCE_SIGNAL_IF, MCE_RADIO_STATES_SIG, priv);
+                QmSignalHub::unmirror(MCE_SERVICE, MCE_SIGNAL_PATH, MCE_SIGNAL_IF, MCE_PSM_STATE_SIG, priv);
+            }
+        #endif
+    }
+
     bool QmDeviceMode::setMode(QmDeviceMode::DeviceMode mode) {
         #if HAVE_MCE
             MEEGO_PRIVATE(QmDeviceMode)
@@ -93,6 +93,16 @@ public:
      */
     PSMState getPSMState() const;
 
+    /*!
+     * @brief Enables or disables the cached mode of getMode() and getPSMState().
+     * In the cached mode both states are kept up to date from the signals
+     * of MCE, and the getters return the last states seen without a round
+     * trip to MCE. The states are prefetched asynchronously when the mode
+     * is enabled.
+     * @param cached True to enable, false to disable the cached mode
+     */
+    void setCached(bool cached);
+
     /*!
      * @brief Sets the device operation mode.
      * @credential mce::DeviceModeControl Resource token required to set the device (normal/flight) mode.
@@ -64,6 +64,7 @@ namespace MeeGo
             #endif
 
             connectCount[SIGNAL_DEVICE_MODE] = connectCount[SIGNAL_PSM_MODE] = 0;
+            cached = false;
 
             g_type_init();
             gcClient = gconf_client_get_default();
@@ -101,6 +102,7 @@ namespace MeeGo
 
         QMutex connectMutex;
         size_t connectCount[2];
+        bool cached;
         QmIPCInterface *requestIf;
         GConfClient *gcClient;
 
@@ -28,10 +28,9 @@
  */
 #include "qmdisplaystate.h"
 #include "qmdisplaystate_p.h"
+#include "qmsignalhub_p.h"
 
-#include <QDBusConnection>
 #include <QDBusMessage>
-#include <QDBusReply>
 
 namespace MeeGo {
 
@@ -41,6 +40,8 @@ QmDisplayState::QmDisplayState(QObject *parent)
 
      connect(priv, SIGNAL(displayStateChanged(MeeGo::QmDisplayState::DisplayState)),
              this, SIGNAL(displayStateChanged(MeeGo::QmDisplayState::DisplayState)));
+     connect(priv, SIGNAL(displayStateReceived(MeeGo::QmDisplayState::DisplayState)),
+             this, SIGNAL(displayStateReceived(MeeGo::QmDisplayState::DisplayState)));
 }
 
 QmDisplayState::~QmDisplayState() {
@@ -48,6 +49,8 @@ QmDisplayState::~QmDisplayState() {
 
     disconnect(priv, SIGNAL(displayStateChanged(MeeGo::QmDisplayState::DisplayState)),
                this, SIGNAL(displayStateChanged(MeeGo::QmDisplayState::DisplayState)));
+    disconnect(priv, SIGNAL(displayStateReceived(MeeGo::QmDisplayState::DisplayState)),
+               this, SIGNAL(displayStateReceived(MeeGo::QmDisplayState::DisplayState)));
 
     MEEGO_UNINITIALIZE(QmDisplayState);
 }
@@ -61,12 +64,12 @@ void QmDisplayState::connectNotify(const char *signal) {
     if (QLatin1String(signal) == QLatin1String(QMetaObject::normalizedSignature(SIGNAL(displayStateChanged(MeeGo::QmDisplayState::DisplayState))))) {
         if (0 == priv->connectCount[SIGNAL_DISPLAY_STATE]) {
             #if HAVE_MCE
-                QDBusConnection::systemBus().connect(MCE_SERVICE,
-                                                     MCE_SIGNAL_PATH,
-                                                     MCE_SIGNAL_IF,
-                                                     MCE_DISPLAY_SIG,
-                                                     priv,
-                                                     SLOT(slotDisplayStateChanged(const QString&)));
+                QmSignalHub::connect(MCE_SERVICE,
+                                     MCE_SIGNAL_PATH,
+                                     MCE_SIGNAL_IF,
+                                     MCE_DISPLAY_SIG,
+                                     priv,
+                                     SLOT(slotDisplayStateChanged(const QString&)));
             #endif
         }
         priv->connectCount[SIGNAL_DISPLAY_STATE]++;
@@ -84,12 +87,12 @@ void QmDisplayState::disconnectNotify(const char *signal) {
 
         if (0 == priv->connectCount[SIGNAL_DISPLAY_STATE]) {
             #if HAVE_MCE
-                QDBusConnection::systemBus().disconnect(MCE_SERVICE,
-                                                        MCE_SIGNAL_PATH,
-                                                        MCE_SIGNAL_IF,
-                                                        MCE_DISPLAY_SIG,
-                                                        priv,
-                                                        SLOT(slotDisplayStateChanged(const QString&)));
+                QmSignalHub::disconnect(MCE_SERVICE,
+                                        MCE_SIGNAL_PATH,
+                                        MCE_SIGNAL_IF,
+                                        MCE_DISPLAY_SIG,
+                                        priv,
+                                        SLOT(slotDisplayStateChanged(const QString&)));
             #endif
         }
     }
@@ -98,28 +101,67 @@ void QmDisplayState::disconnectNotify(const char *signal) {
 QmDisplayState::DisplayState QmDisplayState::get() const {
     QmDisplayState::DisplayState state = Unknown;
     #if HAVE_MCE
-        QDBusReply<QString> displayStateReply = QDBusConnection::systemBus().call(
-                                                    QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH, MCE_REQUEST_IF,
-                                                                                   MCE_DISPLAY_STATUS_GET));
-        if (!displayStateReply.isValid()) {
-            return state;
+        MEEGO_PRIVATE_CONST(QmDisplayState)
+
+        QString stateStr;
+        QList<QVariant> cached;
+
+        if (priv->cached
+            && QmSignalHub::cached(MCE_SERVICE, MCE_SIGNAL_PATH, MCE_SIGNAL_IF, MCE_DISPLAY_SIG, cached)
+            && cached.count() == 1) {
+            stateStr = cached[0].toString();
+        } else {
+            QList<QVariant> resp = priv->requestIf->get(MCE_DISPLAY_STATUS_GET);
+            if (resp.isEmpty()) {
+                return state;
+            }
+
+            stateStr = resp[0].toString();
         }
 
-        QString stateStr = displayStateReply.value();
+        state = QmDisplayStatePrivate::stringToState(stateStr);
+    #endif
+    return state;
+}
+
+void QmDisplayState::getAsync() {
+    #if HAVE_MCE
+        MEEGO_PRIVATE(QmDisplayState)
+        QObject::connect(priv->requestIf->getAsync(MCE_DISPLAY_STATUS_GET),
+                         SIGNAL(finished(QDBusPendingCallWatcher*)),
+                         priv, SLOT(didReceiveDisplayState(QDBusPendingCallWatcher*)));
+    #else
+        /* Never from within the call, as with the bus */
+        qRegisterMetaType<MeeGo::QmDisplayState::DisplayState>("MeeGo::QmDisplayState::DisplayState");
+        QMetaObject::invokeMethod(this, "displayStateReceived", Qt::QueuedConnection,
+                                  Q_ARG(MeeGo::QmDisplayState::DisplayState, Unknown));
+    #endif
+}
+
+void QmDisplayState::setCached(bool cached) {
+    MEEGO_PRIVATE(QmDisplayState)
 
-        if (stateStr == MCE_DISPLAY_DIM_STRING) {
-            state = Dimmed;
-        } else if (stateStr == MCE_DISPLAY_ON_STRING) {
-            state = On;
-        } else if (stateStr == MCE_DISPLAY_OFF_STRING) {
-            state = Off;
+    QMutexLocker locker(&priv->connectMutex);
+
+    if (priv->cached == cached)
+        return;
+    priv->cached = cached;
+
+    #if HAVE_MCE
+        if (cached) {
+            QmSignalHub::mirror(MCE_SERVICE, MCE_SIGNAL_PATH, MCE_SIGNAL_IF, MCE_DISPLAY_SIG, priv,
+                                QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH,
+                                                               MCE_REQUEST_IF, MCE_DISPLAY_STATUS_GET));
+        } else {
+            QmSignalHub::unmirror(MCE_SERVICE, MCE_SIGNAL_PATH, MCE_SIGNAL_IF, MCE_DISPLAY_SIG, priv);
         }
     #endif
-    return state;
 }
 
 bool QmDisplayState::set(QmDisplayState::DisplayState state) {
     #if HAVE_MCE
+        MEEGO_PRIVATE(QmDisplayState)
+
         QString method;
 
         switch (state) {
@@ -136,8 +178,7 @@ bool QmDisplayState::set(QmDisplayState::DisplayState state) {
                 return false;
         }
 
-        QDBusMessage displayStateSetCall = QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH, MCE_REQUEST_IF, method);
-        (void)QDBusConnection::systemBus().call(displayStateSetCall, QDBus::NoBlock);
+        priv->requestIf->callAsynchronously(method);
         return true;
     #else
         Q_UNUSED(state);
@@ -259,9 +300,9 @@ void QmDisplayState::setBlankingWhenCharging(bool blanking) {
 
 bool QmDisplayState::setBlankingPause(void) {
     #if HAVE_MCE
-        QDBusMessage blankingPauseCall = QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH, MCE_REQUEST_IF,
-                                                                        MCE_PREVENT_BLANK_REQ);
-        (void)QDBusConnection::systemBus().call(blankingPauseCall, QDBus::NoBlock);
+        MEEGO_PRIVATE(QmDisplayState)
+
+        priv->requestIf->callAsynchronously(MCE_PREVENT_BLANK_REQ);
         return true;
     #else
         return false;
@@ -270,9 +311,9 @@ bool QmDisplayState::setBlankingPause(void) {
 
 bool QmDisplayState::cancelBlankingPause(void) {
     #if HAVE_MCE
-        QDBusMessage cancelBlankingPauseCall = QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH, MCE_REQUEST_IF,
-                                                                              MCE_CANCEL_PREVENT_BLANK_REQ);
-        (void)QDBusConnection::systemBus().call(cancelBlankingPauseCall, QDBus::NoBlock);
+        MEEGO_PRIVATE(QmDisplayState)
+
+        priv->requestIf->callAsynchronously(MCE_CANCEL_PREVENT_BLANK_REQ);
         return true;
     #else
         return false;
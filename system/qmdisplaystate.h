@@ -77,6 +77,23 @@ public:
      */
     DisplayState get() const;
 
+    /*!
+     * @brief Enables or disables the cached mode of get().
+     * In the cached mode the display state is kept up to date from the
+     * display state signal of MCE, and get() returns the last state seen
+     * without a round trip to MCE. The state is prefetched asynchronously
+     * when the mode is enabled; get() asks MCE until the prefetch completes.
+     * @param cached True to enable, false to disable the cached mode
+     */
+    void setCached(bool cached);
+
+    /*!
+     * @brief Gets the current display state without blocking.
+     * The displayStateReceived() signal is sent when the state has been
+     * retrieved, with QmDisplayState::Unknown in case of an error.
+     */
+    void getAsync();
+
     /*!
      * @brief Sets the current display state.
      * @param state Display state new set
@@ -165,6 +182,12 @@ Q_SIGNALS:
      */
     void displayStateChanged(MeeGo::QmDisplayState::DisplayState state);
 
+    /*!
+     * @brief Sent when the display state requested with getAsync() has been retrieved.
+     * @param state Current display state
+     */
+    void displayStateReceived(MeeGo::QmDisplayState::DisplayState state);
+
 protected:
     void connectNotify(const char *signal);
     void disconnectNotify(const char *signal);
@@ -28,6 +28,7 @@
 #define QMDISPLAYSTATE_P_H
 
 #include "qmdisplaystate.h"
+#include "qmipcinterface_p.h"
 
 #include <QMutex>
 
@@ -61,19 +62,44 @@ namespace MeeGo
             g_type_init();
             gc = gconf_client_get_default();
 
+            requestIf = 0;
+            #if HAVE_MCE
+                requestIf = new QmIPCInterface(MCE_SERVICE, MCE_REQUEST_PATH, MCE_REQUEST_IF);
+            #endif
+
             connectCount[SIGNAL_DISPLAY_STATE] = 0;
+            cached = false;
         }
 
         ~QmDisplayStatePrivate() {
+            delete requestIf, requestIf = 0;
             g_object_unref(gc), gc = 0;
         }
 
+        static QmDisplayState::DisplayState stringToState(const QString& state) {
+            QmDisplayState::DisplayState mState = QmDisplayState::Unknown;
+            #if HAVE_MCE
+                if (state == MCE_DISPLAY_DIM_STRING)
+                    mState = QmDisplayState::Dimmed;
+                else if (state == MCE_DISPLAY_ON_STRING)
+                    mState = QmDisplayState::On;
+                else if (state == MCE_DISPLAY_OFF_STRING)
+                    mState = QmDisplayState::Off;
+            #else
+                Q_UNUSED(state);
+            #endif
+            return mState;
+        }
+
         QMutex connectMutex;
         size_t connectCount[1];
+        bool cached;
         GConfClient *gc;
+        QmIPCInterface *requestIf;
 
     Q_SIGNALS:
         void displayStateChanged(MeeGo::QmDisplayState::DisplayState);
+        void displayStateReceived(MeeGo::QmDisplayState::DisplayState);
 
     private Q_SLOTS:
 
@@ -89,6 +115,16 @@ namespace MeeGo
                 Q_UNUSED(state);
             #endif
         }
+
+        void didReceiveDisplayState(QDBusPendingCallWatcher *call) {
+            QList<QVariant> resp = QmIPCInterface::results(call);
+            call->deleteLater();
+
+            QmDisplayState::DisplayState state = QmDisplayState::Unknown;
+            if (resp.count() == 1)
+                state = stringToState(resp[0].toString());
+            emit displayStateReceived(state);
+        }
     };
 }
 #endif // QMDISPLAYSTATE_P_H
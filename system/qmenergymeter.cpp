@@ -0,0 +1,259 @@
+/*!
+ * @file qmenergymeter.cpp
+ * @brief QmEnergyMeter
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#include "qmenergymeter.h"
+#include "qmenergymeter_p.h"
+
+#include <QDebug>
+
+/* Samples further apart than this are not integrated over (us) */
+#define MAX_SAMPLE_GAP 10000000ULL
+
+namespace MeeGo {
+
+/*------------ class QmEnergyInterval ------------*/
+
+QmEnergyInterval::QmEnergyInterval()
+    : running(false),
+      duration(0),
+      energy(0.0),
+      averagePower(0),
+      peakPower(0),
+      charge(0),
+      samples(0)
+{
+}
+
+/*------------ class QmEnergyMeterPrivate ------------*/
+
+QmEnergyMeterPrivate::QmEnergyMeterPrivate()
+    : running(false),
+      havePrevious(false),
+      previousTimestamp(0),
+      previousPower(0)
+{
+    connect(&battery, SIGNAL(batteryMeasurements(const QVector<MeeGo::QmBatteryMeasurement>&)),
+            this, SLOT(onMeasurements(const QVector<MeeGo::QmBatteryMeasurement>&)));
+}
+
+QmEnergyMeterPrivate::~QmEnergyMeterPrivate()
+{
+    if (running) {
+        battery.stopCurrentMeasurement();
+    }
+}
+
+QmEnergyMeterPrivate::Marker* QmEnergyMeterPrivate::find(const QString &name)
+{
+    for (int i = 0; i < markers.size(); i++) {
+        if (markers[i].interval.name == name) {
+            return &markers[i];
+        }
+    }
+    return 0;
+}
+
+const QmEnergyMeterPrivate::Marker* QmEnergyMeterPrivate::find(const QString &name) const
+{
+    for (int i = 0; i < markers.size(); i++) {
+        if (markers[i].interval.name == name) {
+            return &markers[i];
+        }
+    }
+    return 0;
+}
+
+QmEnergyInterval QmEnergyMeterPrivate::result(const Marker &marker) const
+{
+    QmEnergyInterval interval = marker.interval;
+    if (!interval.running) {
+        return interval;
+    }
+
+    quint64 duration = 0;
+    if (interval.samples > 0) {
+        duration = marker.last - marker.start;
+    }
+
+    /* uW * us = pJ */
+    interval.duration = (int)(duration / 1000);
+    interval.energy = marker.energy / 1e9;
+    interval.averagePower = duration > 0 ? (int)(marker.energy / duration / 1000.0) : 0;
+    interval.charge = battery.getCumulativeBatteryCurrent() - marker.startCharge;
+    return interval;
+}
+
+void QmEnergyMeterPrivate::onMeasurements(const QVector<MeeGo::QmBatteryMeasurement> &samples)
+{
+    foreach (const QmBatteryMeasurement &sample, samples) {
+        /* mA * mV = uW */
+        qint64 power = (qint64)sample.current * sample.voltage;
+
+        double energy = 0.0;
+        bool integrate = havePrevious
+            && sample.timestamp > previousTimestamp
+            && sample.timestamp - previousTimestamp <= MAX_SAMPLE_GAP;
+        if (integrate) {
+            energy = (previousPower + power) / 2.0
+                * (double)(sample.timestamp - previousTimestamp);
+        }
+
+        for (int i = 0; i < markers.size(); i++) {
+            Marker &marker = markers[i];
+            if (!marker.interval.running) {
+                continue;
+            }
+
+            if (marker.interval.samples == 0) {
+                /* The marker starts from its first sample */
+                marker.start = sample.timestamp;
+                marker.interval.peakPower = (int)(power / 1000);
+            } else if (integrate) {
+                marker.energy += energy;
+            }
+
+            if (power / 1000 > marker.interval.peakPower) {
+                marker.interval.peakPower = (int)(power / 1000);
+            }
+            marker.last = sample.timestamp;
+            marker.interval.samples++;
+        }
+
+        havePrevious = true;
+        previousTimestamp = sample.timestamp;
+        previousPower = power;
+    }
+}
+
+/*------------ class QmEnergyMeter ------------*/
+
+QmEnergyMeter::QmEnergyMeter(QObject *parent)
+    : QObject(parent)
+{
+    MEEGO_INITIALIZE(QmEnergyMeter)
+}
+
+QmEnergyMeter::~QmEnergyMeter()
+{
+    MEEGO_UNINITIALIZE(QmEnergyMeter);
+}
+
+bool QmEnergyMeter::start(QmBattery::Period rate)
+{
+    MEEGO_PRIVATE(QmEnergyMeter)
+
+    if (priv->running) {
+        return true;
+    }
+
+    priv->havePrevious = false;
+    priv->running = priv->battery.startCurrentMeasurement(rate);
+    return priv->running;
+}
+
+bool QmEnergyMeter::stop()
+{
+    MEEGO_PRIVATE(QmEnergyMeter)
+
+    if (!priv->running) {
+        return true;
+    }
+
+    if (!priv->battery.stopCurrentMeasurement()) {
+        return false;
+    }
+    priv->running = false;
+    priv->havePrevious = false;
+    return true;
+}
+
+bool QmEnergyMeter::isRunning() const
+{
+    MEEGO_PRIVATE_CONST(QmEnergyMeter)
+    return priv->running;
+}
+
+void QmEnergyMeter::startMarker(const QString &name)
+{
+    MEEGO_PRIVATE(QmEnergyMeter)
+
+    QmEnergyMeterPrivate::Marker *marker = priv->find(name);
+    if (!marker) {
+        priv->markers.append(QmEnergyMeterPrivate::Marker());
+        marker = &priv->markers.last();
+    }
+
+    marker->interval = QmEnergyInterval();
+    marker->interval.name = name;
+    marker->interval.running = true;
+    marker->start = 0;
+    marker->last = 0;
+    marker->energy = 0.0;
+    marker->startCharge = priv->battery.getCumulativeBatteryCurrent();
+}
+
+QmEnergyInterval QmEnergyMeter::stopMarker(const QString &name)
+{
+    MEEGO_PRIVATE(QmEnergyMeter)
+
+    QmEnergyMeterPrivate::Marker *marker = priv->find(name);
+    if (!marker) {
+        qWarning() << "QmEnergyMeter: no marker" << name;
+        return QmEnergyInterval();
+    }
+
+    if (marker->interval.running) {
+        marker->interval = priv->result(*marker);
+        marker->interval.running = false;
+    }
+    return marker->interval;
+}
+
+QmEnergyInterval QmEnergyMeter::interval(const QString &name) const
+{
+    MEEGO_PRIVATE_CONST(QmEnergyMeter)
+
+    const QmEnergyMeterPrivate::Marker *marker = priv->find(name);
+    if (!marker) {
+        return QmEnergyInterval();
+    }
+    return priv->result(*marker);
+}
+
+QList<QmEnergyInterval> QmEnergyMeter::intervals() const
+{
+    MEEGO_PRIVATE_CONST(QmEnergyMeter)
+
+    QList<QmEnergyInterval> result;
+    foreach (const QmEnergyMeterPrivate::Marker &marker, priv->markers) {
+        result.append(priv->result(marker));
+    }
+    return result;
+}
+
+void QmEnergyMeter::clear()
+{
+    MEEGO_PRIVATE(QmEnergyMeter)
+    priv->markers.clear();
+}
+
+} // MeeGo namespace
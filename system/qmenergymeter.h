@@ -0,0 +1,176 @@
+/*!
+ * @file qmenergymeter.h
+ * @brief Contains QmEnergyMeter.
+
+   <p>
+   @copyright (C) 2009-2011 Nokia Corporation
+   @license LGPL Lesser General Public License
+
+   @scope Nokia Meego
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#ifndef QMENERGYMETER_H
+#define QMENERGYMETER_H
+
+#include "system_global.h"
+#include "qmbattery.h"
+#include <QtCore/qobject.h>
+#include <QList>
+#include <QString>
+
+QT_BEGIN_HEADER
+
+namespace MeeGo {
+
+class QmEnergyMeterPrivate;
+
+/*!
+ * @scope Nokia Meego
+ *
+ * @class QmEnergyInterval
+ * @brief Energy consumed between the start and the stop of a QmEnergyMeter marker.
+ */
+class MEEGO_SYSTEM_EXPORT QmEnergyInterval
+{
+public:
+    QmEnergyInterval();
+
+    QString name;     //!< Marker name
+    bool running;     //!< True if the marker has not been stopped yet
+    int duration;     //!< Measured time (ms)
+    double energy;    //!< Energy taken from the battery (mJ), negative when charging
+    int averagePower; //!< Average power (mW)
+    int peakPower;    //!< Highest power of a single sample (mW)
+    int charge;       //!< Change of the cumulative battery current (mAs)
+    int samples;      //!< Number of measurement samples within the interval
+};
+
+/*!
+ * @scope Nokia Meego
+ *
+ * @class QmEnergyMeter
+ * @brief QmEnergyMeter measures the energy consumed during named intervals.
+ *
+ * The meter integrates battery current times battery voltage from the
+ * QmBattery current measurement samples with the trapezoidal rule. Any
+ * number of named markers can be running at the same time, each
+ * accumulating the energy, the average power and the peak power between
+ * its start and stop.
+ *
+ * The charge reported for an interval comes from the coulomb counter (see
+ * QmBattery::getCumulativeBatteryCurrent()), which is compensated for
+ * counter resets when the battery management daemon restarts.
+ *
+ * @code
+ * QmEnergyMeter meter;
+ * meter.start(QmBattery::RATE_250ms);
+ * meter.startMarker("scroll");
+ * ...
+ * QmEnergyInterval scroll = meter.stopMarker("scroll");
+ * qDebug() << scroll.energy << "mJ" << scroll.averagePower << "mW";
+ * @endcode
+ */
+class MEEGO_SYSTEM_EXPORT QmEnergyMeter : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * @brief Constructor
+     * @param parent The possible parent object
+     */
+    QmEnergyMeter(QObject *parent = 0);
+
+    /*!
+     * @brief Destructor
+     */
+    ~QmEnergyMeter();
+
+    /*!
+     * @brief Starts the battery current measurement the meter is based on.
+     *
+     * @param rate The measurement rate, the faster the more accurate
+     *
+     * @retval  TRUE   success
+     * @retval  FALSE  failure
+     */
+    bool start(QmBattery::Period rate = QmBattery::RATE_250ms);
+
+    /*!
+     * @brief Stops the battery current measurement. Running markers stop
+     * accumulating energy until start() is called again.
+     *
+     * @retval  TRUE   success
+     * @retval  FALSE  failure
+     */
+    bool stop();
+
+    /*!
+     * @brief Checks whether the measurement is running.
+     *
+     * @return True if running
+     */
+    bool isRunning() const;
+
+    /*!
+     * @brief Starts a named marker. A marker of the same name is restarted.
+     *
+     * @param name Marker name
+     */
+    void startMarker(const QString &name);
+
+    /*!
+     * @brief Stops a named marker.
+     *
+     * @param name Marker name
+     * @return The final interval of the marker, with an empty name if there
+     *         is no such marker
+     */
+    QmEnergyInterval stopMarker(const QString &name);
+
+    /*!
+     * @brief Gets the interval of a running or stopped marker.
+     *
+     * @param name Marker name
+     * @return The interval, with an empty name if there is no such marker
+     */
+    QmEnergyInterval interval(const QString &name) const;
+
+    /*!
+     * @brief Gets the intervals of all the markers.
+     *
+     * @return The intervals in the order the markers were started
+     */
+    QList<QmEnergyInterval> intervals() const;
+
+    /*!
+     * @brief Forgets all the markers.
+     */
+    void clear();
+
+private:
+    Q_DISABLE_COPY(QmEnergyMeter)
+    MEEGO_DECLARE_PRIVATE(QmEnergyMeter)
+};
+
+} // MeeGo namespace
+
+QT_END_HEADER
+
+#endif /*QMENERGYMETER_H*/
+
+// End of file
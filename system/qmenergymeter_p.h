@@ -0,0 +1,73 @@
+/*!
+ * @file qmenergymeter_p.h
+ * @brief Contains QmEnergyMeterPrivate
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   @scope Private
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#ifndef QMENERGYMETER_P_H
+#define QMENERGYMETER_P_H
+
+#include "qmenergymeter.h"
+#include "qmbattery.h"
+
+#include <QList>
+#include <QVector>
+
+namespace MeeGo
+{
+    class QmEnergyMeterPrivate : public QObject
+    {
+        Q_OBJECT
+        MEEGO_DECLARE_PUBLIC(QmEnergyMeter)
+
+    public:
+        QmEnergyMeterPrivate();
+        ~QmEnergyMeterPrivate();
+
+        struct Marker
+        {
+            QmEnergyInterval interval;
+            quint64 start;      /* us, timestamp of the first sample */
+            quint64 last;       /* us, timestamp of the latest sample */
+            double energy;      /* uW * us */
+            int startCharge;    /* mAs */
+        };
+
+        Marker* find(const QString &name);
+        const Marker* find(const QString &name) const;
+        QmEnergyInterval result(const Marker &marker) const;
+
+        QmBattery battery;
+        bool running;
+
+        /* The previous sample, integration runs from it to the next one */
+        bool havePrevious;
+        quint64 previousTimestamp;
+        qint64 previousPower;
+
+        QList<Marker> markers;
+
+    private Q_SLOTS:
+        void onMeasurements(const QVector<MeeGo::QmBatteryMeasurement> &samples);
+    };
+}
+
+#endif // QMENERGYMETER_P_H
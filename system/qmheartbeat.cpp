@@ -34,7 +34,14 @@
 #include <unistd.h>
 
 #include <QDebug>
+#include <QFile>
+#include <QMutex>
 #include <QProcess>
+#include <QTextStream>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 namespace MeeGo {
 
@@ -48,29 +55,243 @@ const unsigned short QmHeartbeat::WAKEUP_SLOT_1_HOUR   = IPHB_GS_WAIT_1_HOUR;
 const unsigned short QmHeartbeat::WAKEUP_SLOT_2_HOURS  = IPHB_GS_WAIT_2_HOURS;
 const unsigned short QmHeartbeat::WAKEUP_SLOT_10_HOURS = IPHB_GS_WAIT_10_HOURS;
 
+/* The service counts whole seconds, a wakeup this much before the end of its
+ * window was not caused by the window ending */
+#define COALESCE_TOLERANCE_MS 1000
+
+/* A wakeup this much after a multiple of the 30 second slot is at the slot */
+#define SLOT_TOLERANCE_MS 1000
+
+/* Wakeups kept in the history of a heartbeat */
+#define HISTORY_SIZE 32
+
 #define LOG_ERROR { qWarning() << Q_FUNC_INFO << " PID=" << (unsigned long)getpid() << " " << strerror(errno) <<  " errno=" << errno; }
 
+QmHeartbeat::Wakeup::Wakeup()
+    : requested(-1),
+      time(-1),
+      mintime(0),
+      maxtime(0),
+      slip(0),
+      coalesced(false),
+      onSlot(false) {
+}
+
+QmHeartbeat::Statistics::Statistics()
+    : waits(0),
+      cancelled(0),
+      wakeups(0),
+      coalesced(0),
+      early(0),
+      late(0),
+      onSlot(0),
+      offSlot(0),
+      totalSlip(0),
+      maxSlip(0) {
+}
+
+/* Set once the accounting has been destroyed at exit */
+static bool accountingDone = false;
+
+/* The wakeups of all the heartbeats of the process */
+class QmHeartbeatAccounting
+{
+public:
+    QmHeartbeatAccounting() : created_(0) {
+    }
+
+    ~QmHeartbeatAccounting() {
+        accountingDone = true;
+
+        const char *env = getenv(HEARTBEAT_STATS_ENV);
+        if (!env || !*env) {
+            return;
+        }
+
+        QFile file;
+        if (!strcmp(env, "1") || !strcmp(env, "stderr")) {
+            file.open(stderr, QIODevice::WriteOnly);
+        } else {
+            file.setFileName(QFile::decodeName(env));
+            file.open(QIODevice::WriteOnly | QIODevice::Append);
+        }
+        if (file.isOpen()) {
+            QTextStream stream(&file);
+            stream << "qmsystem2 heartbeat wakeups of pid " << getpid() << "\n" << report();
+        }
+    }
+
+    void add(QmHeartbeatPrivate *handle) {
+        if (accountingDone) {
+            return;
+        }
+        QMutexLocker locker(&mutex);
+        handle->number = ++created_;
+        handles_.append(handle);
+    }
+
+    void remove(QmHeartbeatPrivate *handle) {
+        if (accountingDone) {
+            return;
+        }
+        QMutexLocker locker(&mutex);
+        retire(handle);
+        handles_.removeAll(handle);
+    }
+
+    /* Moves the statistics of the handle to the earlier ones, with the mutex held */
+    void retire(QmHeartbeatPrivate *handle) {
+        add(earlierStatistics_, handle->statistics);
+        handle->statistics = QmHeartbeat::Statistics();
+        handle->history.clear();
+    }
+
+    QmHeartbeat::Statistics total() {
+        QMutexLocker locker(&mutex);
+        QmHeartbeat::Statistics result = earlierStatistics_;
+        foreach (QmHeartbeatPrivate *handle, handles_) {
+            add(result, handle->statistics);
+        }
+        return result;
+    }
+
+    QString report() {
+        QMutexLocker locker(&mutex);
+
+        QString result;
+        QTextStream stream(&result);
+
+        stream << "# handle waits cancelled wakeups coalesced early late on_slot off_slot avg_slip_ms max_slip_ms\n";
+
+        QmHeartbeat::Statistics total = earlierStatistics_;
+        foreach (QmHeartbeatPrivate *handle, handles_) {
+            QString name = handle->pub_func()->objectName();
+            name.replace(' ', '_');
+            write(stream, QString("#%1%2").arg(handle->number).arg(name.isEmpty() ? QString() : "/" + name),
+                  handle->statistics);
+            add(total, handle->statistics);
+        }
+        write(stream, "earlier", earlierStatistics_);
+        write(stream, "total", total);
+
+        if (total.wakeups) {
+            stream << "# " << total.wakeups << " wakeups, "
+                   << QString::number(100.0 * total.coalesced / total.wakeups, 'f', 1) << "% coalesced, "
+                   << QString::number(100.0 * total.onSlot / total.wakeups, 'f', 1) << "% on a global slot\n";
+        }
+        stream.flush();
+        return result;
+    }
+
+    QMutex mutex;
+
+private:
+    static void add(QmHeartbeat::Statistics &to, const QmHeartbeat::Statistics &from) {
+        to.waits += from.waits;
+        to.cancelled += from.cancelled;
+        to.wakeups += from.wakeups;
+        to.coalesced += from.coalesced;
+        to.early += from.early;
+        to.late += from.late;
+        to.onSlot += from.onSlot;
+        to.offSlot += from.offSlot;
+        to.totalSlip += from.totalSlip;
+        if (from.maxSlip > to.maxSlip) {
+            to.maxSlip = from.maxSlip;
+        }
+    }
+
+    static void write(QTextStream &stream, const QString &name, const QmHeartbeat::Statistics &stats) {
+        double avg = stats.wakeups ? (double)stats.totalSlip / stats.wakeups : 0.0;
+
+        stream << name << ' ' << stats.waits << ' ' << stats.cancelled << ' ' << stats.wakeups << ' '
+               << stats.coalesced << ' ' << stats.early << ' ' << stats.late << ' '
+               << stats.onSlot << ' ' << stats.offSlot << ' '
+               << QString::number(avg, 'f', 1) << ' ' << stats.maxSlip << '\n';
+    }
+
+    int created_;
+    QList<QmHeartbeatPrivate*> handles_;
+    /* Of the deleted heartbeats, and of the ones reopened or reset since */
+    QmHeartbeat::Statistics earlierStatistics_;
+};
+
+/* Destroyed at exit, when it logs the statistics if asked to */
+static QmHeartbeatAccounting heartbeatAccounting;
+
+static qint64 monotonicMs() {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0) {
+        return 0;
+    }
+    return (qint64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
 QmHeartbeatPrivate::QmHeartbeatPrivate() {
     //Init
     iphbdHandler = 0;
     signalNeed = QmHeartbeat::NoSignalNeeded;
     notifier = 0;
+    waitRequested = -1;
+    waitSlotBase = 0;
+    waitMin = 0;
+    waitMax = 0;
+    number = 0;
+    heartbeatAccounting.add(this);
+}
+
+bool QmHeartbeatPrivate::isSlot(unsigned short value) {
+    return value == QmHeartbeat::WAKEUP_SLOT_30_SEC ||
+           value == QmHeartbeat::WAKEUP_SLOT_2_5_MINS ||
+           value == QmHeartbeat::WAKEUP_SLOT_5_MINS ||
+           value == QmHeartbeat::WAKEUP_SLOT_10_MINS ||
+           value == QmHeartbeat::WAKEUP_SLOT_30_MINS ||
+           value == QmHeartbeat::WAKEUP_SLOT_1_HOUR ||
+           value == QmHeartbeat::WAKEUP_SLOT_2_HOURS ||
+           value == QmHeartbeat::WAKEUP_SLOT_10_HOURS;
+}
+
+void QmHeartbeatPrivate::startWait(unsigned short mintime, unsigned short maxtime) {
+    QMutexLocker locker(&heartbeatAccounting.mutex);
+    if (waitRequested >= 0)
+        statistics.cancelled++;
+    waitRequested = QmHeartbeat::monotonicTime();
+    waitSlotBase = monotonicMs();
+    waitMin = mintime;
+    waitMax = maxtime;
+    statistics.waits++;
+}
+
+void QmHeartbeatPrivate::cancelWait() {
+    QMutexLocker locker(&heartbeatAccounting.mutex);
+    if (waitRequested >= 0) {
+        statistics.cancelled++;
+        waitRequested = -1;
+    }
 }
 
 QmHeartbeatPrivate::~QmHeartbeatPrivate() {
     //Call iphb_close if the developer forgot to call it
     close();
+    heartbeatAccounting.remove(this);
 }
 
 bool QmHeartbeatPrivate::open(QmHeartbeat::SignalNeed signalNeed) {
     bool status =  false;
 
-    iphbdHandler = iphb_open(0);
+    QmIphbTransport *transport = QmIphbTransport::instance();
+    iphbdHandler = transport->open();
     this->signalNeed = signalNeed;
+    cancelWait();
+    {
+        QMutexLocker locker(&heartbeatAccounting.mutex);
+        heartbeatAccounting.retire(this);
+        lastWakeup = QmHeartbeat::Wakeup();
+    }
 
     if (iphbdHandler) {
         if (signalNeed == QmHeartbeat::SignalNeeded) {
-            int sockfd  = iphb_get_fd(iphbdHandler);
+            int sockfd  = transport->fd(iphbdHandler);
 
             if (sockfd == -1) {
                 LOG_ERROR;
@@ -102,7 +323,7 @@ void QmHeartbeatPrivate::close() {
     //Avoiding ~QmHeartbeat to call iphb_close again
     if (iphbdHandler) {
         //Actually sets priv->iphbdHandler to 0
-        iphbdHandler = iphb_close(iphbdHandler);
+        iphbdHandler = QmIphbTransport::instance()->close(iphbdHandler);
     }
 
     if (notifier) {
@@ -111,24 +332,88 @@ void QmHeartbeatPrivate::close() {
     }
 
     signalNeed = QmHeartbeat::NoSignalNeeded;
-
+    cancelWait();
 }
 
 void QmHeartbeatPrivate::socketReady(int sock) {
     Q_UNUSED(sock);
 
-    int st = iphb_discard_wakeups(iphbdHandler);
+    int st = QmIphbTransport::instance()->discardWakeups(iphbdHandler);
 
-    if (st == -1)
+    if (st == -1) {
         LOG_ERROR;
+        // The connection is lost, do not spin on it
+        if (notifier)
+            notifier->setEnabled(false);
+    }
+
+    if (waitRequested >= 0) {
+        QMutexLocker locker(&heartbeatAccounting.mutex);
+
+        QmHeartbeat::Wakeup wakeup;
+        wakeup.requested = waitRequested;
+        wakeup.time = QmHeartbeat::monotonicTime();
+        wakeup.mintime = waitMin;
+        wakeup.maxtime = waitMax;
+        wakeup.onSlot = monotonicMs() % (QmHeartbeat::WAKEUP_SLOT_30_SEC * 1000) < SLOT_TOLERANCE_MS;
+
+        qint64 opens = waitRequested;
+        qint64 closes;
+        qint64 lateAfter;
+        if (waitMin == waitMax && isSlot(waitMin)) {
+            /* A global slot fires at its first boundary on CLOCK_MONOTONIC
+             * after the wait, anywhere up to a slot away */
+            qint64 period = (qint64)waitMin * 1000;
+            qint64 boundary = (waitSlotBase / period + 1) * period;
+            closes = waitRequested + (boundary - waitSlotBase);
+            lateAfter = closes + SLOT_TOLERANCE_MS;
+        } else {
+            opens += (qint64)waitMin * 1000;
+            closes = waitRequested + (qint64)waitMax * 1000;
+            lateAfter = closes;
+        }
+
+        if (wakeup.time < opens) {
+            wakeup.slip = wakeup.time - opens;
+            statistics.early++;
+        } else if (wakeup.time > lateAfter) {
+            wakeup.slip = wakeup.time - closes;
+            statistics.late++;
+        }
+        wakeup.coalesced = wakeup.time + COALESCE_TOLERANCE_MS < closes;
+
+        qint64 slip = wakeup.slip < 0 ? -wakeup.slip : wakeup.slip;
+        statistics.wakeups++;
+        if (wakeup.coalesced)
+            statistics.coalesced++;
+        statistics.totalSlip += slip;
+        if (slip > statistics.maxSlip)
+            statistics.maxSlip = slip;
+        if (wakeup.onSlot)
+            statistics.onSlot++;
+        else
+            statistics.offSlot++;
+
+        history.append(wakeup);
+        if (history.size() > HISTORY_SIZE)
+            history.removeFirst();
+
+        waitRequested = -1;
+        lastWakeup = wakeup;
+        locker.unlock();
+        emit wokeUp(wakeup);
+    }
 
-    wait_time.elapsed();
     emit wakeUp(wait_time);
 }
 
 QmHeartbeat::QmHeartbeat(QObject *parent)
            : QObject(parent) {
     MEEGO_INITIALIZE(QmHeartbeat)
+
+    qRegisterMetaType<MeeGo::QmHeartbeat::Wakeup>("MeeGo::QmHeartbeat::Wakeup");
+    connect(priv, SIGNAL(wokeUp(MeeGo::QmHeartbeat::Wakeup)),
+            this, SIGNAL(wokeUp(MeeGo::QmHeartbeat::Wakeup)));
 }
 
 QmHeartbeat::~QmHeartbeat() {
@@ -152,7 +437,7 @@ void QmHeartbeat::close(void) {
 
 int QmHeartbeat::getFD() {
     MEEGO_PRIVATE(QmHeartbeat);
-    return iphb_get_fd(priv->iphbdHandler);
+    return QmIphbTransport::instance()->fd(priv->iphbdHandler);
 }
 
 bool QmHeartbeat::IWokeUp(void) {
@@ -161,7 +446,9 @@ bool QmHeartbeat::IWokeUp(void) {
     if (priv->notifier)
         priv->notifier->setEnabled(false);
 
-    int st = iphb_I_woke_up(priv->iphbdHandler);
+    priv->cancelWait();
+
+    int st = QmIphbTransport::instance()->wokeUp(priv->iphbdHandler);
     if (st >= 0) {
         // qDebug() << Q_FUNC_INFO << "Woke up, discared" << st << " bytes";
         return true;
@@ -189,13 +476,18 @@ QTime QmHeartbeat::wait(unsigned short mintime, unsigned short maxtime, QmHeartb
 
     if (wait == DoNotWaitHeartbeat) {
         priv->wait_time.start();
+        if (priv->notifier)
+            priv->startWait(mintime, maxtime);
+    } else {
+        priv->cancelWait();
     }
 
     //NOTE: This function could freeze the GUI if wait is not DoNotWaitHeartbeat
-    time_t unixTime = iphb_wait(priv->iphbdHandler, mintime, maxtime, (int) wait);
+    time_t unixTime = QmIphbTransport::instance()->wait(priv->iphbdHandler, mintime, maxtime, (int) wait);
 
     if (unixTime == (time_t) - 1) {
         LOG_ERROR;
+        priv->cancelWait();
     }
 
     QTime time = QDateTime::fromTime_t(unixTime).toUTC().time();
@@ -205,4 +497,69 @@ QTime QmHeartbeat::wait(unsigned short mintime, unsigned short maxtime, QmHeartb
     return time;
 }
 
+bool QmHeartbeat::waitAsync(unsigned short mintime, unsigned short maxtime) {
+    MEEGO_PRIVATE(QmHeartbeat);
+
+    if (!priv->notifier) {
+        qWarning() << Q_FUNC_INFO << "The heartbeat service is not open with SignalNeeded";
+        return false;
+    }
+
+    priv->notifier->setEnabled(true);
+    priv->wait_time.start();
+
+    if (QmIphbTransport::instance()->wait(priv->iphbdHandler, mintime, maxtime, 0) == (time_t) - 1) {
+        LOG_ERROR;
+        priv->notifier->setEnabled(false);
+        priv->cancelWait();
+        return false;
+    }
+
+    priv->startWait(mintime, maxtime);
+    return true;
+}
+
+QmHeartbeat::Wakeup QmHeartbeat::lastWakeup() const {
+    MEEGO_PRIVATE_CONST(QmHeartbeat);
+    QMutexLocker locker(&heartbeatAccounting.mutex);
+    return priv->lastWakeup;
+}
+
+QmHeartbeat::Statistics QmHeartbeat::statistics() const {
+    MEEGO_PRIVATE_CONST(QmHeartbeat);
+    QMutexLocker locker(&heartbeatAccounting.mutex);
+    return priv->statistics;
+}
+
+void QmHeartbeat::resetStatistics() {
+    MEEGO_PRIVATE(QmHeartbeat);
+    QMutexLocker locker(&heartbeatAccounting.mutex);
+    heartbeatAccounting.retire(priv);
+}
+
+QList<QmHeartbeat::Wakeup> QmHeartbeat::history() const {
+    MEEGO_PRIVATE_CONST(QmHeartbeat);
+    QMutexLocker locker(&heartbeatAccounting.mutex);
+    return priv->history;
+}
+
+QmHeartbeat::Statistics QmHeartbeat::totalStatistics() {
+    return heartbeatAccounting.total();
+}
+
+QString QmHeartbeat::report() {
+    return heartbeatAccounting.report();
+}
+
+qint64 QmHeartbeat::monotonicTime() {
+    struct timespec ts;
+#ifdef CLOCK_BOOTTIME
+    if (clock_gettime(CLOCK_BOOTTIME, &ts) == 0)
+        return (qint64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0)
+        return 0;
+    return (qint64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
 }
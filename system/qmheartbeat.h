@@ -34,6 +34,8 @@
 #define QMHEARTBEAT_H
 #include <QtCore/qobject.h>
 #include <QtCore/qdatetime.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qmetatype.h>
 
 #include "system_global.h"
 
@@ -126,6 +128,48 @@ public:
      */
     static const unsigned short WAKEUP_SLOT_10_HOURS;
 
+    /*!
+     * @brief A wakeup of waitAsync(). The times are milliseconds of monotonicTime().
+     */
+    struct Wakeup
+    {
+        Wakeup();
+
+        qint64 requested;        //!< When the wait was requested
+        qint64 time;             //!< When the wakeup was received
+        unsigned short mintime;  //!< The requested mintime in seconds
+        unsigned short maxtime;  //!< The requested maxtime in seconds
+        qint64 slip;             //!< How far the wakeup was out of the requested window,
+                                 //!< negative if before it, 0 inside it
+        bool coalesced;          //!< True if the wakeup came before the end of the window,
+                                 //!< or of the slot boundary for a global slot, i.e.
+                                 //!< together with the wakeups of others
+        bool onSlot;             //!< True if the wakeup came at a global slot, i.e. a
+                                 //!< multiple of WAKEUP_SLOT_30_SEC on CLOCK_MONOTONIC
+    };
+
+    /*!
+     * @brief Statistics of the wakeups of waitAsync() since open() or resetStatistics().
+     */
+    struct Statistics
+    {
+        Statistics();
+
+        int waits;               //!< Waits requested
+        int cancelled;           //!< Waits cancelled with IWokeUp() or close(), or replaced
+                                 //!< by another wait, so that waits == wakeups + cancelled
+                                 //!< once no wait is pending
+        int wakeups;             //!< Wakeups received
+        int coalesced;           //!< Wakeups before the end of their window, or before
+                                 //!< the slot boundary a global slot waited for
+        int early;               //!< Wakeups before their window
+        int late;                //!< Wakeups after their window
+        int onSlot;              //!< Wakeups at a global slot
+        int offSlot;             //!< Wakeups outside the global slots
+        qint64 totalSlip;        //!< Sum of the absolute slips in milliseconds
+        qint64 maxSlip;          //!< The largest absolute slip in milliseconds
+    };
+
     /*!
      * @brief Constructor
      * @param parent The parent object
@@ -191,6 +235,66 @@ public:
     */
     bool  IWokeUp(void);
 
+    /*!
+     * @brief Waits for the next heartbeat without blocking.
+     * @details The wokeUp() signal is emitted when the heartbeat has occurred, with the
+     *          times of the wait on the monotonic clock. A wait replaces the one pending.
+     *          The service must have been opened with SignalNeeded.
+     *
+     * @param mintime   Time in seconds that MUST be waited before heartbeat is reacted to, see wait()
+     * @param maxtime   Time in seconds when the wait MUST end, see wait()
+     *
+     * @return          True if success, false if error
+     */
+    bool waitAsync(unsigned short mintime, unsigned short maxtime);
+
+    /*!
+     * @brief Gets the last wakeup of waitAsync().
+     * @return The wakeup, with requested -1 if there has been none
+     */
+    Wakeup lastWakeup() const;
+
+    /*!
+     * @brief Gets the statistics of the wakeups of waitAsync().
+     * @return The statistics
+     */
+    Statistics statistics() const;
+
+    /*!
+     * @brief Clears the statistics and the history of the wakeups.
+     */
+    void resetStatistics();
+
+    /*!
+     * @brief Gets the last wakeups of waitAsync(), with their requested windows.
+     * @return At most 32 wakeups, the oldest first
+     */
+    QList<Wakeup> history() const;
+
+    /*!
+     * @brief Gets the statistics of all the heartbeats of the process, including
+     *        the ones closed or deleted already.
+     * @return The statistics
+     */
+    static Statistics totalStatistics();
+
+    /*!
+     * @brief Gets a report of the wakeups of each heartbeat of the process, one
+     *        line per heartbeat, named by its objectName() if it has one, a line for
+     *        the deleted heartbeats and the statistics reset, and the totals.
+     * @details The report is also written at exit if $QMSYSTEM_HEARTBEAT_STATS is set,
+     *          to stderr if it is "1" or "stderr", else appended to the file it names.
+     * @return The report
+     */
+    static QString report();
+
+    /*!
+     * @brief Gets the time of the clock of the wakeups. The clock runs on while
+     *        the device is suspended if the kernel supports it.
+     * @return Milliseconds since an unspecified moment
+     */
+    static qint64 monotonicTime();
+
 Q_SIGNALS:
     /*!
      * @brief Signaled when a heartbeat is received. To get the signal, use open()
@@ -199,6 +303,12 @@ Q_SIGNALS:
      */
     void wakeUp(QTime time);
 
+    /*!
+     * @brief Signaled when the heartbeat waited for with waitAsync() is received.
+     * @param wakeup The times of the wait
+     */
+    void wokeUp(const MeeGo::QmHeartbeat::Wakeup &wakeup);
+
 private:
     Q_DISABLE_COPY(QmHeartbeat)
     MEEGO_DECLARE_PRIVATE(QmHeartbeat)
@@ -206,6 +316,8 @@ private:
 
 } // MeeGo namespace
 
+Q_DECLARE_METATYPE(MeeGo::QmHeartbeat::Wakeup)
+
 QT_END_HEADER
 
 #endif /* QMHEARTBEAT_H */
@@ -28,12 +28,13 @@
 #define QMHEARTBEAT_P_H
 
 #include "qmheartbeat.h"
-extern "C" {
-#include <iphbd/libiphb.h>
-}
+#include "qmiphbtransport_p.h"
 #include <QSocketNotifier>
 #include <QTime>
 
+/* Set to log the wakeup statistics at exit, to stderr or to the file named */
+#define HEARTBEAT_STATS_ENV "QMSYSTEM_HEARTBEAT_STATS"
+
 namespace MeeGo
 {
 
@@ -51,10 +52,33 @@ namespace MeeGo
         iphb_t iphbdHandler;
         QmHeartbeat::SignalNeed signalNeed;
         QSocketNotifier *notifier;
-        QTime wait_time;
+        QTime wait_time;       // for the wakeUp signal only, it wraps at midnight
+
+        /* True for the WAKEUP_SLOT_* values */
+        static bool isSlot(unsigned short value);
+
+        /* Starts tracking a wait requested without blocking, a pending
+         * one is replaced */
+        void startWait(unsigned short mintime, unsigned short maxtime);
+
+        /* Stops tracking the pending wait, if any, as cancelled */
+        void cancelWait();
+
+        qint64 waitRequested;  // monotonicTime() of the pending wait, -1 if none
+        qint64 waitSlotBase;   // CLOCK_MONOTONIC ms of the pending wait, the slots are aligned to it
+        unsigned short waitMin;
+        unsigned short waitMax;
+
+        /* Guarded by the mutex of the process accounting, the report may
+         * be taken from any thread */
+        int number;            // in the report, in order of creation
+        QmHeartbeat::Wakeup lastWakeup;
+        QmHeartbeat::Statistics statistics;
+        QList<QmHeartbeat::Wakeup> history;
 
     Q_SIGNALS:
         void wakeUp(QTime);
+        void wokeUp(const MeeGo::QmHeartbeat::Wakeup &);
 
     private Q_SLOTS:
         void socketReady(int sock);
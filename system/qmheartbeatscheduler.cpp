@@ -0,0 +1,357 @@
+/*!
+ * @file qmheartbeatscheduler.cpp
+ * @brief QmHeartbeatScheduler
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#include "qmheartbeatscheduler.h"
+#include "qmheartbeatscheduler_p.h"
+#include "qmheartbeat_p.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QList>
+#include <QMetaObject>
+#include <QMutex>
+#include <QPointer>
+#include <QThread>
+
+/* The heartbeat service counts whole seconds, so a wakeup may come up to
+ * this much before the second a window opens at */
+#define DUE_TOLERANCE_MS 1000
+
+namespace MeeGo {
+
+static QMutex sharedMutex;
+static QPointer<QmHeartbeatScheduler> sharedScheduler;
+
+QmHeartbeatSchedulerPrivate::QmHeartbeatSchedulerPrivate()
+    : heartbeat(new QmHeartbeat(this)),
+      opened(false),
+      waiting(false),
+      dispatching(false),
+      requestedSlot(0),
+      lastId(0) {
+    heartbeat->setObjectName("QmHeartbeatScheduler");
+    connect(heartbeat, SIGNAL(wokeUp(MeeGo::QmHeartbeat::Wakeup)),
+            this, SLOT(wokeUp(MeeGo::QmHeartbeat::Wakeup)));
+}
+
+QmHeartbeatSchedulerPrivate::~QmHeartbeatSchedulerPrivate() {
+    if (opened) {
+        heartbeat->close();
+    }
+}
+
+bool QmHeartbeatSchedulerPrivate::isDue(const Timer &timer, qint64 now, unsigned short fired) {
+    if (timer.slot) {
+        /* Each slot is a multiple of the shorter ones, so firing a slot fires
+         * the shorter ones as well. A longer slot than the one waited for is
+         * due at the first wakeup after it has been waited for in full. */
+        return fired >= timer.slot ||
+               now + DUE_TOLERANCE_MS >= timer.started + (qint64)timer.slot * 1000;
+    }
+    return now + DUE_TOLERANCE_MS >= timer.started + (qint64)timer.mintime * 1000;
+}
+
+void QmHeartbeatSchedulerPrivate::schedule() {
+    if (dispatching) {
+        /* callDue() schedules once all the due timers have been called */
+        return;
+    }
+
+    if (timers.isEmpty()) {
+        if (waiting) {
+            heartbeat->IWokeUp();
+            waiting = false;
+        }
+        return;
+    }
+
+    qint64 now = QmHeartbeat::monotonicTime();
+    qint64 deadline = -1;    // the end of the first window to be over
+    unsigned short slot = 0; // the shortest global slot
+
+    for (QMap<int, Timer>::const_iterator it = timers.constBegin(); it != timers.constEnd(); ++it) {
+        const Timer &timer = it.value();
+        if (timer.slot) {
+            if (!slot || timer.slot < slot) {
+                slot = timer.slot;
+            }
+        } else {
+            qint64 end = timer.started + (qint64)timer.maxtime * 1000;
+            if (deadline < 0 || end < deadline) {
+                deadline = end;
+            }
+        }
+    }
+
+    if (deadline >= 0 && deadline <= now) {
+        /* A window is over already, e.g. the process was stopped */
+        QMetaObject::invokeMethod(this, "dispatch", Qt::QueuedConnection);
+        return;
+    }
+
+    unsigned short mintime, maxtime;
+
+    if (slot && (deadline < 0 || deadline >= now + (qint64)slot * 1000)) {
+        /* The slot fires before any window is over */
+        mintime = maxtime = slot;
+    } else {
+        /* Wake up as late as possible before the first window is over, so
+         * that as many windows as possible are open at the wakeup */
+        qint64 begin = now;
+        for (QMap<int, Timer>::const_iterator it = timers.constBegin(); it != timers.constEnd(); ++it) {
+            const Timer &timer = it.value();
+            if (!timer.slot) {
+                qint64 open = timer.started + (qint64)timer.mintime * 1000;
+                if (open <= deadline && open > begin) {
+                    begin = open;
+                }
+            }
+        }
+        mintime = (unsigned short)((begin - now) / 1000);
+        maxtime = (unsigned short)((deadline - now) / 1000);
+        if (maxtime < 1) {
+            maxtime = 1;
+        }
+        if (mintime > maxtime) {
+            mintime = maxtime;
+        }
+        slot = 0;
+    }
+
+    requestedSlot = slot;
+    waiting = heartbeat->waitAsync(mintime, maxtime);
+}
+
+void QmHeartbeatSchedulerPrivate::callDue(qint64 now, unsigned short fired) {
+    MEEGO_PUBLIC(QmHeartbeatScheduler);
+
+    /* The windows go under 0, before the slots */
+    QMap<unsigned short, QList<int> > batches;
+    for (QMap<int, Timer>::const_iterator it = timers.constBegin(); it != timers.constEnd(); ++it) {
+        if (isDue(it.value(), now, fired)) {
+            batches[it.value().slot].append(it.key());
+        }
+    }
+
+    dispatching = true;
+
+    for (QMap<unsigned short, QList<int> >::const_iterator batch = batches.constBegin();
+         batch != batches.constEnd(); ++batch) {
+        foreach (int id, batch.value()) {
+            QMap<int, Timer>::iterator it = timers.find(id);
+            if (it == timers.end()) {
+                /* Stopped by an earlier timer of this wakeup */
+                continue;
+            }
+
+            Timer timer = it.value();
+            if (timer.hasReceiver && timer.receiver.isNull()) {
+                /* The receiver has been deleted */
+                timers.erase(it);
+                continue;
+            }
+            if (timer.repeat) {
+                it.value().started = now;
+            } else {
+                timers.erase(it);
+            }
+
+            if (timer.hasReceiver) {
+                /* Queued to a receiver living in another thread */
+                if (timer.withId) {
+                    QMetaObject::invokeMethod(timer.receiver, timer.method.constData(),
+                                              Qt::AutoConnection, Q_ARG(int, id));
+                } else {
+                    QMetaObject::invokeMethod(timer.receiver, timer.method.constData(),
+                                              Qt::AutoConnection);
+                }
+            }
+            emit pub->timeout(id);
+        }
+    }
+
+    dispatching = false;
+    schedule();
+}
+
+Qt::ConnectionType QmHeartbeatSchedulerPrivate::callType() const {
+    return thread() == QThread::currentThread() ? Qt::DirectConnection
+                                                : Qt::BlockingQueuedConnection;
+}
+
+int QmHeartbeatSchedulerPrivate::add(int mintime, int maxtime, bool repeat, QObject *receiver,
+                                     const QByteArray &method, bool withId) {
+    Timer timer;
+    timer.mintime = (unsigned short)mintime;
+    timer.maxtime = (unsigned short)maxtime;
+    timer.slot = (mintime == maxtime && QmHeartbeatPrivate::isSlot(mintime)) ? timer.mintime : 0;
+    timer.repeat = repeat;
+    timer.hasReceiver = receiver != 0;
+    timer.receiver = receiver;
+    timer.method = method;
+    timer.withId = withId;
+
+    if (!opened) {
+        if (!heartbeat->open(QmHeartbeat::SignalNeeded)) {
+            return 0;
+        }
+        opened = true;
+    }
+
+    /* Skip ids still in use after the counter has wrapped */
+    do {
+        if (++lastId <= 0) {
+            lastId = 1;
+        }
+    } while (timers.contains(lastId));
+
+    timer.started = QmHeartbeat::monotonicTime();
+    timers.insert(lastId, timer);
+    schedule();
+
+    return lastId;
+}
+
+bool QmHeartbeatSchedulerPrivate::remove(int id) {
+    if (!timers.remove(id)) {
+        return false;
+    }
+    schedule();
+    return true;
+}
+
+bool QmHeartbeatSchedulerPrivate::contains(int id) const {
+    return timers.contains(id);
+}
+
+int QmHeartbeatSchedulerPrivate::size() const {
+    return timers.size();
+}
+
+void QmHeartbeatSchedulerPrivate::dispatch() {
+    callDue(QmHeartbeat::monotonicTime(), 0);
+}
+
+void QmHeartbeatSchedulerPrivate::wokeUp(const MeeGo::QmHeartbeat::Wakeup &wakeup) {
+    waiting = false;
+    callDue(wakeup.time, requestedSlot);
+}
+
+QmHeartbeatScheduler::QmHeartbeatScheduler(QObject *parent)
+                    : QObject(parent) {
+    MEEGO_INITIALIZE(QmHeartbeatScheduler);
+}
+
+QmHeartbeatScheduler::~QmHeartbeatScheduler() {
+    MEEGO_UNINITIALIZE(QmHeartbeatScheduler);
+}
+
+QmHeartbeatScheduler *QmHeartbeatScheduler::instance() {
+    QCoreApplication *app = QCoreApplication::instance();
+    if (!app) {
+        qWarning() << Q_FUNC_INFO << "No QCoreApplication, the shared scheduler would never be deleted";
+        return 0;
+    }
+
+    QMutexLocker locker(&sharedMutex);
+    if (sharedScheduler.isNull()) {
+        QmHeartbeatScheduler *scheduler = new QmHeartbeatScheduler();
+        if (scheduler->thread() != app->thread()) {
+            /* Served by the event loop of the application, whoever asked first */
+            scheduler->priv_func()->moveToThread(app->thread());
+            scheduler->moveToThread(app->thread());
+        }
+        /* Deleted with the application, which closes the connection */
+        scheduler->setParent(app);
+        sharedScheduler = scheduler;
+    }
+    return sharedScheduler;
+}
+
+int QmHeartbeatScheduler::start(unsigned short mintime, unsigned short maxtime, bool repeat,
+                                QObject *receiver, const char *member) {
+    MEEGO_PRIVATE(QmHeartbeatScheduler);
+
+    if (maxtime == 0 || mintime > maxtime) {
+        qWarning() << Q_FUNC_INFO << "Invalid window" << mintime << maxtime;
+        return 0;
+    }
+
+    QByteArray method;
+    bool withId = false;
+    if (receiver) {
+        if (!member || (member[0] - '0') != QSLOT_CODE) {
+            qWarning() << Q_FUNC_INFO << "Not a slot:" << member;
+            return 0;
+        }
+        QByteArray signature = QMetaObject::normalizedSignature(member + 1);
+        if (receiver->metaObject()->indexOfMethod(signature.constData()) < 0) {
+            qWarning() << Q_FUNC_INFO << "No such slot:" << signature;
+            return 0;
+        }
+        int paren = signature.indexOf('(');
+        QByteArray arguments = signature.mid(paren);
+        if (arguments == "(int)") {
+            withId = true;
+        } else if (arguments != "()") {
+            qWarning() << Q_FUNC_INFO << "The slot must take no argument or an int:" << signature;
+            return 0;
+        }
+        method = signature.left(paren);
+    }
+
+    int id = 0;
+    QMetaObject::invokeMethod(priv, "add", priv->callType(), Q_RETURN_ARG(int, id),
+                              Q_ARG(int, mintime), Q_ARG(int, maxtime), Q_ARG(bool, repeat),
+                              Q_ARG(QObject *, receiver), Q_ARG(QByteArray, method),
+                              Q_ARG(bool, withId));
+    return id;
+}
+
+bool QmHeartbeatScheduler::stop(int id) {
+    MEEGO_PRIVATE(QmHeartbeatScheduler);
+
+    bool stopped = false;
+    QMetaObject::invokeMethod(priv, "remove", priv->callType(),
+                              Q_RETURN_ARG(bool, stopped), Q_ARG(int, id));
+    return stopped;
+}
+
+bool QmHeartbeatScheduler::isActive(int id) const {
+    MEEGO_PRIVATE_CONST(QmHeartbeatScheduler);
+
+    bool active = false;
+    QMetaObject::invokeMethod(const_cast<QmHeartbeatSchedulerPrivate *>(priv), "contains",
+                              priv->callType(), Q_RETURN_ARG(bool, active), Q_ARG(int, id));
+    return active;
+}
+
+int QmHeartbeatScheduler::count() const {
+    MEEGO_PRIVATE_CONST(QmHeartbeatScheduler);
+
+    int timers = 0;
+    QMetaObject::invokeMethod(const_cast<QmHeartbeatSchedulerPrivate *>(priv), "size",
+                              priv->callType(), Q_RETURN_ARG(int, timers));
+    return timers;
+}
+
+} // MeeGo namespace
@@ -0,0 +1,152 @@
+/*!
+ * @file qmheartbeatscheduler.h
+ * @brief Contains QmHeartbeatScheduler which runs many heartbeat timers over one heartbeat connection.
+
+   <p>
+   @copyright (C) 2009-2011 Nokia Corporation
+   @license LGPL Lesser General Public License
+
+   @scope Nokia Meego
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#ifndef QMHEARTBEATSCHEDULER_H
+#define QMHEARTBEATSCHEDULER_H
+
+#include "system_global.h"
+
+#include <QtCore/qobject.h>
+
+QT_BEGIN_HEADER
+
+namespace MeeGo {
+
+class QmHeartbeatSchedulerPrivate;
+
+/*!
+ * @scope Nokia Meego
+ *
+ * @class QmHeartbeatScheduler
+ * @brief QmHeartbeatScheduler runs any number of heartbeat timers over a single
+ * heartbeat service connection.
+ * @details Each QmHeartbeat is a connection of its own to the heartbeat service.
+ * The scheduler keeps one connection for all its timers: it always asks the
+ * service for the narrowest wakeup window that serves the most timers without
+ * missing any deadline, and on each wakeup it calls every timer that is due.
+ * <p>
+ * A timer is either a window, called once at least mintime and at most maxtime
+ * seconds after it was started, or a global slot, started with the same
+ * QmHeartbeat::WAKEUP_SLOT_* value as mintime and maxtime. The timers of a slot
+ * are called together, when the service fires the slot, and a wakeup calls the
+ * due slots in ascending order, from WAKEUP_SLOT_30_SEC to WAKEUP_SLOT_10_HOURS,
+ * after the due windows. A repeating timer is started again when it has been
+ * called.
+ * </p>
+ * <p>
+ * The timers of the whole process should share instance(), which makes the
+ * process wake up as few times as possible.
+ * </p>
+ * <p>
+ * The timers and the heartbeat connection are only touched in the thread the
+ * scheduler lives in. start(), stop(), isActive() and count() may be called
+ * from any thread: from another one they wait until the event loop of the
+ * scheduler's thread has run them, so that thread must not be blocked on the
+ * caller. A receiver living in another thread than the scheduler is called
+ * through the event loop of its own thread.
+ * </p>
+ * @code
+ * QmHeartbeatScheduler *scheduler = QmHeartbeatScheduler::instance();
+ * scheduler->start(QmHeartbeat::WAKEUP_SLOT_5_MINS, QmHeartbeat::WAKEUP_SLOT_5_MINS,
+ *                  true, this, SLOT(poll()));
+ * scheduler->start(50, 70, false, this, SLOT(retry(int)));
+ * @endcode
+ */
+class MEEGO_SYSTEM_EXPORT QmHeartbeatScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * @brief Constructor
+     * @param parent The parent object
+     */
+    QmHeartbeatScheduler(QObject *parent = 0);
+    ~QmHeartbeatScheduler();
+
+    /*!
+     * @brief Gets the scheduler shared by the whole process.
+     *
+     * The scheduler is created at the first call, from any thread, and lives
+     * in the thread of the application until the application is deleted.
+     *
+     * @return The scheduler, owned by the library, or 0 if there is no QCoreApplication
+     */
+    static QmHeartbeatScheduler *instance();
+
+    /*!
+     * @brief Starts a timer.
+     * @param mintime  Time in seconds that must pass before the timer is called,
+     *                 or a QmHeartbeat::WAKEUP_SLOT_* value for a global slot timer
+     * @param maxtime  Time in seconds by which the timer must be called, the same
+     *                 value as mintime for a global slot timer
+     * @param repeat   True if the timer is started again each time it is called
+     * @param receiver The object to call, or 0 to use the timeout() signal only
+     * @param member   The slot of receiver, as given by SLOT(), which takes either
+     *                 no argument or the id of the timer as an int
+     * @return The id of the timer, 0 if the arguments are not valid or the
+     *         heartbeat service can't be opened
+     */
+    int start(unsigned short mintime, unsigned short maxtime, bool repeat,
+              QObject *receiver = 0, const char *member = 0);
+
+    /*!
+     * @brief Stops a timer. A one-shot timer is stopped once it has been called.
+     * @param id The id of the timer
+     * @return False if the timer is not running
+     */
+    bool stop(int id);
+
+    /*!
+     * @brief Checks whether a timer is running.
+     * @param id The id of the timer
+     * @return True if the timer is running
+     */
+    bool isActive(int id) const;
+
+    /*!
+     * @brief Gets the number of running timers.
+     * @return The number of timers
+     */
+    int count() const;
+
+Q_SIGNALS:
+    /*!
+     * @brief Sent for each timer that is due, after its receiver has been called,
+     * or the call has been queued to the thread of the receiver.
+     * @param id The id of the timer
+     */
+    void timeout(int id);
+
+private:
+    Q_DISABLE_COPY(QmHeartbeatScheduler)
+    MEEGO_DECLARE_PRIVATE(QmHeartbeatScheduler)
+};
+
+} // MeeGo namespace
+
+QT_END_HEADER
+
+#endif // QMHEARTBEATSCHEDULER_H
@@ -0,0 +1,94 @@
+/*!
+ * @file qmheartbeatscheduler_p.h
+ * @brief Contains QmHeartbeatSchedulerPrivate
+
+   <p>
+   @copyright (C) 2009-2011 Nokia Corporation
+   @license LGPL Lesser General Public License
+
+   @scope Private
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#ifndef QMHEARTBEATSCHEDULER_P_H
+#define QMHEARTBEATSCHEDULER_P_H
+
+#include "qmheartbeatscheduler.h"
+#include "qmheartbeat.h"
+
+#include <QByteArray>
+#include <QMap>
+#include <QPointer>
+
+namespace MeeGo
+{
+    class QmHeartbeatSchedulerPrivate : public QObject
+    {
+        Q_OBJECT
+        MEEGO_DECLARE_PUBLIC(QmHeartbeatScheduler)
+
+    public:
+        struct Timer
+        {
+            unsigned short mintime;
+            unsigned short maxtime;
+            unsigned short slot;       // WAKEUP_SLOT_* of a global slot timer, 0 for a window
+            bool repeat;
+            bool hasReceiver;
+            QPointer<QObject> receiver;
+            QByteArray method;         // name of the slot of receiver
+            bool withId;               // the slot takes the id of the timer
+            qint64 started;            // QmHeartbeat::monotonicTime() when it was started
+        };
+
+        QmHeartbeatSchedulerPrivate();
+        ~QmHeartbeatSchedulerPrivate();
+
+        /* True if the timer is to be called at a wakeup at now, fired
+         * the global slot the service was asked for, or 0 */
+        static bool isDue(const Timer &timer, qint64 now, unsigned short fired);
+
+        /* Asks the service for the next wakeup of the timers */
+        void schedule();
+        /* Calls the due timers, in batches by slot, and schedules again */
+        void callDue(qint64 now, unsigned short fired);
+
+        /* How the public calls reach the slots below from the current thread */
+        Qt::ConnectionType callType() const;
+
+        QmHeartbeat *heartbeat;
+        bool opened;
+        bool waiting;
+        bool dispatching;
+        unsigned short requestedSlot;  // the global slot waited for, 0 for a window
+        int lastId;
+        QMap<int, Timer> timers;
+
+        /* The public calls, run in the thread of the scheduler, which is the
+         * only one touching timers and heartbeat */
+        Q_INVOKABLE int add(int mintime, int maxtime, bool repeat, QObject *receiver,
+                            const QByteArray &method, bool withId);
+        Q_INVOKABLE bool remove(int id);
+        Q_INVOKABLE bool contains(int id) const;
+        Q_INVOKABLE int size() const;
+
+    private Q_SLOTS:
+        void dispatch();
+        void wokeUp(const MeeGo::QmHeartbeat::Wakeup &wakeup);
+    };
+}
+
+#endif // QMHEARTBEATSCHEDULER_P_H
@@ -25,9 +25,138 @@
    </p>
  */
 #include "qmipcinterface_p.h"
+#include "qmipcstatistics.h"
+
+#include <QFile>
+#include <QMap>
+#include <QMutex>
+#include <QStringList>
+#include <QTextStream>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LATENCY_BUCKETS 10
 
 namespace MeeGo {
 
+/* Upper bounds of the reply latency buckets in ms, the last bucket is open */
+static const int bucketLimits[LATENCY_BUCKETS - 1] = { 1, 2, 5, 10, 20, 50, 100, 500, 1000 };
+
+static qint64 monotonicUsec() {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0) {
+        return 0;
+    }
+    return (qint64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+class IPCStatistics
+{
+public:
+    ~IPCStatistics() {
+        const char *env = getenv(QMIPC_STATS_ENV);
+        if (!env || !*env) {
+            return;
+        }
+
+        QFile file;
+        if (!strcmp(env, "1") || !strcmp(env, "stderr")) {
+            file.open(stderr, QIODevice::WriteOnly);
+        } else {
+            file.setFileName(QFile::decodeName(env));
+            file.open(QIODevice::WriteOnly | QIODevice::Append);
+        }
+        if (file.isOpen()) {
+            QTextStream stream(&file);
+            stream << "qmsystem2 D-Bus calls of pid " << getpid() << "\n" << dump();
+        }
+    }
+
+    void recordReply(const QString &service, const QString &method, qint64 usec, bool error) {
+        QMutexLocker locker(&mutex_);
+
+        Method &stats = methods_[service + ' ' + method];
+        stats.calls++;
+        if (error) {
+            stats.errors++;
+        }
+        stats.totalUsec += usec;
+        if (usec > stats.maxUsec) {
+            stats.maxUsec = usec;
+        }
+
+        int bucket = 0;
+        while (bucket < LATENCY_BUCKETS - 1 && usec >= bucketLimits[bucket] * 1000) {
+            bucket++;
+        }
+        stats.histogram[bucket]++;
+    }
+
+    void recordNoReply(const QString &service, const QString &method) {
+        QMutexLocker locker(&mutex_);
+        methods_[service + ' ' + method].noReplyCalls++;
+    }
+
+    QString dump() {
+        QMutexLocker locker(&mutex_);
+
+        QString result;
+        QTextStream stream(&result);
+
+        stream << "# service method calls noreply errors avg_ms max_ms |";
+        for (int i = 0; i < LATENCY_BUCKETS - 1; i++) {
+            stream << " <" << bucketLimits[i];
+        }
+        stream << " >=" << bucketLimits[LATENCY_BUCKETS - 2] << " ms\n";
+
+        QMap<QString, Method>::const_iterator it;
+        for (it = methods_.constBegin(); it != methods_.constEnd(); ++it) {
+            const Method &stats = it.value();
+            double avg = stats.calls ? stats.totalUsec / 1000.0 / stats.calls : 0.0;
+
+            stream << it.key() << ' ' << stats.calls << ' ' << stats.noReplyCalls << ' '
+                   << stats.errors << ' ' << QString::number(avg, 'f', 2) << ' '
+                   << QString::number(stats.maxUsec / 1000.0, 'f', 2) << " |";
+            for (int i = 0; i < LATENCY_BUCKETS; i++) {
+                stream << ' ' << stats.histogram[i];
+            }
+            stream << '\n';
+        }
+        stream.flush();
+        return result;
+    }
+
+    void reset() {
+        QMutexLocker locker(&mutex_);
+        methods_.clear();
+    }
+
+private:
+    struct Method
+    {
+        Method() : calls(0), noReplyCalls(0), errors(0), totalUsec(0), maxUsec(0) {
+            memset(histogram, 0, sizeof(histogram));
+        }
+
+        quint64 calls;          /* calls with a reply, errors included */
+        quint64 noReplyCalls;
+        quint64 errors;
+        qint64 totalUsec;
+        qint64 maxUsec;
+        quint64 histogram[LATENCY_BUCKETS];
+    };
+
+    QMutex mutex_;
+    QMap<QString, Method> methods_;     /* sorted for the dump */
+};
+
+/* Destroyed at exit, when it logs the statistics if asked to */
+static IPCStatistics ipcStatistics;
+
 // Note: QDBusAbstractInterface is used instead of QDBusInterface for performance reasons --
 // QDBusInterface uses blocking D-Bus call in constructor (http://bugreports.qt.nokia.com/browse/QTBUG-14485)
 QmIPCInterface::QmIPCInterface(const char* service,
@@ -50,17 +179,72 @@ void QmIPCInterface::callAsynchronously(const QString& method,
     // As no feedback is needed on the D-Bus call, calling QDBusAbstractInterface
     // with QDBus::NoBlock is faster than calling asyncCall() with QDBusPendingCall.
     (void)call(QDBus::NoBlock, method, arg1, arg2);
+    ipcStatistics.recordNoReply(service(), method);
 }
 
 QList<QVariant> QmIPCInterface::get(const QString& method,
                                     const QVariant& arg1,
                                     const QVariant& arg2) {
     QList<QVariant> results;
+    qint64 start = monotonicUsec();
     QDBusMessage msg = call(method, arg1, arg2);
-    if (msg.type() == QDBusMessage::ReplyMessage) {
+    bool error = msg.type() != QDBusMessage::ReplyMessage;
+    ipcStatistics.recordReply(service(), method, monotonicUsec() - start, error);
+    if (!error) {
         results  = msg.arguments();
     }
     return results;
 }
 
+QDBusPendingCallWatcher* QmIPCInterface::getAsync(const QString& method,
+                                                  const QVariant& arg1,
+                                                  const QVariant& arg2) {
+    return new QmIPCWatcher(asyncCall(method, arg1, arg2), service(), method, this);
+}
+
+QDBusMessage QmIPCInterface::callMessage(const QDBusMessage &message, int timeout) {
+    qint64 start = monotonicUsec();
+    QDBusMessage reply = QDBusConnection::systemBus().call(message, QDBus::Block, timeout);
+    ipcStatistics.recordReply(message.service(), message.member(), monotonicUsec() - start,
+                              reply.type() != QDBusMessage::ReplyMessage);
+    return reply;
+}
+
+QDBusPendingCallWatcher* QmIPCInterface::asyncCallMessage(const QDBusMessage &message,
+                                                          QObject *parent,
+                                                          int timeout) {
+    return new QmIPCWatcher(QDBusConnection::systemBus().asyncCall(message, timeout),
+                            message.service(), message.member(), parent);
+}
+
+QList<QVariant> QmIPCInterface::results(QDBusPendingCallWatcher *watcher) {
+    QList<QVariant> results;
+    QDBusMessage msg = watcher->reply();
+    if (msg.type() == QDBusMessage::ReplyMessage) {
+        results = msg.arguments();
+    }
+    return results;
+}
+
+QmIPCWatcher::QmIPCWatcher(const QDBusPendingCall &call, const QString &service,
+                           const QString &method, QObject *parent)
+            : QDBusPendingCallWatcher(call, parent),
+              service_(service),
+              method_(method),
+              start_(monotonicUsec()) {
+    connect(this, SIGNAL(finished(QDBusPendingCallWatcher*)), this, SLOT(didReceiveReply()));
+}
+
+void QmIPCWatcher::didReceiveReply() {
+    ipcStatistics.recordReply(service_, method_, monotonicUsec() - start_, isError());
+}
+
+QString QmIPCStatistics::dump() {
+    return ipcStatistics.dump();
+}
+
+void QmIPCStatistics::reset() {
+    ipcStatistics.reset();
+}
+
 } // Namespace MeeGo
@@ -36,6 +36,11 @@
 #include "system_global.h"
 
 #include <QDBusAbstractInterface>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+
+/* Set to log the call statistics at exit, to stderr or to the file named */
+#define QMIPC_STATS_ENV "QMSYSTEM_IPC_STATS"
 
 namespace MeeGo {
 
@@ -61,6 +66,50 @@ public:
     void callAsynchronously(const QString& method,
                             const QVariant& arg1 = QVariant(),
                             const QVariant& arg2 = QVariant());
+
+    /*
+     * Makes a non-blocking call with feedback. The returned watcher emits
+     * finished() when the reply has arrived; pass it to results() and
+     * delete it with deleteLater() in the slot. A pending watcher is
+     * deleted with the interface.
+     */
+    QDBusPendingCallWatcher* getAsync(const QString& method,
+                                      const QVariant& arg1 = QVariant(),
+                                      const QVariant& arg2 = QVariant());
+
+    /* The arguments of a finished call, as returned by get() */
+    static QList<QVariant> results(QDBusPendingCallWatcher *watcher);
+
+    /*
+     * Blocking and non-blocking calls of a prepared message on the system
+     * bus, for the callers that need a timeout or build the message
+     * themselves. Counted in QmIPCStatistics like the calls above.
+     */
+    static QDBusMessage callMessage(const QDBusMessage &message, int timeout = -1);
+    static QDBusPendingCallWatcher* asyncCallMessage(const QDBusMessage &message,
+                                                     QObject *parent = 0,
+                                                     int timeout = -1);
+};
+
+/*
+ * Records the reply of a call in QmIPCStatistics. Its own slot is
+ * connected first, so it runs before the slots of the caller.
+ */
+class QmIPCWatcher : public QDBusPendingCallWatcher
+{
+    Q_OBJECT
+
+public:
+    QmIPCWatcher(const QDBusPendingCall &call, const QString &service,
+                 const QString &method, QObject *parent = 0);
+
+private Q_SLOTS:
+    void didReceiveReply();
+
+private:
+    QString service_;
+    QString method_;
+    qint64 start_;          // us, monotonic
 };
 
 } // MeeGo namespace
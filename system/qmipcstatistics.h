@@ -0,0 +1,83 @@
+/*!
+ * @file qmipcstatistics.h
+ * @brief Contains QmIPCStatistics.
+
+   <p>
+   @copyright (C) 2009-2011 Nokia Corporation
+   @license LGPL Lesser General Public License
+
+   @scope Nokia Meego
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#ifndef QMIPCSTATISTICS_H
+#define QMIPCSTATISTICS_H
+
+#include "system_global.h"
+
+#include <QString>
+
+namespace MeeGo {
+
+/*!
+ *
+ * @scope Nokia Meego
+ *
+ * Statistics of the D-Bus calls the library has made in this process.
+ *
+ * The calls are counted per service and method, together with the calls
+ * made without waiting for a reply, the error replies, and the average,
+ * the maximum and a histogram of the reply latencies. Setting
+ * $QMSYSTEM_IPC_STATS to 1 logs the statistics to stderr at exit, any
+ * other value names the file they are appended to.
+ *
+\code
+#include <qmipcstatistics.h>
+
+MeeGo::QmIPCStatistics::reset();
+// ... use the library
+qDebug() << MeeGo::QmIPCStatistics::dump();
+\endcode
+
+ */
+class MEEGO_SYSTEM_EXPORT QmIPCStatistics
+{
+public:
+    /*!
+     * @brief Gets the statistics as text.
+     *
+     * The first line is a header naming the columns, followed by one line
+     * per method: the service, the method, the calls with a reply (errors
+     * included), the calls without a reply, the errors, the average and the
+     * maximum latency in ms, and after a '|' the counts of the latency
+     * histogram buckets.
+     *
+     * @return The statistics since the start of the process or reset().
+     */
+    static QString dump();
+
+    /*!
+     * @brief Clears the statistics.
+     */
+    static void reset();
+
+private:
+    QmIPCStatistics();
+};
+
+} // MeeGo namespace
+
+#endif // QMIPCSTATISTICS_H
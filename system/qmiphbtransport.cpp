@@ -0,0 +1,252 @@
+/*!
+ * @file qmiphbtransport.cpp
+ * @brief QmIphbTransport
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#include "qmiphbtransport_p.h"
+
+#include <QByteArray>
+#include <QDebug>
+
+extern "C" {
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+}
+
+namespace MeeGo {
+
+/*------------ class QmIphbLibTransport ------------*/
+
+class QmIphbLibTransport : public QmIphbTransport
+{
+public:
+    iphb_t open() { return ::iphb_open(0); }
+    int fd(iphb_t handle) { return ::iphb_get_fd(handle); }
+
+    time_t wait(iphb_t handle, unsigned short mintime, unsigned short maxtime, int mustWait)
+    {
+        return ::iphb_wait(handle, mintime, maxtime, mustWait);
+    }
+
+    int discardWakeups(iphb_t handle) { return ::iphb_discard_wakeups(handle); }
+    int wokeUp(iphb_t handle) { return ::iphb_I_woke_up(handle); }
+    iphb_t close(iphb_t handle) { return ::iphb_close(handle); }
+};
+
+#ifdef QMSYSTEM_IPHBSIM
+
+/*------------ class QmIphbSimTransport ------------*/
+
+class QmIphbSimTransport : public QmIphbTransport
+{
+public:
+    QmIphbSimTransport(const QByteArray &path) : path_(path)
+    {
+        qDebug() << "QmHeartbeat: using the simulated iphbd at" << path;
+    }
+
+    iphb_t open()
+    {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (path_.size() >= (int)sizeof(addr.sun_path)) {
+            errno = ENAMETOOLONG;
+            return 0;
+        }
+        strcpy(addr.sun_path, path_.constData());
+
+        int sd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (sd < 0)
+            return 0;
+        fcntl(sd, F_SETFD, FD_CLOEXEC);
+        if (::connect(sd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+            int error = errno;
+            ::close(sd);
+            errno = error;
+            return 0;
+        }
+        return (iphb_t)new Handle(sd);
+    }
+
+    int fd(iphb_t handle)
+    {
+        if (!handle) {
+            errno = EINVAL;
+            return -1;
+        }
+        return ((Handle *)handle)->sd;
+    }
+
+    time_t wait(iphb_t handle, unsigned short mintime, unsigned short maxtime, int mustWait)
+    {
+        if (!handle || mintime > maxtime) {
+            errno = EINVAL;
+            return (time_t)-1;
+        }
+        int sd = ((Handle *)handle)->sd;
+
+        /* A pending wakeup belongs to the wait being replaced */
+        discard_(sd);
+
+        QmIphbSimRequest request;
+        memset(&request, 0, sizeof(request));
+        request.command = QmIphbSimRequest::Wait;
+        request.mintime = mintime;
+        request.maxtime = maxtime;
+        request.pid = getpid();
+
+        time_t start = time(0);
+        if (!write_(sd, &request, sizeof(request)))
+            return (time_t)-1;
+        if (!mustWait)
+            return 0;
+
+        QmIphbSimWakeup wakeup;
+        if (!read_(sd, &wakeup, sizeof(wakeup)))
+            return (time_t)-1;
+        return time(0) - start;
+    }
+
+    int discardWakeups(iphb_t handle)
+    {
+        if (!handle) {
+            errno = EINVAL;
+            return -1;
+        }
+        return discard_(((Handle *)handle)->sd);
+    }
+
+    int wokeUp(iphb_t handle)
+    {
+        if (!handle) {
+            errno = EINVAL;
+            return -1;
+        }
+        int sd = ((Handle *)handle)->sd;
+
+        QmIphbSimRequest request;
+        memset(&request, 0, sizeof(request));
+        request.command = QmIphbSimRequest::Cancel;
+        request.pid = getpid();
+        if (!write_(sd, &request, sizeof(request)))
+            return -1;
+        return discard_(sd);
+    }
+
+    iphb_t close(iphb_t handle)
+    {
+        if (handle) {
+            ::close(((Handle *)handle)->sd);
+            delete (Handle *)handle;
+        }
+        return 0;
+    }
+
+private:
+    struct Handle
+    {
+        Handle(int sd) : sd(sd) {}
+        int sd;
+    };
+
+    /* Reads what is available, as iphb_discard_wakeups() */
+    static int discard_(int sd)
+    {
+        int total = 0;
+        char buf[64];
+        while (true) {
+            ssize_t n = ::recv(sd, buf, sizeof(buf), MSG_DONTWAIT);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                return total;
+            if (n <= 0) {
+                errno = EIO;
+                return -1;
+            }
+            total += n;
+        }
+    }
+
+    static bool write_(int sd, const void *data, int len)
+    {
+        const char *p = (const char *)data;
+        while (len > 0) {
+            ssize_t n = ::send(sd, p, len, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            p += n;
+            len -= n;
+        }
+        return true;
+    }
+
+    /* Blocks as long as the wait takes, as iphb_wait() does */
+    static bool read_(int sd, void *data, int len)
+    {
+        char *p = (char *)data;
+        while (len > 0) {
+            ssize_t n = ::recv(sd, p, len, 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0) {
+                errno = EIO;
+                return false;
+            }
+            p += n;
+            len -= n;
+        }
+        return true;
+    }
+
+    QByteArray path_;
+};
+
+#endif /* QMSYSTEM_IPHBSIM */
+
+/*------------ class QmIphbTransport ------------*/
+
+static QmIphbTransport* createTransport()
+{
+#ifdef QMSYSTEM_IPHBSIM
+    const char *path = getenv(IPHBSIM_ENV);
+    if (path && *path)
+        return new QmIphbSimTransport(QByteArray(path));
+#endif
+    return new QmIphbLibTransport();
+}
+
+QmIphbTransport* QmIphbTransport::instance()
+{
+    /* Chosen once per process */
+    static QmIphbTransport *transport = createTransport();
+    return transport;
+}
+
+} // MeeGo namespace
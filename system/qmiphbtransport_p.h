@@ -0,0 +1,95 @@
+/*!
+ * @file qmiphbtransport_p.h
+ * @brief Contains QmIphbTransport, the connection to the heartbeat daemon
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   @scope Private
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#ifndef QMIPHBTRANSPORT_P_H
+#define QMIPHBTRANSPORT_P_H
+
+#include <QtGlobal>
+
+#include <time.h>
+
+extern "C" {
+#include <iphbd/libiphb.h>
+}
+
+/*
+ * If set, QmHeartbeat talks to a simulated iphbd listening on the UNIX
+ * socket the variable names instead of the real one. Only in the host
+ * builds made with CONFIG+=iphbsim, which define QMSYSTEM_IPHBSIM.
+ */
+#define IPHBSIM_ENV "QMSYSTEM_IPHB_SIMULATOR"
+
+namespace MeeGo
+{
+    /*
+     * The simulator protocol. The client sends requests, the simulator
+     * answers a wait with the CLOCK_MONOTONIC milliseconds of the wakeup
+     * when the wait ends. A cancel drops the pending wait, a new wait
+     * replaces it. The simulator fires the global slots at the multiples of
+     * the slot on CLOCK_MONOTONIC.
+     */
+    struct QmIphbSimRequest
+    {
+        enum Command
+        {
+            Wait = 1,
+            Cancel
+        };
+
+        qint32 command;
+        quint16 mintime;
+        quint16 maxtime;
+        qint32 pid;
+    };
+
+    typedef qint64 QmIphbSimWakeup;
+
+    /**
+     * The calls of libiphb that QmHeartbeat uses, so that they can be
+     * served by something else than iphbd.
+     */
+    class QmIphbTransport
+    {
+    public:
+        virtual ~QmIphbTransport() {}
+
+        /* As iphb_open(), iphb_get_fd(), iphb_wait(), iphb_discard_wakeups(),
+         * iphb_I_woke_up() and iphb_close() */
+        virtual iphb_t open() = 0;
+        virtual int fd(iphb_t handle) = 0;
+        virtual time_t wait(iphb_t handle, unsigned short mintime, unsigned short maxtime, int mustWait) = 0;
+        virtual int discardWakeups(iphb_t handle) = 0;
+        virtual int wokeUp(iphb_t handle) = 0;
+        virtual iphb_t close(iphb_t handle) = 0;
+
+        /**
+         * @return The simulator transport if built with QMSYSTEM_IPHBSIM
+         *         and $QMSYSTEM_IPHB_SIMULATOR is set, libiphb otherwise.
+         */
+        static QmIphbTransport* instance();
+    };
+
+} // MeeGo namespace
+
+#endif // QMIPHBTRANSPORT_P_H
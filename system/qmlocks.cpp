@@ -28,6 +28,7 @@
  */
 #include "qmlocks.h"
 #include "qmlocks_p.h"
+#include "qmsignalhub_p.h"
 
 namespace MeeGo {
 
@@ -57,19 +58,19 @@ void QmLocks::connectNotify(const char *signal) {
     if (QLatin1String(signal) == QLatin1String(QMetaObject::normalizedSignature(SIGNAL(stateChanged(MeeGo::QmLocks::Lock, MeeGo::QmLocks::State))))) {
         if (0 == priv->connectCount[SIGNAL_LOCK_STATE]) {
             #if HAVE_MCE
-                QDBusConnection::systemBus().connect(MCE_SERVICE,
-                                                     MCE_SIGNAL_PATH,
-                                                     MCE_SIGNAL_IF,
-                                                     MCE_TKLOCK_MODE_SIG,
-                                                     priv,
-                                                     SLOT(touchAndKeyboardStateChanged(const QString&)));
+                QmSignalHub::connect(MCE_SERVICE,
+                                     MCE_SIGNAL_PATH,
+                                     MCE_SIGNAL_IF,
+                                     MCE_TKLOCK_MODE_SIG,
+                                     priv,
+                                     SLOT(touchAndKeyboardStateChanged(const QString&)));
             #endif
-            QDBusConnection::systemBus().connect(DEVLOCK_SERVICE,
-                                                 DEVLOCK_PATH,
-                                                 DEVLOCK_SERVICE,
-                                                 DEVLOCK_SIGNAL,
-                                                 priv,
-                                                 SLOT(deviceStateChanged(int,int)));
+            QmSignalHub::connect(DEVLOCK_SERVICE,
+                                 DEVLOCK_PATH,
+                                 DEVLOCK_SERVICE,
+                                 DEVLOCK_SIGNAL,
+                                 priv,
+                                 SLOT(deviceStateChanged(int,int)));
         }
         priv->connectCount[SIGNAL_LOCK_STATE]++;
     }
@@ -85,19 +86,19 @@ void QmLocks::disconnectNotify(const char *signal) {
 
         if (0 == priv->connectCount[SIGNAL_LOCK_STATE]) {
             #if HAVE_MCE
-                QDBusConnection::systemBus().disconnect(MCE_SERVICE,
-                                                        MCE_SIGNAL_PATH,
-                                                        MCE_SIGNAL_IF,
-                                                        MCE_TKLOCK_MODE_SIG,
-                                                        priv,
-                                                        SLOT(touchAndKeyboardStateChanged(const QString&)));
+                QmSignalHub::disconnect(MCE_SERVICE,
+                                        MCE_SIGNAL_PATH,
+                                        MCE_SIGNAL_IF,
+                                        MCE_TKLOCK_MODE_SIG,
+                                        priv,
+                                        SLOT(touchAndKeyboardStateChanged(const QString&)));
             #endif
-            QDBusConnection::systemBus().disconnect(DEVLOCK_SERVICE,
-                                                    DEVLOCK_PATH,
-                                                    DEVLOCK_SERVICE,
-                                                    DEVLOCK_SIGNAL,
-                                                    priv,
-                                                    SLOT(deviceStateChanged(int,int)));
+            QmSignalHub::disconnect(DEVLOCK_SERVICE,
+                                    DEVLOCK_PATH,
+                                    DEVLOCK_SERVICE,
+                                    DEVLOCK_SIGNAL,
+                                    priv,
+                                    SLOT(deviceStateChanged(int,int)));
         }
     }
 }
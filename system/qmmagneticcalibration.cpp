@@ -0,0 +1,328 @@
+/*!
+ * @file qmmagneticcalibration.cpp
+ * @brief QmMagneticCalibration
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#include "qmmagneticcalibration_p.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAGCAL_FILE_ENV     "QMSYSTEM_MAGCAL_FILE"
+#define MAGCAL_FILE_DEFAULT "/.qmsystem2/magcal"
+#define MAGCAL_VERSION      1
+
+/* Number of good readings used for one fit */
+#define MAGCAL_WINDOW       64
+/* Minimum raw variance on an axis for fitting the scale, otherwise 1.0 is used */
+#define MAGCAL_MIN_VARIANCE 100.0
+#define MAGCAL_MIN_SCALE    0.5
+#define MAGCAL_MAX_SCALE    2.0
+/* Changes smaller than these are not worth a disk write */
+#define MAGCAL_OFFSET_EPS   1.0
+#define MAGCAL_SCALE_EPS    0.01
+/* Delay of the write after a change, the fits of a calibration run come in bursts */
+#define MAGCAL_WRITE_DELAY  5000
+
+namespace MeeGo {
+
+static QString defaultPath()
+{
+    const char *env = getenv(MAGCAL_FILE_ENV);
+    if (env && *env) {
+        return QString::fromLocal8Bit(env);
+    }
+    return QDir::homePath() + MAGCAL_FILE_DEFAULT;
+}
+
+QmMagneticCalibrationWriter::QmMagneticCalibrationWriter(QmMagneticCalibration *calibration)
+    : calibration_(calibration)
+{
+    timer_.setSingleShot(true);
+    timer_.setInterval(MAGCAL_WRITE_DELAY);
+    connect(&timer_, SIGNAL(timeout()), this, SLOT(write()));
+}
+
+void QmMagneticCalibrationWriter::schedule()
+{
+    if (!timer_.isActive()) {
+        timer_.start();
+    }
+}
+
+void QmMagneticCalibrationWriter::cancel()
+{
+    timer_.stop();
+}
+
+void QmMagneticCalibrationWriter::write()
+{
+    calibration_->flush();
+}
+
+QmMagneticCalibration& QmMagneticCalibration::instance()
+{
+    static QmMagneticCalibration calibration(defaultPath());
+    return calibration;
+}
+
+QmMagneticCalibration::QmMagneticCalibration(const QString &path)
+    : path_(path), samples_(0), level_(0), unsaved_(0), writer_(this)
+{
+    for (int i = 0; i < 3; i++) {
+        axis_[i].scale = 1.0;
+        axis_[i].offset = 0.0;
+    }
+    resetAccumulators();
+    load();
+}
+
+QmMagneticCalibration::~QmMagneticCalibration()
+{
+    flush();
+}
+
+bool QmMagneticCalibration::isValid() const
+{
+    return level_ > 0;
+}
+
+int QmMagneticCalibration::level() const
+{
+    return level_;
+}
+
+void QmMagneticCalibration::learn(const QmMagnetometerReading &reading)
+{
+    if (reading.level < GoodLevel) {
+        // Whatever was collected may span a change in sensord calibration
+        resetAccumulators();
+        return;
+    }
+
+    const int raw[3] = { reading.rx, reading.ry, reading.rz };
+    const int cal[3] = { reading.x, reading.y, reading.z };
+
+    for (int i = 0; i < 3; i++) {
+        acc_[i].raw += raw[i];
+        acc_[i].cal += cal[i];
+        acc_[i].raw2 += (double)raw[i] * raw[i];
+        acc_[i].rawCal += (double)raw[i] * cal[i];
+    }
+
+    if (++samples_ >= MAGCAL_WINDOW) {
+        fit();
+        resetAccumulators();
+        level_ = reading.level;
+        if (unsaved_) {
+            writer_.schedule();
+        }
+    }
+}
+
+bool QmMagneticCalibration::correct(QmMagnetometerReading &reading) const
+{
+    if (!isValid()) {
+        return false;
+    }
+
+    reading.x = (int)lround(axis_[0].scale * reading.rx + axis_[0].offset);
+    reading.y = (int)lround(axis_[1].scale * reading.ry + axis_[1].offset);
+    reading.z = (int)lround(axis_[2].scale * reading.rz + axis_[2].offset);
+    reading.level = level_;
+    return true;
+}
+
+void QmMagneticCalibration::clear()
+{
+    for (int i = 0; i < 3; i++) {
+        axis_[i].scale = 1.0;
+        axis_[i].offset = 0.0;
+    }
+    resetAccumulators();
+    level_ = 0;
+    unsaved_ = 0;
+    writer_.cancel();
+
+    if (QFile::exists(path_) && !QFile::remove(path_)) {
+        qWarning() << "QmMagneticCalibration: cannot remove" << path_;
+    }
+}
+
+void QmMagneticCalibration::flush()
+{
+    writer_.cancel();
+    if (unsaved_ && save()) {
+        unsaved_ = 0;
+    }
+}
+
+int QmMagneticCalibration::azimuth(const QmMagnetometerReading &field,
+                                   const QmAccelerometerReading &gravity)
+{
+    // The accelerometer reports the reaction to gravity with the sign of
+    // NCS, the tilt compensation below expects the gravity vector itself.
+    double gx = -gravity.x;
+    double gy = -gravity.y;
+    double gz = -gravity.z;
+
+    double roll = atan2(gy, gz);
+    double sinRoll = sin(roll);
+    double cosRoll = cos(roll);
+    double pitch = atan2(-gx, gy * sinRoll + gz * cosRoll);
+    double sinPitch = sin(pitch);
+    double cosPitch = cos(pitch);
+
+    double bx = field.x * cosPitch
+              + field.y * sinPitch * sinRoll
+              + field.z * sinPitch * cosRoll;
+    double by = field.y * cosRoll - field.z * sinRoll;
+
+    int degrees = (int)lround(atan2(-by, bx) * 180.0 / M_PI);
+    if (degrees < 0) {
+        degrees += 360;
+    }
+    return degrees % 360;
+}
+
+void QmMagneticCalibration::load()
+{
+    QFile file(path_);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return;
+    }
+
+    QTextStream in(&file);
+    int version = 0, level = 0;
+    Axis axis[3];
+
+    in >> version >> level;
+    for (int i = 0; i < 3; i++) {
+        in >> axis[i].scale >> axis[i].offset;
+    }
+
+    if (in.status() != QTextStream::Ok || version != MAGCAL_VERSION || level <= 0) {
+        qWarning() << "QmMagneticCalibration: ignoring invalid" << path_;
+        return;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        if (axis[i].scale < MAGCAL_MIN_SCALE || axis[i].scale > MAGCAL_MAX_SCALE) {
+            qWarning() << "QmMagneticCalibration: ignoring invalid" << path_;
+            return;
+        }
+    }
+
+    for (int i = 0; i < 3; i++) {
+        axis_[i] = axis[i];
+    }
+    level_ = level;
+}
+
+bool QmMagneticCalibration::save()
+{
+    QFileInfo info(path_);
+    if (!QDir().mkpath(info.absolutePath())) {
+        qWarning() << "QmMagneticCalibration: cannot create" << info.absolutePath();
+        return false;
+    }
+
+    // Write a temporary file and rename it over the old one, so that a
+    // crash never leaves a half written snapshot behind.
+    QString tmpPath = path_ + ".tmp";
+    QFile file(tmpPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        qWarning() << "QmMagneticCalibration: cannot write" << tmpPath;
+        return false;
+    }
+
+    QTextStream out(&file);
+    out.setRealNumberPrecision(8);
+    out << MAGCAL_VERSION << " " << level_;
+    for (int i = 0; i < 3; i++) {
+        out << " " << axis_[i].scale << " " << axis_[i].offset;
+    }
+    out << "\n";
+    out.flush();
+    file.close();
+
+    if (file.error() != QFile::NoError) {
+        QFile::remove(tmpPath);
+        return false;
+    }
+
+    if (::rename(QFile::encodeName(tmpPath).constData(),
+                 QFile::encodeName(path_).constData()) != 0) {
+        qWarning() << "QmMagneticCalibration: cannot rename" << tmpPath;
+        QFile::remove(tmpPath);
+        return false;
+    }
+    return true;
+}
+
+void QmMagneticCalibration::fit()
+{
+    for (int i = 0; i < 3; i++) {
+        double meanRaw = acc_[i].raw / samples_;
+        double meanCal = acc_[i].cal / samples_;
+        double variance = acc_[i].raw2 / samples_ - meanRaw * meanRaw;
+        double covariance = acc_[i].rawCal / samples_ - meanRaw * meanCal;
+
+        Axis axis;
+        axis.scale = 1.0;
+        if (variance > MAGCAL_MIN_VARIANCE) {
+            double scale = covariance / variance;
+            if (scale >= MAGCAL_MIN_SCALE && scale <= MAGCAL_MAX_SCALE) {
+                axis.scale = scale;
+            }
+        }
+        axis.offset = meanCal - axis.scale * meanRaw;
+
+        if (fabs(axis.scale - axis_[i].scale) > MAGCAL_SCALE_EPS ||
+            fabs(axis.offset - axis_[i].offset) > MAGCAL_OFFSET_EPS) {
+            unsaved_ = 1;
+        }
+        axis_[i] = axis;
+    }
+
+    if (level_ == 0) {
+        unsaved_ = 1;
+    }
+}
+
+void QmMagneticCalibration::resetAccumulators()
+{
+    for (int i = 0; i < 3; i++) {
+        acc_[i].raw = 0.0;
+        acc_[i].cal = 0.0;
+        acc_[i].raw2 = 0.0;
+        acc_[i].rawCal = 0.0;
+    }
+    samples_ = 0;
+}
+
+} // MeeGo namespace
@@ -0,0 +1,166 @@
+/*!
+ * @file qmmagneticcalibration_p.h
+ * @brief Contains QmMagneticCalibration, the persistent magnetometer calibration store
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   @scope Private
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#ifndef QMMAGNETICCALIBRATION_P_H
+#define QMMAGNETICCALIBRATION_P_H
+
+#include "qmmagnetometer.h"
+#include "qmaccelerometer.h"
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+namespace MeeGo
+{
+    class QmMagneticCalibration;
+
+    /* Writes the snapshot a while after it changed, from the event loop
+     * rather than from the data slot the fit is made in */
+    class QmMagneticCalibrationWriter : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        QmMagneticCalibrationWriter(QmMagneticCalibration *calibration);
+
+        /* Starts the delay, unless a write is pending already */
+        void schedule();
+        void cancel();
+
+    private Q_SLOTS:
+        void write();
+
+    private:
+        QmMagneticCalibration *calibration_;
+        QTimer timer_;
+    };
+
+    /**
+     * Process wide store for the last good magnetometer calibration.
+     *
+     * While sensord reports a good calibration level, the store fits
+     * calibrated = scale * raw + offset separately for each axis from the
+     * raw and calibrated values of the readings. The offset is the
+     * hard-iron estimate and the scale the (diagonal) soft-iron estimate.
+     * The fit is saved to a small file and loaded again by the next
+     * session, so that the readings can be corrected in-library until
+     * sensord's own calibration catches up.
+     *
+     * The file is $QMSYSTEM_MAGCAL_FILE, or ~/.qmsystem2/magcal if the
+     * variable is not set.
+     */
+    class QmMagneticCalibration
+    {
+    public:
+        /** Calibration level at which sensord calibration is trusted. */
+        enum { GoodLevel = 3 };
+
+        static QmMagneticCalibration& instance();
+
+        /**
+         * A store of its own, kept in the file given. instance() is the one
+         * used by the sensors, this is for tests and tools.
+         */
+        QmMagneticCalibration(const QString &path);
+        ~QmMagneticCalibration();
+
+        /**
+         * @return True if a snapshot is available for correcting readings.
+         */
+        bool isValid() const;
+
+        /**
+         * @return Calibration level the snapshot was taken at, or 0.
+         */
+        int level() const;
+
+        /**
+         * Feeds a sensord reading into the estimator. Readings below
+         * #GoodLevel are ignored. A changed snapshot is written to disk
+         * a few seconds later from the event loop, or at flush().
+         */
+        void learn(const QmMagnetometerReading &reading);
+
+        /**
+         * Replaces the calibrated values of the reading with the ones
+         * computed from the raw values and the snapshot, and raises the
+         * level to the snapshot level.
+         *
+         * @return False if there is no snapshot to apply.
+         */
+        bool correct(QmMagnetometerReading &reading) const;
+
+        /**
+         * Drops the snapshot both from memory and from disk.
+         */
+        void clear();
+
+        /**
+         * Writes the snapshot to disk if it changed since the last write.
+         */
+        void flush();
+
+        /**
+         * Computes the azimuth of the device x-axis in degrees [0, 360)
+         * from a calibrated magnetic field and the gravity vector, the same
+         * way sensord's compass filter does.
+         */
+        static int azimuth(const QmMagnetometerReading &field,
+                           const QmAccelerometerReading &gravity);
+
+    private:
+        Q_DISABLE_COPY(QmMagneticCalibration)
+
+        struct Axis
+        {
+            double scale;
+            double offset;
+        };
+
+        struct Accumulator
+        {
+            double raw;
+            double cal;
+            double raw2;
+            double rawCal;
+        };
+
+        void load();
+        bool save();
+        void fit();
+        void resetAccumulators();
+
+        QString path_;
+        Axis axis_[3];
+        Accumulator acc_[3];
+        int samples_;
+        int level_;
+        int unsaved_;
+        QmMagneticCalibrationWriter writer_;
+    };
+
+} // MeeGo namespace
+
+#endif // QMMAGNETICCALIBRATION_P_H
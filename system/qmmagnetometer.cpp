@@ -60,6 +60,7 @@ namespace MeeGo {
         output.rz = value.data().rz_;
         output.timestamp = value.data().timestamp_;
         output.level = value.data().level_;
+        priv->calibrate(output);
         return output;
     }
 
@@ -70,6 +71,7 @@ namespace MeeGo {
 
         QmMagnetometerPrivate *priv = reinterpret_cast<QmMagnetometerPrivate*>(priv_ptr);
         priv->sensorIfc->reset();
+        QmMagneticCalibration::instance().clear();
 
     }
 
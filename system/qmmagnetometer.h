@@ -38,7 +38,13 @@ QT_BEGIN_HEADER
 namespace MeeGo {
 
     /**
-     * Magnetometer measurement
+     * Magnetometer measurement. x, y and z are the calibrated values,
+     * rx, ry and rz the raw ones.
+     *
+     * The last good calibration is stored on disk. Until sensord has
+     * calibrated itself in a new session, the calibrated values are
+     * computed from the raw ones with the stored calibration, and level
+     * reports the level the stored calibration was taken at.
      */
     class QmMagnetometerReading : public QmSensorReading
     {
@@ -85,7 +91,8 @@ namespace MeeGo {
         QmMagnetometerReading magneticField();
 
         /**
-         * Resets the magnetometer calibration back to 0.
+         * Resets the magnetometer calibration back to 0 and drops the
+         * calibration stored on disk.
          */
         void reset();
 
@@ -29,6 +29,7 @@
 #define QMMAGNETOMETER_P_H
 
 #include "qmmagnetometer.h"
+#include "qmmagneticcalibration_p.h"
 #include "qmsensor_p.h"
 #include "sensord/magnetometersensor_i.h"
 #include "sensord/sensormanagerinterface.h"
@@ -45,7 +46,10 @@ namespace MeeGo
     public:
         MagnetometerSensorChannelInterface* sensorIfc;
 
-        QmMagnetometerPrivate(QmMagnetometer* parent) : QmSensorPrivate(parent), sensorIfc(NULL) {
+        /* True once sensord calibration has reached the stored level in this session */
+        bool caughtUp;
+
+        QmMagnetometerPrivate(QmMagnetometer* parent) : QmSensorPrivate(parent), sensorIfc(NULL), caughtUp(false) {
             pub_ptr = parent;
         }
 
@@ -74,6 +78,31 @@ namespace MeeGo
             if (!initDone_) { if (!init()) return NULL; }
             return MagnetometerSensorChannelInterface::listenInterface("magnetometersensor");
         }
+
+        bool start()
+        {
+            caughtUp = false;
+            return QmSensorPrivate::start();
+        }
+
+        /**
+         * Feeds the reading to the calibration store and, until sensord
+         * calibration catches up with the stored one, replaces the
+         * calibrated values with the ones computed from the snapshot.
+         */
+        void calibrate(QmMagnetometerReading &reading)
+        {
+            QmMagneticCalibration &calibration = QmMagneticCalibration::instance();
+
+            if (!caughtUp && reading.level >= calibration.level()) {
+                caughtUp = true;
+            }
+            calibration.learn(reading);
+
+            if (!caughtUp) {
+                calibration.correct(reading);
+            }
+        }
         bool setupSignals(bool setOn)
         {
             MEEGO_PUBLIC(QmMagnetometer)
@@ -115,6 +144,7 @@ namespace MeeGo
             output.timestamp = data.data().timestamp_;
             output.level = data.data().level_;
 
+            calibrate(output);
             emit dataAvailable(output);
         }
     };
@@ -0,0 +1,383 @@
+/*!
+ * @file qmsignalhub.cpp
+ * @brief QmSignalHub
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#include "qmsignalhub_p.h"
+#include "qmipcinterface_p.h"
+
+#include <QCoreApplication>
+#include <QDBusConnection>
+#include <QDBusPendingCall>
+#include <QDebug>
+#include <QMetaType>
+#include <QStringList>
+#include <QThread>
+#include <QVariant>
+
+/* QMetaMethod::invoke() takes at most ten arguments */
+#define MAX_ARGUMENTS 10
+
+namespace MeeGo {
+
+static inline QString signalKey(const QString &service, const QString &path,
+                                const QString &interface, const QString &name)
+{
+    return service + '\n' + path + '\n' + interface + '\n' + name;
+}
+
+QmSignalHub::QmSignalHub()
+    : mutex_(QMutex::Recursive)
+{
+    /* The bus signals are received in the main thread, whoever subscribes */
+    adoptApplicationThread_();
+}
+
+void QmSignalHub::adoptApplicationThread_()
+{
+    QCoreApplication *app = QCoreApplication::instance();
+    if (!app || thread() == app->thread())
+        return;
+
+    /*
+     * Created before the application, in a thread that is not going to be
+     * the main one. Only the thread owning the objects can push them away.
+     */
+    if (thread() != QThread::currentThread()) {
+        qWarning() << "QmSignalHub: used before QCoreApplication from another thread,"
+                   << "the signals are received in that thread";
+        return;
+    }
+    moveToThread(app->thread());
+    foreach (QmSignalRelay *relay, relays_)
+        relay->moveToThread(app->thread());
+}
+
+QmSignalHub* QmSignalHub::instance()
+{
+    /* Lives as long as the process, like the bus connection */
+    static QmSignalHub *hub = new QmSignalHub();
+    return hub;
+}
+
+bool QmSignalHub::connect(const QString &service, const QString &path,
+                          const QString &interface, const QString &name,
+                          QObject *receiver, const char *slot)
+{
+    return instance()->connect_(signalKey(service, path, interface, name),
+                                service, path, interface, name, receiver, slot);
+}
+
+bool QmSignalHub::disconnect(const QString &service, const QString &path,
+                             const QString &interface, const QString &name,
+                             QObject *receiver, const char *slot)
+{
+    return instance()->disconnect_(signalKey(service, path, interface, name),
+                                   receiver, slot);
+}
+
+bool QmSignalHub::mirror(const QString &service, const QString &path,
+                         const QString &interface, const QString &name,
+                         QObject *owner, const QDBusMessage &getCall)
+{
+    if (!owner)
+        return false;
+
+    QmSignalHub *hub = instance();
+    QString key = signalKey(service, path, interface, name);
+
+    Subscriber subscriber;
+    subscriber.receiver = owner;
+    subscriber.mirror = true;
+
+    QMutexLocker locker(&hub->mutex_);
+
+    QmSignalRelay *relay = hub->subscribe_(key, service, path, interface, name, subscriber);
+    if (!relay)
+        return false;
+
+    if (!relay->valid && !relay->prefetching) {
+        relay->prefetching = true;
+        QDBusPendingCallWatcher *watcher =
+            QmIPCInterface::asyncCallMessage(getCall);
+        /* Completed in the thread of the relay, and dropped with it */
+        watcher->moveToThread(relay->thread());
+        watcher->setParent(relay);
+        QObject::connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)),
+                         relay, SLOT(prefetched(QDBusPendingCallWatcher*)));
+    }
+    return true;
+}
+
+bool QmSignalHub::unmirror(const QString &service, const QString &path,
+                           const QString &interface, const QString &name,
+                           QObject *owner)
+{
+    QmSignalHub *hub = instance();
+    QString key = signalKey(service, path, interface, name);
+
+    QMutexLocker locker(&hub->mutex_);
+
+    QmSignalRelay *relay = hub->relays_.value(key);
+    if (!relay)
+        return false;
+
+    for (int i = 0; i < relay->subscribers.size(); i++) {
+        const Subscriber &subscriber = relay->subscribers[i];
+        if (subscriber.mirror && subscriber.receiver == owner) {
+            hub->unsubscribe_(key, relay, i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool QmSignalHub::cached(const QString &service, const QString &path,
+                         const QString &interface, const QString &name,
+                         QList<QVariant> &arguments)
+{
+    QmSignalHub *hub = instance();
+    QMutexLocker locker(&hub->mutex_);
+
+    QmSignalRelay *relay = hub->relays_.value(signalKey(service, path, interface, name));
+    if (!relay || !relay->valid)
+        return false;
+
+    arguments = relay->arguments;
+    return true;
+}
+
+int QmSignalHub::subscriptionCount()
+{
+    QmSignalHub *hub = instance();
+    QMutexLocker locker(&hub->mutex_);
+    return hub->relays_.size();
+}
+
+bool QmSignalHub::connect_(const QString &key, const QString &service, const QString &path,
+                           const QString &interface, const QString &name,
+                           QObject *receiver, const char *slot)
+{
+    if (!receiver || !slot || !*slot)
+        return false;
+
+    /* SLOT() prefixes the signature with a code */
+    QByteArray signature = QMetaObject::normalizedSignature(slot + 1);
+    int index = receiver->metaObject()->indexOfMethod(signature.constData());
+    if (index < 0) {
+        qWarning() << "QmSignalHub: no such slot" << receiver->metaObject()->className()
+                   << signature;
+        return false;
+    }
+
+    Subscriber subscriber;
+    subscriber.receiver = receiver;
+    subscriber.method = receiver->metaObject()->method(index);
+    subscriber.mirror = false;
+
+    QMutexLocker locker(&mutex_);
+    return subscribe_(key, service, path, interface, name, subscriber) != 0;
+}
+
+QmSignalRelay* QmSignalHub::subscribe_(const QString &key, const QString &service,
+                                       const QString &path, const QString &interface,
+                                       const QString &name, const Subscriber &subscriber)
+{
+    adoptApplicationThread_();
+
+    QmSignalRelay *relay = relays_.value(key);
+    if (!relay) {
+        relay = new QmSignalRelay(service, path, interface, name);
+        relay->moveToThread(thread());
+        if (!QDBusConnection::systemBus().connect(service, path, interface, name,
+                                                  relay, SLOT(relay(const QDBusMessage&)))) {
+            qWarning() << "QmSignalHub: cannot subscribe to" << interface << name;
+            delete relay;
+            return 0;
+        }
+        relays_.insert(key, relay);
+    }
+
+    relay->subscribers.append(subscriber);
+
+    if (receivers_[subscriber.receiver]++ == 0) {
+        QObject::connect(subscriber.receiver, SIGNAL(destroyed(QObject*)),
+                         this, SLOT(receiverDestroyed(QObject*)), Qt::DirectConnection);
+    }
+    return relay;
+}
+
+bool QmSignalHub::disconnect_(const QString &key, QObject *receiver, const char *slot)
+{
+    if (!receiver || !slot || !*slot)
+        return false;
+
+    QByteArray signature = QMetaObject::normalizedSignature(slot + 1);
+
+    QMutexLocker locker(&mutex_);
+
+    QmSignalRelay *relay = relays_.value(key);
+    if (!relay)
+        return false;
+
+    for (int i = 0; i < relay->subscribers.size(); i++) {
+        const Subscriber &subscriber = relay->subscribers[i];
+        if (subscriber.mirror || subscriber.receiver != receiver
+            || signature != subscriber.method.signature())
+            continue;
+
+        unsubscribe_(key, relay, i);
+        return true;
+    }
+    return false;
+}
+
+void QmSignalHub::unsubscribe_(const QString &key, QmSignalRelay *relay, int index)
+{
+    QObject *receiver = relay->subscribers.takeAt(index).receiver;
+    if (--receivers_[receiver] == 0) {
+        receivers_.remove(receiver);
+        QObject::disconnect(receiver, SIGNAL(destroyed(QObject*)),
+                            this, SLOT(receiverDestroyed(QObject*)));
+    }
+    if (relay->subscribers.isEmpty())
+        release_(key);
+}
+
+void QmSignalHub::release_(const QString &key)
+{
+    QmSignalRelay *relay = relays_.take(key);
+    QDBusConnection::systemBus().disconnect(relay->service, relay->path,
+                                            relay->interface, relay->name,
+                                            relay, SLOT(relay(const QDBusMessage&)));
+    /* It may be delivering the signal right now */
+    relay->deleteLater();
+}
+
+void QmSignalHub::receiverDestroyed(QObject *receiver)
+{
+    QMutexLocker locker(&mutex_);
+
+    if (!receivers_.remove(receiver))
+        return;
+
+    QStringList unused;
+    QHash<QString, QmSignalRelay*>::iterator it;
+    for (it = relays_.begin(); it != relays_.end(); ++it) {
+        QList<Subscriber> &subscribers = it.value()->subscribers;
+        for (int i = subscribers.size() - 1; i >= 0; i--) {
+            if (subscribers[i].receiver == receiver)
+                subscribers.removeAt(i);
+        }
+        if (subscribers.isEmpty())
+            unused.append(it.key());
+    }
+    foreach (const QString &key, unused)
+        release_(key);
+}
+
+void QmSignalHub::deliver_(QmSignalRelay *relay, const QDBusMessage &message)
+{
+    const QList<QVariant> arguments = message.arguments();
+
+    QList<Subscriber> subscribers;
+    {
+        QMutexLocker locker(&mutex_);
+        subscribers = relay->subscribers;
+        relay->arguments = arguments;
+        relay->valid = true;
+    }
+
+    foreach (const Subscriber &subscriber, subscribers) {
+        if (subscriber.mirror)
+            continue;
+
+        /* As in QtDBus, a slot may take fewer arguments than the signal has */
+        QList<QByteArray> types = subscriber.method.parameterTypes();
+        if (types.size() > arguments.size() || types.size() > MAX_ARGUMENTS) {
+            qWarning() << "QmSignalHub: cannot deliver" << message.member()
+                       << "to" << subscriber.method.signature();
+            continue;
+        }
+
+        QVariant values[MAX_ARGUMENTS];
+        QGenericArgument args[MAX_ARGUMENTS];
+        for (int i = 0; i < types.size(); i++) {
+            values[i] = arguments[i];
+            int type = QMetaType::type(types[i].constData());
+            if (type != QMetaType::Void && values[i].userType() != type)
+                values[i].convert((QVariant::Type)type);
+            args[i] = QGenericArgument(types[i].constData(), values[i].constData());
+        }
+
+        QMutexLocker locker(&mutex_);
+
+        /* Unsubscribed from this signal or destroyed meanwhile, e.g. by an
+         * earlier slot of this delivery */
+        if (!isSubscribed_(relay, subscriber))
+            continue;
+
+        Qt::ConnectionType connection = Qt::DirectConnection;
+        if (subscriber.receiver->thread() != QThread::currentThread()) {
+            /* Posting is safe under the lock, the receiver cannot go away */
+            connection = Qt::QueuedConnection;
+        } else {
+            locker.unlock();
+        }
+
+        subscriber.method.invoke(subscriber.receiver, connection,
+                                 args[0], args[1], args[2], args[3], args[4],
+                                 args[5], args[6], args[7], args[8], args[9]);
+    }
+}
+
+bool QmSignalHub::isSubscribed_(const QmSignalRelay *relay, const Subscriber &subscriber)
+{
+    foreach (const Subscriber &current, relay->subscribers) {
+        if (!current.mirror && current.receiver == subscriber.receiver
+            && qstrcmp(current.method.signature(), subscriber.method.signature()) == 0)
+            return true;
+    }
+    return false;
+}
+
+void QmSignalHub::prefetched_(QmSignalRelay *relay, QDBusPendingCallWatcher *watcher)
+{
+    QDBusMessage reply = watcher->reply();
+    watcher->deleteLater();
+
+    QMutexLocker locker(&mutex_);
+
+    relay->prefetching = false;
+
+    /* A signal received meanwhile is newer than the reply */
+    if (relay->valid)
+        return;
+
+    if (reply.type() != QDBusMessage::ReplyMessage) {
+        qWarning() << "QmSignalHub: cannot prefetch" << relay->interface << relay->name
+                   << reply.errorMessage();
+        return;
+    }
+    relay->arguments = reply.arguments();
+    relay->valid = true;
+}
+
+} // MeeGo namespace
@@ -0,0 +1,162 @@
+/*!
+ * @file qmsignalhub_p.h
+ * @brief Contains QmSignalHub, the shared D-Bus signal subscriptions.
+
+   <p>
+   @copyright (C) 2009-2011 Nokia Corporation
+   @license LGPL Lesser General Public License
+
+   @scope Private
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#ifndef QMSIGNALHUB_P_H
+#define QMSIGNALHUB_P_H
+
+#include <QByteArray>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QHash>
+#include <QList>
+#include <QMetaMethod>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QVariant>
+
+namespace MeeGo {
+
+class QmSignalRelay;
+
+/*
+ * Process-wide subscriptions to system bus signals.
+ *
+ * connect() and disconnect() take the same arguments as the
+ * QDBusConnection methods. Every distinct (service, path, interface, name)
+ * signal is subscribed on the bus once, with one match rule, however many
+ * objects listen to it, and delivered to the receivers in-process. The
+ * slots are called in the threads of their receivers, as by QtDBus.
+ *
+ * The bus signals are received in the thread of the QCoreApplication. If
+ * the hub is first used before the application exists, it moves there at
+ * the first subscription after the application has been created, which
+ * only works if both happen in the thread that used it first, normally
+ * the main thread.
+ *
+ * The arguments of the last signal received are kept as long as the signal
+ * is subscribed. mirror() keeps a signal subscribed on behalf of an owner
+ * without a slot and warms the value with an asynchronous call of the
+ * matching getter, so that cached() can answer without a round trip.
+ */
+class QmSignalHub : public QObject
+{
+    Q_OBJECT
+
+public:
+    static bool connect(const QString &service, const QString &path,
+                        const QString &interface, const QString &name,
+                        QObject *receiver, const char *slot);
+    static bool disconnect(const QString &service, const QString &path,
+                           const QString &interface, const QString &name,
+                           QObject *receiver, const char *slot);
+
+    /* Keeps the signal subscribed until unmirror() or until the owner is
+     * destroyed, and prefetches its value with getCall if not known yet */
+    static bool mirror(const QString &service, const QString &path,
+                       const QString &interface, const QString &name,
+                       QObject *owner, const QDBusMessage &getCall);
+    static bool unmirror(const QString &service, const QString &path,
+                         const QString &interface, const QString &name,
+                         QObject *owner);
+
+    /* The arguments of the last signal or of the prefetch, false if none */
+    static bool cached(const QString &service, const QString &path,
+                       const QString &interface, const QString &name,
+                       QList<QVariant> &arguments);
+
+    /* Number of signals subscribed on the bus */
+    static int subscriptionCount();
+
+private Q_SLOTS:
+    void receiverDestroyed(QObject *receiver);
+
+private:
+    friend class QmSignalRelay;
+
+    struct Subscriber
+    {
+        QObject *receiver;
+        QMetaMethod method;
+        bool mirror;        /* no slot, keeps the value cached */
+    };
+
+    QmSignalHub();
+    static QmSignalHub* instance();
+
+    bool connect_(const QString &key, const QString &service, const QString &path,
+                  const QString &interface, const QString &name,
+                  QObject *receiver, const char *slot);
+    bool disconnect_(const QString &key, QObject *receiver, const char *slot);
+    QmSignalRelay* subscribe_(const QString &key, const QString &service, const QString &path,
+                              const QString &interface, const QString &name,
+                              const Subscriber &subscriber);
+    void unsubscribe_(const QString &key, QmSignalRelay *relay, int index);
+    void deliver_(QmSignalRelay *relay, const QDBusMessage &message);
+    static bool isSubscribed_(const QmSignalRelay *relay, const Subscriber &subscriber);
+    void prefetched_(QmSignalRelay *relay, QDBusPendingCallWatcher *watcher);
+    void release_(const QString &key);
+    void adoptApplicationThread_();
+
+    QMutex mutex_;
+    QHash<QString, QmSignalRelay*> relays_;
+    QHash<QObject*, int> receivers_; /* subscriptions per receiver */
+};
+
+/* The single bus connection of one signal */
+class QmSignalRelay : public QObject
+{
+    Q_OBJECT
+
+public:
+    QmSignalRelay(const QString &service, const QString &path,
+                  const QString &interface, const QString &name)
+        : service(service), path(path), interface(interface), name(name),
+          valid(false), prefetching(false) {}
+
+    QString service;
+    QString path;
+    QString interface;
+    QString name;
+    QList<QmSignalHub::Subscriber> subscribers;
+
+    /* The last value seen */
+    bool valid;
+    bool prefetching;
+    QList<QVariant> arguments;
+
+public Q_SLOTS:
+    void relay(const QDBusMessage &message) {
+        QmSignalHub::instance()->deliver_(this, message);
+    }
+
+    void prefetched(QDBusPendingCallWatcher *watcher) {
+        QmSignalHub::instance()->prefetched_(this, watcher);
+    }
+};
+
+} // MeeGo namespace
+
+#endif // QMSIGNALHUB_P_H
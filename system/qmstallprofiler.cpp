@@ -0,0 +1,386 @@
+/*!
+ * @file qmstallprofiler.cpp
+ * @brief QmStallProfiler
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#include "qmstallprofiler_p.h"
+
+#include <QAtomicInt>
+#include <QDebug>
+#include <QMetaMethod>
+#include <QMetaObject>
+#include <QObject>
+
+extern "C" {
+#include <errno.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+}
+
+#define STALL_SIGNAL SIGPROF
+#define STALL_RING_SIZE 16
+#define STALL_MAX_FRAMES 64
+#define STALL_MAX_SLOTS 16
+#define STALL_CAPTURE_TIMEOUT_MS 500
+
+/* The signal spy callbacks of QtCore, as declared in its private qobject_p.h.
+ * Not a public API: the layout and the signatures are those of Qt 4, Qt 5
+ * changed them, so the slots are tracked with Qt 4 only. */
+#if QT_VERSION < 0x050000
+#define STALL_TRACK_SLOTS 1
+
+struct QSignalSpyCallbackSet
+{
+    typedef void (*BeginCallback)(QObject *caller, int method_index, void **argv);
+    typedef void (*EndCallback)(QObject *caller, int method_index);
+    BeginCallback signal_begin_callback, slot_begin_callback;
+    EndCallback signal_end_callback, slot_end_callback;
+};
+extern void Q_CORE_EXPORT qt_register_signal_spy_callbacks(const QSignalSpyCallbackSet &callback_set);
+extern QSignalSpyCallbackSet Q_CORE_EXPORT qt_signal_spy_callback_set;
+#endif
+
+namespace MeeGo {
+
+struct StallSlot
+{
+    const QMetaObject *metaObject;
+    int index;
+};
+
+struct StallTrace
+{
+    qint64 time;                            // ms, monotonic
+    qint64 latency;                         // ms since the ping
+    int frameCount;
+    void *frames[STALL_MAX_FRAMES];
+    int callCount;
+    StallSlot calls[STALL_MAX_SLOTS];       // innermost last
+};
+
+/* Everything the signal handler and the spy callbacks touch is allocated here */
+static StallTrace ring[STALL_RING_SIZE];
+static int ringNext = 0;                    // the sampler thread only
+
+static QAtomicInt armed;                    // 0 idle, 1 armed, 2 capturing
+static volatile int armedIndex = 0;
+static sem_t capturedSem;
+
+static pthread_t profiled;
+static volatile int slotDepth = 0;
+static StallSlot slotStack[STALL_MAX_SLOTS];
+
+static QmStallProfiler *enabledProfiler = 0;
+#ifdef STALL_TRACK_SLOTS
+static QSignalSpyCallbackSet previousCallbacks;
+#endif
+static struct sigaction previousAction;
+
+static qint64 monotonicMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (qint64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+#ifdef STALL_TRACK_SLOTS
+/* Called around every slot called through a connection, in every thread */
+static void slotBegin(QObject *caller, int index, void **argv)
+{
+    if (pthread_equal(pthread_self(), profiled)) {
+        int depth = slotDepth;
+        if (depth < STALL_MAX_SLOTS) {
+            slotStack[depth].metaObject = caller->metaObject();
+            slotStack[depth].index = index;
+        }
+        slotDepth = depth + 1;
+    }
+    if (previousCallbacks.slot_begin_callback) {
+        previousCallbacks.slot_begin_callback(caller, index, argv);
+    }
+}
+
+static void slotEnd(QObject *caller, int index)
+{
+    if (pthread_equal(pthread_self(), profiled) && slotDepth > 0) {
+        slotDepth = slotDepth - 1;
+    }
+    if (previousCallbacks.slot_end_callback) {
+        previousCallbacks.slot_end_callback(caller, index);
+    }
+}
+#endif
+
+/* Async-signal-safe: copies into the armed entry of the ring only */
+static void stallSignalHandler(int)
+{
+    if (!armed.testAndSetOrdered(1, 2)) {
+        return;
+    }
+    int saved = errno;
+
+    StallTrace &trace = ring[armedIndex];
+    trace.frameCount = backtrace(trace.frames, STALL_MAX_FRAMES);
+    int depth = slotDepth;
+    trace.callCount = depth < STALL_MAX_SLOTS ? depth : STALL_MAX_SLOTS;
+    for (int i = 0; i < trace.callCount; i++) {
+        trace.calls[i] = slotStack[i];
+    }
+
+    armed.fetchAndStoreOrdered(0);
+    sem_post(&capturedSem);
+    errno = saved;
+}
+
+static void writeAll(int fd, const char *text, int len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, text, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return;
+        }
+        text += n;
+        len -= n;
+    }
+}
+
+QmStallProfiler::QmStallProfiler()
+    : threshold(0), fd(-1), ownFd(false), stopping(false),
+      pending(false), pingTime(0), samples(0), captured(0)
+{
+}
+
+QmStallProfiler::~QmStallProfiler()
+{
+    disable();
+}
+
+bool QmStallProfiler::enable(int threshold, const QByteArray &fileName)
+{
+    if (enabledProfiler == this) {
+        disable();
+    }
+    if (enabledProfiler || threshold <= 0) {
+        return false;
+    }
+
+    if (fileName.isEmpty()) {
+        fd = STDERR_FILENO;
+        ownFd = false;
+    } else {
+        fd = open(fileName.constData(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            qWarning() << "QmStallProfiler: cannot open" << fileName << strerror(errno);
+            return false;
+        }
+        ownFd = true;
+    }
+
+    /* The first call loads libgcc, which is not allowed in the handler */
+    void *preload[1];
+    backtrace(preload, 1);
+
+    sem_init(&capturedSem, 0, 0);
+    armed.fetchAndStoreOrdered(0);
+    ringNext = 0;
+    slotDepth = 0;
+    profiled = pthread_self();
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stallSignalHandler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(STALL_SIGNAL, &action, &previousAction);
+
+#ifdef STALL_TRACK_SLOTS
+    previousCallbacks = qt_signal_spy_callback_set;
+    QSignalSpyCallbackSet callbacks = previousCallbacks;
+    callbacks.slot_begin_callback = slotBegin;
+    callbacks.slot_end_callback = slotEnd;
+    qt_register_signal_spy_callbacks(callbacks);
+#endif
+
+    this->threshold = threshold;
+    target = profiled;
+    stopping = false;
+    pending = false;
+    samples = 0;
+    enabledProfiler = this;
+    start();
+    return true;
+}
+
+void QmStallProfiler::disable()
+{
+    if (enabledProfiler != this) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&mutex);
+        stopping = true;
+        changed.wakeAll();
+    }
+    wait();
+
+#ifdef STALL_TRACK_SLOTS
+    qt_register_signal_spy_callbacks(previousCallbacks);
+#endif
+    sigaction(STALL_SIGNAL, &previousAction, 0);
+    sem_destroy(&capturedSem);
+
+    if (ownFd) {
+        close(fd);
+    }
+    fd = -1;
+    enabledProfiler = 0;
+}
+
+bool QmStallProfiler::isEnabled() const
+{
+    return enabledProfiler == this;
+}
+
+void QmStallProfiler::pinged()
+{
+    QMutexLocker locker(&mutex);
+    if (!pending) {
+        /* A ping after an unanswered one extends the same stall */
+        pending = true;
+        pingTime = monotonicMs();
+        samples = 0;
+        changed.wakeAll();
+    }
+}
+
+void QmStallProfiler::ponged()
+{
+    QMutexLocker locker(&mutex);
+    pending = false;
+    changed.wakeAll();
+}
+
+int QmStallProfiler::captures() const
+{
+    QMutexLocker locker(&mutex);
+    return captured;
+}
+
+void QmStallProfiler::run()
+{
+    QMutexLocker locker(&mutex);
+    while (!stopping) {
+        if (!pending) {
+            changed.wait(&mutex);
+            continue;
+        }
+        qint64 now = monotonicMs();
+        qint64 due = pingTime + (qint64)threshold * (samples + 1);
+        if (due > now) {
+            changed.wait(&mutex, (unsigned long)(due - now));
+            continue;
+        }
+
+        samples++;
+        qint64 latency = now - pingTime;
+        locker.unlock();
+        bool ok = capture(latency);
+        locker.relock();
+        if (ok) {
+            captured++;
+        }
+    }
+}
+
+bool QmStallProfiler::capture(qint64 latency)
+{
+    int index = ringNext;
+    StallTrace &trace = ring[index];
+    trace.time = monotonicMs();
+    trace.latency = latency;
+    trace.frameCount = 0;
+    trace.callCount = 0;
+
+    armedIndex = index;
+    armed.fetchAndStoreOrdered(1);
+    if (pthread_kill(target, STALL_SIGNAL) != 0) {
+        armed.fetchAndStoreOrdered(0);
+        return false;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += STALL_CAPTURE_TIMEOUT_MS * 1000000L;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+
+    while (sem_timedwait(&capturedSem, &deadline) < 0) {
+        if (errno == EINTR) {
+            continue;
+        }
+        /* Disarm, unless the handler is running already */
+        if (armed.testAndSetOrdered(1, 0)) {
+            return false;
+        }
+        while (sem_wait(&capturedSem) < 0 && errno == EINTR) {
+        }
+        break;
+    }
+
+    ringNext = (index + 1) % STALL_RING_SIZE;
+    flush(index);
+    return true;
+}
+
+void QmStallProfiler::flush(int index)
+{
+    const StallTrace &trace = ring[index];
+    char line[512];
+    int len;
+
+    len = snprintf(line, sizeof(line), "qmsystem stall at %lld ms: no pong %lld ms after the ping\n",
+                   (long long)trace.time, (long long)trace.latency);
+    writeAll(fd, line, qMin(len, (int)sizeof(line) - 1));
+
+#ifdef STALL_TRACK_SLOTS
+    for (int i = trace.callCount - 1; i >= 0; i--) {
+        const StallSlot &slot = trace.calls[i];
+        QMetaMethod method = slot.metaObject->method(slot.index);
+        len = snprintf(line, sizeof(line), "  in slot %s::%s\n",
+                       slot.metaObject->className(), method.signature());
+        writeAll(fd, line, qMin(len, (int)sizeof(line) - 1));
+    }
+#endif
+
+    backtrace_symbols_fd(trace.frames, trace.frameCount, fd);
+    writeAll(fd, "\n", 1);
+}
+
+} // MeeGo namespace
@@ -0,0 +1,109 @@
+/*!
+ * @file qmstallprofiler_p.h
+ * @brief Contains QmStallProfiler, which samples a stalled event loop
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   @scope Private
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#ifndef QMSTALLPROFILER_P_H
+#define QMSTALLPROFILER_P_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <pthread.h>
+
+namespace MeeGo
+{
+    /**
+     * Captures the stack of a thread whose watchdog ping has not been
+     * answered for a while, together with the slots it is executing.
+     *
+     * The thread is interrupted with SIGPROF, and the signal handler copies
+     * the stack and the slots into a preallocated ring buffer. A sampler
+     * thread of the profiler writes the captures into a file right away, so
+     * that they survive DSME killing the process. The capture is repeated
+     * at each threshold for as long as the ping is unanswered.
+     *
+     * The slots are tracked with the signal spy callbacks of QtCore, which
+     * see the slots called through connections. The callbacks are declared
+     * in the private qobject_p.h of Qt 4, not in its public API, so the
+     * slots are tracked only when built against Qt 4; a later Qt gets the
+     * stacks without the slots. While a profiler is enabled, the callbacks
+     * run around every slot call of every thread of the process, and add a
+     * thread check to each of them. The frames are written as
+     * backtrace_symbols_fd() prints them, link the application with
+     * -rdynamic to get the function names.
+     *
+     * A single profiler can be enabled in a process at a time.
+     */
+    class QmStallProfiler : public QThread
+    {
+    public:
+        QmStallProfiler();
+        ~QmStallProfiler();
+
+        /**
+         * Starts profiling the calling thread.
+         *
+         * @param threshold The time in ms a ping may remain unanswered
+         * @param fileName The file the captures are appended to, stderr if empty
+         * @return False if the file cannot be opened or another profiler is enabled
+         */
+        bool enable(int threshold, const QByteArray &fileName);
+
+        /* Stops the sampler, closes the file and restores the signal handler */
+        void disable();
+
+        bool isEnabled() const;
+
+        /* Called at a ping and at its pong, from any thread */
+        void pinged();
+        void ponged();
+
+        /* The number of the stacks captured */
+        int captures() const;
+
+    protected:
+        void run();
+
+    private:
+        bool capture(qint64 latency);
+        void flush(int index);
+
+        int threshold;          // ms
+        int fd;
+        bool ownFd;
+        pthread_t target;
+
+        mutable QMutex mutex;
+        QWaitCondition changed;
+        bool stopping;
+        bool pending;           // a ping without a pong
+        qint64 pingTime;        // ms, monotonic
+        int samples;            // taken for the pending ping
+        int captured;
+    };
+
+} // MeeGo namespace
+
+#endif // QMSTALLPROFILER_P_H
@@ -0,0 +1,229 @@
+/*!
+ * @file qmsystemsnapshot.cpp
+ * @brief QmSystemSnapshot
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#include "qmsystemsnapshot.h"
+#include "qmsystemsnapshot_p.h"
+
+/* For the reply conversions of the classes */
+#include "qmcabc_p.h"
+#include "qmcallstate_p.h"
+#include "qmdevicemode_p.h"
+#include "qmdisplaystate_p.h"
+#include "qmlocks_p.h"
+#include "qmthermal_p.h"
+
+#include "qmipcinterface_p.h"
+
+#include <QDBusPendingCallWatcher>
+#include <QList>
+
+namespace MeeGo {
+
+QmSystemSnapshot::Values::Values()
+    : displayState(QmDisplayState::Unknown),
+      deviceMode(QmDeviceMode::Error),
+      psmState(QmDeviceMode::PSMError),
+      touchAndKeyboardLock(QmLocks::Unknown),
+      deviceLock(QmLocks::Unknown),
+      activity(QmActivity::Inactive),
+      callState(QmCallState::Error),
+      callType(QmCallState::Unknown),
+      cabcMode(QmCABC::Off),
+      thermalState(QmThermal::Error)
+{
+}
+
+QmSystemSnapshot::QmSystemSnapshot(QObject *parent)
+                : QObject(parent) {
+    MEEGO_INITIALIZE(QmSystemSnapshot);
+
+    connect(priv, SIGNAL(fetched()), this, SIGNAL(fetched()));
+}
+
+QmSystemSnapshot::~QmSystemSnapshot() {
+    MEEGO_PRIVATE(QmSystemSnapshot)
+
+    disconnect(priv, SIGNAL(fetched()), this, SIGNAL(fetched()));
+
+    MEEGO_UNINITIALIZE(QmSystemSnapshot);
+}
+
+QmSystemSnapshot::Values QmSystemSnapshot::fetch(int timeout) {
+    QList<QDBusPendingCallWatcher*> calls;
+    QList<int> requests;
+
+    /* Send everything first, then collect */
+    for (int i = 0; i < QmSystemSnapshotPrivate::RequestCount; i++) {
+        QDBusMessage message = QmSystemSnapshotPrivate::message((QmSystemSnapshotPrivate::Request)i);
+        if (message.type() == QDBusMessage::InvalidMessage) {
+            continue;
+        }
+        calls.append(QmIPCInterface::asyncCallMessage(message, 0, timeout));
+        requests.append(i);
+    }
+
+    Values values;
+    for (int i = 0; i < calls.size(); i++) {
+        calls[i]->waitForFinished();
+        QmSystemSnapshotPrivate::store((QmSystemSnapshotPrivate::Request)requests[i],
+                                       calls[i]->reply(), values);
+    }
+    qDeleteAll(calls);
+    return values;
+}
+
+bool QmSystemSnapshot::fetchAsync(int timeout) {
+    MEEGO_PRIVATE(QmSystemSnapshot)
+
+    if (!priv->pending.isEmpty()) {
+        return false;
+    }
+
+    priv->next = Values();
+
+    for (int i = 0; i < QmSystemSnapshotPrivate::RequestCount; i++) {
+        QDBusMessage message = QmSystemSnapshotPrivate::message((QmSystemSnapshotPrivate::Request)i);
+        if (message.type() == QDBusMessage::InvalidMessage) {
+            continue;
+        }
+        QDBusPendingCallWatcher *watcher = QmIPCInterface::asyncCallMessage(message, priv, timeout);
+        priv->pending.insert(watcher, i);
+        QObject::connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)),
+                         priv, SLOT(didReceiveReply(QDBusPendingCallWatcher*)));
+    }
+    return true;
+}
+
+QmSystemSnapshot::Values QmSystemSnapshot::values() const {
+    MEEGO_PRIVATE_CONST(QmSystemSnapshot)
+
+    return priv->values;
+}
+
+QDBusMessage QmSystemSnapshotPrivate::message(Request request) {
+    QDBusMessage message;
+
+    switch (request) {
+    #if HAVE_MCE
+    case DisplayStateRequest:
+        message = QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH, MCE_REQUEST_IF,
+                                                 MCE_DISPLAY_STATUS_GET);
+        break;
+    case DeviceModeRequest:
+        message = QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH, MCE_REQUEST_IF,
+                                                 MCE_RADIO_STATES_GET);
+        break;
+    case PSMStateRequest:
+        message = QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH, MCE_REQUEST_IF,
+                                                 MCE_PSM_STATE_GET);
+        break;
+    case TouchAndKeyboardLockRequest:
+        message = QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH, MCE_REQUEST_IF,
+                                                 MCE_TKLOCK_MODE_GET);
+        break;
+    case ActivityRequest:
+        message = QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH, MCE_REQUEST_IF,
+                                                 MCE_INACTIVITY_STATUS_GET);
+        break;
+    case CallStateRequest:
+        message = QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH, MCE_REQUEST_IF,
+                                                 MCE_CALL_STATE_GET);
+        break;
+    case CABCRequest:
+        message = QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH, MCE_REQUEST_IF,
+                                                 MCE_CABC_MODE_GET);
+        break;
+    #endif
+    case DeviceLockRequest:
+        message = QDBusMessage::createMethodCall(DEVLOCK_SERVICE, DEVLOCK_PATH, DEVLOCK_SERVICE,
+                                                 DEVLOCK_GET);
+        message << DEVLOCK_LOCK_TYPE_DEVICE;
+        break;
+    case ThermalRequest:
+        message = QDBusMessage::createMethodCall(SYS_THERMALMANAGER_SERVICE, SYS_THERMALMANAGER_PATH,
+                                                 SYS_THERMALMANAGER_INTERFACE, SYS_THERMALMANAGER_STATE_GET);
+        break;
+    default:
+        break;
+    }
+    return message;
+}
+
+void QmSystemSnapshotPrivate::store(Request request, const QDBusMessage &reply,
+                                    QmSystemSnapshot::Values &values) {
+    if (reply.type() != QDBusMessage::ReplyMessage) {
+        return;
+    }
+
+    QList<QVariant> resp = reply.arguments();
+    if (resp.isEmpty()) {
+        return;
+    }
+
+    switch (request) {
+    case DisplayStateRequest:
+        values.displayState = QmDisplayStatePrivate::stringToState(resp[0].toString());
+        break;
+    case DeviceModeRequest:
+        values.deviceMode = QmDeviceModePrivate::radioStateToDeviceMode(resp[0].toUInt());
+        break;
+    case PSMStateRequest:
+        values.psmState = QmDeviceModePrivate::psmStateToModeEnum(resp[0].toBool());
+        break;
+    case TouchAndKeyboardLockRequest:
+        values.touchAndKeyboardLock = QmLocksPrivate::stringToState(resp[0].toString());
+        break;
+    case DeviceLockRequest:
+        values.deviceLock = QmLocksPrivate::stateToState(resp[0].toInt());
+        break;
+    case ActivityRequest:
+        values.activity = resp[0].toBool() ? QmActivity::Inactive : QmActivity::Active;
+        break;
+    case CallStateRequest:
+        if (resp.count() == 2) {
+            QmCallStatePrivate::stringsToState(resp[0].toString(), resp[1].toString(),
+                                               values.callState, values.callType);
+        }
+        break;
+    case CABCRequest:
+        values.cabcMode = QmCABCPrivate::stringToMode(resp[0].toString());
+        break;
+    case ThermalRequest:
+        values.thermalState = QmThermalPrivate::stringToState(resp[0].toString());
+        break;
+    default:
+        break;
+    }
+}
+
+void QmSystemSnapshotPrivate::didReceiveReply(QDBusPendingCallWatcher *call) {
+    int request = pending.take(call);
+    store((Request)request, call->reply(), next);
+    call->deleteLater();
+
+    if (pending.isEmpty()) {
+        values = next;
+        emit fetched();
+    }
+}
+
+} // MeeGo namespace
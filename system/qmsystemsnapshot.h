@@ -0,0 +1,132 @@
+/*!
+ * @file qmsystemsnapshot.h
+ * @brief Contains QmSystemSnapshot which fetches the MCE and thermal states at once.
+
+   <p>
+   @copyright (C) 2009-2011 Nokia Corporation
+   @license LGPL Lesser General Public License
+
+   @scope Nokia Meego
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#ifndef QMSYSTEMSNAPSHOT_H
+#define QMSYSTEMSNAPSHOT_H
+
+#include "system_global.h"
+#include "qmactivity.h"
+#include "qmcabc.h"
+#include "qmcallstate.h"
+#include "qmdevicemode.h"
+#include "qmdisplaystate.h"
+#include "qmlocks.h"
+#include "qmthermal.h"
+
+#include <QtCore/qobject.h>
+
+QT_BEGIN_HEADER
+
+namespace MeeGo {
+
+class QmSystemSnapshotPrivate;
+
+/*!
+ * @scope Nokia Meego
+ *
+ * @class QmSystemSnapshot
+ * @brief QmSystemSnapshot gets the states of QmDisplayState, QmDeviceMode,
+ * QmLocks, QmActivity, QmCallState, QmCABC and QmThermal at once.
+ *
+ * All the requests are sent before any reply is waited for, so that
+ * fetching the whole snapshot takes about one D-Bus round trip instead of
+ * one round trip per state. Each value is the one the getter of the class
+ * would return, including its error value if the state could not be
+ * retrieved.
+ *
+ * @code
+ * QmSystemSnapshot::Values values = QmSystemSnapshot::fetch();
+ * if (values.displayState == QmDisplayState::On) ...
+ * @endcode
+ */
+class MEEGO_SYSTEM_EXPORT QmSystemSnapshot : public QObject
+{
+    Q_OBJECT
+
+public:
+    //! The states in a snapshot
+    struct Values
+    {
+        Values();
+
+        QmDisplayState::DisplayState displayState; //!< As by QmDisplayState::get()
+        QmDeviceMode::DeviceMode deviceMode;       //!< As by QmDeviceMode::getMode()
+        QmDeviceMode::PSMState psmState;           //!< As by QmDeviceMode::getPSMState()
+        QmLocks::State touchAndKeyboardLock;       //!< As by QmLocks::getState(QmLocks::TouchAndKeyboard)
+        QmLocks::State deviceLock;                 //!< As by QmLocks::getState(QmLocks::Device)
+        QmActivity::Activity activity;             //!< As by QmActivity::get()
+        QmCallState::State callState;              //!< As by QmCallState::getState()
+        QmCallState::Type callType;                //!< As by QmCallState::getType()
+        QmCABC::Mode cabcMode;                     //!< As by QmCABC::get()
+        QmThermal::ThermalState thermalState;      //!< As by QmThermal::get()
+    };
+
+public:
+    /*!
+     * @brief Constructor
+     * @param parent The parent object
+     */
+    QmSystemSnapshot(QObject *parent = 0);
+    ~QmSystemSnapshot();
+
+    /*!
+     * @brief Gets all the states, blocking until every reply has arrived
+     * or timed out.
+     * @param timeout Timeout of each request in milliseconds, -1 for the D-Bus default
+     * @return The states
+     */
+    static Values fetch(int timeout = -1);
+
+    /*!
+     * @brief Requests all the states without blocking. The fetched() signal
+     * is sent when every reply has arrived or timed out. A request made
+     * while another one is pending is ignored.
+     * @param timeout Timeout of each request in milliseconds, -1 for the D-Bus default
+     * @return False if a request was already pending
+     */
+    bool fetchAsync(int timeout = -1);
+
+    /*!
+     * @brief Gets the states of the last completed fetchAsync().
+     * @return The states, the error values if no request has completed
+     */
+    Values values() const;
+
+Q_SIGNALS:
+    /*!
+     * @brief Sent when the states requested with fetchAsync() have been retrieved.
+     */
+    void fetched();
+
+private:
+    Q_DISABLE_COPY(QmSystemSnapshot)
+    MEEGO_DECLARE_PRIVATE(QmSystemSnapshot)
+};
+
+} // MeeGo namespace
+
+QT_END_HEADER
+
+#endif // QMSYSTEMSNAPSHOT_H
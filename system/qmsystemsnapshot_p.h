@@ -0,0 +1,79 @@
+/*!
+ * @file qmsystemsnapshot_p.h
+ * @brief Contains QmSystemSnapshotPrivate
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   @scope Private
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#ifndef QMSYSTEMSNAPSHOT_P_H
+#define QMSYSTEMSNAPSHOT_P_H
+
+#include "qmsystemsnapshot.h"
+
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QHash>
+
+namespace MeeGo
+{
+    class QmSystemSnapshotPrivate : public QObject
+    {
+        Q_OBJECT
+        MEEGO_DECLARE_PUBLIC(QmSystemSnapshot)
+
+    public:
+        enum Request
+        {
+            DisplayStateRequest = 0,
+            DeviceModeRequest,
+            PSMStateRequest,
+            TouchAndKeyboardLockRequest,
+            DeviceLockRequest,
+            ActivityRequest,
+            CallStateRequest,
+            CABCRequest,
+            ThermalRequest,
+            RequestCount
+        };
+
+        QmSystemSnapshotPrivate() {}
+        ~QmSystemSnapshotPrivate() {}
+
+        /* The get call of a request, an invalid message if the service is
+         * not supported by this build */
+        static QDBusMessage message(Request request);
+
+        /* Stores the value of a reply as the getter of its class would */
+        static void store(Request request, const QDBusMessage &reply,
+                          QmSystemSnapshot::Values &values);
+
+        QHash<QDBusPendingCallWatcher*, int> pending;
+        QmSystemSnapshot::Values next;
+        QmSystemSnapshot::Values values;
+
+    Q_SIGNALS:
+        void fetched();
+
+    private Q_SLOTS:
+        void didReceiveReply(QDBusPendingCallWatcher *call);
+    };
+}
+
+#endif // QMSYSTEMSNAPSHOT_P_H
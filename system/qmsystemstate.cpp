@@ -29,6 +29,7 @@
  */
 #include "qmsystemstate.h"
 #include "qmsystemstate_p.h"
+#include "qmsignalhub_p.h"
 
 #include "qmsysteminformation.h"
 
@@ -70,6 +71,8 @@ QmSystemState::QmSystemState(QObject *parent)
 
     connect(priv, SIGNAL(systemStateChanged(MeeGo::QmSystemState::StateIndication)),
             this, SIGNAL(systemStateChanged(MeeGo::QmSystemState::StateIndication)));
+    connect(priv, SIGNAL(powerOnTimeReceived(unsigned int)),
+            this, SIGNAL(powerOnTimeReceived(unsigned int)));
 }
 
 QmSystemState::~QmSystemState() {
@@ -77,6 +80,8 @@ QmSystemState::~QmSystemState() {
 
     disconnect(priv, SIGNAL(systemStateChanged(MeeGo::QmSystemState::StateIndication)),
                this, SIGNAL(systemStateChanged(MeeGo::QmSystemState::StateIndication)));
+    disconnect(priv, SIGNAL(powerOnTimeReceived(unsigned int)),
+               this, SIGNAL(powerOnTimeReceived(unsigned int)));
 
     MEEGO_UNINITIALIZE(QmSystemState);
 }
@@ -89,36 +94,36 @@ void QmSystemState::connectNotify(const char *signal) {
 
     if (QLatin1String(signal) == QLatin1String(QMetaObject::normalizedSignature(SIGNAL(systemStateChanged(MeeGo::QmSystemState::StateIndication))))) {
         if (0 == priv->connectCount[SIGNAL_SYSTEM_STATE]) {
-            QDBusConnection::systemBus().connect(dsme_service,
-                                                 dsme_sig_path,
-                                                 dsme_sig_interface,
-                                                 dsme_shutdown_ind,
-                                                 priv,
-                                                 SLOT(emitShutdown()));
-            QDBusConnection::systemBus().connect(dsme_service,
-                                                 dsme_sig_path,
-                                                 dsme_sig_interface,
-                                                 dsme_save_unsaved_data_ind,
-                                                 priv,
-                                                 SLOT(emitSaveData()));
-            QDBusConnection::systemBus().connect(dsme_service,
-                                                 dsme_sig_path,
-                                                 dsme_sig_interface,
-                                                 dsme_battery_empty_ind,
-                                                 priv,
-                                                 SLOT(emitBatteryShutdown()));
-            QDBusConnection::systemBus().connect(dsme_service,
-                                                 dsme_sig_path,
-                                                 dsme_sig_interface,
-                                                 dsme_state_req_denied_ind,
-                                                 priv,
-                                                 SLOT(emitShutdownDenied(QString, QString)));
-            QDBusConnection::systemBus().connect(SYS_THERMALMANAGER_SERVICE,
-                                                 SYS_THERMALMANAGER_PATH,
-                                                 SYS_THERMALMANAGER_INTERFACE,
-                                                 SYS_THERMALMANAGER_STATE_SIG,
-                                                 priv,
-                                                 SLOT(emitThermalShutdown(QString)));
+            QmSignalHub::connect(dsme_service,
+                                 dsme_sig_path,
+                                 dsme_sig_interface,
+                                 dsme_shutdown_ind,
+                                 priv,
+                                 SLOT(emitShutdown()));
+            QmSignalHub::connect(dsme_service,
+                                 dsme_sig_path,
+                                 dsme_sig_interface,
+                                 dsme_save_unsaved_data_ind,
+                                 priv,
+                                 SLOT(emitSaveData()));
+            QmSignalHub::connect(dsme_service,
+                                 dsme_sig_path,
+                                 dsme_sig_interface,
+                                 dsme_battery_empty_ind,
+                                 priv,
+                                 SLOT(emitBatteryShutdown()));
+            QmSignalHub::connect(dsme_service,
+                                 dsme_sig_path,
+                                 dsme_sig_interface,
+                                 dsme_state_req_denied_ind,
+                                 priv,
+                                 SLOT(emitShutdownDenied(QString, QString)));
+            QmSignalHub::connect(SYS_THERMALMANAGER_SERVICE,
+                                 SYS_THERMALMANAGER_PATH,
+                                 SYS_THERMALMANAGER_INTERFACE,
+                                 SYS_THERMALMANAGER_STATE_SIG,
+                                 priv,
+                                 SLOT(emitThermalShutdown(QString)));
         }
         priv->connectCount[SIGNAL_SYSTEM_STATE]++;
     }
@@ -134,36 +139,36 @@ void QmSystemState::disconnectNotify(const char *signal) {
         priv->connectCount[SIGNAL_SYSTEM_STATE]--;
 
         if (0 == priv->connectCount[SIGNAL_SYSTEM_STATE]) {
-            QDBusConnection::systemBus().disconnect(dsme_service,
-                                                    dsme_sig_path,
-                                                    dsme_sig_interface,
-                                                    dsme_shutdown_ind,
-                                                    priv,
-                                                    SLOT(emitShutdown()));
-            QDBusConnection::systemBus().disconnect(dsme_service,
-                                                    dsme_sig_path,
-                                                    dsme_sig_interface,
-                                                    dsme_save_unsaved_data_ind,
-                                                    priv,
-                                                    SLOT(emitSaveData()));
-            QDBusConnection::systemBus().disconnect(dsme_service,
-                                                    dsme_sig_path,
-                                                    dsme_sig_interface,
-                                                    dsme_battery_empty_ind,
-                                                    priv,
-                                                    SLOT(emitBatteryShutdown()));
-            QDBusConnection::systemBus().disconnect(dsme_service,
-                                                    dsme_sig_path,
-                                                    dsme_sig_interface,
-                                                    dsme_state_req_denied_ind,
-                                                    priv,
-                                                    SLOT(emitShutdownDenied(QString, QString)));
-            QDBusConnection::systemBus().disconnect(SYS_THERMALMANAGER_SERVICE,
-                                                    SYS_THERMALMANAGER_PATH,
-                                                    SYS_THERMALMANAGER_INTERFACE,
-                                                    SYS_THERMALMANAGER_STATE_SIG,
-                                                    priv,
-                                                    SLOT(emitThermalShutdown(QString)));
+            QmSignalHub::disconnect(dsme_service,
+                                    dsme_sig_path,
+                                    dsme_sig_interface,
+                                    dsme_shutdown_ind,
+                                    priv,
+                                    SLOT(emitShutdown()));
+            QmSignalHub::disconnect(dsme_service,
+                                    dsme_sig_path,
+                                    dsme_sig_interface,
+                                    dsme_save_unsaved_data_ind,
+                                    priv,
+                                    SLOT(emitSaveData()));
+            QmSignalHub::disconnect(dsme_service,
+                                    dsme_sig_path,
+                                    dsme_sig_interface,
+                                    dsme_battery_empty_ind,
+                                    priv,
+                                    SLOT(emitBatteryShutdown()));
+            QmSignalHub::disconnect(dsme_service,
+                                    dsme_sig_path,
+                                    dsme_sig_interface,
+                                    dsme_state_req_denied_ind,
+                                    priv,
+                                    SLOT(emitShutdownDenied(QString, QString)));
+            QmSignalHub::disconnect(SYS_THERMALMANAGER_SERVICE,
+                                    SYS_THERMALMANAGER_PATH,
+                                    SYS_THERMALMANAGER_INTERFACE,
+                                    SYS_THERMALMANAGER_STATE_SIG,
+                                    priv,
+                                    SLOT(emitThermalShutdown(QString)));
         }
     }
 }
@@ -249,18 +254,24 @@ QmSystemState::BootReason QmSystemState::getBootReason() {
 }
 
 unsigned int QmSystemState::getPowerOnTimeInSeconds() {
+    MEEGO_PRIVATE(QmSystemState)
+
     unsigned int result = 0;
-    QDBusReply<int> powerontimerReply = QDBusConnection::systemBus().call(
-                                            QDBusMessage::createMethodCall(SYS_POWERONTIMER_SERVICE,
-                                                                           SYS_POWERONTIMER_PATH,
-                                                                           SYS_POWERONTIMER_INTERFACE,
-                                                                           SYS_POWERONTIMER_TIME_GET));
-    if (!powerontimerReply.isValid()) {
+    QList<QVariant> results = priv->powerOnTimerIf->get(SYS_POWERONTIMER_TIME_GET);
+    if (results.isEmpty()) {
         return result;
     }
 
-    result = powerontimerReply.value();
+    result = results[0].toInt();
     return result;
 }
 
+void QmSystemState::getPowerOnTimeInSecondsAsync() {
+    MEEGO_PRIVATE(QmSystemState)
+
+    QObject::connect(priv->powerOnTimerIf->getAsync(SYS_POWERONTIMER_TIME_GET),
+                     SIGNAL(finished(QDBusPendingCallWatcher*)),
+                     priv, SLOT(didReceivePowerOnTime(QDBusPendingCallWatcher*)));
+}
+
 } // MeeGo namespace
@@ -143,6 +143,13 @@ public:
      */
     unsigned int getPowerOnTimeInSeconds();
 
+    /*!
+     * @brief Gets the power on counter without blocking.
+     * The powerOnTimeReceived() signal is sent when the counter has been
+     * retrieved, with 0 in case of an error, as by getPowerOnTimeInSeconds().
+     */
+    void getPowerOnTimeInSecondsAsync();
+
 Q_SIGNALS:
     /*!
      * @brief Sent when device state indication has been received.
@@ -150,6 +157,12 @@ Q_SIGNALS:
      */
     void systemStateChanged(MeeGo::QmSystemState::StateIndication what);
 
+    /*!
+     * @brief Sent when the power on counter requested with getPowerOnTimeInSecondsAsync() has been retrieved.
+     * @param seconds The total time in seconds the device has been powered on
+     */
+    void powerOnTimeReceived(unsigned int seconds);
+
 protected:
     void connectNotify(const char *signal);
     void disconnectNotify(const char *signal);
@@ -50,6 +50,10 @@ namespace MeeGo
                            dsme_service,
                            dsme_req_path,
                            dsme_req_interface);
+            powerOnTimerIf = new QmIPCInterface(
+                           SYS_POWERONTIMER_SERVICE,
+                           SYS_POWERONTIMER_PATH,
+                           SYS_POWERONTIMER_INTERFACE);
             connectCount[SIGNAL_SYSTEM_STATE] = 0;
         }
 
@@ -57,18 +61,34 @@ namespace MeeGo
             if (dsmeRequestIf) {
                 delete dsmeRequestIf, dsmeRequestIf = 0;
             }
+            if (powerOnTimerIf) {
+                delete powerOnTimerIf, powerOnTimerIf = 0;
+            }
         }
 
         QMutex connectMutex;
         size_t connectCount[1];
         QmIPCInterface *dsmeRequestIf;
+        QmIPCInterface *powerOnTimerIf;
 
     Q_SIGNALS:
 
         void systemStateChanged(MeeGo::QmSystemState::StateIndication what);
+        void powerOnTimeReceived(unsigned int seconds);
 
     private Q_SLOTS:
 
+        void didReceivePowerOnTime(QDBusPendingCallWatcher *call) {
+            QList<QVariant> resp = QmIPCInterface::results(call);
+            call->deleteLater();
+
+            unsigned int seconds = 0;
+            if (!resp.isEmpty()) {
+                seconds = resp[0].toInt();
+            }
+            emit powerOnTimeReceived(seconds);
+        }
+
         void emitShutdown() {
             emit systemStateChanged(QmSystemState::Shutdown);
         }
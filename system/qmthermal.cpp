@@ -26,6 +26,7 @@
  */
 #include "qmthermal.h"
 #include "qmthermal_p.h"
+#include "qmsignalhub_p.h"
 
 namespace MeeGo {
 
@@ -35,6 +36,8 @@ QmThermal::QmThermal(QObject *parent)
 
     connect(priv, SIGNAL(thermalChanged(MeeGo::QmThermal::ThermalState)),
             this, SIGNAL(thermalChanged(MeeGo::QmThermal::ThermalState)));
+    connect(priv, SIGNAL(thermalStateReceived(MeeGo::QmThermal::ThermalState)),
+            this, SIGNAL(thermalStateReceived(MeeGo::QmThermal::ThermalState)));
 }
 
 QmThermal::~QmThermal() {
@@ -42,6 +45,8 @@ QmThermal::~QmThermal() {
 
     disconnect(priv, SIGNAL(thermalChanged(MeeGo::QmThermal::ThermalState)),
                this, SIGNAL(thermalChanged(MeeGo::QmThermal::ThermalState)));
+    disconnect(priv, SIGNAL(thermalStateReceived(MeeGo::QmThermal::ThermalState)),
+               this, SIGNAL(thermalStateReceived(MeeGo::QmThermal::ThermalState)));
 
     MEEGO_UNINITIALIZE(QmThermal);
 }
@@ -54,12 +59,12 @@ void QmThermal::connectNotify(const char *signal) {
 
     if (QLatin1String(signal) == QLatin1String(QMetaObject::normalizedSignature(SIGNAL(thermalChanged(MeeGo::QmThermal::ThermalState))))) {
         if (0 == priv->connectCount[SIGNAL_THERMAL_STATE]) {
-            QDBusConnection::systemBus().connect(SYS_THERMALMANAGER_SERVICE,
-                                                 SYS_THERMALMANAGER_PATH,
-                                                 SYS_THERMALMANAGER_INTERFACE,
-                                                 SYS_THERMALMANAGER_STATE_SIG,
-                                                 priv,
-                                                 SLOT(thermalStateChanged(const QString&)));
+            QmSignalHub::connect(SYS_THERMALMANAGER_SERVICE,
+                                 SYS_THERMALMANAGER_PATH,
+                                 SYS_THERMALMANAGER_INTERFACE,
+                                 SYS_THERMALMANAGER_STATE_SIG,
+                                 priv,
+                                 SLOT(thermalStateChanged(const QString&)));
         }
         priv->connectCount[SIGNAL_THERMAL_STATE]++;
     }
@@ -74,12 +79,12 @@ void QmThermal::disconnectNotify(const char *signal) {
         priv->connectCount[SIGNAL_THERMAL_STATE]--;
 
         if (0 == priv->connectCount[SIGNAL_THERMAL_STATE]) {
-            QDBusConnection::systemBus().disconnect(SYS_THERMALMANAGER_SERVICE,
-                                                    SYS_THERMALMANAGER_PATH,
-                                                    SYS_THERMALMANAGER_INTERFACE,
-                                                    SYS_THERMALMANAGER_STATE_SIG,
-                                                    priv,
-                                                    SLOT(thermalStateChanged(const QString&)));
+            QmSignalHub::disconnect(SYS_THERMALMANAGER_SERVICE,
+                                    SYS_THERMALMANAGER_PATH,
+                                    SYS_THERMALMANAGER_INTERFACE,
+                                    SYS_THERMALMANAGER_STATE_SIG,
+                                    priv,
+                                    SLOT(thermalStateChanged(const QString&)));
         }
     }
 }
@@ -99,4 +104,12 @@ QmThermal::ThermalState QmThermal::get() const {
     return QmThermalPrivate::stringToState(state);
 }
 
+void QmThermal::getAsync() {
+    MEEGO_PRIVATE(QmThermal)
+
+    QObject::connect(priv->If->getAsync(SYS_THERMALMANAGER_STATE_GET),
+                     SIGNAL(finished(QDBusPendingCallWatcher*)),
+                     priv, SLOT(didReceiveThermalState(QDBusPendingCallWatcher*)));
+}
+
 } // MeeGo namespace
@@ -83,6 +83,13 @@ public:
      */
     ThermalState get() const;
 
+    /*!
+     * @brief Gets the current thermal state without blocking.
+     * The thermalStateReceived() signal is sent when the state has been
+     * retrieved, with QmThermal::Error in case of an error.
+     */
+    void getAsync();
+
 Q_SIGNALS:
     /*!
      * @brief Sent when device thermal state has changed.
@@ -90,6 +97,12 @@ Q_SIGNALS:
      */
     void thermalChanged(MeeGo::QmThermal::ThermalState state);
 
+    /*!
+     * @brief Sent when the thermal state requested with getAsync() has been retrieved.
+     * @param state Current thermal state
+     */
+    void thermalStateReceived(MeeGo::QmThermal::ThermalState state);
+
 protected:
     void connectNotify(const char *signal);
     void disconnectNotify(const char *signal);
@@ -84,11 +84,23 @@ namespace MeeGo
 
     Q_SIGNALS:
         void thermalChanged(MeeGo::QmThermal::ThermalState);
+        void thermalStateReceived(MeeGo::QmThermal::ThermalState);
 
     private Q_SLOTS:
         void thermalStateChanged(const QString &state) {
             emit thermalChanged(QmThermalPrivate::stringToState(state));
         }
+
+        void didReceiveThermalState(QDBusPendingCallWatcher *call) {
+            QList<QVariant> resp = QmIPCInterface::results(call);
+            call->deleteLater();
+
+            if (resp.isEmpty()) {
+                emit thermalStateReceived(QmThermal::Error);
+            } else {
+                emit thermalStateReceived(QmThermalPrivate::stringToState(resp[0].toString()));
+            }
+        }
     };
 }
 #endif // QMTHERMAL_P_H
@@ -27,9 +27,11 @@
    </p>
  */
 
+#include <QDBusPendingReply>
 #include <QDBusReply>
 #include <QDebug>
 #include <QDateTime>
+#include <QHash>
 
 #if !defined(HAVE_QMLOG)
     #define log_debug(...) do {} while (0)
@@ -44,6 +46,8 @@
 
 #include "qmtime.h"
 #include "qmtime_p.h"
+#include "qmtimezone_p.h"
+#include "qmtimezoneindex_p.h"
 
 MeeGo::QmTime::QmTime(QObject *parent) : QObject(parent)
 {
@@ -66,54 +70,22 @@ MeeGo::QmTime::~QmTime()
 }
 
 QMutex MeeGo::QmTimePrivate2::object_mutex ;
-QMutex MeeGo::QmTimePrivate2::TzWrapper::mutex ;
-
-MeeGo::QmTimePrivate2::TzWrapper::TzWrapper(const char *tz) // NULL means "don't change", empty string means "unset"
-{
-  mutex.lock() ;
-  valid = true ;
-  set_timezone = tz!=NULL ;
-  if (set_timezone)
-  {
-    saved_tz = getenv("TZ") ?: "" ; // if set and empty, then will be unset at exit
-    if (not set_tz_env(tz))
-      set_timezone = valid = false ;
-  }
-}
-
-MeeGo::QmTimePrivate2::TzWrapper::~TzWrapper()
-{
-  if (set_timezone)
-  {
-    if (not set_tz_env(saved_tz.c_str()))
-      log_critical("can't restore TZ environment '%s'", saved_tz.c_str()) ;
-  }
-  mutex.unlock() ;
-}
-
-bool MeeGo::QmTimePrivate2::TzWrapper::set_tz_env(const char *tz)
-{
-  bool res ;
-  if (*tz=='\0') // empty string -> unset
-    res = unsetenv("TZ")==0 ;
-  else
-    res = setenv("TZ", tz, true)==0 ;
-  tzset() ;
-  return res ;
-}
 
 bool MeeGo::QmTimePrivate2::remote_time(const char *tz, time_t t, QDateTime *qdatetime, struct tm *tm)
 {
-  MeeGo::QmTimePrivate2::TzWrapper tmp_tz(tz) ;
-  if (not tmp_tz.is_valid())
+  // tz: NULL means the zone of the process, empty string means TZ unset
+  //   The environment is only read, the conversion takes no lock
+  if (tz==NULL)
+    tz = getenv("TZ") ;
+  else if (*tz=='\0')
+    tz = NULL ;
+
+  struct tm local_tm, *p_tm = tm ?: &local_tm ;
+  if (not MeeGo::QmTimeZone::find(tz)->convert(t, p_tm))
   {
-    log_error("can't set TZ environment '%s'", tz ?: "[null]") ;
+    log_error("can't convert time %ld to time zone '%s'", (long)t, tz ?: "[null]") ;
     return false ;
   }
-  struct tm local_tm, *p_tm = tm ?: &local_tm ;
-  bool res = localtime_r(&t, p_tm) == p_tm ;
-  if (not res)
-    return false ;
 
   if (qdatetime!=NULL)
   {
@@ -148,6 +120,14 @@ bool MeeGo::QmTime::setTimezone(const QString tz)
   if (not s.check())
     return false;
 
+  if (p->sync_policy==Asynchronous)
+  {
+    p->pending.zone_mode = QmTimePrivate2::pending_settings_t::ZoneManual ;
+    p->pending.zone = tz ;
+    p->schedule_settings() ;
+    return true ;
+  }
+
   QDBusMessage reply = p->timed->wall_clock_settings_sync(s) ;
   QDBusReply<bool> reply_bool = reply ;
 
@@ -170,28 +150,7 @@ bool MeeGo::QmTime::setTimezone(const QString tz)
 
 int MeeGo::QmTime::getTimeDiff(time_t t, const QString &tz1, const QString &tz2)
 {
-  string s1 = tz1.toStdString(), s2 = tz2.toStdString() ;
-
-  struct tm tm1, tm2;
-  bool res1 = p->remote_time(s1.c_str(), t, NULL, &tm1) ;
-
-  if (not res1)
-  {
-    log_error("can't calculate gmt offset for time zone '%s'", s1.c_str()) ;
-    return -1 ;
-  }
-
-  bool res2 = p->remote_time(s2.c_str(), t, NULL, &tm2) ;
-
-  if (not res2)
-  {
-    log_error("can't calculate gmt offset for time zone '%s'", s2.c_str()) ;
-    return -1 ;
-  }
-
-  long diff = tm1.tm_gmtoff- tm2.tm_gmtoff ;
-
-  return diff ;
+  return p->zone_offset(tz1.toStdString(), t) - p->zone_offset(tz2.toStdString(), t) ;
 }
 
 enum MeeGo::QmTime::AutoSystemTimeStatus MeeGo::QmTime::autoSystemTime()
@@ -213,6 +172,16 @@ bool MeeGo::QmTime::setAutoSystemTime(enum MeeGo::QmTime::AutoSystemTimeStatus n
   else
     return false ;
 
+  if (p->sync_policy==Asynchronous)
+  {
+    if (new_status==AutoSystemTimeOn)
+      p->pending.time_mode = QmTimePrivate2::pending_settings_t::TimeNitz ;
+    else if (p->pending.time_mode!=QmTimePrivate2::pending_settings_t::TimeSet) // manual anyway
+      p->pending.time_mode = QmTimePrivate2::pending_settings_t::TimeManual ;
+    p->schedule_settings() ;
+    return true ;
+  }
+
   QDBusMessage reply = p->timed->wall_clock_settings_sync(s) ;
   QDBusReply<bool> reply_bool = reply ;
 
@@ -252,6 +221,22 @@ bool MeeGo::QmTime::setAutoTimeZone(enum MeeGo::QmTime::AutoTimeZoneStatus new_s
   else
     return false ;
 
+  if (p->sync_policy==Asynchronous)
+  {
+    if (new_status==AutoTimeZoneOn)
+    {
+      p->pending.zone_mode = QmTimePrivate2::pending_settings_t::ZoneCellular ;
+      p->pending.zone = "" ;
+    }
+    else if (p->pending.zone_mode!=QmTimePrivate2::pending_settings_t::ZoneManual) // a zone set meanwhile is kept
+    {
+      p->pending.zone_mode = QmTimePrivate2::pending_settings_t::ZoneManual ;
+      p->pending.zone = "" ;
+    }
+    p->schedule_settings() ;
+    return true ;
+  }
+
   QDBusMessage reply = p->timed->wall_clock_settings_sync(s) ;
   QDBusReply<bool> reply_bool = reply ;
 
@@ -289,6 +274,16 @@ bool MeeGo::QmTime::deviceDefaultTimezone(QString &default_timezone)
 }
 
 MeeGo::QmTimePrivate2* MeeGo::QmTimePrivate2::object = 0 ;
+MeeGo::QmTime::SettingsSynchronizationPolicy MeeGo::QmTimePrivate2::default_sync_policy = MeeGo::QmTime::SynchronizeOnWrite ;
+
+bool MeeGo::QmTime::setSynchronizationPolicy(MeeGo::QmTime::SettingsSynchronizationPolicy policy)
+{
+  QMutexLocker locker(&QmTimePrivate2::object_mutex) ;
+  QmTimePrivate2::default_sync_policy = policy ;
+  if (QmTimePrivate2::object)
+    QmTimePrivate2::object->sync_policy = policy ;
+  return true ;
+}
 
 MeeGo::QmTimePrivate2 *MeeGo::QmTimePrivate2::get_object()
 {
@@ -314,13 +309,14 @@ void MeeGo::QmTimePrivate2::unref_object()
 
 MeeGo::QmTimePrivate2::QmTimePrivate2(QObject *parent) : QObject(parent)
 {
-  sync_policy = MeeGo::QmTime::WaitForSignal ;
-  sync_policy = MeeGo::QmTime::SynchronizeOnWrite ; // this line to be removed later
+  sync_policy = default_sync_policy ;
   disconn_policy = MeeGo::QmTime::KeepConnected ;
   counter = 0 ;
   initialized = false ;
   timed_info_valid = false ;
   timed = NULL ;
+  info_serial = 0 ;
+  flush_scheduled = false ;
 }
 
 void MeeGo::QmTimePrivate2::initialize()
@@ -337,7 +333,10 @@ void MeeGo::QmTimePrivate2::initialize()
   else
     log_notice("connected to timed signal") ;
 
-  syncronize_timed_info() ;
+  if (sync_policy==MeeGo::QmTime::Asynchronous)
+    request_timed_info() ;
+  else
+    syncronize_timed_info() ;
 
   initialized = true ;
 }
@@ -359,6 +358,85 @@ bool MeeGo::QmTimePrivate2::syncronize_timed_info()
   }
 }
 
+void MeeGo::QmTimePrivate2::request_timed_info()
+{
+  QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(timed->get_wall_clock_info_async(), this) ;
+  watcher->setProperty("serial", info_serial) ;
+  connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)), this, SLOT(timed_info_received(QDBusPendingCallWatcher*))) ;
+}
+
+void MeeGo::QmTimePrivate2::timed_info_received(QDBusPendingCallWatcher *watcher)
+{
+  QDBusPendingReply<Maemo::Timed::WallClock::Info> reply = *watcher ;
+  watcher->deleteLater() ;
+
+  if (reply.isError())
+  {
+    log_error("requesting timed info failed: error '%s'", reply.error().message().toStdString().c_str()) ;
+    return ;
+  }
+  if (watcher->property("serial").toUInt()!=info_serial)
+  {
+    log_notice("timed info reply dropped: a newer signal was received") ;
+    return ;
+  }
+
+  log_notice("timed info received") ;
+  process_timed_info(reply.value(), false, true) ;
+}
+
+void MeeGo::QmTimePrivate2::schedule_settings()
+{
+  // The changes of this event loop iteration go in one request
+  if (flush_scheduled)
+    return ;
+  flush_scheduled = true ;
+  QMetaObject::invokeMethod(this, "flush_settings", Qt::QueuedConnection) ;
+}
+
+void MeeGo::QmTimePrivate2::flush_settings()
+{
+  flush_scheduled = false ;
+  if (pending.time_mode==pending_settings_t::TimeUnchanged and pending.zone_mode==pending_settings_t::ZoneUnchanged)
+    return ;
+  if (timed==NULL)
+    return ;
+
+  Maemo::Timed::WallClock::Settings s ;
+  if (pending.time_mode==pending_settings_t::TimeNitz)
+    s.setTimeNitz() ;
+  else if (pending.time_mode==pending_settings_t::TimeManual)
+    s.setTimeManual() ;
+  else if (pending.time_mode==pending_settings_t::TimeSet)
+    s.setTimeManual(pending.time) ;
+  if (pending.zone_mode==pending_settings_t::ZoneCellular)
+    s.setTimezoneCellular() ;
+  else if (pending.zone_mode==pending_settings_t::ZoneManual)
+    s.setTimezoneManual(pending.zone) ;
+  pending = pending_settings_t() ;
+
+  if (not s.check())
+  {
+    log_error("can't change time settings: invalid combination") ;
+    return ;
+  }
+
+  // The cached settings are updated by the signal timed sends on change
+  QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(timed->wall_clock_settings_async(s), this) ;
+  connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)), this, SLOT(settings_written(QDBusPendingCallWatcher*))) ;
+}
+
+void MeeGo::QmTimePrivate2::settings_written(QDBusPendingCallWatcher *watcher)
+{
+  QDBusPendingReply<bool> reply = *watcher ;
+  watcher->deleteLater() ;
+
+  if (reply.isError() or not reply.value())
+    log_error("can't change time settings, error message: '%s'", reply.error().message().toStdString().c_str()) ;
+  else
+    log_notice("time settings changed") ;
+}
+
 void MeeGo::QmTimePrivate2::uninitialize_v2()
 {
   initialized = false ;
@@ -373,7 +451,10 @@ void MeeGo::QmTimePrivate2::uninitialize_v2()
   }
 
   if (timed)
+  {
+    flush_settings() ;
     delete timed, timed = NULL ;
+  }
 
   timed_info_valid = false ;
 }
@@ -389,7 +470,10 @@ void MeeGo::QmTimePrivate2::uninitialize()
     log_notice("disconnected from timed signal") ;
 
   if (timed)
+  {
+    flush_settings() ;
     delete timed, timed = NULL ;
+  }
 
   timed_info_valid = false ;
 }
@@ -402,17 +486,106 @@ bool MeeGo::QmTime::localTime(time_t t, QDateTime &qdatetime, struct tm *tm)
 
 bool MeeGo::QmTime::remoteTime(QString const &tz, time_t t, QDateTime &qdatetime, struct tm *tm)
 {
-  bool empty = tz.isEmpty() ;
-  const char *p = "" ;
-  string timezone ;
-  if (not empty)
+  string timezone = MeeGo::QmTimePrivate2::remote_tz(tz) ;
+  return MeeGo::QmTimePrivate2::remote_time(timezone.c_str(), t, &qdatetime, tm) ;
+}
+
+bool MeeGo::QmTime::remoteTimes(const QString &tz, const QVector<time_t> &t, QVector<struct tm> &tm)
+{
+  tm.resize(t.size()) ;
+  return MeeGo::QmTimePrivate2::remote_zone(tz)->convert(t.constData(), t.size(), tm.data()) ;
+}
+
+bool MeeGo::QmTime::remoteOffsets(const QString &tz, const QVector<time_t> &t, QVector<int> &offsets)
+{
+  offsets.resize(t.size()) ;
+  MeeGo::QmTimePrivate2::remote_zone(tz)->offsets(t.constData(), t.size(), offsets.data()) ;
+  return true ;
+}
+
+bool MeeGo::QmTime::remoteTimes(const QVector<QPair<QString, time_t> > &moments, QVector<struct tm> &tm)
+{
+  tm.resize(moments.size()) ;
+  return MeeGo::QmTimePrivate2::remote_batch(moments, NULL, tm.data()) ;
+}
+
+bool MeeGo::QmTime::remoteOffsets(const QVector<QPair<QString, time_t> > &moments, QVector<int> &offsets)
+{
+  offsets.resize(moments.size()) ;
+  return MeeGo::QmTimePrivate2::remote_batch(moments, offsets.data(), NULL) ;
+}
+
+int MeeGo::QmTime::remoteOffset(const QString &tz, time_t t)
+{
+  return MeeGo::QmTimePrivate2::zone_offset(MeeGo::QmTimePrivate2::remote_tz(tz), t) ;
+}
+
+string MeeGo::QmTimePrivate2::remote_tz(const QString &tz)
+{
+  if (tz.isEmpty())
+    return "" ;
+  string timezone = (string)":" + tz.toStdString() ;
+  size_t colons = timezone.find_first_not_of(':') ;
+  if (colons==string::npos) // Make sure we have exactly one ':'
+    return ":" ;
+  return timezone.substr(colons-1) ;
+}
+
+const MeeGo::QmTimeZone *MeeGo::QmTimePrivate2::remote_zone(const QString &tz)
+{
+  string timezone = remote_tz(tz) ;
+  return MeeGo::QmTimeZone::find(timezone.empty() ? NULL : timezone.c_str()) ;
+}
+
+int MeeGo::QmTimePrivate2::zone_offset(const string &tz, time_t t)
+{
+  // The zones of the zoneinfo are looked up in the index, the others parsed
+  const char *name = tz.c_str() ;
+  if (*name==':')
+    ++ name ;
+  int gmtoff ;
+  const MeeGo::QmTimeZoneIndex *index = *name!='\0' ? MeeGo::QmTimeZoneIndex::get() : NULL ;
+  if (index!=NULL and index->offset(name, t, gmtoff))
+    return gmtoff ;
+  return MeeGo::QmTimeZone::find(tz.empty() ? NULL : tz.c_str())->offset(t) ;
+}
+
+bool MeeGo::QmTimePrivate2::remote_batch(const QVector<QPair<QString, time_t> > &moments, int *offsets, struct tm *tm)
+{
+  // The moments of each zone, so that each zone is looked up and walked once
+  QHash<QString, QVector<int> > by_zone ;
+  for (int i=0; i<moments.size(); ++i)
+    by_zone[moments[i].first].append(i) ;
+
+  bool res = true ;
+  vector<time_t> times ;
+  vector<int> zone_offsets ;
+  vector<struct tm> zone_tm ;
+  for (QHash<QString, QVector<int> >::const_iterator it=by_zone.constBegin(); it!=by_zone.constEnd(); ++it)
   {
-    timezone = (string)":" + tz.toStdString() ;
-    p = timezone.c_str() ;
-    while(*p!='\0' and p[1]==':') // Make sure we have exactly one ':'
-      ++ p ;
+    const QVector<int> &index = it.value() ;
+    int n = index.size() ;
+    times.resize(n) ;
+    for (int k=0; k<n; ++k)
+      times[k] = moments[index[k]].second ;
+
+    const MeeGo::QmTimeZone *zone = remote_zone(it.key()) ;
+    if (offsets!=NULL)
+    {
+      zone_offsets.resize(n) ;
+      zone->offsets(&times[0], n, &zone_offsets[0]) ;
+      for (int k=0; k<n; ++k)
+        offsets[index[k]] = zone_offsets[k] ;
+    }
+    if (tm!=NULL)
+    {
+      zone_tm.resize(n) ;
+      res = zone->convert(&times[0], n, &zone_tm[0]) and res ;
+      for (int k=0; k<n; ++k)
+        tm[index[k]] = zone_tm[k] ;
+    }
   }
-  return MeeGo::QmTimePrivate2::remote_time(p, t, &qdatetime, tm) ;
+  return res ;
 }
 
 MeeGo::QmTimePrivate2::~QmTimePrivate2()
@@ -434,6 +607,7 @@ void MeeGo::QmTimePrivate2::process_timed_info(const Maemo::Timed::WallClock::In
 void MeeGo::QmTimePrivate2::emit_signal(bool systime)
 {
   tzset() ;
+  MeeGo::QmTimeZone::system_zone_changed() ;
   emit change_signal(systime ? MeeGo::QmTime::TimeChanged : MeeGo::QmTime::OnlySettingsChanged) ;
   emit change_signal(systime ? MeeGo::QmTimeTimeChanged : MeeGo::QmTimeOnlySettingsChanged) ;
 }
@@ -469,6 +643,14 @@ bool MeeGo::QmTime::setTime(time_t t)
   if (not s.check())
     return false ;
 
+  if (p->sync_policy==Asynchronous)
+  {
+    p->pending.time_mode = QmTimePrivate2::pending_settings_t::TimeSet ;
+    p->pending.time = t ;
+    p->schedule_settings() ;
+    return true ;
+  }
+
   QDBusMessage reply = p->timed->wall_clock_settings_sync(s) ;
   QDBusReply<bool> reply_bool = reply ;
 
@@ -37,6 +37,8 @@
 #include <QTime>
 #include <QDate>
 #include <QDateTime>
+#include <QPair>
+#include <QVector>
 #include <time.h>
 
 QT_BEGIN_HEADER
@@ -105,7 +107,9 @@ public:
   enum SettingsSynchronizationPolicy
   {
     SynchronizeOnWrite, /**< Every call changing time settings will be followed by settings synchronization D-Bus call */
-    WaitForSignal       /**< Settings will be retrieved only after arrival of the D-Bus signal */
+    WaitForSignal,      /**< Settings will be retrieved only after arrival of the D-Bus signal */
+    Asynchronous        /**< No call blocks: the settings are retrieved in the background, changes made during
+                             one event loop iteration are sent at once, and the settings follow the D-Bus signal */
   } ;
 
   /** Status of the automatic system time setting */
@@ -148,6 +152,10 @@ public:
    *
    * @param p <tt>QmTime::SynchronizeOnWrite</tt> to execute synchronize() after every call changing settings
    *          <tt>QmTime::WaitForSignal</tt> to avoid it
+   *          <tt>QmTime::Asynchronous</tt> to never block on the time daemon; to make the first QmTime
+   *          object not block either, set it before that object is created. The settings are unknown
+   *          until timeOrSettingsChanged() is sent, and the methods changing settings return before
+   *          the changes are applied
    *
    * @return true if successfully set
    */
@@ -338,6 +346,69 @@ public:
    */
   static bool localTime(time_t t, QDateTime &dt, struct tm *p=NULL) ;
 
+  /**
+   * Calculate local times in given timezone for many moments at once
+   *
+   * Faster than remoteTime() for each moment: the time zone is looked up
+   * once and its transitions are walked once, in ascending time order.
+   *
+   * @param   tz       the time zone, empty for the device default time zone
+   * @param   t        times in seconds from the Unix epoch begin
+   * @param   tm       set to the broken down times, in the order of t
+   *
+   * @return  True if all the times were successfully converted
+   */
+  static bool remoteTimes(const QString &tz, const QVector<time_t> &t, QVector<struct tm> &tm) ;
+
+  /**
+   * Calculate the UTC offsets of given timezone at many moments at once
+   *
+   * @param   tz       the time zone, empty for the device default time zone
+   * @param   t        times in seconds from the Unix epoch begin
+   * @param   offsets  set to the offsets from UTC in seconds, positive to the east, in the order of t
+   *
+   * @return  True if information successfully retrieved
+   */
+  static bool remoteOffsets(const QString &tz, const QVector<time_t> &t, QVector<int> &offsets) ;
+
+  /**
+   * Calculate the UTC offset of given timezone at given moment
+   *
+   * The zones of the system zoneinfo are looked up in an index of their
+   * offsets, built once and cached on disk. The first call starts loading
+   * the index in a background thread and returns at once; until the index
+   * is ready the zone is parsed, as by remoteTime().
+   *
+   * @param   tz       the time zone, empty for the device default time zone
+   * @param   t        time in seconds from the Unix epoch begin
+   *
+   * @return  The offset from UTC in seconds, positive to the east
+   */
+  static int remoteOffset(const QString &tz, time_t t) ;
+
+  /**
+   * Calculate local times of many (time zone, time) pairs at once
+   *
+   * The pairs are grouped by time zone, each zone is then converted as by
+   * remoteTimes(const QString &, const QVector<time_t> &, QVector<struct tm> &).
+   *
+   * @param   moments  the time zones, empty for the device default, and the times
+   * @param   tm       set to the broken down times, in the order of moments
+   *
+   * @return  True if all the times were successfully converted
+   */
+  static bool remoteTimes(const QVector<QPair<QString, time_t> > &moments, QVector<struct tm> &tm) ;
+
+  /**
+   * Calculate the UTC offsets of many (time zone, time) pairs at once
+   *
+   * @param   moments  the time zones, empty for the device default, and the times
+   * @param   offsets  set to the offsets from UTC in seconds, positive to the east, in the order of moments
+   *
+   * @return  True if information successfully retrieved
+   */
+  static bool remoteOffsets(const QVector<QPair<QString, time_t> > &moments, QVector<int> &offsets) ;
+
   /**
    * Get time difference between two locations at given moment of time
    *
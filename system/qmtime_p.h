@@ -33,6 +33,7 @@
 #include <string>
 using namespace std ;
 
+#include <QDBusPendingCallWatcher>
 #include <QDebug>
 #include <QMutex>
 #include <timed/interface>
@@ -52,7 +53,7 @@ static inline const char *signal_o() { return SIGNAL(timeOrSettingsChanged(MeeGo
 // Slot name
 static inline const char *p_slot_timed() { return SLOT(timed_signal(const Maemo::Timed::WallClock::Info &, bool)) ; }
 
-namespace MeeGo { class QmTimePrivate2 ; class QmTime ; }
+namespace MeeGo { class QmTimePrivate2 ; class QmTime ; class QmTimeZone ; }
 
 class MeeGo::QmTimePrivate2 : public QObject
 {
@@ -77,6 +78,7 @@ class MeeGo::QmTimePrivate2 : public QObject
   void first_run_init() ;
 
   // Policies
+  static QmTime::SettingsSynchronizationPolicy default_sync_policy ;
   QmTime::SettingsSynchronizationPolicy sync_policy ;
   QmTime::DisconnectionPolicy disconn_policy ;
 
@@ -89,9 +91,26 @@ class MeeGo::QmTimePrivate2 : public QObject
   void process_timed_info(const Maemo::Timed::WallClock::Info &wc_info, bool system_time, bool need_signal) ;
   bool syncronize_timed_info() ;
 
+  // Asynchronous policy
+  unsigned info_serial ; // settings signals received so far
+  void request_timed_info() ;
+  struct pending_settings_t
+  {
+    enum { TimeUnchanged, TimeNitz, TimeManual, TimeSet } time_mode ;
+    time_t time ;
+    enum { ZoneUnchanged, ZoneCellular, ZoneManual } zone_mode ;
+    QString zone ;
+    pending_settings_t() : time_mode(TimeUnchanged), time(0), zone_mode(ZoneUnchanged) { }
+  } pending ;
+  bool flush_scheduled ;
+  void schedule_settings() ;
+
   // helpers
-  class TzWrapper ;
   static bool remote_time(const char *tz, time_t t, QDateTime *qdt, struct tm *tm) ;
+  static string remote_tz(const QString &tz) ;
+  static const QmTimeZone *remote_zone(const QString &tz) ;
+  static int zone_offset(const string &tz, time_t t) ;
+  static bool remote_batch(const QVector<QPair<QString, time_t> > &moments, int *offsets, struct tm *tm) ;
 
   void emit_signal(bool) ;
 signals:
@@ -100,20 +119,10 @@ signals:
 #endif
   void change_signal(MeeGo::QmTime::WhatChanged) ;
 private slots:
-  void timed_signal(const Maemo::Timed::WallClock::Info &wc_info, bool system_time_changed) { process_timed_info(wc_info, system_time_changed, true) ; }
-} ;
-
-class MeeGo::QmTimePrivate2::TzWrapper
-{
-  static QMutex mutex ;
-  string saved_tz ;
-  bool set_timezone ;
-  bool valid ;
-  static bool set_tz_env(const char *tz) ;
-public:
-  TzWrapper(const char *tz) ;
- ~TzWrapper() ;
-  bool is_valid() { return valid ; }
+  void timed_signal(const Maemo::Timed::WallClock::Info &wc_info, bool system_time_changed) { ++ info_serial ; process_timed_info(wc_info, system_time_changed, true) ; }
+  void timed_info_received(QDBusPendingCallWatcher *watcher) ;
+  void flush_settings() ;
+  void settings_written(QDBusPendingCallWatcher *watcher) ;
 } ;
 
 #endif // QMTIME_P_H
@@ -0,0 +1,638 @@
+/*!
+ * @file qmtimezone.cpp
+ * @brief QmTimeZone
+ *
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <limits>
+
+#include <QAtomicPointer>
+#include <QMutex>
+
+#if !defined(HAVE_QMLOG)
+    #define log_debug(...) do {} while (0)
+    #define log_info(...) do {} while (0)
+    #define log_notice(...) do {} while (0)
+    #define log_warning(...) do {} while (0)
+    #define log_error(...) do {} while (0)
+    #define log_critical(...) do {} while (0)
+#else
+    #include <qmlog>
+#endif
+
+#include "qmtimezone_p.h"
+
+#define TZ_DEFAULT_FILE "/etc/localtime"
+#define TZ_MAX_FILE_SIZE (1<<20)
+#define TZ_TABLE_SIZE 1024
+
+// The zones by TZ value, an open addressing table filled with
+//   compare-and-swap: the lookups take no lock
+static QAtomicPointer<MeeGo::QmTimeZone> zone_table[TZ_TABLE_SIZE] ;
+// Only used if the table is full
+static QMutex overflow_mutex ;
+static vector<MeeGo::QmTimeZone*> overflow_zones ;
+// /etc/localtime
+static QAtomicPointer<MeeGo::QmTimeZone> system_zone ;
+
+static unsigned hash_name(const char *s)
+{
+  unsigned h = 2166136261u ;
+  for (; *s!='\0'; ++s)
+    h = (h ^ (unsigned char)*s) * 16777619u ;
+  return h ;
+}
+
+static qint64 read_be(const unsigned char *p, int size)
+{
+  quint64 x = 0 ;
+  for (int i=0; i<size; ++i)
+    x = x<<8 | p[i] ;
+  if (size<8 and (x & (Q_UINT64_C(1) << (8*size-1))))
+    x |= ~Q_UINT64_C(0) << (8*size) ;
+  return (qint64)x ;
+}
+
+struct by_time
+{
+  const time_t *t ;
+  by_time(const time_t *t) : t(t) { }
+  bool operator()(int a, int b) const { return t[a]<t[b] ; }
+} ;
+
+static bool is_leap(int year)
+{
+  return year%4==0 and (year%100!=0 or year%400==0) ;
+}
+
+// Days from 1970-01-01 to the given date of the proleptic Gregorian calendar
+static qint64 days_from_civil(qint64 y, int m, int d)
+{
+  y -= m<=2 ;
+  qint64 era = (y>=0 ? y : y-399) / 400 ;
+  qint64 yoe = y - era*400 ;
+  qint64 doy = (153*(m>2 ? m-3 : m+9) + 2)/5 + d-1 ;
+  qint64 doe = yoe*365 + yoe/4 - yoe/100 + doy ;
+  return era*146097 + doe - 719468 ;
+}
+
+static int year_from_days(qint64 z)
+{
+  z += 719468 ;
+  qint64 era = (z>=0 ? z : z-146096) / 146097 ;
+  qint64 doe = z - era*146097 ;
+  qint64 yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365 ;
+  qint64 doy = doe - (365*yoe + yoe/4 - yoe/100) ;
+  qint64 mp = (5*doy + 2)/153 ;
+  return yoe + era*400 + (mp>=10) ;
+}
+
+static bool parse_number(const char *&s, int max, int &value)
+{
+  if (not isdigit((unsigned char)*s))
+    return false ;
+  for (value=0; isdigit((unsigned char)*s); ++s)
+    if ((value = value*10 + (*s-'0')) > max)
+      return false ;
+  return true ;
+}
+
+// [+-]hh[:mm[:ss]], in seconds
+static bool parse_hms(const char *&s, int max_hours, int &secs)
+{
+  int sign = 1, h, m = 0, sec = 0 ;
+  if (*s=='+' or *s=='-')
+    sign = *s++=='-' ? -1 : 1 ;
+  if (not parse_number(s, max_hours, h))
+    return false ;
+  if (*s==':')
+  {
+    if (not parse_number(++s, 59, m))
+      return false ;
+    if (*s==':' and not parse_number(++s, 59, sec))
+      return false ;
+  }
+  secs = sign * (h*3600 + m*60 + sec) ;
+  return true ;
+}
+
+static bool parse_abbr(const char *&s, string &abbr)
+{
+  const char *begin = s ;
+  if (*s=='<')
+  {
+    for (begin = ++s; *s!='\0' and *s!='>'; ++s)
+      ;
+    if (*s!='>')
+      return false ;
+    abbr.assign(begin, s++ - begin) ;
+  }
+  else
+  {
+    while (isalpha((unsigned char)*s))
+      ++s ;
+    abbr.assign(begin, s - begin) ;
+  }
+  return abbr.size()>=3 ;
+}
+
+const MeeGo::QmTimeZone *MeeGo::QmTimeZone::find(const char *tz)
+{
+  MeeGo::QmTimeZone *fresh = NULL ;
+
+  if (tz==NULL)
+  {
+    for (;;)
+    {
+      MeeGo::QmTimeZone *zone = system_zone ;
+      if (zone!=NULL)
+      {
+        delete fresh ;
+        return zone ;
+      }
+      if (fresh==NULL)
+        fresh = create(NULL) ;
+      if (system_zone.testAndSetOrdered(NULL, fresh))
+        return fresh ;
+    }
+  }
+
+  unsigned h = hash_name(tz) ;
+  for (int i=0; i<TZ_TABLE_SIZE; ++i)
+  {
+    QAtomicPointer<MeeGo::QmTimeZone> &slot = zone_table[(h+i) % TZ_TABLE_SIZE] ;
+    for (;;)
+    {
+      MeeGo::QmTimeZone *zone = slot ;
+      if (zone==NULL)
+      {
+        if (fresh==NULL)
+          fresh = create(tz) ;
+        if (slot.testAndSetOrdered(NULL, fresh))
+          return fresh ;
+        continue ; // taken meanwhile, maybe by the same zone
+      }
+      if (zone->name==tz)
+      {
+        delete fresh ;
+        return zone ;
+      }
+      break ;
+    }
+  }
+
+  QMutexLocker locker(&overflow_mutex) ;
+  for (unsigned i=0; i<overflow_zones.size(); ++i)
+  {
+    if (overflow_zones[i]->name==tz)
+    {
+      delete fresh ;
+      return overflow_zones[i] ;
+    }
+  }
+  if (fresh==NULL)
+    fresh = create(tz) ;
+  overflow_zones.push_back(fresh) ;
+  return fresh ;
+}
+
+void MeeGo::QmTimeZone::system_zone_changed()
+{
+  // The old zone is not deleted: another thread may be converting with it
+  system_zone.fetchAndStoreOrdered(NULL) ;
+}
+
+MeeGo::QmTimeZone::QmTimeZone(const string &name) : name(name), has_rule(false)
+{
+}
+
+MeeGo::QmTimeZone *MeeGo::QmTimeZone::create(const char *tz)
+{
+  MeeGo::QmTimeZone *zone = new MeeGo::QmTimeZone(tz ?: "") ;
+
+  if (tz==NULL)
+  {
+    if (not zone->load_file(TZ_DEFAULT_FILE))
+      zone->set_utc() ;
+    return zone ;
+  }
+
+  // As in the C library: ":name" is a file, "name" a file or a POSIX rule
+  bool file_only = *tz==':' ;
+  const char *spec = file_only ? tz+1 : tz ;
+  if (*spec=='\0')
+  {
+    zone->set_utc() ;
+    return zone ;
+  }
+
+  string path = spec ;
+  if (*spec!='/')
+  {
+    const char *dir = getenv("TZDIR") ;
+    path = (string)(dir and *dir ? dir : TZ_DEFAULT_DIR) + "/" + spec ;
+  }
+  bool escapes = *spec!='/' and strstr(spec, "..")!=NULL ;
+  if (not escapes and zone->load_file(path))
+    return zone ;
+
+  if (not file_only and zone->rule.parse(spec))
+  {
+    zone->times.clear() ;
+    zone->indices.clear() ;
+    zone->types.clear() ;
+    zone->has_rule = true ;
+    return zone ;
+  }
+
+  log_warning("unknown time zone '%s', using UTC", tz) ;
+  zone->set_utc() ;
+  return zone ;
+}
+
+void MeeGo::QmTimeZone::set_utc()
+{
+  times.clear() ;
+  indices.clear() ;
+  types.clear() ;
+  has_rule = false ;
+  abbrs = "UTC" ;
+  type_t utc = { 0, false, abbrs.c_str() } ;
+  types.push_back(utc) ;
+}
+
+bool MeeGo::QmTimeZone::load_file(const string &path)
+{
+  int fd = open(path.c_str(), O_RDONLY) ;
+  if (fd<0)
+    return false ;
+
+  string data ;
+  char buf[4096] ;
+  ssize_t n ;
+  while ((n = read(fd, buf, sizeof(buf)))!=0 and data.size()<TZ_MAX_FILE_SIZE)
+  {
+    if (n<0 and errno==EINTR)
+      continue ;
+    if (n<0)
+      break ;
+    data.append(buf, n) ;
+  }
+  close(fd) ;
+
+  if (n!=0 or not parse_tzif(data))
+  {
+    log_error("can't read time zone file '%s'", path.c_str()) ;
+    return false ;
+  }
+  return true ;
+}
+
+bool MeeGo::QmTimeZone::parse_tzif(const string &data)
+{
+  struct header_t
+  {
+    char version ;
+    qint64 isutcnt, isstdcnt, leapcnt, timecnt, typecnt, charcnt ;
+    bool read(const unsigned char *&p, const unsigned char *end)
+    {
+      if (end-p < 44 or memcmp(p, "TZif", 4)!=0)
+        return false ;
+      version = p[4] ;
+      qint64 *counts[] = { &isutcnt, &isstdcnt, &leapcnt, &timecnt, &typecnt, &charcnt } ;
+      for (int i=0; i<6; ++i)
+        *counts[i] = (quint32)read_be(p + 20 + 4*i, 4) ;
+      p += 44 ;
+      return true ;
+    }
+    qint64 data_size(int time_size) const
+    {
+      return timecnt*(time_size+1) + typecnt*6 + charcnt + leapcnt*(time_size+4) + isstdcnt + isutcnt ;
+    }
+  } h ;
+
+  const unsigned char *p = (const unsigned char *)data.data(), *end = p + data.size() ;
+  if (not h.read(p, end))
+    return false ;
+
+  // Version 2 repeats the data with 64 bit times, followed by the rule
+  int time_size = 4 ;
+  if (h.version>='2')
+  {
+    if (end-p < h.data_size(4))
+      return false ;
+    p += h.data_size(4) ;
+    if (not h.read(p, end))
+      return false ;
+    time_size = 8 ;
+  }
+  if (end-p < h.data_size(time_size) or h.typecnt==0 or h.charcnt==0)
+    return false ;
+
+  times.resize(h.timecnt) ;
+  for (int i=0; i<h.timecnt; ++i, p+=time_size)
+  {
+    times[i] = read_be(p, time_size) ;
+    if (i>0 and times[i]<=times[i-1])
+      return false ;
+  }
+  indices.assign(p, p + h.timecnt) ;
+  p += h.timecnt ;
+  for (int i=0; i<h.timecnt; ++i)
+    if (indices[i]>=h.typecnt)
+      return false ;
+
+  vector<int> abbr_index(h.typecnt) ;
+  types.resize(h.typecnt) ;
+  for (int i=0; i<h.typecnt; ++i, p+=6)
+  {
+    types[i].gmtoff = read_be(p, 4) ;
+    types[i].isdst = p[4]!=0 ;
+    abbr_index[i] = p[5] ;
+    if (abbr_index[i]>=h.charcnt)
+      return false ;
+  }
+  abbrs.assign((const char *)p, h.charcnt) ;
+  for (int i=0; i<h.typecnt; ++i)
+    types[i].abbr = abbrs.c_str() + abbr_index[i] ;
+  p += h.charcnt + h.leapcnt*(time_size+4) + h.isstdcnt + h.isutcnt ;
+
+  // "\nrule\n", possibly empty
+  has_rule = false ;
+  if (time_size==8 and p<end and *p=='\n')
+  {
+    const unsigned char *rule_end = (const unsigned char *)memchr(p+1, '\n', end-p-1) ;
+    string footer(p+1, rule_end ?: p+1) ;
+    if (not footer.empty())
+    {
+      has_rule = rule.parse(footer.c_str()) ;
+      if (not has_rule)
+        log_warning("can't parse time zone rule '%s'", footer.c_str()) ;
+    }
+  }
+
+  return true ;
+}
+
+MeeGo::QmTimeZone::type_t MeeGo::QmTimeZone::type(qint64 t) const
+{
+  if (has_rule and (times.empty() or t>=times.back()))
+  {
+    rule_t::year_t cache = { INT_MIN, 0, 0 } ;
+    return rule.type(t, cache) ;
+  }
+  // Before the first transition the first type applies
+  if (times.empty() or t<times[0])
+    return types[0] ;
+  size_t i = upper_bound(times.begin(), times.end(), t) - times.begin() - 1 ;
+  return types[indices[i]] ;
+}
+
+void MeeGo::QmTimeZone::lookup(const time_t *t, int count, type_t *out) const
+{
+  vector<int> order(count) ;
+  bool ascending = true ;
+  for (int i=0; i<count; ++i)
+  {
+    order[i] = i ;
+    ascending = ascending and (i==0 or t[i-1]<=t[i]) ;
+  }
+  if (not ascending)
+    stable_sort(order.begin(), order.end(), by_time(t)) ;
+
+  size_t next = 0 ; // the first transition after the previous time
+  rule_t::year_t cache = { INT_MIN, 0, 0 } ;
+  for (int k=0; k<count; ++k)
+  {
+    int i = order[k] ;
+    qint64 x = t[i] ;
+    if (has_rule and (times.empty() or x>=times.back()))
+      out[i] = rule.type(x, cache) ;
+    else if (times.empty() or x<times[0])
+      out[i] = types[0] ;
+    else
+    {
+      if (next<times.size() and times[next]<=x)
+        next = upper_bound(times.begin()+next, times.end(), x) - times.begin() ;
+      out[i] = types[indices[next-1]] ;
+    }
+  }
+}
+
+bool MeeGo::QmTimeZone::broken_down(time_t t, const type_t &ty, struct tm *tm)
+{
+  qint64 local = (qint64)t + ty.gmtoff ;
+  time_t local_t = (time_t)local ;
+  if ((qint64)local_t!=local or gmtime_r(&local_t, tm)!=tm)
+    return false ;
+  tm->tm_isdst = ty.isdst ;
+  tm->tm_gmtoff = ty.gmtoff ;
+  tm->tm_zone = ty.abbr ;
+  return true ;
+}
+
+bool MeeGo::QmTimeZone::convert(time_t t, struct tm *tm) const
+{
+  return broken_down(t, type(t), tm) ;
+}
+
+int MeeGo::QmTimeZone::offset(time_t t) const
+{
+  return type(t).gmtoff ;
+}
+
+bool MeeGo::QmTimeZone::convert(const time_t *t, int count, struct tm *tm) const
+{
+  if (count<=0)
+    return true ;
+  vector<type_t> found(count) ;
+  lookup(t, count, &found[0]) ;
+  bool res = true ;
+  for (int i=0; i<count; ++i)
+    res = broken_down(t[i], found[i], tm+i) and res ;
+  return res ;
+}
+
+void MeeGo::QmTimeZone::offsets(const time_t *t, int count, int *gmtoff) const
+{
+  if (count<=0)
+    return ;
+  vector<type_t> found(count) ;
+  lookup(t, count, &found[0]) ;
+  for (int i=0; i<count; ++i)
+    gmtoff[i] = found[i].gmtoff ;
+}
+
+// The offset from the beginning of time, then each time it changes, until the given time
+void MeeGo::QmTimeZone::offset_changes(qint64 until, vector<qint64> &starts, vector<int> &offsets) const
+{
+  vector<qint64> points ;
+  for (size_t i=0; i<times.size() and times[i]<until; ++i)
+    points.push_back(times[i]) ;
+
+  if (has_rule and rule.has_dst)
+  {
+    qint64 from = times.empty() ? 0 : times.back() ;
+    int first_year = year_from_days(from/86400 - (from%86400<0)) ;
+    int last_year = year_from_days((until-1)/86400) ;
+    for (int year=first_year; year<=last_year; ++year)
+    {
+      qint64 change[] =
+      {
+        rule_t::date_time(year, rule.start) + rule.start.secs - rule.std_gmtoff,
+        rule_t::date_time(year, rule.end) + rule.end.secs - rule.dst_gmtoff
+      } ;
+      for (int k=0; k<2; ++k)
+        if (from<change[k] and change[k]<until)
+          points.push_back(change[k]) ;
+    }
+    sort(points.begin(), points.end()) ;
+  }
+
+  starts.assign(1, numeric_limits<qint64>::min()) ;
+  offsets.assign(1, type(points.empty() ? 0 : points[0]-1).gmtoff) ;
+  for (size_t i=0; i<points.size(); ++i)
+  {
+    int gmtoff = type(points[i]).gmtoff ;
+    if (gmtoff!=offsets.back())
+    {
+      starts.push_back(points[i]) ;
+      offsets.push_back(gmtoff) ;
+    }
+  }
+}
+
+bool MeeGo::QmTimeZone::rule_t::parse(const char *s)
+{
+  int off ;
+  has_dst = false ;
+  if (not parse_abbr(s, std_abbr) or not parse_hms(s, 24, off))
+    return false ;
+  std_gmtoff = -off ; // POSIX counts west of Greenwich
+  if (*s=='\0')
+    return true ;
+
+  if (not parse_abbr(s, dst_abbr))
+    return false ;
+  dst_gmtoff = std_gmtoff + 3600 ;
+  if (*s!=',' and *s!='\0')
+  {
+    if (not parse_hms(s, 24, off))
+      return false ;
+    dst_gmtoff = -off ;
+  }
+  has_dst = true ;
+
+  if (*s=='\0') // the US rules, as by default in the C library
+  {
+    date_t march = { 'M', 0, 3, 2, 0, 7200 }, november = { 'M', 0, 11, 1, 0, 7200 } ;
+    start = march ;
+    end = november ;
+    return true ;
+  }
+  if (*s++!=',' or not parse_date(s, start) or *s++!=',' or not parse_date(s, end))
+    return false ;
+  return *s=='\0' ;
+}
+
+bool MeeGo::QmTimeZone::rule_t::parse_date(const char *&s, date_t &d)
+{
+  d.n = d.month = d.week = d.day = 0 ;
+  if (*s=='J')
+  {
+    d.kind = 'J' ;
+    if (not parse_number(++s, 365, d.n) or d.n<1)
+      return false ;
+  }
+  else if (*s=='M')
+  {
+    d.kind = 'M' ;
+    if (not parse_number(++s, 12, d.month) or d.month<1 or *s!='.')
+      return false ;
+    if (not parse_number(++s, 5, d.week) or d.week<1 or *s!='.')
+      return false ;
+    if (not parse_number(++s, 6, d.day))
+      return false ;
+  }
+  else
+  {
+    d.kind = 'N' ;
+    if (not parse_number(s, 365, d.n))
+      return false ;
+  }
+
+  d.secs = 7200 ;
+  if (*s=='/')
+    return parse_hms(++s, 167, d.secs) ;
+  return true ;
+}
+
+// Local midnight of the day the date falls on in the year, as seconds from the epoch
+qint64 MeeGo::QmTimeZone::rule_t::date_time(int year, const date_t &d)
+{
+  static const int month_days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 } ;
+  bool leap = is_leap(year) ;
+  qint64 day ;
+  if (d.kind=='J')
+    day = days_from_civil(year, 1, 1) + d.n-1 + (leap and d.n>=60) ;
+  else if (d.kind=='N')
+    day = days_from_civil(year, 1, 1) + d.n ;
+  else
+  {
+    qint64 first = days_from_civil(year, d.month, 1) ;
+    int wday = ((first+4) % 7 + 7) % 7 ; // 1970-01-01 was a Thursday
+    int length = month_days[d.month-1] + (leap and d.month==2) ;
+    int mday = 1 + (d.day - wday + 7) % 7 + (d.week-1)*7 ;
+    while (mday>length)
+      mday -= 7 ;
+    day = first + mday-1 ;
+  }
+  return day * 86400 ;
+}
+
+MeeGo::QmTimeZone::type_t MeeGo::QmTimeZone::rule_t::type(qint64 t, year_t &cache) const
+{
+  type_t std_type = { std_gmtoff, false, std_abbr.c_str() } ;
+  if (not has_dst)
+    return std_type ;
+  type_t dst_type = { dst_gmtoff, true, dst_abbr.c_str() } ;
+
+  qint64 local = t + std_gmtoff ;
+  int year = year_from_days(local/86400 - (local%86400<0)) ;
+  if (cache.year!=year)
+  {
+    cache.year = year ;
+    cache.start = date_time(year, start) + start.secs - std_gmtoff ;
+    cache.end = date_time(year, end) + end.secs - dst_gmtoff ;
+  }
+
+  // Southern hemisphere rules end the summer time before starting it again
+  bool dst = cache.start<cache.end ? cache.start<=t and t<cache.end : not (cache.end<=t and t<cache.start) ;
+  return dst ? dst_type : std_type ;
+}
@@ -0,0 +1,119 @@
+/*!
+ * @file qmtimezone_p.h
+ * @brief Contains QmTimeZone, the time zone conversions of QmTime
+ *
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   @scope Private
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+#ifndef QMTIMEZONE_P_H
+#define QMTIMEZONE_P_H
+
+#include <time.h>
+
+#include <string>
+#include <vector>
+using namespace std ;
+
+#include <QtGlobal>
+
+#define TZ_DEFAULT_DIR "/usr/share/zoneinfo"
+
+namespace MeeGo { class QmTimeZone ; class QmTimeZoneIndex ; }
+
+// A time zone read from a tzfile(5) of the zoneinfo database, or given
+//   as a POSIX TZ rule, as localtime_r() would do it for the same TZ value.
+// The zones are parsed once and then kept for the life of the process,
+//   they are never modified, so any thread may use them without locking.
+// Leap seconds of the "right/" zones are not applied.
+
+class MeeGo::QmTimeZone
+{
+  friend class MeeGo::QmTimeZoneIndex ;
+public:
+  // The zone of a TZ value: NULL means TZ is unset, i.e. /etc/localtime
+  //   and "" means UTC. Unknown zones are UTC, as in the C library.
+  static const QmTimeZone *find(const char *tz) ;
+  // Forgets /etc/localtime, to be read again at the next use
+  static void system_zone_changed() ;
+
+  // Local time at t, as by localtime_r() with this zone
+  bool convert(time_t t, struct tm *tm) const ;
+  // Offset from UTC at t, in seconds east
+  int offset(time_t t) const ;
+
+  // The same for count times at once: the times are taken in ascending
+  //   order, so that the transitions are walked only once
+  bool convert(const time_t *t, int count, struct tm *tm) const ;
+  void offsets(const time_t *t, int count, int *gmtoff) const ;
+
+private:
+  struct type_t
+  {
+    int gmtoff ;
+    bool isdst ;
+    const char *abbr ;
+  } ;
+
+  // The POSIX TZ rule, in force after the last transition
+  struct rule_t
+  {
+    struct date_t
+    {
+      char kind ; // 'J': Julian day without Feb 29, 'N': day of year from 0, 'M': month.week.day
+      int n, month, week, day ;
+      int secs ; // local time of the change
+    } ;
+    // The changes of one year, in UTC
+    struct year_t
+    {
+      int year ;
+      qint64 start, end ;
+    } ;
+    string std_abbr, dst_abbr ;
+    int std_gmtoff, dst_gmtoff ;
+    bool has_dst ;
+    date_t start, end ;
+    bool parse(const char *s) ;
+    type_t type(qint64 t, year_t &cache) const ;
+    static bool parse_date(const char *&s, date_t &d) ;
+    static qint64 date_time(int year, const date_t &d) ;
+  } ;
+
+  string name ;
+  vector<qint64> times ;        // transitions, ascending
+  vector<unsigned char> indices ; // type in force from each transition on
+  vector<type_t> types ;
+  string abbrs ;                // the abbreviations the types point into
+  bool has_rule ;
+  rule_t rule ;
+
+  QmTimeZone(const string &name) ;
+  bool load_file(const string &path) ;
+  bool parse_tzif(const string &data) ;
+  void set_utc() ;
+  type_t type(qint64 t) const ;
+  void lookup(const time_t *t, int count, type_t *out) const ;
+  static bool broken_down(time_t t, const type_t &ty, struct tm *tm) ;
+  void offset_changes(qint64 until, vector<qint64> &starts, vector<int> &offsets) const ;
+
+  static QmTimeZone *create(const char *tz) ;
+} ;
+
+#endif // QMTIMEZONE_P_H
@@ -0,0 +1,350 @@
+/*!
+ * @file qmtimezoneindex.cpp
+ * @brief QmTimeZoneIndex
+ *
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+
+#if !defined(HAVE_QMLOG)
+    #define log_debug(...) do {} while (0)
+    #define log_info(...) do {} while (0)
+    #define log_notice(...) do {} while (0)
+    #define log_warning(...) do {} while (0)
+    #define log_error(...) do {} while (0)
+    #define log_critical(...) do {} while (0)
+#else
+    #include <qmlog>
+#endif
+
+#include "qmtimezone_p.h"
+#include "qmtimezoneindex_p.h"
+
+#define TZ_INDEX_MAGIC "QMTZIDX1"
+#define TZ_INDEX_FILE "qmsystem-tzindex"
+#define TZ_INDEX_BYTE_ORDER 0x01020304
+#define TZ_INDEX_UNTIL Q_INT64_C(2145916800) // 2038-01-01 00:00:00 UTC
+
+static QAtomicPointer<MeeGo::QmTimeZoneIndex> the_index ;
+static QAtomicInt index_started ;
+
+static void *load_index(void *)
+{
+  MeeGo::QmTimeZoneIndex::load() ;
+  return NULL ;
+}
+
+const MeeGo::QmTimeZoneIndex *MeeGo::QmTimeZoneIndex::get()
+{
+  MeeGo::QmTimeZoneIndex *index = the_index ;
+  if (index!=NULL or not index_started.testAndSetOrdered(0, 1))
+    return index ;
+
+  // Scanning the zoneinfo takes seconds on a cold cache, the callers
+  //   parse their zones meanwhile
+  pthread_attr_t attr ;
+  pthread_t thread ;
+  pthread_attr_init(&attr) ;
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED) ;
+  int error = pthread_create(&thread, &attr, load_index, NULL) ;
+  pthread_attr_destroy(&attr) ;
+  if (error!=0)
+  {
+    log_warning("can't start indexing the time zones: %s", strerror(error)) ;
+    load() ;
+  }
+  return the_index ;
+}
+
+void MeeGo::QmTimeZoneIndex::load()
+{
+  string dir = zoneinfo_dir(), path = cache_path() ;
+  qint64 stamp = scan(dir, "", NULL) ;
+  const char *data = path.empty() ? NULL : map_file(path, dir, stamp) ;
+  if (data==NULL)
+  {
+    string built = build(dir, stamp) ;
+    if (built.empty())
+    {
+      log_error("can't index the time zones of '%s'", dir.c_str()) ;
+      return ;
+    }
+    if (not path.empty() and save(path, built))
+      data = map_file(path, dir, stamp) ;
+    if (data==NULL) // not cached, kept for this process only
+    {
+      char *copy = new char[built.size()] ;
+      memcpy(copy, built.data(), built.size()) ;
+      data = copy ;
+    }
+  }
+
+  // Like the zones, the index is kept for the life of the process
+  the_index.fetchAndStoreOrdered(new MeeGo::QmTimeZoneIndex(data)) ;
+}
+
+MeeGo::QmTimeZoneIndex::QmTimeZoneIndex(const char *data)
+{
+  header = (const header_t *)data ;
+  zones = (const zone_t *)(header + 1) ;
+  starts = (const qint64 *)(zones + header->zone_count) ;
+  offsets = (const qint32 *)(starts + header->interval_count) ;
+  names = (const char *)(offsets + header->interval_count) ;
+}
+
+bool MeeGo::QmTimeZoneIndex::offset(const char *zone, time_t t, int &gmtoff) const
+{
+  if ((qint64)t>=header->until)
+    return false ;
+
+  quint32 lo = 0, hi = header->zone_count ;
+  while (lo<hi)
+  {
+    quint32 mid = lo + (hi-lo)/2 ;
+    if (strcmp(names + zones[mid].name, zone)<0)
+      lo = mid + 1 ;
+    else
+      hi = mid ;
+  }
+  if (lo==header->zone_count or strcmp(names + zones[lo].name, zone)!=0)
+    return false ;
+
+  // The first interval starts at the beginning of time
+  const qint64 *begin = starts + zones[lo].first, *end = begin + zones[lo].count ;
+  gmtoff = offsets[upper_bound(begin, end, (qint64)t) - starts - 1] ;
+  return true ;
+}
+
+string MeeGo::QmTimeZoneIndex::zoneinfo_dir()
+{
+  const char *dir = getenv("TZDIR") ;
+  return dir and *dir ? dir : TZ_DEFAULT_DIR ;
+}
+
+string MeeGo::QmTimeZoneIndex::cache_path()
+{
+  const char *path = getenv(TZ_INDEX_ENV) ;
+  if (path!=NULL)
+    return path ; // empty: not cached
+
+  const char *cache = getenv("XDG_CACHE_HOME") ;
+  if (cache!=NULL and *cache!='\0')
+    return (string)cache + "/" + TZ_INDEX_FILE ;
+  const char *home = getenv("HOME") ;
+  if (home!=NULL and *home!='\0')
+    return (string)home + "/.cache/" + TZ_INDEX_FILE ;
+  return "" ;
+}
+
+// The newest modification time of the directories, and the files found if wanted
+qint64 MeeGo::QmTimeZoneIndex::scan(const string &dir, const string &prefix, vector<string> *files)
+{
+  struct stat st ;
+  if (stat(dir.c_str(), &st)<0)
+    return -1 ;
+  qint64 newest = st.st_mtime ;
+
+  DIR *d = opendir(dir.c_str()) ;
+  if (d==NULL)
+    return newest ;
+  while (struct dirent *e = readdir(d))
+  {
+    string name = e->d_name ;
+    if (name[0]=='.')
+      continue ;
+    // Copies of the zones, and the ones with leap seconds
+    if (prefix.empty() and (name=="posix" or name=="right"))
+      continue ;
+
+    // Linked directories are not followed
+    string path = dir + "/" + name ;
+    bool is_dir = e->d_type==DT_DIR ;
+    if (e->d_type==DT_UNKNOWN)
+      is_dir = lstat(path.c_str(), &st)==0 and S_ISDIR(st.st_mode) ;
+
+    if (is_dir)
+      newest = max(newest, scan(path, prefix + name + "/", files)) ;
+    else if (files!=NULL)
+      files->push_back(prefix + name) ;
+  }
+  closedir(d) ;
+  return newest ;
+}
+
+bool MeeGo::QmTimeZoneIndex::is_tzif(const string &path)
+{
+  int fd = open(path.c_str(), O_RDONLY) ;
+  if (fd<0)
+    return false ;
+  char magic[4] ;
+  bool res = read(fd, magic, 4)==4 and memcmp(magic, "TZif", 4)==0 ;
+  close(fd) ;
+  return res ;
+}
+
+string MeeGo::QmTimeZoneIndex::build(const string &dir, qint64 stamp)
+{
+  vector<string> files ;
+  scan(dir, "", &files) ;
+  sort(files.begin(), files.end()) ; // as by strcmp()
+
+  vector<zone_t> zone_list ;
+  vector<qint64> all_starts ;
+  vector<qint32> all_offsets ;
+  string all_names = dir + '\0' ;
+  for (size_t i=0; i<files.size(); ++i)
+  {
+    string path = dir + "/" + files[i] ;
+    MeeGo::QmTimeZone zone(files[i]) ;
+    if (not is_tzif(path) or not zone.load_file(path))
+      continue ;
+
+    vector<qint64> zone_starts ;
+    vector<int> zone_offsets ;
+    zone.offset_changes(TZ_INDEX_UNTIL, zone_starts, zone_offsets) ;
+
+    zone_t z = { (quint32)all_names.size(), (quint32)all_starts.size(), (quint32)zone_starts.size(), 0 } ;
+    zone_list.push_back(z) ;
+    all_names += files[i] + '\0' ;
+    all_starts.insert(all_starts.end(), zone_starts.begin(), zone_starts.end()) ;
+    all_offsets.insert(all_offsets.end(), zone_offsets.begin(), zone_offsets.end()) ;
+  }
+  if (zone_list.empty())
+    return "" ;
+
+  header_t h ;
+  memset(&h, 0, sizeof(h)) ;
+  memcpy(h.magic, TZ_INDEX_MAGIC, sizeof(h.magic)) ;
+  h.byte_order = TZ_INDEX_BYTE_ORDER ;
+  h.zone_count = zone_list.size() ;
+  h.interval_count = all_starts.size() ;
+  h.names_size = all_names.size() ;
+  h.stamp = stamp ;
+  h.until = TZ_INDEX_UNTIL ;
+  h.dir = 0 ;
+
+  string data ((const char *)&h, sizeof(h)) ;
+  data.append((const char *)&zone_list[0], zone_list.size()*sizeof(zone_t)) ;
+  data.append((const char *)&all_starts[0], all_starts.size()*sizeof(qint64)) ;
+  data.append((const char *)&all_offsets[0], all_offsets.size()*sizeof(qint32)) ;
+  data.append(all_names) ;
+  log_info("indexed %d time zones, %d offset intervals", h.zone_count, h.interval_count) ;
+  return data ;
+}
+
+bool MeeGo::QmTimeZoneIndex::save(const string &path, const string &data)
+{
+  size_t slash = path.rfind('/') ;
+  if (slash!=string::npos and slash>0)
+    mkdir(path.substr(0, slash).c_str(), 0700) ;
+
+  // Written aside and renamed, as other processes may be mapping it
+  char suffix[32] ;
+  snprintf(suffix, sizeof(suffix), ".%d", (int)getpid()) ;
+  string tmp = path + suffix ;
+  int fd = open(tmp.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644) ;
+  if (fd<0)
+  {
+    log_warning("can't save the time zone index to '%s': %s", path.c_str(), strerror(errno)) ;
+    return false ;
+  }
+
+  size_t done = 0 ;
+  while (done<data.size())
+  {
+    ssize_t n = write(fd, data.data()+done, data.size()-done) ;
+    if (n<0 and errno==EINTR)
+      continue ;
+    if (n<=0)
+      break ;
+    done += n ;
+  }
+  bool res = close(fd)==0 and done==data.size() and rename(tmp.c_str(), path.c_str())==0 ;
+  if (not res)
+  {
+    log_warning("can't save the time zone index to '%s': %s", path.c_str(), strerror(errno)) ;
+    unlink(tmp.c_str()) ;
+  }
+  return res ;
+}
+
+const char *MeeGo::QmTimeZoneIndex::map_file(const string &path, const string &dir, qint64 stamp)
+{
+  int fd = open(path.c_str(), O_RDONLY) ;
+  if (fd<0)
+    return NULL ;
+
+  struct stat st ;
+  void *data = MAP_FAILED ;
+  if (fstat(fd, &st)==0 and st.st_size>=(off_t)sizeof(header_t))
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0) ;
+  close(fd) ;
+  if (data==MAP_FAILED)
+    return NULL ;
+
+  if (not is_valid((const char *)data, st.st_size, dir, stamp))
+  {
+    log_info("time zone index '%s' is out of date", path.c_str()) ;
+    munmap(data, st.st_size) ;
+    return NULL ;
+  }
+  return (const char *)data ;
+}
+
+bool MeeGo::QmTimeZoneIndex::is_valid(const char *data, qint64 size, const string &dir, qint64 stamp)
+{
+  const header_t *h = (const header_t *)data ;
+  if (memcmp(h->magic, TZ_INDEX_MAGIC, sizeof(h->magic))!=0 or h->byte_order!=TZ_INDEX_BYTE_ORDER)
+    return false ;
+  if (h->stamp!=stamp or h->until!=TZ_INDEX_UNTIL)
+    return false ;
+
+  qint64 expected = sizeof(header_t) + (qint64)h->zone_count*sizeof(zone_t)
+                  + (qint64)h->interval_count*(sizeof(qint64)+sizeof(qint32)) + h->names_size ;
+  if (size!=expected or h->names_size==0)
+    return false ;
+
+  const char *names = data + size - h->names_size ;
+  if (names[h->names_size-1]!='\0' or h->dir>=h->names_size or dir!=names + h->dir)
+    return false ;
+
+  const zone_t *zones = (const zone_t *)(h + 1) ;
+  for (quint32 i=0; i<h->zone_count; ++i)
+  {
+    const zone_t &z = zones[i] ;
+    if (z.name>=h->names_size or z.count==0 or z.first>=h->interval_count or z.count>h->interval_count-z.first)
+      return false ;
+  }
+  return true ;
+}
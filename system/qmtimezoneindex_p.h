@@ -0,0 +1,103 @@
+/*!
+ * @file qmtimezoneindex_p.h
+ * @brief Contains QmTimeZoneIndex, the UTC offsets of all the zones of the zoneinfo
+ *
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   @scope Private
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+#ifndef QMTIMEZONEINDEX_P_H
+#define QMTIMEZONEINDEX_P_H
+
+#include <time.h>
+
+#include <string>
+#include <vector>
+using namespace std ;
+
+#include <QtGlobal>
+
+// The file of the index, by default $XDG_CACHE_HOME/qmsystem-tzindex
+#define TZ_INDEX_ENV "QMSYSTEM_TZ_INDEX"
+
+namespace MeeGo { class QmTimeZoneIndex ; }
+
+// The UTC offsets of all the zones of the zoneinfo directory, as sorted
+//   intervals of constant offset, until the end of 2037.
+// The index is built at the first use, saved to a cache file and mapped
+//   from it by the next processes. It is built again when any zoneinfo
+//   directory has been modified after it. Once mapped it is never modified,
+//   so the lookups take no lock.
+// The first use only starts a thread that maps or builds the index, which
+//   takes seconds when the zoneinfo is not in the page cache: get() returns
+//   NULL until the index is ready, and the callers parse the zone instead.
+// File layout, in the byte order of the host:
+//   header_t, zone_t[zone_count] sorted by name, qint64 starts[interval_count],
+//   qint32 offsets[interval_count], names (NUL terminated)
+
+class MeeGo::QmTimeZoneIndex
+{
+public:
+  // The index, NULL while it is being built or if it can't be built
+  static const QmTimeZoneIndex *get() ;
+
+  // Maps or builds the index, run in its own thread by get()
+  static void load() ;
+
+  // Offset from UTC of a zoneinfo zone at t, in seconds east
+  //   False if the zone is not in the zoneinfo or t is not indexed
+  bool offset(const char *zone, time_t t, int &gmtoff) const ;
+
+private:
+  struct header_t
+  {
+    char magic[8] ;
+    quint32 byte_order ;
+    quint32 zone_count ;
+    quint32 interval_count ;
+    quint32 names_size ;
+    qint64 stamp ;   // the newest modification time of the zoneinfo directories
+    qint64 until ;   // the end of the indexed period
+    quint32 dir ;    // the zoneinfo directory, in the names
+    quint32 reserved ;
+  } ;
+  struct zone_t
+  {
+    quint32 name, first, count, reserved ;
+  } ;
+
+  const header_t *header ;
+  const zone_t *zones ;
+  const qint64 *starts ;
+  const qint32 *offsets ;
+  const char *names ;
+
+  QmTimeZoneIndex(const char *data) ;
+
+  static string zoneinfo_dir() ;
+  static string cache_path() ;
+  static qint64 scan(const string &dir, const string &prefix, vector<string> *files) ;
+  static bool is_tzif(const string &path) ;
+  static string build(const string &dir, qint64 stamp) ;
+  static bool save(const string &path, const string &data) ;
+  static const char *map_file(const string &path, const string &dir, qint64 stamp) ;
+  static bool is_valid(const char *data, qint64 size, const string &dir, qint64 stamp) ;
+} ;
+
+#endif // QMTIMEZONEINDEX_P_H
@@ -25,10 +25,9 @@
  */
 #include "qmusbmode.h"
 #include "qmusbmode_p.h"
+#include "qmsignalhub_p.h"
 
-#include <QDBusConnection>
 #include <QDBusMessage>
-#include <QDBusReply>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -52,6 +51,7 @@ QmUSBMode::QmUSBMode(QObject *parent) : QObject(parent) {
     MEEGO_INITIALIZE(QmUSBMode);
 
     connect(priv, SIGNAL(modeChanged(MeeGo::QmUSBMode::Mode)), this, SIGNAL(modeChanged(MeeGo::QmUSBMode::Mode)));
+    connect(priv, SIGNAL(modeReceived(MeeGo::QmUSBMode::Mode)), this, SIGNAL(modeReceived(MeeGo::QmUSBMode::Mode)));
     connect(priv, SIGNAL(fileSystemWillUnmount(MeeGo::QmUSBMode::MountPath)), this, SIGNAL(fileSystemWillUnmount(MeeGo::QmUSBMode::MountPath)));
     connect(priv, SIGNAL(error(const QString&)), this, SIGNAL(error(const QString&)));
 }
@@ -60,6 +60,7 @@ QmUSBMode::~QmUSBMode() {
     MEEGO_PRIVATE(QmUSBMode);
 
     disconnect(priv, SIGNAL(modeChanged(MeeGo::QmUSBMode::Mode)), this, SIGNAL(modeChanged(MeeGo::QmUSBMode::Mode)));
+    disconnect(priv, SIGNAL(modeReceived(MeeGo::QmUSBMode::Mode)), this, SIGNAL(modeReceived(MeeGo::QmUSBMode::Mode)));
     disconnect(priv, SIGNAL(fileSystemWillUnmount(MeeGo::QmUSBMode::MountPath)), this, SIGNAL(fileSystemWillUnmount(MeeGo::QmUSBMode::MountPath)));
     disconnect(priv, SIGNAL(error(const QString&)), this, SIGNAL(error(const QString&)));
 
@@ -75,22 +76,22 @@ void QmUSBMode::connectNotify(const char *signal) {
     if ((QLatin1String(signal) == QLatin1String(QMetaObject::normalizedSignature(SIGNAL(modeChanged(MeeGo::QmUSBMode::Mode))))) ||
         (QLatin1String(signal) == QLatin1String(QMetaObject::normalizedSignature(SIGNAL(fileSystemWillUnmount(MeeGo::QmUSBMode::MountPath)))))) {
         if (0 == priv->connectCount[SIGNAL_USB_MODE]) {
-            QDBusConnection::systemBus().connect(USB_MODE_SERVICE,
-                                                 USB_MODE_OBJECT,
-                                                 USB_MODE_INTERFACE,
-                                                 USB_MODE_SIGNAL_NAME,
-                                                 priv,
-                                                 SLOT(modeChanged(const QString&)));
+            QmSignalHub::connect(USB_MODE_SERVICE,
+                                 USB_MODE_OBJECT,
+                                 USB_MODE_INTERFACE,
+                                 USB_MODE_SIGNAL_NAME,
+                                 priv,
+                                 SLOT(modeChanged(const QString&)));
         }
         priv->connectCount[SIGNAL_USB_MODE]++;
     } else if (QLatin1String(signal) == QLatin1String(QMetaObject::normalizedSignature(SIGNAL(error(const QString&))))) {
         if (0 == priv->connectCount[SIGNAL_USB_ERROR]) {
-            QDBusConnection::systemBus().connect(USB_MODE_SERVICE,
-                                                 USB_MODE_OBJECT,
-                                                 USB_MODE_INTERFACE,
-                                                 USB_MODE_ERROR_SIGNAL_NAME,
-                                                 priv,
-                                                 SLOT(didReceiveError(const QString&)));
+            QmSignalHub::connect(USB_MODE_SERVICE,
+                                 USB_MODE_OBJECT,
+                                 USB_MODE_INTERFACE,
+                                 USB_MODE_ERROR_SIGNAL_NAME,
+                                 priv,
+                                 SLOT(didReceiveError(const QString&)));
         }
         priv->connectCount[SIGNAL_USB_ERROR]++;
     }
@@ -107,23 +108,23 @@ void QmUSBMode::disconnectNotify(const char *signal) {
         priv->connectCount[SIGNAL_USB_MODE]--;
 
         if (0 == priv->connectCount[SIGNAL_USB_MODE]) {
-            QDBusConnection::systemBus().disconnect(USB_MODE_SERVICE,
-                                                    USB_MODE_OBJECT,
-                                                    USB_MODE_INTERFACE,
-                                                    USB_MODE_SIGNAL_NAME,
-                                                    priv,
-                                                    SLOT(modeChanged(const QString&)));
+            QmSignalHub::disconnect(USB_MODE_SERVICE,
+                                    USB_MODE_OBJECT,
+                                    USB_MODE_INTERFACE,
+                                    USB_MODE_SIGNAL_NAME,
+                                    priv,
+                                    SLOT(modeChanged(const QString&)));
         }
     } else if (QLatin1String(signal) == QLatin1String(QMetaObject::normalizedSignature(SIGNAL(error(const QString&))))) {
         priv->connectCount[SIGNAL_USB_ERROR]--;
 
         if (0 == priv->connectCount[SIGNAL_USB_ERROR]) {
-            QDBusConnection::systemBus().disconnect(USB_MODE_SERVICE,
-                                                    USB_MODE_OBJECT,
-                                                    USB_MODE_INTERFACE,
-                                                    USB_MODE_ERROR_SIGNAL_NAME,
-                                                    priv,
-                                                    SLOT(didReceiveError(const QString&)));
+            QmSignalHub::disconnect(USB_MODE_SERVICE,
+                                    USB_MODE_OBJECT,
+                                    USB_MODE_INTERFACE,
+                                    USB_MODE_ERROR_SIGNAL_NAME,
+                                    priv,
+                                    SLOT(didReceiveError(const QString&)));
         }
     }
 }
@@ -131,15 +132,21 @@ void QmUSBMode::disconnectNotify(const char *signal) {
 QmUSBMode::Mode QmUSBMode::getMode() {
     MEEGO_PRIVATE(QmUSBMode);
 
-    QDBusReply<QString> usbModeReply = QDBusConnection::systemBus().call(
-                                           QDBusMessage::createMethodCall(USB_MODE_SERVICE, USB_MODE_OBJECT, USB_MODE_INTERFACE,
-                                                                          USB_MODE_STATE_REQUEST));
-    if (usbModeReply.isValid()) {
-        return priv->stringToMode(usbModeReply.value());
+    QList<QVariant> resp = priv->requestIf->get(USB_MODE_STATE_REQUEST);
+    if (!resp.isEmpty()) {
+        return priv->stringToMode(resp[0].toString());
     }
     return QmUSBMode::Undefined;
 }
 
+void QmUSBMode::getModeAsync() {
+    MEEGO_PRIVATE(QmUSBMode);
+
+    QObject::connect(priv->requestIf->getAsync(USB_MODE_STATE_REQUEST),
+                     SIGNAL(finished(QDBusPendingCallWatcher*)),
+                     priv, SLOT(didReceiveMode(QDBusPendingCallWatcher*)));
+}
+
 bool QmUSBMode::setMode(QmUSBMode::Mode mode) {
     MEEGO_PRIVATE(QmUSBMode);
 
@@ -153,10 +160,7 @@ bool QmUSBMode::setMode(QmUSBMode::Mode mode) {
         return false;
     }
 
-    QDBusMessage usbModeSetCall = QDBusMessage::createMethodCall(USB_MODE_SERVICE, USB_MODE_OBJECT, USB_MODE_INTERFACE, USB_MODE_STATE_SET);
-    usbModeSetCall << usbModeString;
-
-    (void)QDBusConnection::systemBus().call(usbModeSetCall, QDBus::NoBlock);
+    priv->requestIf->callAsynchronously(USB_MODE_STATE_SET, usbModeString);
     return true;
 }
 
@@ -174,10 +178,7 @@ bool QmUSBMode::setDefaultMode(QmUSBMode::Mode mode) {
     }
 
     // Meego uses different gconf databases for root and user, so sending dbus message to set it 
-    QDBusMessage usbDefaultModeSetCall = QDBusMessage::createMethodCall(USB_MODE_SERVICE, USB_MODE_OBJECT, USB_MODE_INTERFACE, USB_MODE_CONFIG_SET);
-    usbDefaultModeSetCall << str;
-
-    (void)QDBusConnection::systemBus().call(usbDefaultModeSetCall, QDBus::NoBlock);
+    priv->requestIf->callAsynchronously(USB_MODE_CONFIG_SET, str);
 
     gboolean ret = gconf_client_set_string(priv->gcClient, USB_MODE_GCONF, str.toAscii().data(), NULL);
     if (ret == TRUE) {
@@ -237,9 +238,12 @@ QmUSBModePrivate::QmUSBModePrivate(QObject *parent) : QObject(parent) {
 
     g_type_init();
     gcClient = gconf_client_get_default();
+
+    requestIf = new QmIPCInterface(USB_MODE_SERVICE, USB_MODE_OBJECT, USB_MODE_INTERFACE);
 }
 
 QmUSBModePrivate::~QmUSBModePrivate() {
+    delete requestIf, requestIf = 0;
     g_object_unref(gcClient), gcClient = 0;
 }
 
@@ -317,4 +321,15 @@ void QmUSBModePrivate::modeChanged(const QString &mode) {
     }
 }
 
+void QmUSBModePrivate::didReceiveMode(QDBusPendingCallWatcher *call) {
+    QList<QVariant> resp = QmIPCInterface::results(call);
+    call->deleteLater();
+
+    if (resp.isEmpty()) {
+        emit modeReceived(QmUSBMode::Undefined);
+    } else {
+        emit modeReceived(stringToMode(resp[0].toString()));
+    }
+}
+
 } // namespace MeeGo
@@ -90,6 +90,13 @@ public:
      */
     QmUSBMode::Mode getMode();
 
+    /*!
+     * @brief Gets the current USB mode without blocking.
+     * The modeReceived signal is emitted when the mode has been retrieved,
+     * with QmUSBMode::Undefined in case of an error.
+     */
+    void getModeAsync();
+
     /*!
      * @brief Sets the USB mode. Note that calling setMode is non-blocking, so the method returns immediately.
      * If the USB mode change succeeded, the modeChanged signal is emitted.
@@ -157,6 +164,12 @@ Q_SIGNALS:
      */
     void modeChanged(MeeGo::QmUSBMode::Mode mode);
 
+    /*!
+     * @brief This signal is emitted when the USB mode requested with getModeAsync() has been retrieved.
+     * @param mode The current mode.
+     */
+    void modeReceived(MeeGo::QmUSBMode::Mode mode);
+
     /*!
      * @brief This signal is emitted before a file system is being unmounted.
      * Applications can use the signal as an indication that a certain mount path
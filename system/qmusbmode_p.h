@@ -29,6 +29,7 @@
 #define QMUSBMODE_P_H
 
 #include "qmusbmode.h"
+#include "qmipcinterface_p.h"
 
 #include <gconf/gconf-client.h>
 #include <QMutex>
@@ -47,6 +48,7 @@ public:
     GConfClient *gcClient;
     QMutex connectMutex;
     size_t connectCount[2];
+    QmIPCInterface *requestIf;
 
     QmUSBModePrivate(QObject *parent = 0);
     ~QmUSBModePrivate();
@@ -56,12 +58,14 @@ public:
 
 Q_SIGNALS:
     void modeChanged(MeeGo::QmUSBMode::Mode mode);
+    void modeReceived(MeeGo::QmUSBMode::Mode mode);
     void fileSystemWillUnmount(MeeGo::QmUSBMode::MountPath mountPath);
     void error(const QString &errorCode);
 
 public Q_SLOTS:
     void didReceiveError(const QString &errorCode);
     void modeChanged(const QString &mode);
+    void didReceiveMode(QDBusPendingCallWatcher *call);
 };
 
 } // namespace MeeGo
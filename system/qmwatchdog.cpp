@@ -25,13 +25,603 @@
 #include "qmwatchdog.h"
 #include "qmwatchdog_p.h"
 
+#include <QCoreApplication>
+#include <QFile>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+/* The reconnect delay doubles from the first to the last */
+#define RETRY_MIN_MS 500
+#define RETRY_MAX_MS 30000
+
+/* How long stop() waits for a slow DSME to take the unregistration */
+#define STOP_FLUSH_MS 200
+
 namespace MeeGo {
 
+/* Upper bounds of the latency buckets in ms, the last bucket is open */
+static const int bucketLimits[QmProcessWatchdog::LatencyBuckets - 1] = { 1, 2, 5, 10, 20, 50, 100, 500, 1000 };
+
+static qint64 monotonicMs()
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0) {
+        return 0;
+    }
+    return (qint64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+QmProcessWatchdog::LoopStatistics::LoopStatistics()
+    : probes(0), stalls(0), totalLatency(0), maxLatency(0)
+{
+    memset(histogram, 0, sizeof(histogram));
+}
+
+QEvent::Type QmWatchdogProbe::eventType()
+{
+    static QEvent::Type type = (QEvent::Type)QEvent::registerEventType();
+    return type;
+}
+
+QmWatchdogPonger::QmWatchdogPonger(QmProcessWatchdogPrivate *watchdog)
+    : watchdog(watchdog)
+{
+    wakePipe[0] = wakePipe[1] = -1;
+    if (pipe(wakePipe) == 0) {
+        fcntl(wakePipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(wakePipe[1], F_SETFL, O_NONBLOCK);
+    }
+}
+
+QmWatchdogPonger::~QmWatchdogPonger()
+{
+    stop();
+    for (int i = 0; i < 2; i++) {
+        if (wakePipe[i] >= 0) {
+            close(wakePipe[i]);
+        }
+    }
+}
+
+void QmWatchdogPonger::stop()
+{
+    {
+        QMutexLocker locker(&watchdog->mutex);
+        watchdog->stopping = true;
+        watchdog->probeServed.wakeAll();
+    }
+    wake();
+    wait();
+}
+
+void QmWatchdogPonger::wake()
+{
+    if (wakePipe[1] >= 0) {
+        char c = 0;
+        if (write(wakePipe[1], &c, 1) < 0) {
+            /* Full, the thread wakes up anyway */
+        }
+    }
+}
+
+void QmWatchdogPonger::run()
+{
+    while (true) {
+        short events = POLLIN;
+        {
+            QMutexLocker locker(&watchdog->mutex);
+            if (watchdog->stopping) {
+                break;
+            }
+            if (watchdog->outCount > 0) {
+                events |= POLLOUT;
+            }
+        }
+
+        struct pollfd fds[2] = {
+            { watchdog->fd, events, 0 },
+            { wakePipe[0], POLLIN, 0 }
+        };
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[1].revents) {
+            char buf[64];
+            while (read(wakePipe[0], buf, sizeof(buf)) > 0) {
+            }
+        }
+
+        bool lost = false;
+        if (fds[0].revents & POLLOUT) {
+            QMutexLocker locker(&watchdog->mutex);
+            lost = watchdog->flush() < 0;
+        }
+        if (!lost && (fds[0].revents & (POLLIN | POLLHUP | POLLERR))) {
+            int pings = watchdog->receive();
+            lost = pings < 0;
+            if (pings > 0) {
+                watchdog->profiler.pinged();
+                for (int i = 0; i < pings; i++) {
+                    QMetaObject::invokeMethod(watchdog, "ping", Qt::QueuedConnection);
+                }
+                /* One probe answers the pings read together */
+                if (watchdog->probe() && watchdog->queue((dsmemsg_generic_t*)watchdog->pongMsg)) {
+                    watchdog->profiler.ponged();
+                }
+            }
+        }
+        if (lost) {
+            QMetaObject::invokeMethod(watchdog, "connectionLost", Qt::QueuedConnection);
+            break;
+        }
+    }
+}
+
+QmProcessWatchdogPrivate::QmProcessWatchdogPrivate()
+    : state(Stopped), fd(-1), readNotifier(NULL), writeNotifier(NULL), retryDelay(RETRY_MIN_MS),
+      connectFailed(false),
+      outCount(0), outOffset(0), inFill(0), inSkip(0),
+      automatic(false), latencyBudget(1000), ponger(NULL),
+      stopping(false), probeSerial(0), servedSerial(0)
+{
+    createMsg = DSME_MSG_NEW(DSM_MSGTYPE_PROCESSWD_CREATE);
+    deleteMsg = DSME_MSG_NEW(DSM_MSGTYPE_PROCESSWD_DELETE);
+    pongMsg = DSME_MSG_NEW(DSM_MSGTYPE_PROCESSWD_PONG);
+
+    retryTimer.setSingleShot(true);
+    connect(&retryTimer, SIGNAL(timeout()), this, SLOT(connectToDsme()));
+}
+
+QmProcessWatchdogPrivate::~QmProcessWatchdogPrivate()
+{
+    stop();
+    free(createMsg);
+    free(deleteMsg);
+    free(pongMsg);
+}
+
+bool QmProcessWatchdogPrivate::start()
+{
+    if (state != Stopped) {
+        return true;
+    }
+    retryDelay = RETRY_MIN_MS;
+    connectFailed = false;
+    connectToDsme();
+    /* DSME is waited for, only a socket that cannot be created fails */
+    return state != Stopped;
+}
+
+bool QmProcessWatchdogPrivate::stop()
+{
+    retryTimer.stop();
+    stopPonger();
+    profiler.ponged();
+
+    bool ok = true;
+    if (state == Connected) {
+        /* Gives a slow DSME a moment to take the unregistration */
+        ok = queue((dsmemsg_generic_t*)deleteMsg);
+        qint64 deadline = monotonicMs() + STOP_FLUSH_MS;
+        while (ok) {
+            int done;
+            {
+                QMutexLocker locker(&mutex);
+                done = flush();
+            }
+            if (done != 0) {
+                ok = done > 0;
+                break;
+            }
+            int left = (int)(deadline - monotonicMs());
+            struct pollfd pfd = { fd, POLLOUT, 0 };
+            if (left <= 0 || (poll(&pfd, 1, left) < 0 && errno != EINTR)) {
+                ok = false;
+            }
+        }
+        if (!ok) {
+            qWarning() << "Could not unregister from the process watchdog service.";
+        }
+    }
+    closeSocket();
+    state = Stopped;
+    return true;
+}
+
+void QmProcessWatchdogPrivate::connectToDsme()
+{
+    if (state != Stopped && state != Retrying) {
+        return;
+    }
+    bool starting = state == Stopped;
+    state = Connecting;
+
+    const char *path = getenv(DSME_SOCKFILE_ENV);
+    if (!path || !*path) {
+        path = DSME_SOCKFILE_DEFAULT;
+    }
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        qWarning() << "Could not create a socket for the dsme daemon:" << strerror(errno);
+        if (starting) {
+            state = Stopped;
+        } else {
+            scheduleRetry();
+        }
+        return;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+
+    if (::connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+        connected();
+    } else if (errno == EINPROGRESS) {
+        writeNotifier = new QSocketNotifier(fd, QSocketNotifier::Write);
+        connect(writeNotifier, SIGNAL(activated(int)), this, SLOT(writable(int)));
+    } else {
+        /* Not up yet, or its backlog is full */
+        connectFailure();
+    }
+}
+
+void QmProcessWatchdogPrivate::connected()
+{
+    state = Connected;
+    retryDelay = RETRY_MIN_MS;
+    connectFailed = false;
+    createMsg->pid = deleteMsg->pid = pongMsg->pid = getpid();
+
+    if (!writeNotifier) {
+        writeNotifier = new QSocketNotifier(fd, QSocketNotifier::Write);
+        connect(writeNotifier, SIGNAL(activated(int)), this, SLOT(writable(int)));
+    }
+    writeNotifier->setEnabled(false);
+
+    queue((dsmemsg_generic_t*)createMsg);
+    if (automatic) {
+        startPonger();
+    } else {
+        readNotifier = new QSocketNotifier(fd, QSocketNotifier::Read);
+        connect(readNotifier, SIGNAL(activated(int)), this, SLOT(readable(int)));
+    }
+}
+
+void QmProcessWatchdogPrivate::connectionLost()
+{
+    if (state != Connected) {
+        return;
+    }
+    qWarning() << "Lost the connection to the dsme daemon, reconnecting.";
+    stopPonger();
+    profiler.ponged();
+    scheduleRetry();
+}
+
+void QmProcessWatchdogPrivate::connectFailure()
+{
+    /* Logged once, the retries go on quietly */
+    if (!connectFailed) {
+        qWarning() << "Could not connect to dsme daemon.";
+        connectFailed = true;
+    }
+    scheduleRetry();
+}
+
+void QmProcessWatchdogPrivate::scheduleRetry()
+{
+    closeSocket();
+    state = Retrying;
+    retryTimer.start(retryDelay);
+    retryDelay = qMin(retryDelay * 2, RETRY_MAX_MS);
+}
+
+void QmProcessWatchdogPrivate::closeSocket()
+{
+    /* Possibly called from the slot of a notifier */
+    if (readNotifier) {
+        readNotifier->setEnabled(false);
+        readNotifier->deleteLater();
+        readNotifier = NULL;
+    }
+    if (writeNotifier) {
+        writeNotifier->setEnabled(false);
+        writeNotifier->deleteLater();
+        writeNotifier = NULL;
+    }
+
+    QMutexLocker locker(&mutex);
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+    outCount = outOffset = 0;
+    inFill = inSkip = 0;
+}
+
+bool QmProcessWatchdogPrivate::queue(dsmemsg_generic_t *msg)
+{
+    QMutexLocker locker(&mutex);
+    if (fd < 0) {
+        return false;
+    }
+
+    bool queued = false;
+    for (int i = 0; i < outCount; i++) {
+        if (outQueue[i] == msg && (i > 0 || outOffset == 0)) {
+            queued = true;
+        }
+    }
+    if (!queued) {
+        if (outCount == WATCHDOG_OUT_QUEUE) {
+            return false;
+        }
+        outQueue[outCount++] = msg;
+    }
+
+    int done = flush();
+    if (done < 0) {
+        QMetaObject::invokeMethod(this, "connectionLost", Qt::QueuedConnection);
+        return false;
+    }
+    if (done == 0) {
+        wantWrite();
+    }
+    return true;
+}
+
+int QmProcessWatchdogPrivate::flush()
+{
+    while (outCount > 0) {
+        const char *data = (const char*)outQueue[0];
+        int size = outQueue[0]->line_size_;
+        ssize_t n = ::send(fd, data + outOffset, size - outOffset, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        outOffset += n;
+        if (outOffset == size) {
+            outCount--;
+            memmove(outQueue, outQueue + 1, outCount * sizeof(outQueue[0]));
+            outOffset = 0;
+        }
+    }
+    return 1;
+}
+
+int QmProcessWatchdogPrivate::receive()
+{
+    const int header = sizeof(dsmemsg_generic_t);
+    int pings = 0;
+
+    while (true) {
+        int want;
+        if (inSkip > 0) {
+            want = qMin(inSkip, (int)sizeof(in.bytes));
+        } else if (inFill < header) {
+            want = header - inFill;
+        } else {
+            want = in.header.line_size_ - inFill;
+        }
+
+        ssize_t n = ::recv(fd, inSkip > 0 ? in.bytes : in.bytes + inFill, want, MSG_DONTWAIT);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return pings;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+
+        if (inSkip > 0) {
+            inSkip -= n;
+            continue;
+        }
+        inFill += n;
+        if (inFill < header) {
+            continue;
+        }
+        if (inFill == header) {
+            if (in.header.line_size_ < (quint32)header) {
+                return -1;
+            }
+            if (in.header.line_size_ > sizeof(in.bytes)) {
+                /* Not one of ours */
+                inSkip = in.header.line_size_ - header;
+                inFill = 0;
+                continue;
+            }
+        }
+        if (inFill < (int)in.header.line_size_) {
+            continue;
+        }
+
+        if (dsmemsg_id(&in.header) == DSME_MSG_ID_(DSM_MSGTYPE_PROCESSWD_PING)) {
+            pings++;
+        }
+        inFill = 0;
+    }
+}
+
+void QmProcessWatchdogPrivate::wantWrite()
+{
+    if (ponger) {
+        ponger->wake();
+    } else if (QThread::currentThread() == thread()) {
+        enableWrite();
+    } else {
+        QMetaObject::invokeMethod(this, "enableWrite", Qt::QueuedConnection);
+    }
+}
+
+void QmProcessWatchdogPrivate::enableWrite()
+{
+    if (writeNotifier && state == Connected && !ponger) {
+        writeNotifier->setEnabled(true);
+    }
+}
+
+bool QmProcessWatchdogPrivate::pong()
+{
+    if (state != Connected) {
+        return false;
+    }
+    if (!queue((dsmemsg_generic_t*)pongMsg)) {
+        qWarning() << "Could not send a PONG message.";
+        return false;
+    }
+    profiler.ponged();
+    return true;
+}
+
+void QmProcessWatchdogPrivate::readable(int)
+{
+    int pings = receive();
+    if (pings < 0) {
+        connectionLost();
+        return;
+    }
+    if (pings > 0) {
+        profiler.pinged();
+    }
+    for (int i = 0; i < pings && state == Connected; i++) {
+        emit ping();
+    }
+}
+
+void QmProcessWatchdogPrivate::writable(int)
+{
+    if (state == Connecting) {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0) {
+            connectFailure();
+        } else {
+            connected();
+        }
+        return;
+    }
+
+    int done;
+    {
+        QMutexLocker locker(&mutex);
+        done = flush();
+    }
+    if (done < 0) {
+        connectionLost();
+    } else if (done > 0 && writeNotifier) {
+        writeNotifier->setEnabled(false);
+    }
+}
+
+void QmProcessWatchdogPrivate::startPonger()
+{
+    {
+        QMutexLocker locker(&mutex);
+        stopping = false;
+    }
+    ponger = new QmWatchdogPonger(this);
+    ponger->start();
+}
+
+void QmProcessWatchdogPrivate::stopPonger()
+{
+    if (ponger) {
+        delete ponger;
+        ponger = NULL;
+    }
+}
+
+bool QmProcessWatchdogPrivate::probe()
+{
+    QMutexLocker locker(&mutex);
+
+    quint32 serial = ++probeSerial;
+    qint64 posted = monotonicMs();
+    qint64 deadline = posted + latencyBudget;
+    loop.probes++;
+    QCoreApplication::postEvent(this, new QmWatchdogProbe(serial, posted));
+
+    while ((qint32)(servedSerial - serial) < 0 && !stopping) {
+        qint64 left = deadline - monotonicMs();
+        if (left <= 0) {
+            break;
+        }
+        probeServed.wait(&mutex, (unsigned long)left);
+    }
+    if ((qint32)(servedSerial - serial) >= 0) {
+        return true;
+    }
+    if (!stopping) {
+        loop.stalls++;
+    }
+    return false;
+}
+
+void QmProcessWatchdogPrivate::probed(const QmWatchdogProbe *probe)
+{
+    qint64 latency = monotonicMs() - probe->posted;
+    bool late;
+    {
+        QMutexLocker locker(&mutex);
+        if ((qint32)(probe->serial - servedSerial) > 0) {
+            servedSerial = probe->serial;
+        }
+        probeServed.wakeAll();
+
+        int bucket = 0;
+        while (bucket < QmProcessWatchdog::LatencyBuckets - 1 && latency >= bucketLimits[bucket]) {
+            bucket++;
+        }
+        loop.histogram[bucket]++;
+        loop.totalLatency += latency;
+        if (latency > loop.maxLatency) {
+            loop.maxLatency = latency;
+        }
+        late = latency > latencyBudget;
+    }
+    if (late) {
+        emit loopStalled((int)latency);
+    }
+}
+
+bool QmProcessWatchdogPrivate::event(QEvent *event)
+{
+    if (event->type() == QmWatchdogProbe::eventType()) {
+        probed(static_cast<QmWatchdogProbe*>(event));
+        return true;
+    }
+    return QObject::event(event);
+}
+
 
 QmProcessWatchdog::QmProcessWatchdog(QObject *parent) : QObject(parent)
 {
     MEEGO_INITIALIZE(QmProcessWatchdog);
     connect(priv, SIGNAL(ping()), this, SIGNAL(ping()));
+    connect(priv, SIGNAL(loopStalled(int)), this, SIGNAL(loopStalled(int)));
 }
 
 QmProcessWatchdog::~QmProcessWatchdog()
@@ -59,4 +649,52 @@ bool QmProcessWatchdog::pong()
     return priv->pong();
 }
 
+bool QmProcessWatchdog::setAutomaticPong(bool automatic, int latencyBudget)
+{
+    MEEGO_PRIVATE(QmProcessWatchdog);
+    if (priv->state != QmProcessWatchdogPrivate::Stopped) {
+        return false;
+    }
+    priv->automatic = automatic;
+    priv->latencyBudget = latencyBudget > 0 ? latencyBudget : 1;
+    return true;
+}
+
+bool QmProcessWatchdog::automaticPong() const
+{
+    MEEGO_PRIVATE_CONST(QmProcessWatchdog);
+    return priv->automatic;
+}
+
+QmProcessWatchdog::LoopStatistics QmProcessWatchdog::loopStatistics() const
+{
+    MEEGO_PRIVATE_CONST(QmProcessWatchdog);
+    QMutexLocker locker(const_cast<QMutex*>(&priv->mutex));
+    return priv->loop;
+}
+
+bool QmProcessWatchdog::setStallProfiler(int threshold, const QString &fileName)
+{
+    MEEGO_PRIVATE(QmProcessWatchdog);
+    if (threshold <= 0) {
+        priv->profiler.disable();
+        return true;
+    }
+    return priv->profiler.enable(threshold, QFile::encodeName(fileName));
+}
+
+int QmProcessWatchdog::stallCaptures() const
+{
+    MEEGO_PRIVATE_CONST(QmProcessWatchdog);
+    return priv->profiler.captures();
+}
+
+int QmProcessWatchdog::bucketLimit(int bucket)
+{
+    if (bucket < 0 || bucket >= LatencyBuckets - 1) {
+        return -1;
+    }
+    return bucketLimits[bucket];
+}
+
 } // Namespace MeeGo
@@ -47,15 +47,90 @@ namespace MeeGo {
     Q_OBJECT;
 
     public:
+        //! Number of buckets of the event loop latency histogram
+        static const int LatencyBuckets = 10;
+
+        /**
+         * Latencies of the event loop, measured by the probes of the automatic pongs.
+         * Bucket i of the histogram counts the latencies below bucketLimit(i) ms,
+         * the last bucket the rest.
+         */
+        struct LoopStatistics {
+            LoopStatistics();
+
+            int probes;                     //!< Probes posted, one per ping
+            int stalls;                     //!< Probes not served within the latency budget
+            qint64 totalLatency;            //!< Sum of the latencies of the served probes in ms
+            qint64 maxLatency;              //!< The largest latency in ms
+            int histogram[LatencyBuckets];  //!< Served probes by latency
+        };
+
         QmProcessWatchdog(QObject *parent = NULL);
         ~QmProcessWatchdog();
 
+        /**
+         * Makes the library answer the pings by itself. The pings are received
+         * by a thread of the library, which posts a probe to the thread of this
+         * object and sends the pong only if the event loop of that thread has
+         * processed the probe within the latency budget. A stalled event loop
+         * thus gets the process killed by DSME, as it would without the
+         * automatic pongs. The ping() signal is still sent.
+         *
+         * @param automatic True to send the pongs automatically
+         * @param latencyBudget The time in ms the event loop may take to process a probe
+         * @return False if the watchdog has been started already
+         */
+        bool setAutomaticPong(bool automatic, int latencyBudget = 1000);
+
+        /**
+         * @return True if the pongs are sent automatically
+         */
+        bool automaticPong() const;
+
+        /**
+         * @return The latencies of the event loop since the first start()
+         */
+        LoopStatistics loopStatistics() const;
+
+        /**
+         * Makes the watchdog capture the stack of the calling thread, and the slots
+         * it is executing, when a ping has not been answered within the threshold,
+         * and again at each threshold until it is. The captures are appended to
+         * the file as they are taken, so that they are there even if DSME kills
+         * the process. The thread is interrupted with SIGPROF for the capture.
+         * Link the application with -rdynamic to get the function names.
+         *
+         * Only one watchdog of the process can profile at a time. Call this in
+         * the thread of the event loop to be profiled.
+         *
+         * @param threshold The time in ms a ping may remain unanswered, 0 to stop profiling
+         * @param fileName The file to append to, stderr if empty
+         * @return False if the file cannot be opened or another watchdog profiles
+         */
+        bool setStallProfiler(int threshold, const QString &fileName = QString());
+
+        /**
+         * @return The number of the stacks captured by the stall profiler
+         */
+        int stallCaptures() const;
+
+        /**
+         * @param bucket A bucket of LoopStatistics::histogram, but the last one
+         * @return The upper bound of the latencies of the bucket in ms
+         */
+        static int bucketLimit(int bucket);
+
         /**
          * Registers the current process to the DSME process watchdog service.
          * After the registration, the ping() signal will be emitted periodically.
          * The application should then call pong() function to avoid being killed.
          *
-         * @return True if successful, false if not
+         * Does not block: the connection is made in the background, and made
+         * again if DSME is not up yet or restarts, with the registration sent
+         * at each connect. The first failed connect is logged.
+         *
+         * @return False if the socket cannot be created, true otherwise, also
+         *         when DSME is not up yet or the watchdog has been started already
          */
         bool start();
 
@@ -72,6 +147,9 @@ namespace MeeGo {
          * Sends a pong signal to the DSME process watchdog service to indicate that
          * this process is still active.
          *
+         * Does not block. If DSME is not reading, the pong is queued and sent
+         * when it is, once for the pongs queued meanwhile.
+         *
          * @return True if successful, false is not
          */
         bool pong();
@@ -82,6 +160,14 @@ namespace MeeGo {
          */
         void ping();
 
+        /**
+         * Sent when the event loop processes a probe later than the latency budget
+         * allows, in automatic pong mode.
+         *
+         * @param latency The time the probe waited in ms
+         */
+        void loopStalled(int latency);
+
     private:
         Q_DISABLE_COPY(QmProcessWatchdog)
         MEEGO_DECLARE_PRIVATE(QmProcessWatchdog)
@@ -28,14 +28,64 @@
 #define QMWATCHDOG_P_H
 
 #include "qmwatchdog.h"
+#include "qmstallprofiler_p.h"
 #include <QSocketNotifier>
+#include <QEvent>
+#include <QMutex>
+#include <QThread>
+#include <QTimer>
+#include <QWaitCondition>
 #include <dsme/processwd.h>
 #include <dsme/protocol.h>
 #include <cstdlib>
 #include <QDebug>
 
+/* As libdsme, the socket is $DSME_SOCKFILE if set. The simulated DSME of
+ * tests/dsmesim is used by pointing the variable to it. */
+#define DSME_SOCKFILE_ENV "DSME_SOCKFILE"
+#define DSME_SOCKFILE_DEFAULT "/tmp/dsmesock"
+
+#define WATCHDOG_OUT_QUEUE 4
+#define WATCHDOG_IN_BUFFER 256
+
 namespace MeeGo
 {
+    class QmProcessWatchdogPrivate;
+
+    /* Receives the pings in automatic pong mode and answers them once the
+     * event loop has processed a probe */
+    class QmWatchdogPonger : public QThread
+    {
+    public:
+        QmWatchdogPonger(QmProcessWatchdogPrivate *watchdog);
+        ~QmWatchdogPonger();
+
+        /* Stops the thread and waits for it */
+        void stop();
+
+        /* Makes the thread poll again, for the queue to be written */
+        void wake();
+
+    protected:
+        void run();
+
+    private:
+        QmProcessWatchdogPrivate *watchdog;
+        int wakePipe[2];
+    };
+
+    /* Posted to the thread of the watchdog at each ping */
+    class QmWatchdogProbe : public QEvent
+    {
+    public:
+        QmWatchdogProbe(quint32 serial, qint64 posted)
+            : QEvent(eventType()), serial(serial), posted(posted) { }
+
+        static QEvent::Type eventType();
+
+        quint32 serial;
+        qint64 posted;      // ms, monotonic
+    };
 
     class QmProcessWatchdogPrivate : public QObject
     {
@@ -43,88 +93,108 @@ namespace MeeGo
         MEEGO_DECLARE_PUBLIC(QmProcessWatchdog);
 
     public:
-        QmProcessWatchdogPrivate() : conn(NULL), notifier(NULL) { }
-
-        bool start() {
-            conn = dsmesock_connect();
-            if (!conn) {
-                qWarning() << "Could not connect to dsme daemon.";
-                return false;
-            }
-
-            DSM_MSGTYPE_PROCESSWD_CREATE *msg = DSME_MSG_NEW(DSM_MSGTYPE_PROCESSWD_CREATE);
-            msg->pid = getpid();
-            int ret = dsmesock_send(conn, msg);
-            free(msg);
-            if (ret < 0) {
-                dsmesock_close(conn);
-                conn = NULL;
-                qWarning("Could not register to the process watchdog service.");
-                return false;
-            }
-            notifier = new QSocketNotifier(conn->fd, QSocketNotifier::Read);
-            connect(notifier, SIGNAL(activated(int)), this, SLOT(readable(int)));
-            notifier->setEnabled(true);
-
-            return true;
-        }
-
-        bool stop() {
-            if (notifier) {
-                delete notifier;
-                notifier = NULL;
-            }
-            if (conn) {
-                DSM_MSGTYPE_PROCESSWD_DELETE *msg = DSME_MSG_NEW(DSM_MSGTYPE_PROCESSWD_DELETE);
-                msg->pid = getpid();
-                int ret = dsmesock_send(conn, msg);
-                if (ret < 0) {
-                    qWarning() << "Could not unregister from the process watchdog service.";
-                }
-                free (msg);
-                dsmesock_close(conn);
-                conn = NULL;
-            }
-
-            return true;
-
-        }
-
-
-        dsmesock_connection_t *conn;
-        QSocketNotifier *notifier;
+        /* The connection to DSME. It is made and remade in the background,
+         * so that neither start() nor pong() block on a slow DSME. */
+        enum State
+        {
+            Stopped,
+            Connecting,     // waiting for the non-blocking connect
+            Connected,      // registered, or the registration queued
+            Retrying        // waiting for the retry timer
+        };
+
+        QmProcessWatchdogPrivate();
+        ~QmProcessWatchdogPrivate();
+
+        bool start();
+        bool stop();
+
+        /* Queues a preallocated message and writes what the socket takes
+         * without blocking. Queuing a message already waiting is a no-op,
+         * so the pongs of the pings of a slow DSME are sent once. */
+        bool queue(dsmemsg_generic_t *msg);
+
+        /* Writes the queue under the mutex: 1 when empty, 0 if the socket
+         * is full, -1 if the connection is lost */
+        int flush();
+
+        /* Reads what there is: the number of the pings, -1 if the
+         * connection is lost */
+        int receive();
+
+        void startPonger();
+        void stopPonger();
+
+        /* Called by the ponger at a ping: posts a probe and waits for the
+         * event loop to process it, for the latency budget at most */
+        bool probe();
+
+        /* Records the latency of a probe processed by the event loop */
+        void probed(const QmWatchdogProbe *probe);
+
+        State state;
+        int fd;
+        QSocketNotifier *readNotifier;
+        QSocketNotifier *writeNotifier;
+        QTimer retryTimer;
+        int retryDelay;                 // ms
+        bool connectFailed;             // logged since start() or the last connect
+
+        /* Allocated once, the pid is filled in at each connect */
+        DSM_MSGTYPE_PROCESSWD_CREATE *createMsg;
+        DSM_MSGTYPE_PROCESSWD_DELETE *deleteMsg;
+        DSM_MSGTYPE_PROCESSWD_PONG *pongMsg;
+
+        dsmemsg_generic_t *outQueue[WATCHDOG_OUT_QUEUE];
+        int outCount;
+        int outOffset;                  // bytes of the first one written
+
+        /* A message being received, read by one thread at a time */
+        union {
+            dsmemsg_generic_t header;
+            char bytes[WATCHDOG_IN_BUFFER];
+        } in;
+        int inFill;
+        int inSkip;                     // bytes left of a message too large
+
+        bool automatic;
+        int latencyBudget;              // ms
+        QmWatchdogPonger *ponger;
+
+        /* Guards the queue, the probes and the statistics */
+        QMutex mutex;
+        QWaitCondition probeServed;
+        bool stopping;
+        quint32 probeSerial;            // the last posted
+        quint32 servedSerial;           // the last processed
+        QmProcessWatchdog::LoopStatistics loop;
+
+        /* Told of the pings and the pongs, in both modes */
+        QmStallProfiler profiler;
+
+    protected:
+        bool event(QEvent *event);
+
+    private:
+        void connected();
+        void closeSocket();
+        void scheduleRetry();
+        void connectFailure();
+        void wantWrite();
 
     Q_SIGNALS:
         void ping();
+        void loopStalled(int latency);
 
     public Q_SLOTS:
-        bool pong() {
-            if (conn) {
-                DSM_MSGTYPE_PROCESSWD_PONG *msg = DSME_MSG_NEW(DSM_MSGTYPE_PROCESSWD_PONG);
-                msg->pid = getpid();
-                int ret = dsmesock_send(conn, msg);
-                free (msg);
-                if (ret < 0) {
-                    qWarning() << "Could not send a PONG message.";
-                    return false;
-                } else {
-                    return true;
-                }
-            }
-            return false;
-
-        }
-
-        void readable(int fd) {
-            if (conn && conn->fd == fd) {
-                dsmemsg_generic_t *msg = (dsmemsg_generic_t*)dsmesock_receive(conn);
-                if (msg && dsmemsg_id(msg) == DSME_MSG_ID_(DSM_MSGTYPE_PROCESSWD_PING)) {
-                    emit ping();
-                }
-                free (msg);
-            }
-        }
-
+        bool pong();
+
+    private Q_SLOTS:
+        void connectToDsme();
+        void connectionLost();
+        void enableWrite();
+        void readable(int fd);
+        void writable(int fd);
     };
 }
 #endif // QMWATCHDOG_P_H
@@ -26,6 +26,13 @@ linux-g++-maemo {
     message("Compiling without sysinfo support")
 }
 
+# CONFIG+=iphbsim builds a host library for the simulated iphbd of
+# tests/iphbsim. Only such builds let $QMSYSTEM_IPHB_SIMULATOR replace
+# libiphb.
+iphbsim {
+    DEFINES += QMSYSTEM_IPHBSIM
+}
+
 # DEFINES += HAVE_QMLOG
 message("Compiling without qmlog support")
 
@@ -40,6 +47,7 @@ HEADERS += mainpage.h \
     qmals_p.h \
     qmbattery.h \
     qmcabc.h \
+    qmcabc_p.h \
     qmcallstate.h \
     qmcallstate_p.h \
     qmcompass.h \
@@ -48,14 +56,21 @@ HEADERS += mainpage.h \
     qmdevicemode_p.h \
     qmdisplaystate.h \
     qmdisplaystate_p.h \
+    qmenergymeter.h \
+    qmenergymeter_p.h \
     qmheartbeat.h \
     qmheartbeat_p.h \
+    qmheartbeatscheduler.h \
+    qmheartbeatscheduler_p.h \
     qmipcinterface_p.h \
+    qmipcstatistics.h \
+    qmiphbtransport_p.h \
     qmkeys.h \
     qmkeys_p.h \
     qmled.h \
     qmlocks.h \
     qmlocks_p.h \
+    qmmagneticcalibration_p.h \
     qmmagnetometer.h \
     qmmagnetometer_p.h \
     qmorientation.h \
@@ -66,15 +81,21 @@ HEADERS += mainpage.h \
     qmrotation_p.h \
     qmsensor.h \
     qmsensor_p.h \
+    qmsignalhub_p.h \
+    qmstallprofiler_p.h \
     qmsysteminformation.h \
     qmsysteminformation_p.h \
     qmsystemstate.h \
     qmsystemstate_p.h \
+    qmsystemsnapshot.h \
+    qmsystemsnapshot_p.h \
     qmtap.h \
     qmtap_p.h \
     qmthermal.h \
     qmthermal_p.h \
     qmtime.h \
+    qmtimezone_p.h \
+    qmtimezoneindex_p.h \
     qmusbmode.h \
     qmusbmode_p.h \
     qmwatchdog.h \
@@ -89,29 +110,49 @@ SOURCES += qmactivity.cpp \
     qmcompass.cpp \
     qmdevicemode.cpp \
     qmdisplaystate.cpp \
+    qmenergymeter.cpp \
     qmheartbeat.cpp \
+    qmheartbeatscheduler.cpp \
     qmipcinterface.cpp \
+    qmiphbtransport.cpp \
     qmkeys.cpp \
     qmled.cpp \
     qmlocks.cpp \
     qmorientation.cpp \
     qmsysteminformation.cpp \
     qmsystemstate.cpp \
+    qmsystemsnapshot.cpp \
     qmtap.cpp \
     qmthermal.cpp \
     qmproximity.cpp \
     qmtime.cpp \
+    qmtimezone.cpp \
+    qmtimezoneindex.cpp \
     qmsensor.cpp \
     qmrotation.cpp \
+    qmsignalhub.cpp \
+    qmstallprofiler.cpp \
     qmmagnetometer.cpp \
+    qmmagneticcalibration.cpp \
     qmwatchdog.cpp \
     qmusbmode.cpp
 
-linux-g++-maemo {
+# CONFIG+=bmesim builds the real battery backend on a host, to be run
+# against the simulated BME of tests/bmesim. Only such builds let
+# $QMSYSTEM_BME_SIMULATOR replace libbmeipc.
+bmesim {
+    DEFINES += QMSYSTEM_BMESIM
+}
+
+linux-g++-maemo|bmesim {
     message("Compiling with bmeipc support")
     PKGCONFIG += bmeipc
-    HEADERS += qmbattery_p.h
-    SOURCES += qmbattery.cpp
+    HEADERS += qmbattery_p.h \
+               qmbatterymodel_p.h \
+               qmbmetransport_p.h
+    SOURCES += qmbattery.cpp \
+               qmbatterymodel.cpp \
+               qmbmetransport.cpp
 } else {
     message("Compiling without bmeipc support")
     SOURCES += qmbattery_stub.cpp 
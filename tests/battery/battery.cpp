@@ -26,16 +26,48 @@
    </p>
  */
 #include <QObject>
+#include <QThread>
 #include <qmbattery.h>
 #include <QTest>
 
+/* Calls the battery getters in a loop, for the concurrency test */
+class GetterThread : public QThread {
+public:
+    GetterThread(MeeGo::QmBattery *battery) : battery(battery), failures(0) {}
+
+    MeeGo::QmBattery *battery;
+    int failures;
+
+protected:
+    void run() {
+        for (int i = 0; i < 1000; i++) {
+            int pct = battery->getRemainingCapacityPct();
+            if (pct < 0 || pct > 100)
+                failures++;
+            if (battery->getVoltage() < 0 || battery->getNominalCapacity() < 0)
+                failures++;
+            battery->getCumulativeBatteryCurrent();
+            battery->getBatteryCurrent();
+
+            MeeGo::QmBatterySnapshot snapshot = battery->snapshot();
+            if (snapshot.remainingCapacityBars < 0 || snapshot.remainingCapacityBars > snapshot.maxBars)
+                failures++;
+
+            if (i % 100 == 0)
+                battery->getAverageIdleCurrent(MeeGo::QmBattery::NormalMode);
+        }
+    }
+};
+
 class SignalDump : public QObject {
     Q_OBJECT
 
 public:
-    SignalDump(QObject *parent = NULL) : QObject(parent), batteryCurrentSignal(false) {}
+    SignalDump(QObject *parent = NULL) : QObject(parent), batteryCurrentSignal(false), batteryMeasurementsSignal(false), remainingTimesSignal(false) {}
 
     bool batteryCurrentSignal;
+    bool batteryMeasurementsSignal;
+    bool remainingTimesSignal;
 
 public slots:
     void slotChargingStateChanged(MeeGo::QmBattery::ChargingState){}
@@ -43,6 +75,10 @@ public slots:
     void slotBatteryStateChanged(MeeGo::QmBattery::BatteryState){}
     void slotBatteryRemainingCapacityChanged(int, int){}
     void slotBatteryCurrent(int) { batteryCurrentSignal = true; }
+    void slotRemainingTimesAvailable(MeeGo::QmBattery::RemainingTimeMode, int, int, int) { remainingTimesSignal = true; }
+    void slotBatteryMeasurements(const QVector<MeeGo::QmBatteryMeasurement> &measurements) {
+        batteryMeasurementsSignal = !measurements.isEmpty();
+    }
     
     /* Depreciated */
     void slotBatteryEnergyLevelChanged(int){}
@@ -85,6 +121,9 @@ private slots:
 
         QVERIFY(connect(battery, SIGNAL(batteryCurrent(int)),
                 &signalDump, SLOT(slotBatteryCurrent(int))));
+
+        QVERIFY(connect(battery, SIGNAL(batteryMeasurements(const QVector<MeeGo::QmBatteryMeasurement>&)),
+                &signalDump, SLOT(slotBatteryMeasurements(const QVector<MeeGo::QmBatteryMeasurement>&))));
         QTest::qWait(10*1000);
 
     }
@@ -125,6 +164,30 @@ private slots:
         (void)result;
     }
 
+    void testSnapshot() {
+        MeeGo::QmBatterySnapshot result = battery->snapshot();
+        QVERIFY(result.remainingCapacityPct >= 0 && result.remainingCapacityPct <= 100);
+        QVERIFY(result.remainingCapacityBars >= 0 && result.remainingCapacityBars <= result.maxBars);
+        QCOMPARE(result.nominalCapacity, battery->getNominalCapacity());
+        QCOMPARE(result.maxBars, battery->getMaxBars());
+        QCOMPARE(result.batteryCondition, battery->getBatteryCondition());
+    }
+
+    void testConcurrentGetters() {
+        GetterThread *threads[4];
+        for (int i = 0; i < 4; i++) {
+            threads[i] = new GetterThread(battery);
+            threads[i]->start();
+        }
+        /* Let the battery events be processed meanwhile */
+        for (int i = 0; i < 4; i++) {
+            while (!threads[i]->isFinished())
+                QTest::qWait(10);
+            QCOMPARE(threads[i]->failures, 0);
+            delete threads[i];
+        }
+    }
+
     void testAverageTalkCurrentNormal() {
         int result = battery->getAverageTalkCurrent(MeeGo::QmBattery::NormalMode);
         (void)result;
@@ -185,6 +248,17 @@ private slots:
         (void)result;
     }
 
+    void testRequestRemainingTimes() {
+        QVERIFY(connect(battery, SIGNAL(remainingTimesAvailable(MeeGo::QmBattery::RemainingTimeMode, int, int, int)),
+                &signalDump, SLOT(slotRemainingTimesAvailable(MeeGo::QmBattery::RemainingTimeMode, int, int, int))));
+
+        signalDump.remainingTimesSignal = false;
+        battery->requestRemainingTimes(MeeGo::QmBattery::NormalMode);
+        QVERIFY(!signalDump.remainingTimesSignal);
+        QTest::qWait(3000);
+        QVERIFY(signalDump.remainingTimesSignal);
+    }
+
     void testRemainingChargingTime() {
         int result = battery->getRemainingChargingTime();
         (void)result;
@@ -192,10 +266,12 @@ private slots:
 
     void testStartCurrentMeasurementMs250() {
         signalDump.batteryCurrentSignal = false;
+        signalDump.batteryMeasurementsSignal = false;
         bool result = battery->startCurrentMeasurement(MeeGo::QmBattery::RATE_250ms);
         QVERIFY(result == true );
         QTest::qWait(1000);
         QVERIFY(signalDump.batteryCurrentSignal);
+        QVERIFY(signalDump.batteryMeasurementsSignal);
     }
 
     void testStopCurrentMeasurementMs250() {
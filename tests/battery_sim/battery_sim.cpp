@@ -0,0 +1,328 @@
+/*!
+ * @file battery_sim.cpp
+ * @brief QmBattery tests against the simulated BME
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#include <QAtomicInt>
+#include <QFile>
+#include <QObject>
+#include <QTest>
+#include <QThread>
+#include <qmbattery.h>
+
+
+#include "bmesimulator.h"
+
+extern "C" {
+#include "bme/bmemsg.h"
+}
+
+/*
+ * Reads the battery until stopped. The test lowers the level and raises
+ * floor after each event has been delivered, a higher level read after
+ * that is a stale cache. The coulomb counter only grows meanwhile.
+ */
+class GetterThread : public QThread {
+public:
+    GetterThread(MeeGo::QmBattery *battery, const QAtomicInt &floor)
+        : battery(battery), floor(floor), reads(0), failures(0) {}
+
+    MeeGo::QmBattery *battery;
+    const QAtomicInt &floor;
+    QAtomicInt stopping;
+    int reads;
+    int failures;
+
+protected:
+    void run() {
+        int cc = battery->getCumulativeBatteryCurrent();
+        while (!stopping) {
+            int limit = floor;
+            if (battery->getRemainingCapacityPct() > limit)
+                failures++;
+
+            MeeGo::QmBatterySnapshot snapshot = battery->snapshot();
+            if (snapshot.remainingCapacityPct > limit)
+                failures++;
+
+            int value = battery->getCumulativeBatteryCurrent();
+            if (value < cc)
+                failures++;
+            cc = value;
+            reads++;
+        }
+    }
+};
+
+class SignalDump : public QObject {
+    Q_OBJECT
+
+public:
+    SignalDump(QObject *parent = NULL)
+        : QObject(parent), capacitySignals(0), lastPct(-1), chargerSignals(0),
+          lastCharger(MeeGo::QmBattery::Unknown), settledSignals(0),
+          lastSettled(MeeGo::QmBattery::Unknown), measurementSignals(0),
+          remainingTimesSignals(0), lastTalkTime(-1), lastIdleTime(-1),
+          remainingTimesThread(0) {}
+
+    int capacitySignals;
+    int lastPct;
+    int chargerSignals;
+    MeeGo::QmBattery::ChargerType lastCharger;
+    int settledSignals;
+    MeeGo::QmBattery::ChargerType lastSettled;
+    int measurementSignals;
+    QVector<MeeGo::QmBatteryMeasurement> lastMeasurements;
+    int remainingTimesSignals;
+    int lastTalkTime;
+    int lastIdleTime;
+    QThread *remainingTimesThread;
+
+public slots:
+    void slotBatteryRemainingCapacityChanged(int pct, int) {
+        capacitySignals++;
+        lastPct = pct;
+    }
+    void slotChargerEvent(MeeGo::QmBattery::ChargerType type) {
+        chargerSignals++;
+        lastCharger = type;
+    }
+    void slotChargerSettled(MeeGo::QmBattery::ChargerType type) {
+        settledSignals++;
+        lastSettled = type;
+    }
+    void slotBatteryMeasurements(const QVector<MeeGo::QmBatteryMeasurement> &measurements) {
+        measurementSignals++;
+        lastMeasurements = measurements;
+    }
+    void slotRemainingTimesAvailable(MeeGo::QmBattery::RemainingTimeMode, int talk, int, int idle) {
+        remainingTimesSignals++;
+        lastTalkTime = talk;
+        lastIdleTime = idle;
+        remainingTimesThread = QThread::currentThread();
+    }
+};
+
+class TestClass : public QObject
+{
+    Q_OBJECT
+
+private:
+    BmeSimulator *simulator;
+    MeeGo::QmBattery *battery;
+    SignalDump signalDump;
+
+private slots:
+    void initTestCase() {
+        simulator = new BmeSimulator(SimServer::tempPath("bmesim-test"));
+        qputenv("QMSYSTEM_BATTERY_MODEL_FILE", QFile::encodeName(simulator->path() + "/battery-model"));
+        QVERIFY(simulator->setTrace("0 pct=80 bars=6 maxbars=8 volt=3950 current=150 cc=1000 state=ok"));
+        QVERIFY(simulator->serve("QMSYSTEM_BME_SIMULATOR"));
+        SIM_TRY_VERIFY(simulator->traceDone(), 3000);
+
+        battery = new MeeGo::QmBattery();
+        QVERIFY(connect(battery, SIGNAL(batteryRemainingCapacityChanged(int, int)),
+                        &signalDump, SLOT(slotBatteryRemainingCapacityChanged(int, int))));
+        QVERIFY(connect(battery, SIGNAL(chargerEvent(MeeGo::QmBattery::ChargerType)),
+                        &signalDump, SLOT(slotChargerEvent(MeeGo::QmBattery::ChargerType))));
+        QVERIFY(connect(battery, SIGNAL(chargerSettled(MeeGo::QmBattery::ChargerType)),
+                        &signalDump, SLOT(slotChargerSettled(MeeGo::QmBattery::ChargerType))));
+        QVERIFY(connect(battery, SIGNAL(batteryMeasurements(const QVector<MeeGo::QmBatteryMeasurement>&)),
+                        &signalDump, SLOT(slotBatteryMeasurements(const QVector<MeeGo::QmBatteryMeasurement>&))));
+    }
+
+    void testGetters() {
+        QCOMPARE(battery->getRemainingCapacityPct(), 80);
+        QCOMPARE(battery->getRemainingCapacityBars(), 6);
+        QCOMPARE(battery->getMaxBars(), 8);
+        QCOMPARE(battery->getVoltage(), 3950);
+        QCOMPARE(battery->getBatteryState(), MeeGo::QmBattery::StateOK);
+        QCOMPARE(battery->getChargerType(), MeeGo::QmBattery::None);
+    }
+
+    void testCachedGetters() {
+        battery->getRemainingCapacityPct();
+        int queries = simulator->statQueries();
+        for (int i = 0; i < 100; i++) {
+            battery->getRemainingCapacityPct();
+            battery->getBatteryState();
+            battery->getChargerType();
+        }
+        QVERIFY(simulator->statQueries() <= queries + 1);
+    }
+
+    void testBatmonEvent() {
+        int count = signalDump.capacitySignals;
+        simulator->setStat(BATTERY_LEVEL_PCT, 79);
+        simulator->sendEvents(BMEVENT_BATMON);
+        SIM_TRY_VERIFY(signalDump.capacitySignals >= count + 1, 3000);
+        QCOMPARE(signalDump.lastPct, 79);
+        QCOMPARE(battery->getRemainingCapacityPct(), 79);
+    }
+
+    void testChargerEvent() {
+        int count = signalDump.chargerSignals;
+        simulator->setStat(CHARGER_TYPE, CHARGER_TYPE_USBWALL);
+        simulator->sendEvents(BMEVENT_CHARGER);
+        SIM_TRY_VERIFY(signalDump.chargerSignals >= count + 1, 3000);
+        QCOMPARE(signalDump.lastCharger, MeeGo::QmBattery::Wall);
+        QCOMPARE(battery->getChargerType(), MeeGo::QmBattery::Wall);
+    }
+
+    void testRepeatedChargerEvent() {
+        /* Every event is reported, also when the type has not changed */
+        int count = signalDump.chargerSignals;
+        simulator->sendEvents(BMEVENT_CHARGER);
+        SIM_TRY_VERIFY(signalDump.chargerSignals >= count + 1, 3000);
+        simulator->sendEvents(BMEVENT_CHARGER);
+        SIM_TRY_VERIFY(signalDump.chargerSignals >= count + 2, 3000);
+        QCOMPARE(signalDump.lastCharger, MeeGo::QmBattery::Wall);
+    }
+
+    void testUsbNegotiation() {
+        int count = signalDump.chargerSignals;
+        int settled = signalDump.settledSignals;
+
+        /* 100 mA is reported at once, but it is not final */
+        simulator->setStat(CHARGER_TYPE, CHARGER_TYPE_USB100MA);
+        simulator->sendEvents(BMEVENT_CHARGER);
+        SIM_TRY_VERIFY(signalDump.chargerSignals >= count + 1, 3000);
+        QCOMPARE(signalDump.lastCharger, MeeGo::QmBattery::USB_100mA);
+        QCOMPARE(signalDump.settledSignals, settled);
+
+        simulator->setStat(CHARGER_TYPE, CHARGER_TYPE_USB500MA);
+        simulator->sendEvents(BMEVENT_CHARGER);
+        SIM_TRY_VERIFY(signalDump.settledSignals >= settled + 1, 3000);
+        QCOMPARE(signalDump.lastCharger, MeeGo::QmBattery::USB_500mA);
+        QCOMPARE(signalDump.lastSettled, MeeGo::QmBattery::USB_500mA);
+        QCOMPARE(signalDump.chargerSignals, count + 2);
+    }
+
+    void testUsbNegotiationTimeout() {
+        simulator->setStat(CHARGER_TYPE, CHARGER_TYPE_NONE);
+        simulator->sendEvents(BMEVENT_CHARGER);
+        int settled = signalDump.settledSignals;
+        SIM_TRY_VERIFY(signalDump.settledSignals >= settled + 1, 3000);
+
+        /* A host that only gives 100 mA settles after the timeout */
+        settled = signalDump.settledSignals;
+        simulator->setStat(CHARGER_TYPE, CHARGER_TYPE_USB100MA);
+        simulator->sendEvents(BMEVENT_CHARGER);
+        SIM_TRY_VERIFY(signalDump.settledSignals >= settled + 1, 6000);
+        QCOMPARE(signalDump.lastSettled, MeeGo::QmBattery::USB_100mA);
+    }
+
+    void testRestart() {
+        int before = battery->getCumulativeBatteryCurrent();
+
+        /* The counter starts from zero when BME restarts */
+        simulator->setStat(COULOMB_COUNTER, 0);
+        simulator->restart();
+        QTest::qWait(100);
+
+        QCOMPARE(battery->getCumulativeBatteryCurrent(), before);
+
+        /* The events are subscribed again */
+        int count = signalDump.capacitySignals;
+        simulator->setStat(BATTERY_LEVEL_PCT, 78);
+        simulator->sendEvents(BMEVENT_BATMON);
+        SIM_TRY_VERIFY(signalDump.capacitySignals >= count + 1, 3000);
+        QCOMPARE(signalDump.lastPct, 78);
+    }
+
+    void testMeasurements() {
+        QVERIFY(battery->startCurrentMeasurement(MeeGo::QmBattery::RATE_250ms));
+        SIM_TRY_VERIFY(signalDump.measurementSignals >= 1, 3000);
+        QVERIFY(battery->stopCurrentMeasurement());
+
+        QVERIFY(!signalDump.lastMeasurements.isEmpty());
+        QCOMPARE(signalDump.lastMeasurements[0].current, 150);
+        QCOMPARE(signalDump.lastMeasurements[0].voltage, 3950);
+    }
+
+    void testConcurrentGetters() {
+        int pct = battery->getRemainingCapacityPct();
+        int cc = simulator->stat(COULOMB_COUNTER);
+        QAtomicInt floor(pct);
+
+        GetterThread *threads[4];
+        for (int i = 0; i < 4; i++) {
+            threads[i] = new GetterThread(battery, floor);
+            threads[i]->start();
+        }
+
+        for (int i = 0; i < 40; i++) {
+            int count = signalDump.capacitySignals;
+            pct--;
+            cc += 1000;
+            simulator->setStat(COULOMB_COUNTER, cc);
+            simulator->setStat(BATTERY_LEVEL_PCT, pct);
+            simulator->sendEvents(BMEVENT_BATMON);
+            SIM_TRY_VERIFY(signalDump.capacitySignals >= count + 1, 3000);
+            QCOMPARE(signalDump.lastPct, pct);
+            floor.fetchAndStoreOrdered(pct);
+            QTest::qWait(5);
+        }
+
+        for (int i = 0; i < 4; i++) {
+            threads[i]->stopping.fetchAndStoreOrdered(1);
+            threads[i]->wait();
+            QVERIFY(threads[i]->reads > 0);
+            QCOMPARE(threads[i]->failures, 0);
+            delete threads[i];
+        }
+        QCOMPARE(battery->getRemainingCapacityPct(), pct);
+    }
+
+    void testRequestRemainingTimes() {
+        QVERIFY(connect(battery, SIGNAL(remainingTimesAvailable(MeeGo::QmBattery::RemainingTimeMode, int, int, int)),
+                        &signalDump, SLOT(slotRemainingTimesAvailable(MeeGo::QmBattery::RemainingTimeMode, int, int, int))));
+
+        /* Computed by the worker, the result comes from the event loop */
+        int count = signalDump.remainingTimesSignals;
+        battery->requestRemainingTimes(MeeGo::QmBattery::NormalMode);
+        QCOMPARE(signalDump.remainingTimesSignals, count);
+        SIM_TRY_VERIFY(signalDump.remainingTimesSignals >= count + 1, 30000);
+        QVERIFY(signalDump.lastTalkTime > 0);
+        QVERIFY(signalDump.lastIdleTime >= signalDump.lastTalkTime);
+        QCOMPARE(signalDump.remainingTimesThread, QThread::currentThread());
+    }
+
+    void benchmarkCachedGetter() {
+        QBENCHMARK {
+            battery->getRemainingCapacityPct();
+        }
+    }
+
+    void benchmarkSnapshot() {
+        QBENCHMARK {
+            battery->snapshot();
+        }
+    }
+
+    void cleanupTestCase() {
+        delete battery;
+        simulator->stop();
+        delete simulator;
+    }
+};
+
+QTEST_MAIN(TestClass)
+#include "battery_sim.moc"
@@ -0,0 +1,181 @@
+/**
+ * @file batterymodel.cpp
+ * @brief QmBatteryModel tests
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include <QDir>
+#include <QFile>
+#include <QObject>
+#include <QTest>
+#include <QTextStream>
+
+#include <unistd.h>
+
+#include "qmbatterymodel_p.h"
+
+using namespace MeeGo;
+
+/* 13.2 mAh for a percent over ten minutes, 79.2 mA */
+#define ACTIVE_CC   47520
+#define ACTIVE_TIME 600
+/* 23.2 mAh for a percent over an hour, 23.2 mA */
+#define IDLE_CC     83520
+#define IDLE_TIME   3600
+
+class TestClass : public QObject
+{
+    Q_OBJECT
+
+private:
+    QString path;
+
+    /* Discharges from 80 % to 78 %, the first drop only sets the reference */
+    void learnActive(QmBatteryModel &model) {
+        model.update(80, 0, 0, true, 1000);
+        model.update(79, 0, ACTIVE_CC, true, 1000 + ACTIVE_TIME);
+        model.update(78, 0, 2 * ACTIVE_CC, true, 1000 + 2 * ACTIVE_TIME);
+    }
+
+private slots:
+    void init() {
+        path = QDir::tempPath() + QString("/battery-model-test-%1").arg(getpid());
+        QFile::remove(path);
+        qputenv("QMSYSTEM_BATTERY_MODEL_FILE", QFile::encodeName(path));
+    }
+
+    void cleanup() {
+        QFile::remove(path);
+    }
+
+    void testUnlearned() {
+        QmBatteryModel model;
+        QCOMPARE(model.averageCurrent(QmBatteryModel::Idle), -1);
+        QCOMPARE(model.averageCurrent(QmBatteryModel::Active), -1);
+        QCOMPARE(model.remainingTime(100), -1);
+
+        QVERIFY(!model.update(80, 0, 0, true, 1000));
+        QCOMPARE(model.remainingTime(100), -1);
+        QVERIFY(!model.takeChanged());
+    }
+
+    void testRemainingCharge() {
+        /* Until a drop has been learned the charge BME estimates is used */
+        QmBatteryModel model;
+        model.update(80, 1056, 0, true, 1000);
+        QCOMPARE(model.remainingTime(100), 1056 * 36);
+        QCOMPARE(model.remainingTime(0), -1);
+    }
+
+    void testLearning() {
+        QmBatteryModel model;
+        learnActive(model);
+        QCOMPARE(model.averageCurrent(QmBatteryModel::Active), 79);
+        QCOMPARE(model.averageCurrent(QmBatteryModel::Idle), -1);
+
+        /* 78 % at 13.2 mAh each */
+        QCOMPARE(model.remainingTime(100), 37065);
+
+        /* Learning only marks the model changed, the owner saves it */
+        QVERIFY(!QFile::exists(path));
+        QVERIFY(model.takeChanged());
+        QVERIFY(!model.takeChanged());
+        QVERIFY(model.save());
+        QVERIFY(QFile::exists(path));
+    }
+
+    void testMovingAverage() {
+        QmBatteryModel model;
+        learnActive(model);
+
+        /* 13.2 + 0.2 * (23.2 - 13.2) mAh for the 70-79 % range */
+        model.update(77, 0, 2 * ACTIVE_CC + IDLE_CC, true, 1000 + 2 * ACTIVE_TIME + IDLE_TIME);
+        QCOMPARE(model.averageCurrent(QmBatteryModel::Idle), 23);
+        QCOMPARE(model.averageCurrent(QmBatteryModel::Active), 79);
+        QCOMPARE(model.remainingTime(100), 42134);
+        QCOMPARE(model.remainingTime(200), 21067);
+    }
+
+    void testCapaDrop() {
+        /* Without a coulomb counter the drop of the BME estimate is learned */
+        QmBatteryModel model;
+        model.update(80, 1056, 0, true, 1000);
+        model.update(79, 1043, 0, true, 1600);
+        model.update(78, 1030, 0, true, 2200);
+        QCOMPARE(model.averageCurrent(QmBatteryModel::Active), 78);
+        QCOMPARE(model.remainingTime(78), 78 * 13 * 3600 / 78);
+    }
+
+    void testUntrusted() {
+        QmBatteryModel model;
+
+        /* Charging and level rises start over */
+        model.update(80, 0, 0, true, 1000);
+        model.update(79, 0, ACTIVE_CC, true, 1600);
+        model.update(78, 0, 2 * ACTIVE_CC, false, 2200);
+        model.update(77, 0, 3 * ACTIVE_CC, true, 2800);
+        QCOMPARE(model.averageCurrent(QmBatteryModel::Active), -1);
+
+        /* A drop of more than five percent at once */
+        model.update(70, 0, 4 * ACTIVE_CC, true, 3400);
+        model.update(60, 0, 14 * ACTIVE_CC, true, 4000);
+        QCOMPARE(model.averageCurrent(QmBatteryModel::Active), -1);
+
+        /* The coulomb counter reset by a BME restart */
+        QVERIFY(!model.update(59, 0, ACTIVE_CC, true, 4600));
+        QVERIFY(!model.update(58, 0, 2 * ACTIVE_CC, true, 5200));
+        QCOMPARE(model.averageCurrent(QmBatteryModel::Active), -1);
+        QCOMPARE(model.remainingTime(100), -1);
+        QVERIFY(!model.takeChanged());
+    }
+
+    void testPersistence() {
+        {
+            QmBatteryModel model;
+            learnActive(model);
+            model.update(77, 0, 2 * ACTIVE_CC + IDLE_CC, true, 1000 + 2 * ACTIVE_TIME + IDLE_TIME);
+            QVERIFY(model.save());
+        }
+
+        QmBatteryModel model;
+        QCOMPARE(model.averageCurrent(QmBatteryModel::Idle), 23);
+        QCOMPARE(model.averageCurrent(QmBatteryModel::Active), 79);
+
+        /* The level is not saved, the curve is */
+        QCOMPARE(model.remainingTime(100), -1);
+        model.update(77, 0, 0, true, 1000);
+        QCOMPARE(model.remainingTime(100), 42134);
+    }
+
+    void testInvalidFile() {
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+        QTextStream(&file) << "2 1 2 3\n";
+        file.close();
+
+        QmBatteryModel model;
+        QCOMPARE(model.averageCurrent(QmBatteryModel::Active), -1);
+        model.update(77, 0, 0, true, 1000);
+        QCOMPARE(model.remainingTime(100), -1);
+    }
+};
+
+QTEST_MAIN(TestClass)
+#include "batterymodel.moc"
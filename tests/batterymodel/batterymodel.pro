@@ -0,0 +1,5 @@
+QT -= gui
+SOURCES += batterymodel.cpp
+
+TARGET = batterymodel-test
+include(../common-install.pri)
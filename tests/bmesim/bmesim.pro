@@ -0,0 +1,15 @@
+QT -= gui
+CONFIG += link_pkgconfig
+PKGCONFIG += bmeipc
+QMAKE_CXXFLAGS += -Wall -Wno-psabi
+
+INCLUDEPATH += ../../system ../../../system
+HEADERS += bmesimulator.h
+SOURCES += main.cpp \
+           bmesimulator.cpp
+LIBS += -lrt
+
+include(../common/simserver.pri)
+
+TEMPLATE = app
+TARGET = qmbmesim
@@ -0,0 +1,605 @@
+/*!
+ * @file bmesimulator.cpp
+ * @brief BmeSimulator
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#include "bmesimulator.h"
+#include "qmbmetransport_p.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QRegExp>
+#include <QStringList>
+#include <QTextStream>
+
+extern "C" {
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "bme/bmemsg.h"
+#include "bme/em_isi.h"
+}
+
+#define MAX_REQUEST    4096 /* bytes */
+#define MAX_SAMPLES      10 /* measurement queue length */
+
+using namespace MeeGo;
+
+static const struct {
+    const char *key;
+    int index;
+} statKeys[] = {
+    { "pct",       BATTERY_LEVEL_PCT },
+    { "bars",      BATTERY_LEVEL_NOW },
+    { "maxbars",   BATTERY_LEVEL_MAX },
+    { "capa",      BATTERY_CAPA_NOW },
+    { "capamax",   BATTERY_CAPA_MAX },
+    { "volt",      BATTERY_VOLT_NOW },
+    { "current",   BATTERY_CURRENT },
+    { "cc",        COULOMB_COUNTER },
+    { "time",      CHARGING_TIME },
+    { "condition", BATTERY_CONDITION },
+    { "state",     BATTERY_STATE },
+    { "charger",   CHARGER_TYPE },
+    { "charging",  CHARGING_STATE },
+};
+
+static const struct {
+    const char *key;
+    const char *name;
+    int value;
+} statNames[] = {
+    { "state",     "empty",   BATTERY_STATE_EMPTY },
+    { "state",     "low",     BATTERY_STATE_LOW },
+    { "state",     "ok",      BATTERY_STATE_OK },
+    { "state",     "full",    BATTERY_STATE_FULL },
+    { "state",     "error",   BATTERY_STATE_ERROR },
+    { "charger",   "none",    CHARGER_TYPE_NONE },
+    { "charger",   "wall",    CHARGER_TYPE_USBWALL },
+    { "charger",   "usb100",  CHARGER_TYPE_USB100MA },
+    { "charger",   "usb500",  CHARGER_TYPE_USB500MA },
+    { "charger",   "dynamo",  CHARGER_TYPE_DYNAMO },
+    { "charger",   "error",   CHARGER_TYPE_ERROR },
+    { "charging",  "started", CHARGING_STATE_STARTED },
+    { "charging",  "stopped", CHARGING_STATE_STOPPED },
+    { "charging",  "error",   CHARGING_STATE_ERROR },
+    { "condition", "good",    BATTERY_CONDITION_GOOD },
+    { "condition", "poor",    BATTERY_CONDITION_POOR },
+};
+
+static const struct {
+    const char *name;
+    int event;
+} eventNames[] = {
+    { "charger", BMEVENT_CHARGER },
+    { "charge",  BMEVENT_CHARGE },
+    { "batmon",  BMEVENT_BATMON },
+};
+
+#define ELEMENTS(a) (int)(sizeof(a) / sizeof(a[0]))
+
+/* Any state but off or error carries a sample */
+static int measuringState()
+{
+    int state = 0;
+    while (state == MEASUREMENTS_OFF || state == MEASUREMENTS_ERROR)
+        state++;
+    return state;
+}
+
+BmeSimulator::BmeSimulator(const QString &dir, QObject *parent)
+    : SimServer(dir, parent),
+      speed_(1.0),
+      traceStart_(-1),
+      ipcListener_(-1),
+      eventListener_(-1),
+      temperature_(300),
+      pendingEvents_(0),
+      pendingRestart_(false),
+      statQueries_(0),
+      nextStep_(0),
+      expectedElements_(0),
+      measuring_(false),
+      clockSampling_(true),
+      samplePeriod_(1000),
+      nextSample_(0),
+      mq_((mqd_t)-1)
+{
+    /* A full battery, no charger */
+    memset(&stat_, 0, sizeof(stat_));
+    stat_[BATTERY_LEVEL_PCT] = 100;
+    stat_[BATTERY_LEVEL_NOW] = 8;
+    stat_[BATTERY_LEVEL_MAX] = 8;
+    stat_[BATTERY_CAPA_MAX] = 1320;
+    stat_[BATTERY_CAPA_NOW] = 1320;
+    stat_[BATTERY_VOLT_NOW] = 4100;
+    stat_[BATTERY_CURRENT] = 100;
+    stat_[BATTERY_STATE] = BATTERY_STATE_FULL;
+    stat_[BATTERY_CONDITION] = BATTERY_CONDITION_GOOD;
+    stat_[CHARGER_TYPE] = CHARGER_TYPE_NONE;
+    stat_[CHARGING_STATE] = CHARGING_STATE_STOPPED;
+}
+
+BmeSimulator::~BmeSimulator()
+{
+    stop();
+}
+
+bool BmeSimulator::parseStep_(const QString &line, Step &step)
+{
+    QStringList tokens = line.split(QRegExp("\\s+"), QString::SkipEmptyParts);
+    if (tokens.isEmpty())
+        return false;
+
+    bool ok;
+    step.time = (qint64)(tokens.takeFirst().toDouble(&ok) * 1000);
+    if (!ok)
+        return false;
+    step.events = 0;
+    step.restart = false;
+    step.temperature = -1;
+
+    foreach (const QString &token, tokens) {
+        if (token == "restart") {
+            step.restart = true;
+            continue;
+        }
+
+        QString key = token.section('=', 0, 0);
+        QString value = token.section('=', 1);
+
+        if (key == "event") {
+            foreach (const QString &name, value.split(',')) {
+                int i;
+                for (i = 0; i < ELEMENTS(eventNames); i++) {
+                    if (name == eventNames[i].name) {
+                        step.events |= eventNames[i].event;
+                        break;
+                    }
+                }
+                if (i == ELEMENTS(eventNames))
+                    return false;
+            }
+            continue;
+        }
+
+        int number = value.toInt(&ok);
+        for (int i = 0; !ok && i < ELEMENTS(statNames); i++) {
+            if (key == statNames[i].key && value == statNames[i].name) {
+                number = statNames[i].value;
+                ok = true;
+            }
+        }
+        if (!ok)
+            return false;
+
+        if (key == "temp") {
+            step.temperature = number;
+            continue;
+        }
+
+        int i;
+        for (i = 0; i < ELEMENTS(statKeys); i++) {
+            if (key == statKeys[i].key) {
+                step.stats.append(qMakePair(statKeys[i].index, number));
+                break;
+            }
+        }
+        if (i == ELEMENTS(statKeys))
+            return false;
+    }
+    return true;
+}
+
+bool BmeSimulator::setTrace(const QString &trace)
+{
+    QList<Step> steps;
+    int number = 0;
+    foreach (QString line, trace.split('\n')) {
+        number++;
+        line = line.section('#', 0, 0).trimmed();
+        if (line.isEmpty())
+            continue;
+
+        Step step;
+        if (!parseStep_(line, step)) {
+            qWarning() << "BmeSimulator: bad trace line" << number << line;
+            return false;
+        }
+        steps.append(step);
+    }
+
+    QMutexLocker locker(&mutex_);
+    trace_ = steps;
+    nextStep_ = 0;
+    return true;
+}
+
+bool BmeSimulator::loadTrace(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << "BmeSimulator: cannot read" << path;
+        return false;
+    }
+    return setTrace(QTextStream(&file).readAll());
+}
+
+void BmeSimulator::setSpeed(double speed)
+{
+    QMutexLocker locker(&mutex_);
+    speed_ = speed > 0.0 ? speed : 1.0;
+}
+
+bool BmeSimulator::listen_()
+{
+    if (!QDir().mkpath(path())) {
+        qWarning() << "BmeSimulator: cannot create" << path();
+        return false;
+    }
+
+    ipcListener_ = listenOn(path() + "/" BMESIM_IPC_SOCKET);
+    eventListener_ = listenOn(path() + "/" BMESIM_EVENT_SOCKET);
+    if (ipcListener_ < 0 || eventListener_ < 0)
+        return false;
+
+    /*
+     * The queue exists for the lifetime of the simulator, so that clients
+     * can open it as soon as their start request has been sent.
+     */
+    QByteArray name = qmBmeSimQueueName(path()).toLocal8Bit();
+    struct mq_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.mq_maxmsg = MAX_SAMPLES;
+    attr.mq_msgsize = sizeof(bmeipc_meas_t);
+    mq_unlink(name.constData());
+    mq_ = mq_open(name.constData(), O_RDWR | O_CREAT | O_NONBLOCK, 0600, &attr);
+    if (mq_ == (mqd_t)-1) {
+        qWarning() << "BmeSimulator: cannot create the measurement queue" << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+void BmeSimulator::stop()
+{
+    SimServer::stop();
+
+    ipcListener_ = eventListener_ = -1;
+    if (mq_ != (mqd_t)-1) {
+        mq_close(mq_);
+        mq_unlink(qmBmeSimQueueName(path()).toLocal8Bit().constData());
+        mq_ = (mqd_t)-1;
+    }
+}
+
+int BmeSimulator::stat(int index) const
+{
+    QMutexLocker locker(&mutex_);
+    return stat_[index];
+}
+
+void BmeSimulator::setStat(int index, int value)
+{
+    QMutexLocker locker(&mutex_);
+    stat_[index] = value;
+}
+
+void BmeSimulator::sendEvents(int events)
+{
+    QMutexLocker locker(&mutex_);
+    pendingEvents_ |= events;
+    wake_();
+}
+
+void BmeSimulator::restart()
+{
+    QMutexLocker locker(&mutex_);
+    pendingRestart_ = true;
+    wake_();
+}
+
+void BmeSimulator::setClockSampling(bool enabled)
+{
+    QMutexLocker locker(&mutex_);
+    clockSampling_ = enabled;
+    wake_();
+}
+
+bool BmeSimulator::isMeasuring() const
+{
+    QMutexLocker locker(&mutex_);
+    return measuring_;
+}
+
+bool BmeSimulator::sendSample(qint64 timestamp, int current, int voltage)
+{
+    struct timeval tv;
+    tv.tv_sec = timestamp / 1000000;
+    tv.tv_usec = timestamp % 1000000;
+
+    QMutexLocker locker(&mutex_);
+    if (!measuring_)
+        return false;
+    return queueSample_(tv, current, voltage, temperature_);
+}
+
+int BmeSimulator::statQueries() const
+{
+    QMutexLocker locker(&mutex_);
+    return statQueries_;
+}
+
+bool BmeSimulator::traceDone() const
+{
+    QMutexLocker locker(&mutex_);
+    return nextStep_ >= trace_.size();
+}
+
+void BmeSimulator::apply_(const Step &step)
+{
+    typedef QPair<int, int> Stat;
+    foreach (const Stat &stat, step.stats)
+        stat_[stat.first] = stat.second;
+    if (step.temperature >= 0)
+        temperature_ = step.temperature;
+    if (step.restart)
+        pendingRestart_ = true;
+    pendingEvents_ |= step.events;
+}
+
+int BmeSimulator::idle_()
+{
+    int events;
+    bool restart;
+    bool clockSampling;
+    int timeout = -1;
+    {
+        QMutexLocker locker(&mutex_);
+        if (traceStart_ < 0)
+            traceStart_ = monotonicMs();
+
+        qint64 elapsed = (qint64)((monotonicMs() - traceStart_) * speed_);
+        while (nextStep_ < trace_.size() && trace_[nextStep_].time <= elapsed)
+            apply_(trace_[nextStep_++]);
+        if (nextStep_ < trace_.size())
+            timeout = (int)((trace_[nextStep_].time - elapsed) / speed_) + 1;
+
+        events = pendingEvents_;
+        restart = pendingRestart_;
+        clockSampling = clockSampling_;
+        pendingEvents_ = 0;
+        pendingRestart_ = false;
+    }
+
+    if (restart) {
+        qDebug() << "BmeSimulator: restart";
+        dropClients_();
+    }
+    if (events)
+        notify_(events);
+
+    if (measuring_ && clockSampling) {
+        qint64 now = monotonicMs();
+        if (now >= nextSample_) {
+            sample_();
+            nextSample_ += samplePeriod_;
+            if (nextSample_ <= now)
+                nextSample_ = now + samplePeriod_;
+        }
+        int wait = (int)(nextSample_ - now);
+        if (timeout < 0 || wait < timeout)
+            timeout = wait;
+    }
+    return timeout;
+}
+
+QList<int> BmeSimulator::polledClients_() const
+{
+    return ipcClients_ + eventClients_;
+}
+
+bool BmeSimulator::accepted_(int listener, int sd)
+{
+    if (listener == eventListener_) {
+        qint32 mask;
+        if (!readAll(sd, &mask, sizeof(mask)))
+            return false;
+        eventClients_.append(sd);
+        eventMasks_.append(mask);
+    } else {
+        ipcClients_.append(sd);
+    }
+    return true;
+}
+
+void BmeSimulator::forget_(int sd)
+{
+    int index = eventClients_.indexOf(sd);
+    if (index >= 0) {
+        eventClients_.removeAt(index);
+        eventMasks_.removeAt(index);
+    }
+    ipcClients_.removeAll(sd);
+}
+
+bool BmeSimulator::serve_(int sd)
+{
+    /* Subscribers only send their mask, anything else is a hangup */
+    if (eventClients_.contains(sd))
+        return false;
+
+    QmBmeSimHeader header;
+    if (!readAll(sd, &header, sizeof(header)))
+        return false;
+    if (header.length <= 0 || header.length > MAX_REQUEST || header.replyLength < 0) {
+        qWarning() << "BmeSimulator: bad request header";
+        return false;
+    }
+
+    QByteArray msg(header.length, 0);
+    if (!readAll(sd, msg.data(), msg.size()))
+        return false;
+
+    int status = 0;
+    QByteArray reply;
+    request_(msg.constData(), msg.size(), status, reply);
+
+    if (header.replyLength == 0)
+        return true;
+    if (status < 0)
+        return reply_(sd, status, 0, 0);
+
+    /* Replies are exactly as long as the client expects */
+    reply.append(QByteArray(qMax(0, header.replyLength - reply.size()), 0));
+    return reply_(sd, 0, reply.constData(), header.replyLength);
+}
+
+bool BmeSimulator::reply_(int sd, qint32 status, const void *data, int len)
+{
+    return writeAll(sd, &status, sizeof(status)) && writeAll(sd, data, len);
+}
+
+void BmeSimulator::request_(const void *msg, int len, int &status, QByteArray &reply)
+{
+    QMutexLocker locker(&mutex_);
+
+    if (expectedElements_ > 0) {
+        struct emsg_measurement_req_elem elem;
+        memset(&elem, 0, sizeof(elem));
+        memcpy(&elem, msg, qMin(len, (int)sizeof(elem)));
+        expectedElements_--;
+        if (elem.type == EM_MEASUREMENT_TYPE_CURRENT)
+            startMeasurement_(elem.period);
+        return;
+    }
+
+    bmeipc_msg_t header;
+    if (len < (int)sizeof(header)) {
+        status = -EINVAL;
+        return;
+    }
+    memcpy(&header, msg, sizeof(header));
+
+    if (header.type == BME_SYSMSG_GETSTAT) {
+        statQueries_++;
+        reply = QByteArray((const char *)&stat_, sizeof(stat_));
+    } else if (header.type == EM_BATTERY_USETIME_REQ) {
+        union emsg_usetime_info info;
+        memset(&info, 0, sizeof(info));
+        memcpy(&info, msg, qMin(len, (int)sizeof(info)));
+        int current = info.request.current;
+
+        memset(&info, 0, sizeof(info));
+        if (current > 0)
+            info.reply.time = stat_[BATTERY_CAPA_NOW] * 3600 / current;
+        reply = QByteArray((const char *)&info, sizeof(info));
+    } else if (header.type == EM_MEASUREMENT_REQ) {
+        struct emsg_measurement_req req;
+        memset(&req, 0, sizeof(req));
+        memcpy(&req, msg, qMin(len, (int)sizeof(req)));
+        if (req.measurement_action == EM_MEASUREMENT_ACTION_START)
+            expectedElements_ = req.channel_count;
+        else
+            stopMeasurement_();
+    } else {
+        qWarning() << "BmeSimulator: unsupported message" << header.type;
+        status = -ENOSYS;
+    }
+}
+
+void BmeSimulator::startMeasurement_(int period)
+{
+    if (period == EM_MEASUREMENT_PERIOD_250MS)
+        samplePeriod_ = 250;
+    else if (period == EM_MEASUREMENT_PERIOD_5S)
+        samplePeriod_ = 5000;
+    else
+        samplePeriod_ = 1000;
+
+    /* Samples left over from a previous client */
+    bmeipc_meas_t msg;
+    while (mq_receive(mq_, (char *)&msg, sizeof(msg), 0) >= 0)
+        ;
+
+    measuring_ = true;
+    nextSample_ = monotonicMs() + samplePeriod_;
+    wake_();
+}
+
+void BmeSimulator::stopMeasurement_()
+{
+    measuring_ = false;
+}
+
+void BmeSimulator::sample_()
+{
+    struct timeval now;
+    gettimeofday(&now, 0);
+
+    QMutexLocker locker(&mutex_);
+    queueSample_(now, stat_[BATTERY_CURRENT], stat_[BATTERY_VOLT_NOW], temperature_);
+}
+
+bool BmeSimulator::queueSample_(const struct timeval &timestamp, int current, int voltage, int temperature)
+{
+    bmeipc_meas_t msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.timestamp = timestamp;
+    msg.state = measuringState();
+    msg.bat_current = current;
+    msg.bat_voltage = voltage;
+    msg.bat_temp = temperature;
+
+    /* A full queue drops samples, as BME does when nobody reads */
+    return mq_send(mq_, (const char *)&msg, sizeof(msg), 0) == 0;
+}
+
+void BmeSimulator::notify_(int events)
+{
+    QList<int> lost;
+    for (int i = 0; i < eventClients_.size(); i++) {
+        qint32 bits = events & eventMasks_[i];
+        if (bits && !writeAll(eventClients_[i], &bits, sizeof(bits)))
+            lost.append(eventClients_[i]);
+    }
+    foreach (int sd, lost) {
+        int index = eventClients_.indexOf(sd);
+        eventClients_.removeAt(index);
+        eventMasks_.removeAt(index);
+        close(sd);
+    }
+}
+
+void BmeSimulator::dropClients_()
+{
+    foreach (int sd, ipcClients_)
+        close(sd);
+    foreach (int sd, eventClients_)
+        close(sd);
+    ipcClients_.clear();
+    eventClients_.clear();
+    eventMasks_.clear();
+    expectedElements_ = 0;
+    measuring_ = false;
+}
@@ -0,0 +1,157 @@
+/*!
+ * @file bmesimulator.h
+ * @brief Contains BmeSimulator, a stand-in for the BME server
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#ifndef BMESIMULATOR_H
+#define BMESIMULATOR_H
+
+#include <QList>
+#include <QPair>
+#include <QString>
+
+#include <mqueue.h>
+#include <sys/time.h>
+
+extern "C" {
+#include "bme/bmeipc.h"
+}
+
+#include "simserver.h"
+
+/**
+ * Serves the bmeipc messages QmBattery sends over the UNIX sockets and the
+ * measurement queue of the QmBmeTransport simulator protocol, in its own
+ * thread, and replays a scripted trace of battery status changes.
+ *
+ * A trace has one step per line, the time of the step in seconds followed
+ * by key=value pairs. '#' starts a comment.
+ *
+ * @code
+ * # time  changes
+ * 0      pct=80 bars=6 maxbars=8 volt=3900 current=150 cc=0 state=ok
+ * 30     pct=79 cc=4500 event=batmon
+ * 60     charger=usb500 charging=started event=charger,charge
+ * 90     restart cc=0
+ * @endcode
+ *
+ * The stat keys are pct, bars, maxbars, capa, capamax, volt, current, cc,
+ * time (charging time), condition, state (empty, low, ok, full, error),
+ * charger (none, wall, usb100, usb500, dynamo, error) and charging (started,
+ * stopped, error). temp sets the temperature of the measurement samples (K).
+ * event lists the events sent to the subscribers: charger, charge, batmon.
+ * restart drops all the connections, as BME does when it restarts.
+ */
+class BmeSimulator : public SimServer
+{
+    Q_OBJECT
+
+public:
+    BmeSimulator(const QString &dir, QObject *parent = 0);
+    ~BmeSimulator();
+
+    /* Trace parsing, before start() */
+    bool setTrace(const QString &trace);
+    bool loadTrace(const QString &path);
+
+    /* Playback speed, 10.0 replays a minute of the trace in six seconds */
+    void setSpeed(double speed);
+
+    /* Also removes the measurement queue */
+    void stop();
+
+    /* Status and events, may be called while running */
+    int stat(int index) const;
+    void setStat(int index, int value);
+    void sendEvents(int events);
+    void restart();
+
+    /*
+     * Measurement samples are queued at the requested period, with the
+     * current and voltage stats. Without the clock pacing them, only the
+     * samples of sendSample() are queued, with their own timestamp (us).
+     */
+    void setClockSampling(bool enabled);
+    bool isMeasuring() const;
+    bool sendSample(qint64 timestamp, int current, int voltage);
+
+    /* Number of BME_SYSMSG_GETSTAT queries served */
+    int statQueries() const;
+
+    /* True when every step of the trace has been replayed */
+    bool traceDone() const;
+
+protected:
+    bool listen_();
+    int idle_();
+    QList<int> polledClients_() const;
+    bool accepted_(int listener, int sd);
+    bool serve_(int sd);
+    void forget_(int sd);
+    void dropClients_();
+
+private:
+    struct Step
+    {
+        qint64 time;                    /* ms */
+        QList<QPair<int, int> > stats;
+        int events;
+        bool restart;
+        int temperature;                /* K, -1 if not changed */
+    };
+
+    bool parseStep_(const QString &line, Step &step);
+    void apply_(const Step &step);
+
+    bool reply_(int sd, qint32 status, const void *data, int len);
+    void request_(const void *msg, int len, int &status, QByteArray &reply);
+    void startMeasurement_(int period);
+    void stopMeasurement_();
+    void sample_();
+    bool queueSample_(const struct timeval &timestamp, int current, int voltage, int temperature);
+    void notify_(int events);
+
+    QList<Step> trace_;
+    double speed_;
+    qint64 traceStart_;      /* ms, monotonic, -1 until the thread runs */
+
+    int ipcListener_;
+    int eventListener_;
+    QList<int> ipcClients_;
+    QList<int> eventClients_;
+    QList<int> eventMasks_;
+
+    bmestat_t stat_;
+    int temperature_;
+    int pendingEvents_;
+    bool pendingRestart_;
+    int statQueries_;
+    int nextStep_;
+
+    /* Measurement request in progress, followed by its channel elements */
+    int expectedElements_;
+    bool measuring_;
+    bool clockSampling_;
+    qint64 samplePeriod_;    /* ms */
+    qint64 nextSample_;      /* ms, monotonic */
+    mqd_t mq_;
+};
+
+#endif // BMESIMULATOR_H
@@ -0,0 +1,63 @@
+/*!
+ * @file main.cpp
+ * @brief qmbmesim, the BME simulator for running QmBattery on a host
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+
+#include "bmesimulator.h"
+
+static int usage()
+{
+    QTextStream(stderr)
+        << "Usage: qmbmesim [-s speed] <directory> [trace]\n"
+        << "Serves QmBattery clients started with QMSYSTEM_BME_SIMULATOR=<directory>\n";
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments().mid(1);
+
+    double speed = 1.0;
+    if (args.size() >= 2 && args[0] == "-s") {
+        bool ok;
+        speed = args[1].toDouble(&ok);
+        if (!ok || speed <= 0.0)
+            return usage();
+        args = args.mid(2);
+    }
+    if (args.isEmpty() || args.size() > 2)
+        return usage();
+
+    BmeSimulator simulator(args[0]);
+    simulator.setSpeed(speed);
+    if (args.size() == 2 && !simulator.loadTrace(args[1]))
+        return 1;
+    if (!simulator.listen())
+        return 1;
+
+    /* Serves until killed */
+    simulator.start();
+    return app.exec();
+}
@@ -38,6 +38,14 @@ class TestClass : public QObject
 
 private:
     MeeGo::QmCABC *cabc;
+    MeeGo::QmCABC::Mode receivedMode;
+    int receivedCount;
+
+public slots:
+    void modeReceived(MeeGo::QmCABC::Mode mode) {
+        receivedMode = mode;
+        receivedCount++;
+    }
 
 private slots:
 
@@ -121,6 +129,37 @@ private slots:
         QCOMPARE(MeeGo::QmCABC::MovingImage, mode);
     }
 
+    void testGetAsync() {
+        if (!cabc) {
+            qDebug() << "testGetAsync skipped";
+            return;
+        }
+
+        QVERIFY(connect(cabc, SIGNAL(modeReceived(MeeGo::QmCABC::Mode)),
+                        this, SLOT(modeReceived(MeeGo::QmCABC::Mode))));
+
+        receivedCount = 0;
+        cabc->getAsync();
+        QCOMPARE(receivedCount, 0);
+
+        QTest::qWait(500);
+        QCOMPARE(receivedCount, 1);
+        QCOMPARE(receivedMode, cabc->get());
+    }
+
+    void testGetAsyncDeleted() {
+        /* A pending call goes with its QmCABC */
+        MeeGo::QmCABC *other = new MeeGo::QmCABC();
+        QVERIFY(connect(other, SIGNAL(modeReceived(MeeGo::QmCABC::Mode)),
+                        this, SLOT(modeReceived(MeeGo::QmCABC::Mode))));
+        receivedCount = 0;
+        other->getAsync();
+        delete other;
+
+        QTest::qWait(500);
+        QCOMPARE(receivedCount, 0);
+    }
+
     void cleanupTestCase() {
         if (cabc) {
             delete cabc, cabc = 0;
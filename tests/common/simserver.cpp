@@ -0,0 +1,236 @@
+/*!
+ * @file simserver.cpp
+ * @brief SimServer
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#include "simserver.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QVector>
+
+extern "C" {
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+}
+
+#define CLIENT_TIMEOUT 1000 /* ms, to receive the rest of a message */
+
+SimServer::SimServer(const QString &path, QObject *parent)
+    : QThread(parent),
+      path_(path),
+      stopping_(false)
+{
+    wakePipe_[0] = wakePipe_[1] = -1;
+}
+
+SimServer::~SimServer()
+{
+    /* The hooks are gone by now, the simulators have stopped already */
+    Q_ASSERT(!isRunning());
+}
+
+QString SimServer::path() const
+{
+    return path_;
+}
+
+qint64 SimServer::monotonicMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (qint64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+bool SimServer::readAll(int sd, void *data, int len)
+{
+    char *p = (char *)data;
+    while (len > 0) {
+        struct pollfd pfd = { sd, POLLIN, 0 };
+        if (poll(&pfd, 1, CLIENT_TIMEOUT) <= 0)
+            return false;
+        ssize_t n = recv(sd, p, len, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool SimServer::writeAll(int sd, const void *data, int len)
+{
+    const char *p = (const char *)data;
+    while (len > 0) {
+        ssize_t n = send(sd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+QString SimServer::tempPath(const QString &name)
+{
+    return QDir::tempPath() + QString("/qm%1-%2").arg(name).arg(getpid());
+}
+
+int SimServer::listenOn(const QString &path)
+{
+    QByteArray name = QFile::encodeName(path);
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (name.size() >= (int)sizeof(addr.sun_path)) {
+        qWarning() << metaObject()->className() << "path too long" << path;
+        return -1;
+    }
+    strcpy(addr.sun_path, name.constData());
+    unlink(name.constData());
+
+    int sd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sd < 0)
+        return -1;
+    if (bind(sd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || ::listen(sd, 8) < 0) {
+        qWarning() << metaObject()->className() << "cannot listen on" << path << strerror(errno);
+        close(sd);
+        return -1;
+    }
+    listeners_.append(sd);
+    socketPaths_.append(path);
+    return sd;
+}
+
+bool SimServer::listen()
+{
+    if (pipe(wakePipe_) < 0)
+        return false;
+    fcntl(wakePipe_[0], F_SETFL, O_NONBLOCK);
+    fcntl(wakePipe_[1], F_SETFL, O_NONBLOCK);
+    return listen_();
+}
+
+bool SimServer::serve(const char *env)
+{
+    if (env)
+        qputenv(env, QFile::encodeName(path_));
+    if (!listen())
+        return false;
+    start();
+    return true;
+}
+
+void SimServer::stop()
+{
+    {
+        QMutexLocker locker(&mutex_);
+        stopping_ = true;
+        wake_();
+    }
+    wait();
+
+    dropClients_();
+    foreach (int sd, listeners_)
+        close(sd);
+    foreach (const QString &path, socketPaths_)
+        unlink(QFile::encodeName(path).constData());
+    listeners_.clear();
+    socketPaths_.clear();
+    for (int i = 0; i < 2; i++) {
+        if (wakePipe_[i] >= 0)
+            close(wakePipe_[i]);
+        wakePipe_[i] = -1;
+    }
+}
+
+void SimServer::wake_()
+{
+    if (wakePipe_[1] >= 0) {
+        char c = 0;
+        if (write(wakePipe_[1], &c, 1) < 0) {
+            /* Full, the thread wakes up anyway */
+        }
+    }
+}
+
+void SimServer::run()
+{
+    while (true) {
+        {
+            QMutexLocker locker(&mutex_);
+            if (stopping_)
+                break;
+        }
+
+        int timeout = idle_();
+
+        /* accepted_() adds to the clients, poll them as they are now */
+        QList<int> clients = polledClients_();
+        QVector<struct pollfd> fds;
+        struct pollfd pfd = { wakePipe_[0], POLLIN, 0 };
+        fds.append(pfd);
+        foreach (int sd, listeners_) {
+            pfd.fd = sd;
+            fds.append(pfd);
+        }
+        foreach (int sd, clients) {
+            pfd.fd = sd;
+            fds.append(pfd);
+        }
+
+        if (poll(fds.data(), fds.size(), timeout) <= 0)
+            continue;
+
+        if (fds[0].revents) {
+            char buf[64];
+            while (read(wakePipe_[0], buf, sizeof(buf)) > 0)
+                ;
+        }
+
+        /* Serve the clients before accepting, which adds */
+        int first = 1 + listeners_.size();
+        for (int i = 0; i < clients.size(); i++) {
+            if (fds[first + i].revents && !serve_(clients[i])) {
+                close(clients[i]);
+                forget_(clients[i]);
+            }
+        }
+        for (int i = 0; i < listeners_.size(); i++) {
+            if (!fds[1 + i].revents)
+                continue;
+            int sd = accept(listeners_[i], 0, 0);
+            if (sd >= 0 && !accepted_(listeners_[i], sd))
+                close(sd);
+        }
+    }
+}
@@ -0,0 +1,123 @@
+/*!
+ * @file simserver.h
+ * @brief Contains SimServer, the base of the daemon simulators of the tests
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#ifndef SIMSERVER_H
+#define SIMSERVER_H
+
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+
+/**
+ * Serves clients on UNIX sockets in its own thread, polling the listeners,
+ * the clients and a pipe that wakes it up when another thread changes the
+ * state of the simulator.
+ *
+ * A simulator creates its listeners in listen_(), does its timed work in
+ * idle_(), and keeps its clients: accepted_() adds one, serve_() reads it
+ * and forget_() drops one the server has closed. The hooks run in the
+ * thread of the server, which holds no lock while calling them; mutex_
+ * guards what the other threads share with it.
+ *
+ * The hooks are called until stop(), which the simulators call in their
+ * destructor, before their members go away.
+ */
+class SimServer : public QThread
+{
+    Q_OBJECT
+
+public:
+    SimServer(const QString &path, QObject *parent = 0);
+    ~SimServer();
+
+    /* The socket, or the directory of the sockets */
+    QString path() const;
+
+    /* Creates the sockets, the clients can connect after this */
+    bool listen();
+
+    /* Sets the variable, if any, to path(), listens and starts the thread */
+    bool serve(const char *env = 0);
+
+    /* Stops the thread, closes the clients and removes the sockets */
+    virtual void stop();
+
+    static qint64 monotonicMs();
+
+    /* Whole messages, the rest of a message is waited for a while */
+    static bool readAll(int sd, void *data, int len);
+    static bool writeAll(int sd, const void *data, int len);
+
+    /* A path in the temporary directory, unique to the process */
+    static QString tempPath(const QString &name);
+
+protected:
+    void run();
+
+    /* Adds a listener at the path, -1 if it cannot be created */
+    int listenOn(const QString &path);
+
+    /* Makes the thread call idle_() again */
+    void wake_();
+
+    /* Creates the listeners with listenOn() */
+    virtual bool listen_() = 0;
+
+    /* Does the work due, returns the time in ms until the next, or -1 */
+    virtual int idle_() = 0;
+
+    /* The clients to read, as they are now */
+    virtual QList<int> polledClients_() const = 0;
+
+    /* Takes a connection of the listener, false to close it */
+    virtual bool accepted_(int listener, int sd) = 0;
+
+    /* Reads a client, false to close it */
+    virtual bool serve_(int sd) = 0;
+
+    /* Drops a client closed by the server */
+    virtual void forget_(int sd) = 0;
+
+    /* Closes and drops all the clients */
+    virtual void dropClients_() = 0;
+
+    mutable QMutex mutex_;
+
+private:
+    QString path_;
+    QList<int> listeners_;
+    QStringList socketPaths_;
+    int wakePipe_[2];
+    bool stopping_;
+};
+
+/* QVERIFY(expr), once expr is true or timeout ms have passed in the event loop */
+#define SIM_TRY_VERIFY(expr, timeout) \
+    do { \
+        for (int simWaited_ = 0; !(expr) && simWaited_ < (timeout); simWaited_ += 10) \
+            QTest::qWait(10); \
+        QVERIFY(expr); \
+    } while (0)
+
+#endif // SIMSERVER_H
@@ -0,0 +1,4 @@
+# The base of the daemon simulators, see simserver.h
+INCLUDEPATH += $$PWD
+HEADERS += $$PWD/simserver.h
+SOURCES += $$PWD/simserver.cpp
@@ -121,6 +121,25 @@ private slots:
         QTest::qWait(WAIT_TIME_MS * 2);
     }
 
+    void testCachedGet() {
+        MeeGo::QmDisplayState cached;
+        cached.setCached(true);
+
+        /* Let the prefetch complete */
+        QTest::qWait(WAIT_TIME_MS);
+        QCOMPARE(cached.get(), displaystate->get());
+
+        setDisplayState(MeeGo::QmDisplayState::On);
+        QCOMPARE(cached.get(), MeeGo::QmDisplayState::On);
+
+        setDisplayState(MeeGo::QmDisplayState::Dimmed);
+        QCOMPARE(cached.get(), MeeGo::QmDisplayState::Dimmed);
+
+        cached.setCached(false);
+        setDisplayState(MeeGo::QmDisplayState::On);
+        QCOMPARE(cached.get(), MeeGo::QmDisplayState::On);
+    }
+
     void testSetBlankingPause() {
         bool result = displaystate->setBlankingPause();
         QVERIFY(result == true);
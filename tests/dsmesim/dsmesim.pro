@@ -0,0 +1,14 @@
+QT -= gui
+CONFIG += link_pkgconfig
+PKGCONFIG += dsme
+QMAKE_CXXFLAGS += -Wall -Wno-psabi
+
+HEADERS += dsmesimulator.h
+SOURCES += main.cpp \
+           dsmesimulator.cpp
+LIBS += -lrt
+
+include(../common/simserver.pri)
+
+TEMPLATE = app
+TARGET = qmdsmesim
@@ -0,0 +1,233 @@
+/*!
+ * @file dsmesimulator.cpp
+ * @brief DsmeSimulator
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#include "dsmesimulator.h"
+
+#include <QDebug>
+
+#include <dsme/processwd.h>
+#include <dsme/protocol.h>
+
+extern "C" {
+#include <stdlib.h>
+#include <unistd.h>
+}
+
+#define MAX_MESSAGE 4096
+
+DsmeSimulator::DsmeSimulator(const QString &path, int pingInterval, QObject *parent)
+    : SimServer(path, parent),
+      pingInterval_(pingInterval),
+      nextPing_(-1),
+      reading_(true),
+      dropping_(false),
+      registrations_(0),
+      unregistrations_(0),
+      pings_(0),
+      pongs_(0),
+      missedPongs_(0)
+{
+}
+
+DsmeSimulator::~DsmeSimulator()
+{
+    stop();
+}
+
+bool DsmeSimulator::listen_()
+{
+    return listenOn(path()) >= 0;
+}
+
+void DsmeSimulator::setReading(bool reading)
+{
+    QMutexLocker locker(&mutex_);
+    reading_ = reading;
+    wake_();
+}
+
+void DsmeSimulator::dropClients()
+{
+    QMutexLocker locker(&mutex_);
+    dropping_ = true;
+    wake_();
+}
+
+int DsmeSimulator::registrations() const
+{
+    QMutexLocker locker(&mutex_);
+    return registrations_;
+}
+
+int DsmeSimulator::unregistrations() const
+{
+    QMutexLocker locker(&mutex_);
+    return unregistrations_;
+}
+
+int DsmeSimulator::pings() const
+{
+    QMutexLocker locker(&mutex_);
+    return pings_;
+}
+
+int DsmeSimulator::pongs() const
+{
+    QMutexLocker locker(&mutex_);
+    return pongs_;
+}
+
+int DsmeSimulator::missedPongs() const
+{
+    QMutexLocker locker(&mutex_);
+    return missedPongs_;
+}
+
+QString DsmeSimulator::summary() const
+{
+    QMutexLocker locker(&mutex_);
+    return QString("%1 registrations, %2 unregistrations, %3 pings, %4 pongs, %5 missed")
+        .arg(registrations_).arg(unregistrations_).arg(pings_).arg(pongs_).arg(missedPongs_);
+}
+
+int DsmeSimulator::idle_()
+{
+    {
+        QMutexLocker locker(&mutex_);
+        if (dropping_) {
+            dropClients_();
+            dropping_ = false;
+        }
+    }
+
+    qint64 now = monotonicMs();
+    if (nextPing_ < 0)
+        nextPing_ = now + pingInterval_;
+    if (now >= nextPing_) {
+        pingAll_();
+        nextPing_ = now + pingInterval_;
+    }
+    return (int)(nextPing_ - now);
+}
+
+QList<int> DsmeSimulator::polledClients_() const
+{
+    QList<int> sds;
+    QMutexLocker locker(&mutex_);
+    if (reading_) {
+        foreach (const Client &client, clients_)
+            sds.append(client.sd);
+    }
+    return sds;
+}
+
+bool DsmeSimulator::accepted_(int listener, int sd)
+{
+    Q_UNUSED(listener);
+
+    Client client;
+    client.sd = sd;
+    client.registered = false;
+    client.pid = 0;
+    client.answered = true;
+    clients_.append(client);
+    return true;
+}
+
+bool DsmeSimulator::serve_(int sd)
+{
+    Client &client = clients_[indexOf_(sd)];
+    static quint32 words[MAX_MESSAGE / sizeof(quint32)];
+    char *buffer = (char *)words;
+    dsmemsg_generic_t *msg = (dsmemsg_generic_t *)words;
+
+    if (!readAll(client.sd, msg, sizeof(dsmemsg_generic_t)))
+        return false;
+    if (msg->line_size_ < sizeof(dsmemsg_generic_t) || msg->line_size_ > sizeof(words))
+        return false;
+    if (!readAll(client.sd, buffer + sizeof(dsmemsg_generic_t), msg->line_size_ - sizeof(dsmemsg_generic_t)))
+        return false;
+
+    QMutexLocker locker(&mutex_);
+    if (dsmemsg_id(msg) == DSME_MSG_ID_(DSM_MSGTYPE_PROCESSWD_CREATE)) {
+        client.registered = true;
+        client.pid = ((DSM_MSGTYPE_PROCESSWD_CREATE *)msg)->pid;
+        client.answered = true;
+        registrations_++;
+    } else if (dsmemsg_id(msg) == DSME_MSG_ID_(DSM_MSGTYPE_PROCESSWD_DELETE)) {
+        client.registered = false;
+        unregistrations_++;
+    } else if (dsmemsg_id(msg) == DSME_MSG_ID_(DSM_MSGTYPE_PROCESSWD_PONG)) {
+        client.answered = true;
+        pongs_++;
+    }
+    return true;
+}
+
+void DsmeSimulator::pingAll_()
+{
+    DSM_MSGTYPE_PROCESSWD_PING *ping = DSME_MSG_NEW(DSM_MSGTYPE_PROCESSWD_PING);
+    int sent = 0;
+    int missed = 0;
+
+    for (int i = clients_.size() - 1; i >= 0; i--) {
+        Client &client = clients_[i];
+        if (!client.registered)
+            continue;
+        if (!client.answered)
+            missed++;
+
+        ping->pid = client.pid;
+        client.answered = false;
+        sent++;
+        if (!writeAll(client.sd, ping, ((dsmemsg_generic_t *)ping)->line_size_)) {
+            close(client.sd);
+            clients_.removeAt(i);
+        }
+    }
+    free(ping);
+
+    QMutexLocker locker(&mutex_);
+    pings_ += sent;
+    missedPongs_ += missed;
+}
+
+void DsmeSimulator::forget_(int sd)
+{
+    clients_.removeAt(indexOf_(sd));
+}
+
+void DsmeSimulator::dropClients_()
+{
+    foreach (const Client &client, clients_)
+        close(client.sd);
+    clients_.clear();
+}
+
+int DsmeSimulator::indexOf_(int sd) const
+{
+    for (int i = 0; i < clients_.size(); i++) {
+        if (clients_[i].sd == sd)
+            return i;
+    }
+    return -1;
+}
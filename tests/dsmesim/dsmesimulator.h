@@ -0,0 +1,94 @@
+/*!
+ * @file dsmesimulator.h
+ * @brief Contains DsmeSimulator, a stand-in for the DSME process watchdog
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#ifndef DSMESIMULATOR_H
+#define DSMESIMULATOR_H
+
+#include "simserver.h"
+
+/**
+ * Serves the process watchdog messages of QmProcessWatchdog on a UNIX
+ * socket, in its own thread, the way DSME does: the registered clients
+ * are pinged at each interval and are expected to pong before the next
+ * ping. A client missing a pong is only counted, not killed.
+ *
+ * QmProcessWatchdog connects to it when $DSME_SOCKFILE names its socket.
+ */
+class DsmeSimulator : public SimServer
+{
+    Q_OBJECT
+
+public:
+    DsmeSimulator(const QString &path, int pingInterval = 1000, QObject *parent = 0);
+    ~DsmeSimulator();
+
+    /* Stops reading the clients, as a busy DSME, or resumes */
+    void setReading(bool reading);
+
+    /* Closes the client connections, as a restart of DSME */
+    void dropClients();
+
+    /* Counters of the messages */
+    int registrations() const;
+    int unregistrations() const;
+    int pings() const;
+    int pongs() const;
+    int missedPongs() const;
+
+    /* The counters as text, for the log */
+    QString summary() const;
+
+protected:
+    bool listen_();
+    int idle_();
+    QList<int> polledClients_() const;
+    bool accepted_(int listener, int sd);
+    bool serve_(int sd);
+    void forget_(int sd);
+    void dropClients_();
+
+private:
+    struct Client
+    {
+        int sd;
+        bool registered;
+        int pid;
+        bool answered;      // ponged since the last ping
+    };
+
+    int indexOf_(int sd) const;
+    void pingAll_();
+
+    int pingInterval_;      // ms
+    qint64 nextPing_;       // ms, monotonic, -1 until the thread runs
+    QList<Client> clients_;
+
+    bool reading_;
+    bool dropping_;
+    int registrations_;
+    int unregistrations_;
+    int pings_;
+    int pongs_;
+    int missedPongs_;
+};
+
+#endif // DSMESIMULATOR_H
@@ -0,0 +1,73 @@
+/*!
+ * @file main.cpp
+ * @brief qmdsmesim, the DSME process watchdog simulator for running QmProcessWatchdog on a host
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+#include <QTimer>
+
+#include "dsmesimulator.h"
+
+static int usage()
+{
+    QTextStream(stderr)
+        << "Usage: qmdsmesim [-i milliseconds] [-t seconds] <socket>\n"
+        << "Pings the QmProcessWatchdog clients started with DSME_SOCKFILE=<socket>\n"
+        << "at the interval given, and prints the pongs they sent when done\n";
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments().mid(1);
+
+    int interval = 1000;
+    int seconds = 0;
+    while (args.size() >= 2 && (args[0] == "-i" || args[0] == "-t")) {
+        bool ok;
+        int value = args[1].toInt(&ok);
+        if (!ok || value <= 0)
+            return usage();
+        if (args[0] == "-i")
+            interval = value;
+        else
+            seconds = value;
+        args = args.mid(2);
+    }
+    if (args.size() != 1)
+        return usage();
+
+    DsmeSimulator simulator(args[0], interval);
+    if (!simulator.listen())
+        return 1;
+
+    /* Serves until killed, or for the time given */
+    if (seconds)
+        QTimer::singleShot(seconds * 1000, &app, SLOT(quit()));
+    simulator.start();
+    int result = app.exec();
+
+    simulator.stop();
+    QTextStream(stdout) << simulator.summary() << "\n";
+    return result;
+}
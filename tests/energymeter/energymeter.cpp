@@ -0,0 +1,89 @@
+/**
+ * @file energymeter.cpp
+ * @brief QmEnergyMeter tests
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#include <QObject>
+#include <qmenergymeter.h>
+#include <QTest>
+
+class TestClass : public QObject
+{
+    Q_OBJECT
+
+private:
+    MeeGo::QmEnergyMeter *meter;
+
+private slots:
+    void initTestCase() {
+        meter = new MeeGo::QmEnergyMeter();
+        QVERIFY(meter);
+    }
+
+    void testStart() {
+        QVERIFY(meter->start(MeeGo::QmBattery::RATE_250ms));
+        QVERIFY(meter->isRunning());
+    }
+
+    void testMarkers() {
+        meter->startMarker("outer");
+        QTest::qWait(1000);
+        meter->startMarker("inner");
+        QTest::qWait(1000);
+
+        MeeGo::QmEnergyInterval inner = meter->stopMarker("inner");
+        QCOMPARE(inner.name, QString("inner"));
+        QVERIFY(!inner.running);
+        QVERIFY(inner.samples > 1);
+        QVERIFY(inner.duration > 0);
+
+        MeeGo::QmEnergyInterval outer = meter->interval("outer");
+        QVERIFY(outer.running);
+        QVERIFY(outer.samples > inner.samples);
+        QVERIFY(outer.duration > inner.duration);
+
+        outer = meter->stopMarker("outer");
+        QVERIFY(!outer.running);
+        QCOMPARE(meter->intervals().size(), 2);
+    }
+
+    void testUnknownMarker() {
+        MeeGo::QmEnergyInterval none = meter->stopMarker("none");
+        QVERIFY(none.name.isEmpty());
+        QCOMPARE(none.samples, 0);
+    }
+
+    void testClear() {
+        meter->clear();
+        QVERIFY(meter->intervals().isEmpty());
+    }
+
+    void testStop() {
+        QVERIFY(meter->stop());
+        QVERIFY(!meter->isRunning());
+    }
+
+    void cleanupTestCase() {
+        delete meter;
+    }
+};
+
+QTEST_MAIN(TestClass)
+#include "energymeter.moc"
@@ -0,0 +1,8 @@
+QT += dbus
+QT -= gui
+SOURCES += energymeter.cpp
+
+LIBS += -lbmeipc
+TARGET = energymeter-test
+
+include(../common-install.pri)
@@ -0,0 +1,122 @@
+/*!
+ * @file energymeter_sim.cpp
+ * @brief QmEnergyMeter tests against the simulated BME
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#include <QFile>
+#include <QObject>
+#include <QTest>
+#include <qmenergymeter.h>
+
+
+#include "bmesimulator.h"
+
+/* The samples are a second apart from here (us) */
+#define T0 1000000000LL
+#define SECOND 1000000LL
+
+class TestClass : public QObject
+{
+    Q_OBJECT
+
+private:
+    BmeSimulator *simulator;
+    MeeGo::QmEnergyMeter *meter;
+
+private slots:
+    void initTestCase() {
+        simulator = new BmeSimulator(SimServer::tempPath("bmesim-energy"));
+        qputenv("QMSYSTEM_BATTERY_MODEL_FILE", QFile::encodeName(simulator->path() + "/battery-model"));
+        simulator->setClockSampling(false);
+        QVERIFY(simulator->setTrace("0 pct=80 bars=6 maxbars=8 volt=4000 current=100 cc=1000 state=ok"));
+        QVERIFY(simulator->serve("QMSYSTEM_BME_SIMULATOR"));
+
+        meter = new MeeGo::QmEnergyMeter();
+        QVERIFY(meter->start(MeeGo::QmBattery::RATE_1000ms));
+        SIM_TRY_VERIFY(simulator->isMeasuring(), 3000);
+    }
+
+    void testExactEnergy() {
+        meter->startMarker("outer");
+
+        /* 400, 800, 1170 and 400 mW a second apart */
+        QVERIFY(simulator->sendSample(T0, 100, 4000));
+        QVERIFY(simulator->sendSample(T0 + SECOND, 200, 4000));
+        SIM_TRY_VERIFY(meter->interval("outer").samples >= 2, 3000);
+
+        meter->startMarker("inner");
+        QVERIFY(simulator->sendSample(T0 + 2 * SECOND, 300, 3900));
+        QVERIFY(simulator->sendSample(T0 + 3 * SECOND, 100, 4000));
+        SIM_TRY_VERIFY(meter->interval("outer").samples >= 4, 3000);
+
+        /* The trapezoids: 600 + 985 + 785 mJ */
+        MeeGo::QmEnergyInterval outer = meter->stopMarker("outer");
+        QVERIFY(!outer.running);
+        QCOMPARE(outer.samples, 4);
+        QCOMPARE(outer.duration, 3000);
+        QCOMPARE(outer.energy, 2370.0);
+        QCOMPARE(outer.averagePower, 790);
+        QCOMPARE(outer.peakPower, 1170);
+        QCOMPARE(outer.charge, 0);
+
+        /* The inner marker starts from its first sample, at 1170 mW */
+        MeeGo::QmEnergyInterval inner = meter->interval("inner");
+        QVERIFY(inner.running);
+        QCOMPARE(inner.samples, 2);
+        QCOMPARE(inner.duration, 1000);
+        QCOMPARE(inner.energy, 785.0);
+        QCOMPARE(inner.averagePower, 785);
+        QCOMPARE(inner.peakPower, 1170);
+    }
+
+    void testGap() {
+        /* Samples more than 10 s apart are not integrated over */
+        QVERIFY(simulator->sendSample(T0 + 23 * SECOND, 500, 4000));
+        SIM_TRY_VERIFY(meter->interval("inner").samples >= 3, 3000);
+
+        MeeGo::QmEnergyInterval inner = meter->stopMarker("inner");
+        QCOMPARE(inner.samples, 3);
+        QCOMPARE(inner.duration, 21000);
+        QCOMPARE(inner.energy, 785.0);
+        QCOMPARE(inner.averagePower, 37);
+        QCOMPARE(inner.peakPower, 2000);
+    }
+
+    void testStoppedMarker() {
+        /* A stopped marker keeps its result */
+        QVERIFY(simulator->sendSample(T0 + 24 * SECOND, 500, 4000));
+        QTest::qWait(200);
+
+        MeeGo::QmEnergyInterval outer = meter->interval("outer");
+        QVERIFY(!outer.running);
+        QCOMPARE(outer.samples, 4);
+        QCOMPARE(outer.energy, 2370.0);
+    }
+
+    void cleanupTestCase() {
+        QVERIFY(meter->stop());
+        delete meter;
+        simulator->stop();
+        delete simulator;
+    }
+};
+
+QTEST_MAIN(TestClass)
+#include "energymeter_sim.moc"
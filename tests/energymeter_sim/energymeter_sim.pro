@@ -0,0 +1,13 @@
+QT -= gui
+SOURCES += energymeter_sim.cpp \
+           ../bmesim/bmesimulator.cpp
+HEADERS += ../bmesim/bmesimulator.h
+INCLUDEPATH += ../bmesim
+include(../common/simserver.pri)
+
+CONFIG += link_pkgconfig
+PKGCONFIG += bmeipc
+LIBS += -lrt
+TARGET = energymeter-sim-test
+
+include(../common-install.pri)
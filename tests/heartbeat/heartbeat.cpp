@@ -139,6 +139,40 @@ private slots:
         QVERIFY(got_signal == 0);
     }
 
+    void testWaitAsync() {
+        QVERIFY(!heartbeat2->waitAsync(0, 4));
+
+        heartbeat->resetStatistics();
+        MeeGo::QmHeartbeat::Statistics stats = heartbeat->statistics();
+        QCOMPARE(stats.waits, 0);
+        QCOMPARE(stats.wakeups, 0);
+
+        qint64 before = MeeGo::QmHeartbeat::monotonicTime();
+        QVERIFY(heartbeat->waitAsync(2, 4));
+        QCOMPARE(heartbeat->statistics().waits, 1);
+
+        int sleep_s = 8;
+        while (sleep_s-- > 0 && heartbeat->statistics().wakeups == 0) {
+            QTest::qWait(1000);
+        }
+        QCOMPARE(heartbeat->statistics().wakeups, 1);
+
+        MeeGo::QmHeartbeat::Wakeup wakeup = heartbeat->lastWakeup();
+        qDebug() << "Woke up after" << wakeup.time - wakeup.requested << "ms, slip"
+                 << wakeup.slip << "ms, coalesced" << wakeup.coalesced;
+        QVERIFY(wakeup.requested >= before);
+        QVERIFY(wakeup.time >= wakeup.requested);
+        QCOMPARE(wakeup.mintime, (unsigned short)2);
+        QCOMPARE(wakeup.maxtime, (unsigned short)4);
+        QVERIFY(wakeup.slip > -1000 && wakeup.slip < 1000);
+        heartbeat->IWokeUp();
+
+        QVERIFY(heartbeat->waitAsync(10, 20));
+        QVERIFY(heartbeat->IWokeUp());
+        QCOMPARE(heartbeat->statistics().waits, 2);
+        QCOMPARE(heartbeat->statistics().cancelled, 1);
+    }
+
    void cleanupTestCase() {
         heartbeat->close();
         heartbeat2->close();
@@ -0,0 +1,179 @@
+/*!
+ * @file heartbeat_sim.cpp
+ * @brief QmHeartbeat and QmHeartbeatScheduler tests against the simulated iphbd
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#include <QObject>
+#include <QTest>
+#include <qmheartbeat.h>
+#include <qmheartbeatscheduler.h>
+
+#include "iphbsimulator.h"
+
+class Receiver : public QObject {
+    Q_OBJECT
+
+public:
+    Receiver(QObject *parent = NULL) : QObject(parent), calls(0) {}
+
+    int calls;
+
+public slots:
+    void fired() { calls++; }
+};
+
+class TestClass : public QObject
+{
+    Q_OBJECT
+
+private:
+    IphbSimulator *simulator;
+    MeeGo::QmHeartbeat *heartbeats[3];
+
+private slots:
+    void initTestCase() {
+        simulator = new IphbSimulator(SimServer::tempPath("iphbsim-test"));
+        QVERIFY(simulator->serve("QMSYSTEM_IPHB_SIMULATOR"));
+
+        for (int i = 0; i < 3; i++) {
+            heartbeats[i] = new MeeGo::QmHeartbeat();
+            heartbeats[i]->setObjectName(QString("client%1").arg(i));
+            QVERIFY(heartbeats[i]->open(MeeGo::QmHeartbeat::SignalNeeded));
+        }
+    }
+
+    void testAlignedWindows() {
+        int wakeups = simulator->wakeups();
+        int ended = simulator->endedWaits();
+
+        // The second window closes first, at 4 s, when the others are open
+        QVERIFY(heartbeats[0]->waitAsync(1, 6));
+        QVERIFY(heartbeats[1]->waitAsync(2, 4));
+        QVERIFY(heartbeats[2]->waitAsync(3, 8));
+
+        for (int i = 0; i < 3; i++)
+            SIM_TRY_VERIFY(heartbeats[i]->statistics().wakeups >= 1, 7000);
+
+        QCOMPARE(simulator->wakeups(), wakeups + 1);
+        QCOMPARE(simulator->endedWaits(), ended + 3);
+
+        QVERIFY(heartbeats[0]->lastWakeup().coalesced);
+        QVERIFY(!heartbeats[1]->lastWakeup().coalesced);
+        QVERIFY(heartbeats[2]->lastWakeup().coalesced);
+        for (int i = 0; i < 3; i++) {
+            MeeGo::QmHeartbeat::Wakeup wakeup = heartbeats[i]->lastWakeup();
+            qDebug() << "client" << i << "woke after" << wakeup.time - wakeup.requested
+                     << "ms, slip" << wakeup.slip;
+            QVERIFY(wakeup.slip > -1000 && wakeup.slip < 1000);
+            QCOMPARE(heartbeats[i]->history().size(), 1);
+        }
+    }
+
+    void testCancel() {
+        int wakeups = heartbeats[0]->statistics().wakeups;
+        int cancelled = heartbeats[0]->statistics().cancelled;
+
+        QVERIFY(heartbeats[0]->waitAsync(1, 2));
+        QVERIFY(heartbeats[0]->IWokeUp());
+        QTest::qWait(3000);
+
+        QCOMPARE(heartbeats[0]->statistics().wakeups, wakeups);
+        QCOMPARE(heartbeats[0]->statistics().cancelled, cancelled + 1);
+    }
+
+    void testReplacedWait() {
+        MeeGo::QmHeartbeat heartbeat;
+        QVERIFY(heartbeat.open(MeeGo::QmHeartbeat::SignalNeeded));
+
+        // The second wait replaces the first one, which never wakes up
+        QVERIFY(heartbeat.waitAsync(5, 6));
+        QVERIFY(heartbeat.waitAsync(1, 2));
+        SIM_TRY_VERIFY(heartbeat.statistics().wakeups >= 1, 3000);
+
+        MeeGo::QmHeartbeat::Statistics stats = heartbeat.statistics();
+        QCOMPARE(stats.waits, 2);
+        QCOMPARE(stats.wakeups, 1);
+        QCOMPARE(stats.cancelled, 1);
+
+        // As is a wait pending at close()
+        QVERIFY(heartbeat.waitAsync(5, 6));
+        heartbeat.close();
+        stats = MeeGo::QmHeartbeat::totalStatistics();
+        QCOMPARE(stats.waits, stats.wakeups + stats.cancelled);
+    }
+
+    void testScheduler() {
+        int wakeups = simulator->wakeups();
+
+        MeeGo::QmHeartbeatScheduler scheduler;
+        Receiver receiver;
+        QVERIFY(scheduler.start(1, 5, false, &receiver, SLOT(fired())));
+        QVERIFY(scheduler.start(4, 8, false, &receiver, SLOT(fired())));
+        QVERIFY(scheduler.start(2, 6, false, &receiver, SLOT(fired())));
+
+        SIM_TRY_VERIFY(receiver.calls >= 3, 7000);
+        QCOMPARE(receiver.calls, 3);
+        QCOMPARE(simulator->wakeups(), wakeups + 1);
+    }
+
+    void testGlobalSlot() {
+        unsigned short slot = MeeGo::QmHeartbeat::WAKEUP_SLOT_30_SEC;
+        int count = heartbeats[1]->statistics().wakeups;
+
+        QVERIFY(heartbeats[1]->waitAsync(slot, slot));
+        SIM_TRY_VERIFY(heartbeats[1]->statistics().wakeups >= count + 1, (slot + 2) * 1000);
+
+        MeeGo::QmHeartbeat::Wakeup wakeup = heartbeats[1]->lastWakeup();
+        QVERIFY(wakeup.onSlot);
+        QCOMPARE(wakeup.slip, (qint64)0);
+        // Fired by its own slot boundary, however soon after the wait
+        QVERIFY(!wakeup.coalesced);
+        QVERIFY(heartbeats[1]->statistics().onSlot >= 1);
+    }
+
+    void testReport() {
+        MeeGo::QmHeartbeat::Statistics total = MeeGo::QmHeartbeat::totalStatistics();
+        QVERIFY(total.wakeups >= 5);
+        QVERIFY(total.onSlot + total.offSlot == total.wakeups);
+
+        QString report = MeeGo::QmHeartbeat::report();
+        qDebug() << report;
+        QVERIFY(report.contains("/client0 "));
+        QVERIFY(report.contains("\ntotal "));
+
+        heartbeats[0]->resetStatistics();
+        QCOMPARE(heartbeats[0]->statistics().wakeups, 0);
+        QVERIFY(heartbeats[0]->history().isEmpty());
+        QCOMPARE(MeeGo::QmHeartbeat::totalStatistics().wakeups, total.wakeups);
+
+        qDebug() << simulator->summary();
+    }
+
+    void cleanupTestCase() {
+        for (int i = 0; i < 3; i++) {
+            heartbeats[i]->close();
+            delete heartbeats[i], heartbeats[i] = 0;
+        }
+        delete simulator, simulator = 0;
+    }
+};
+
+QTEST_MAIN(TestClass)
+#include "heartbeat_sim.moc"
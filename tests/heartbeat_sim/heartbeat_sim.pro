@@ -0,0 +1,14 @@
+QT -= gui
+SOURCES += heartbeat_sim.cpp \
+           ../iphbsim/iphbsimulator.cpp
+HEADERS += ../iphbsim/iphbsimulator.h
+INCLUDEPATH += ../iphbsim
+
+CONFIG += link_pkgconfig
+PKGCONFIG += libiphb
+LIBS += -lrt
+TARGET = heartbeat-sim-test
+
+include(../common/simserver.pri)
+
+include(../common-install.pri)
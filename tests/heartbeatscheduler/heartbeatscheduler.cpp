@@ -0,0 +1,227 @@
+/**
+ * @file heartbeatscheduler.cpp
+ * @brief QmHeartbeatScheduler tests
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QObject>
+#include <qmheartbeat.h>
+#include <qmheartbeatscheduler.h>
+#include <QTest>
+#include <QThread>
+#include <QTime>
+#include <QList>
+#include <QDebug>
+
+class Receiver : public QObject {
+    Q_OBJECT
+
+public:
+    Receiver(QObject *parent = NULL) : QObject(parent), calls(0), calledIn(0) {  }
+
+    int calls;
+    QList<int> ids;
+    QThread *calledIn;
+
+public slots:
+    void fired() { calls++; calledIn = QThread::currentThread(); }
+    void firedId(int id) { ids << id; }
+    void timeout(int id) { ids << id; }
+};
+
+/* Asks for the shared scheduler first, from another thread */
+class InstanceThread : public QThread {
+public:
+    InstanceThread() : scheduler(0) {}
+
+    MeeGo::QmHeartbeatScheduler *scheduler;
+
+protected:
+    void run() {
+        scheduler = MeeGo::QmHeartbeatScheduler::instance();
+    }
+};
+
+/* Starts a timer of the shared scheduler with a receiver living in this
+ * thread, and runs the event loop of the thread until it is called */
+class WorkerThread : public QThread {
+public:
+    WorkerThread() : id(0), calledIn(0) {}
+
+    int id;
+    QThread *calledIn;
+
+protected:
+    void run() {
+        Receiver receiver;
+        id = MeeGo::QmHeartbeatScheduler::instance()->start(1, 2, false, &receiver, SLOT(fired()));
+        for (int i = 0; i < 80 && !receiver.calls; i++) {
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 100);
+            msleep(100);
+        }
+        calledIn = receiver.calledIn;
+    }
+};
+
+class TestClass : public QObject
+{
+    Q_OBJECT
+
+private:
+    MeeGo::QmHeartbeatScheduler *scheduler;
+
+    static void waitFor(const int &value, int expected, int seconds) {
+        for (int i = 0; i < seconds * 10 && value < expected; i++) {
+            QTest::qWait(100);
+        }
+    }
+
+private slots:
+    void initTestCase() {
+        scheduler = new MeeGo::QmHeartbeatScheduler();
+        QVERIFY(scheduler);
+        QCOMPARE(scheduler->count(), 0);
+    }
+
+    void testInvalidTimers() {
+        Receiver receiver;
+        QCOMPARE(scheduler->start(0, 0, false), 0);
+        QCOMPARE(scheduler->start(10, 5, false), 0);
+        QCOMPARE(scheduler->start(1, 5, false, &receiver, SLOT(noSuchSlot())), 0);
+        QCOMPARE(scheduler->start(1, 5, false, &receiver, SIGNAL(destroyed())), 0);
+        QCOMPARE(scheduler->count(), 0);
+    }
+
+    void testStartStop() {
+        int id = scheduler->start(100, 200, false);
+        QVERIFY(id > 0);
+        QVERIFY(scheduler->isActive(id));
+        QCOMPARE(scheduler->count(), 1);
+        QVERIFY(scheduler->stop(id));
+        QVERIFY(!scheduler->isActive(id));
+        QVERIFY(!scheduler->stop(id));
+        QCOMPARE(scheduler->count(), 0);
+    }
+
+    void testOneShot() {
+        Receiver receiver;
+        QTime elapsed;
+        elapsed.start();
+        int id = scheduler->start(2, 5, false, &receiver, SLOT(fired()));
+        QVERIFY(id > 0);
+
+        waitFor(receiver.calls, 1, 8);
+        QCOMPARE(receiver.calls, 1);
+        qDebug() << "Called after" << elapsed.elapsed() << "ms";
+        QVERIFY(elapsed.elapsed() >= 1000);
+        QVERIFY(elapsed.elapsed() <= 6000);
+        QVERIFY(!scheduler->isActive(id));
+    }
+
+    void testSharedWakeup() {
+        // The windows overlap at 4-5 s, one wakeup serves both
+        Receiver receiver;
+        int first = scheduler->start(1, 5, false, &receiver, SLOT(firedId(int)));
+        int second = scheduler->start(4, 8, false, &receiver, SLOT(firedId(int)));
+        QVERIFY(first > 0 && second > 0);
+
+        QTime elapsed;
+        elapsed.start();
+        while (receiver.ids.size() < 2 && elapsed.elapsed() < 10000) {
+            QTest::qWait(100);
+        }
+        QCOMPARE(receiver.ids.size(), 2);
+        QVERIFY(receiver.ids.contains(first));
+        QVERIFY(receiver.ids.contains(second));
+        QCOMPARE(scheduler->count(), 0);
+    }
+
+    void testRepeatingAndSignal() {
+        Receiver receiver;
+        QVERIFY(connect(scheduler, SIGNAL(timeout(int)), &receiver, SLOT(timeout(int))));
+        int id = scheduler->start(1, 2, true);
+        QVERIFY(id > 0);
+
+        QTime elapsed;
+        elapsed.start();
+        while (receiver.ids.size() < 2 && elapsed.elapsed() < 8000) {
+            QTest::qWait(100);
+        }
+        QVERIFY(receiver.ids.size() >= 2);
+        QCOMPARE(receiver.ids.first(), id);
+        QVERIFY(scheduler->isActive(id));
+        QVERIFY(scheduler->stop(id));
+        disconnect(scheduler, SIGNAL(timeout(int)), &receiver, SLOT(timeout(int)));
+    }
+
+    void testDeletedReceiver() {
+        Receiver *receiver = new Receiver();
+        int id = scheduler->start(1, 2, true, receiver, SLOT(fired()));
+        QVERIFY(id > 0);
+        delete receiver;
+
+        QTest::qWait(4000);
+        QVERIFY(!scheduler->isActive(id));
+    }
+
+    void testGlobalSlot() {
+        Receiver receiver;
+        unsigned short slot = MeeGo::QmHeartbeat::WAKEUP_SLOT_30_SEC;
+        int id = scheduler->start(slot, slot, false, &receiver, SLOT(fired()));
+        QVERIFY(id > 0);
+
+        waitFor(receiver.calls, 1, slot + 5);
+        QCOMPARE(receiver.calls, 1);
+        QVERIFY(!scheduler->isActive(id));
+    }
+
+    void testInstance() {
+        InstanceThread thread;
+        thread.start();
+        QVERIFY(thread.wait(5000));
+
+        MeeGo::QmHeartbeatScheduler *shared = MeeGo::QmHeartbeatScheduler::instance();
+        QVERIFY(shared);
+        QCOMPARE(thread.scheduler, shared);
+        QCOMPARE(shared->thread(), QCoreApplication::instance()->thread());
+        QCOMPARE(shared->parent(), (QObject *)QCoreApplication::instance());
+    }
+
+    void testWorkerReceiver() {
+        // The scheduler lives in this thread, the receiver in the worker
+        WorkerThread thread;
+        thread.start();
+        for (int i = 0; i < 100 && !thread.isFinished(); i++) {
+            QTest::qWait(100);
+        }
+        QVERIFY(thread.wait(1000));
+        QVERIFY(thread.id > 0);
+        QCOMPARE(thread.calledIn, (QThread *)&thread);
+        QVERIFY(!MeeGo::QmHeartbeatScheduler::instance()->isActive(thread.id));
+    }
+
+    void cleanupTestCase() {
+        delete scheduler, scheduler = 0;
+    }
+};
+
+QTEST_MAIN(TestClass)
+#include "heartbeatscheduler.moc"
@@ -0,0 +1,7 @@
+QT += dbus
+QT -=gui
+
+TARGET = heartbeatscheduler-test
+SOURCES += heartbeatscheduler.cpp
+
+include(../common-install.pri)
@@ -0,0 +1,173 @@
+/**
+ * @file ipcstatistics.cpp
+ * @brief QmIPCStatistics tests
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QObject>
+#include <QSignalSpy>
+#include <QStringList>
+#include <QTest>
+
+#include "qmipcinterface_p.h"
+#include "qmipcstatistics.h"
+
+/* The bus daemon answers on every system */
+#define BUS_SERVICE "org.freedesktop.DBus"
+#define BUS_PATH    "/org/freedesktop/DBus"
+#define BUS_IF      "org.freedesktop.DBus"
+
+/* The columns of a line of the dump */
+enum { Service, Method, Calls, NoReply, Errors, Average, Maximum, Separator, Histogram };
+
+using namespace MeeGo;
+
+/* The line of the method split into its columns, empty if none */
+static QStringList statistics(const QString &method)
+{
+    QStringList lines = QmIPCStatistics::dump().split('\n', QString::SkipEmptyParts);
+    foreach (const QString &line, lines) {
+        QStringList columns = line.split(' ');
+        if (columns.size() > Method && columns[Service] == BUS_SERVICE && columns[Method] == method)
+            return columns;
+    }
+    return QStringList();
+}
+
+static int histogramTotal(const QStringList &columns)
+{
+    int total = 0;
+    for (int i = Histogram; i < columns.size(); i++)
+        total += columns[i].toInt();
+    return total;
+}
+
+static QDBusMessage busMessage(const char *method)
+{
+    return QDBusMessage::createMethodCall(BUS_SERVICE, BUS_PATH, BUS_IF, method);
+}
+
+class TestClass : public QObject
+{
+    Q_OBJECT
+
+private:
+    QmIPCInterface *bus;
+
+private slots:
+    void initTestCase() {
+        bus = new QmIPCInterface(BUS_SERVICE, BUS_PATH, BUS_IF);
+    }
+
+    void init() {
+        QmIPCStatistics::reset();
+    }
+
+    void testReset() {
+        bus->get("ListNames");
+        QVERIFY(!statistics("ListNames").isEmpty());
+
+        QmIPCStatistics::reset();
+        QVERIFY(statistics("ListNames").isEmpty());
+        /* The header remains */
+        QCOMPARE(QmIPCStatistics::dump().count('\n'), 1);
+    }
+
+    void testBlockingCalls() {
+        QVERIFY(!bus->get("ListNames").isEmpty());
+        QVERIFY(!bus->get("ListNames").isEmpty());
+        QVERIFY(bus->get("NoSuchMethod").isEmpty());
+
+        QStringList columns = statistics("ListNames");
+        QCOMPARE(columns.size(), Histogram + 10);
+        QCOMPARE(columns[Calls].toInt(), 2);
+        QCOMPARE(columns[NoReply].toInt(), 0);
+        QCOMPARE(columns[Errors].toInt(), 0);
+        QCOMPARE(columns[Separator], QString("|"));
+        QCOMPARE(histogramTotal(columns), 2);
+        QVERIFY(columns[Maximum].toDouble() >= columns[Average].toDouble());
+
+        columns = statistics("NoSuchMethod");
+        QCOMPARE(columns[Calls].toInt(), 1);
+        QCOMPARE(columns[Errors].toInt(), 1);
+    }
+
+    void testNoReplyCalls() {
+        bus->callAsynchronously("ListNames");
+        bus->callAsynchronously("ListNames");
+
+        QStringList columns = statistics("ListNames");
+        QCOMPARE(columns[Calls].toInt(), 0);
+        QCOMPARE(columns[NoReply].toInt(), 2);
+        QCOMPARE(histogramTotal(columns), 0);
+    }
+
+    void testAsyncCall() {
+        QDBusPendingCallWatcher *watcher = bus->getAsync("GetNameOwner", QString(BUS_SERVICE));
+        QSignalSpy spy(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)));
+        QVERIFY(statistics("GetNameOwner").isEmpty());
+
+        for (int waited = 0; spy.isEmpty() && waited < 3000; waited += 10)
+            QTest::qWait(10);
+        QCOMPARE(spy.count(), 1);
+        QCOMPARE(QmIPCInterface::results(watcher).size(), 1);
+        delete watcher;
+
+        QStringList columns = statistics("GetNameOwner");
+        QCOMPARE(columns[Calls].toInt(), 1);
+        QCOMPARE(columns[Errors].toInt(), 0);
+        QCOMPARE(histogramTotal(columns), 1);
+    }
+
+    void testMessageCalls() {
+        QDBusMessage message = busMessage("NameHasOwner");
+        message << QString(BUS_SERVICE);
+
+        QDBusMessage reply = QmIPCInterface::callMessage(message, 3000);
+        QCOMPARE(reply.type(), QDBusMessage::ReplyMessage);
+
+        /* Recorded while waiting, before the caller sees the reply */
+        QDBusPendingCallWatcher *watcher = QmIPCInterface::asyncCallMessage(message, 0, 3000);
+        watcher->waitForFinished();
+        QVERIFY(!watcher->isError());
+        delete watcher;
+
+        QDBusMessage missing = QmIPCInterface::callMessage(busMessage("NoSuchMethod"), 3000);
+        QCOMPARE(missing.type(), QDBusMessage::ErrorMessage);
+
+        QStringList columns = statistics("NameHasOwner");
+        QCOMPARE(columns[Calls].toInt(), 2);
+        QCOMPARE(columns[Errors].toInt(), 0);
+        QCOMPARE(histogramTotal(columns), 2);
+
+        columns = statistics("NoSuchMethod");
+        QCOMPARE(columns[Calls].toInt(), 1);
+        QCOMPARE(columns[Errors].toInt(), 1);
+    }
+
+    void cleanupTestCase() {
+        delete bus;
+    }
+};
+
+QTEST_MAIN(TestClass)
+#include "ipcstatistics.moc"
@@ -0,0 +1,7 @@
+QT += dbus
+QT -= gui
+
+TARGET = ipcstatistics-test
+SOURCES += ipcstatistics.cpp
+
+include(../common-install.pri)
@@ -0,0 +1,15 @@
+QT -= gui
+CONFIG += link_pkgconfig
+PKGCONFIG += libiphb
+QMAKE_CXXFLAGS += -Wall -Wno-psabi
+
+INCLUDEPATH += ../../system ../../../system
+HEADERS += iphbsimulator.h
+SOURCES += main.cpp \
+           iphbsimulator.cpp
+LIBS += -lrt
+
+include(../common/simserver.pri)
+
+TEMPLATE = app
+TARGET = qmiphbsim
@@ -0,0 +1,195 @@
+/*!
+ * @file iphbsimulator.cpp
+ * @brief IphbSimulator
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#include "iphbsimulator.h"
+#include "qmiphbtransport_p.h"
+
+extern "C" {
+#include <unistd.h>
+}
+
+using namespace MeeGo;
+
+static bool isSlot(int value)
+{
+    return value == IPHB_GS_WAIT_30_SEC || value == IPHB_GS_WAIT_2_5_MINS ||
+           value == IPHB_GS_WAIT_5_MINS || value == IPHB_GS_WAIT_10_MINS ||
+           value == IPHB_GS_WAIT_30_MINS || value == IPHB_GS_WAIT_1_HOUR ||
+           value == IPHB_GS_WAIT_2_HOURS || value == IPHB_GS_WAIT_10_HOURS;
+}
+
+IphbSimulator::IphbSimulator(const QString &path, QObject *parent)
+    : SimServer(path, parent),
+      wakeups_(0),
+      endedWaits_(0)
+{
+}
+
+IphbSimulator::~IphbSimulator()
+{
+    stop();
+}
+
+int IphbSimulator::wakeups() const
+{
+    QMutexLocker locker(&mutex_);
+    return wakeups_;
+}
+
+int IphbSimulator::endedWaits() const
+{
+    QMutexLocker locker(&mutex_);
+    return endedWaits_;
+}
+
+QString IphbSimulator::summary() const
+{
+    QMutexLocker locker(&mutex_);
+    double perWakeup = wakeups_ ? (double)endedWaits_ / wakeups_ : 0.0;
+    return QString("%1 device wakeups ended %2 waits, %3 waits per wakeup")
+        .arg(wakeups_).arg(endedWaits_).arg(perWakeup, 0, 'f', 2);
+}
+
+bool IphbSimulator::listen_()
+{
+    return listenOn(path()) >= 0;
+}
+
+int IphbSimulator::idle_()
+{
+    qint64 now = monotonicMs();
+    qint64 next = nextWakeup_();
+    if (next >= 0 && next <= now) {
+        wakeUp_(now);
+        next = nextWakeup_();
+    }
+    return next < 0 ? -1 : (int)(next - now);
+}
+
+QList<int> IphbSimulator::polledClients_() const
+{
+    QList<int> sds;
+    foreach (const Client &client, clients_)
+        sds.append(client.sd);
+    return sds;
+}
+
+bool IphbSimulator::accepted_(int, int sd)
+{
+    Client client;
+    client.sd = sd;
+    client.waiting = false;
+    client.opens = client.closes = 0;
+    client.slot = false;
+    clients_.append(client);
+    return true;
+}
+
+int IphbSimulator::indexOf_(int sd) const
+{
+    for (int i = 0; i < clients_.size(); i++) {
+        if (clients_[i].sd == sd)
+            return i;
+    }
+    return -1;
+}
+
+bool IphbSimulator::serve_(int sd)
+{
+    Client &client = clients_[indexOf_(sd)];
+
+    QmIphbSimRequest request;
+    if (!readAll(client.sd, &request, sizeof(request)))
+        return false;
+
+    switch (request.command) {
+    case QmIphbSimRequest::Wait: {
+        if (request.mintime > request.maxtime)
+            return false;
+        qint64 now = monotonicMs();
+        client.waiting = true;
+        client.slot = request.mintime == request.maxtime && isSlot(request.mintime);
+        if (client.slot) {
+            qint64 slot = (qint64)request.mintime * 1000;
+            client.opens = now;
+            client.closes = (now / slot + 1) * slot;
+        } else {
+            client.opens = now + (qint64)request.mintime * 1000;
+            client.closes = now + (qint64)request.maxtime * 1000;
+        }
+        return true;
+    }
+    case QmIphbSimRequest::Cancel:
+        client.waiting = false;
+        return true;
+    default:
+        return false;
+    }
+}
+
+void IphbSimulator::forget_(int sd)
+{
+    clients_.removeAt(indexOf_(sd));
+}
+
+qint64 IphbSimulator::nextWakeup_() const
+{
+    qint64 next = -1;
+    foreach (const Client &client, clients_) {
+        if (client.waiting && (next < 0 || client.closes < next))
+            next = client.closes;
+    }
+    return next;
+}
+
+void IphbSimulator::wakeUp_(qint64 now)
+{
+    QmIphbSimWakeup wakeup = now;
+    int ended = 0;
+
+    for (int i = clients_.size() - 1; i >= 0; i--) {
+        Client &client = clients_[i];
+        if (!client.waiting)
+            continue;
+        /* An open window, or a slot reached */
+        if ((client.slot ? client.closes : client.opens) > now)
+            continue;
+
+        client.waiting = false;
+        ended++;
+        if (!writeAll(client.sd, &wakeup, sizeof(wakeup))) {
+            close(client.sd);
+            clients_.removeAt(i);
+        }
+    }
+
+    QMutexLocker locker(&mutex_);
+    wakeups_++;
+    endedWaits_ += ended;
+}
+
+void IphbSimulator::dropClients_()
+{
+    foreach (const Client &client, clients_)
+        close(client.sd);
+    clients_.clear();
+}
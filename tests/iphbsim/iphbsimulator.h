@@ -0,0 +1,83 @@
+/*!
+ * @file iphbsimulator.h
+ * @brief Contains IphbSimulator, a stand-in for iphbd
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#ifndef IPHBSIMULATOR_H
+#define IPHBSIMULATOR_H
+
+#include "simserver.h"
+
+/**
+ * Serves the waits QmHeartbeat sends over the UNIX socket of the
+ * QmIphbTransport simulator protocol, in its own thread, and wakes the
+ * clients up the way iphbd aligns them.
+ *
+ * The device wakes up when the window of a client closes or a global slot
+ * a client waits for is reached. Each device wakeup ends the waits of all
+ * the clients whose window is open, and of the clients of the slots reached
+ * by then. The slots are the multiples of their length on CLOCK_MONOTONIC,
+ * so a slot fires the shorter ones as well.
+ */
+class IphbSimulator : public SimServer
+{
+    Q_OBJECT
+
+public:
+    IphbSimulator(const QString &path, QObject *parent = 0);
+    ~IphbSimulator();
+
+    /* Device wakeups, and the waits they ended */
+    int wakeups() const;
+    int endedWaits() const;
+
+    /* The counters as text, for the log */
+    QString summary() const;
+
+protected:
+    bool listen_();
+    int idle_();
+    QList<int> polledClients_() const;
+    bool accepted_(int listener, int sd);
+    bool serve_(int sd);
+    void forget_(int sd);
+    void dropClients_();
+
+private:
+    struct Client
+    {
+        int sd;
+        bool waiting;
+        qint64 opens;       /* ms, monotonic */
+        qint64 closes;      /* ms, monotonic, the slot boundary for a slot */
+        bool slot;
+    };
+
+    int indexOf_(int sd) const;
+    qint64 nextWakeup_() const;
+    void wakeUp_(qint64 now);
+
+    QList<Client> clients_;
+
+    int wakeups_;
+    int endedWaits_;
+};
+
+#endif // IPHBSIMULATOR_H
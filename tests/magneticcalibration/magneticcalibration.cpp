@@ -0,0 +1,180 @@
+/**
+ * @file magneticcalibration.cpp
+ * @brief QmMagneticCalibration tests
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include <QDir>
+#include <QFile>
+#include <QObject>
+#include <QTest>
+#include <QTextStream>
+
+#include <unistd.h>
+
+#include "qmmagneticcalibration_p.h"
+
+using namespace MeeGo;
+
+/* One fit worth of readings, calibrated = 1.5 raw + 100, raw - 50 and 0.8 raw + 20 */
+static void feed(QmMagneticCalibration &calibration, int level, int count = 64)
+{
+    for (int i = 0; i < count; i++) {
+        QmMagnetometerReading reading;
+        reading.rx = i * 10 - 320;
+        reading.ry = 200 - i * 10;
+        reading.rz = i * 20 - 640;
+        reading.x = reading.rx * 3 / 2 + 100;
+        reading.y = reading.ry - 50;
+        reading.z = reading.rz * 4 / 5 + 20;
+        reading.level = level;
+        calibration.learn(reading);
+    }
+}
+
+static QmMagnetometerReading raw(int x, int y, int z)
+{
+    QmMagnetometerReading reading;
+    reading.rx = x;
+    reading.ry = y;
+    reading.rz = z;
+    reading.x = reading.y = reading.z = 0;
+    reading.level = 0;
+    return reading;
+}
+
+class TestClass : public QObject
+{
+    Q_OBJECT
+
+private:
+    QString path;
+
+private slots:
+    void init() {
+        path = QDir::tempPath() + QString("/magcal-test-%1").arg(getpid());
+        QFile::remove(path);
+    }
+
+    void cleanup() {
+        QFile::remove(path);
+    }
+
+    void testFit() {
+        QmMagneticCalibration calibration(path);
+        QVERIFY(!calibration.isValid());
+
+        // One short of a fit
+        feed(calibration, 3, 63);
+        QVERIFY(!calibration.isValid());
+
+        feed(calibration, 3, 1);
+        QVERIFY(calibration.isValid());
+        QCOMPARE(calibration.level(), 3);
+
+        QmMagnetometerReading reading = raw(40, -60, 100);
+        QVERIFY(calibration.correct(reading));
+        QCOMPARE(reading.x, 160);
+        QCOMPARE(reading.y, -110);
+        QCOMPARE(reading.z, 100);
+        QCOMPARE(reading.level, 3);
+    }
+
+    void testLowLevelIgnored() {
+        QmMagneticCalibration calibration(path);
+        feed(calibration, 2);
+        QVERIFY(!calibration.isValid());
+
+        // A low level reading drops the readings collected so far
+        feed(calibration, 3, 32);
+        feed(calibration, 1, 1);
+        feed(calibration, 3, 32);
+        QVERIFY(!calibration.isValid());
+
+        QmMagnetometerReading reading = raw(1, 2, 3);
+        QVERIFY(!calibration.correct(reading));
+    }
+
+    void testFlatAxis() {
+        QmMagneticCalibration calibration(path);
+        for (int i = 0; i < 64; i++) {
+            QmMagnetometerReading reading = raw(i * 10, 500, i * 10);
+            reading.x = reading.rx;
+            reading.y = 470;
+            reading.z = reading.rz;
+            reading.level = 3;
+            calibration.learn(reading);
+        }
+
+        // No variance on y, so the scale stays 1 and only the offset is fitted
+        QmMagnetometerReading reading = raw(0, 100, 0);
+        QVERIFY(calibration.correct(reading));
+        QCOMPARE(reading.y, 70);
+    }
+
+    void testRoundTrip() {
+        {
+            QmMagneticCalibration calibration(path);
+            feed(calibration, 3);
+
+            // Written later from the event loop, not from learn()
+            QVERIFY(!QFile::exists(path));
+            calibration.flush();
+            QVERIFY(QFile::exists(path));
+        }
+
+        QmMagneticCalibration loaded(path);
+        QVERIFY(loaded.isValid());
+        QCOMPARE(loaded.level(), 3);
+
+        QmMagnetometerReading reading = raw(40, -60, 100);
+        QVERIFY(loaded.correct(reading));
+        QCOMPARE(reading.x, 160);
+        QCOMPARE(reading.y, -110);
+        QCOMPARE(reading.z, 100);
+
+        loaded.clear();
+        QVERIFY(!loaded.isValid());
+        QVERIFY(!QFile::exists(path));
+    }
+
+    void testDeferredWrite() {
+        QmMagneticCalibration calibration(path);
+        feed(calibration, 3);
+        QVERIFY(!QFile::exists(path));
+
+        QTest::qWait(6000);
+        QVERIFY(QFile::exists(path));
+    }
+
+    void testInvalidFile() {
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+        QTextStream(&file) << "1 3 7.5 0 1 0 1 0\n";
+        file.close();
+
+        // The scale of x is out of range
+        QmMagneticCalibration calibration(path);
+        QVERIFY(!calibration.isValid());
+    }
+};
+
+QTEST_MAIN(TestClass)
+#include "magneticcalibration.moc"
@@ -0,0 +1,5 @@
+QT -= gui
+SOURCES += magneticcalibration.cpp
+
+TARGET = magneticcalibration-test
+include(../common-install.pri)
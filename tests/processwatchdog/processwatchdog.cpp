@@ -26,8 +26,11 @@
 
 #include <QTest>
 #include <QDebug>
+#include <QFile>
 #include <QTime>
 
+#include <unistd.h>
+
 using namespace MeeGo;
 class TestClass : public QObject
 {
@@ -36,6 +39,15 @@ public slots:
     void ping() {
         qDebug() << "ping: " << QTime::currentTime();
         pingCount++;
+        if (stallOnPing) {
+            /* Keeps the event loop busy past the threshold of the profiler,
+             * whose signal cuts the sleeps short */
+            QTime stalled;
+            stalled.start();
+            while ((unsigned)stalled.elapsed() < stallOnPing) {
+                usleep(100 * 1000);
+            }
+        }
         if (pongOnGivenPing == 0) {
             QVERIFY(watchdog->pong());
             qDebug() << "pong: " << QTime::currentTime();
@@ -49,6 +61,7 @@ private:
     QmProcessWatchdog *watchdog;
     unsigned pingCount;
     unsigned pongOnGivenPing;
+    unsigned stallOnPing;
 
     bool waitForPings(unsigned pings, unsigned timeout_ms)
     {
@@ -67,6 +80,7 @@ private slots:
         watchdog = new QmProcessWatchdog();
         pingCount = 0;
         pongOnGivenPing = 0;
+        stallOnPing = 0;
         QVERIFY(connect(watchdog, SIGNAL(ping()), this, SLOT(ping())));
     }
 
@@ -100,6 +114,58 @@ private slots:
         QVERIFY(watchdog->stop());
     }
 
+    void testWatchdogAutomaticPong() {
+        pingCount = 0;
+        /* The library answers, the slot never does */
+        pongOnGivenPing = (unsigned)-1;
+        QVERIFY(watchdog->setAutomaticPong(true, 1000));
+        QVERIFY(watchdog->automaticPong());
+        QVERIFY(watchdog->start());
+        QVERIFY(!watchdog->setAutomaticPong(false));
+        qDebug() << "start: " << QTime::currentTime();
+        bool pingsOk = waitForPings(4, 5*24*1000);
+        qDebug() << "now: " << QTime::currentTime();
+        QVERIFY(pingsOk);
+        QVERIFY(watchdog->stop());
+
+        QmProcessWatchdog::LoopStatistics loop = watchdog->loopStatistics();
+        QVERIFY(loop.probes >= 4);
+        QCOMPARE(loop.stalls, 0);
+        int served = 0;
+        for (int i = 0; i < QmProcessWatchdog::LatencyBuckets; i++) {
+            served += loop.histogram[i];
+        }
+        QCOMPARE(served, loop.probes);
+        QVERIFY(loop.maxLatency <= 1000);
+        QVERIFY(watchdog->setAutomaticPong(false));
+    }
+
+    void testWatchdogStallProfiler() {
+        const QString fileName("/tmp/processwatchdog-stalls.txt");
+        QFile::remove(fileName);
+
+        pingCount = 0;
+        pongOnGivenPing = 0;
+        stallOnPing = 3000;
+        QVERIFY(watchdog->setStallProfiler(1000, fileName));
+        QVERIFY(watchdog->start());
+        bool pingsOk = waitForPings(2, 3*24*1000);
+        QVERIFY(watchdog->stop());
+        stallOnPing = 0;
+        QVERIFY(watchdog->setStallProfiler(0));
+        QVERIFY(pingsOk);
+
+        /* Two captures per ping, at 1 s and at 2 s */
+        QVERIFY(watchdog->stallCaptures() >= 4);
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QByteArray captures = file.readAll();
+        QVERIFY(captures.contains("no pong"));
+        QVERIFY(captures.contains("in slot TestClass::ping()"));
+        file.close();
+        QFile::remove(fileName);
+    }
+
     void testWatchdogAbort() {
         pingCount = 0;
         pongOnGivenPing = 3;
@@ -0,0 +1,148 @@
+/*!
+ * @file processwatchdog_sim.cpp
+ * @brief QmProcessWatchdog tests against the simulated DSME
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+#include <QFile>
+#include <QObject>
+#include <QTest>
+#include <QTime>
+#include <qmwatchdog.h>
+
+#include "dsmesimulator.h"
+
+#define PING_INTERVAL 500 /* ms */
+
+class TestClass : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void ping() {
+        pings++;
+        if (answer)
+            QVERIFY(watchdog->pong());
+    }
+
+private:
+    DsmeSimulator *simulator;
+    MeeGo::QmProcessWatchdog *watchdog;
+    int pings;
+    bool answer;
+
+private slots:
+    void initTestCase() {
+        // Set before the watchdog exists, the simulator listens later
+        simulator = new DsmeSimulator(SimServer::tempPath("dsmesim-test"), PING_INTERVAL);
+        qputenv("DSME_SOCKFILE", QFile::encodeName(simulator->path()));
+        watchdog = new MeeGo::QmProcessWatchdog();
+        pings = 0;
+        answer = true;
+        QVERIFY(connect(watchdog, SIGNAL(ping()), this, SLOT(ping())));
+    }
+
+    void testStartBeforeDsme() {
+        // Nothing listens yet, start() does not wait for it, and the
+        // first failed connect is logged, not the retries
+        QTest::ignoreMessage(QtWarningMsg, "Could not connect to dsme daemon. ");
+        QTime time;
+        time.start();
+        QVERIFY(watchdog->start());
+        QVERIFY(time.elapsed() < 100);
+        QVERIFY(!watchdog->pong());
+        QTest::qWait(1000);
+
+        QVERIFY(simulator->serve());
+
+        // Reconnected by the retries, which back off to 2 s by now
+        SIM_TRY_VERIFY(simulator->registrations() >= 1, 5000);
+        SIM_TRY_VERIFY(simulator->pongs() >= 3, 5 * PING_INTERVAL);
+        QCOMPARE(simulator->missedPongs(), 0);
+        QVERIFY(pings >= 3);
+    }
+
+    void testBusyDsme() {
+        const int count = 50000;
+
+        simulator->setReading(false);
+        int pongs = simulator->pongs();
+
+        // More than the socket takes, the rest is queued without blocking
+        QTime time;
+        time.start();
+        for (int i = 0; i < count; i++)
+            QVERIFY(watchdog->pong());
+        qDebug() << count << "pongs to a busy DSME took" << time.elapsed() << "ms";
+        QVERIFY(time.elapsed() < 5000);
+
+        simulator->setReading(true);
+        SIM_TRY_VERIFY(simulator->pongs() >= pongs + 1, 2000);
+        QTest::qWait(2 * PING_INTERVAL);
+
+        // The queued ones went as one
+        QVERIFY(simulator->pongs() - pongs < count);
+    }
+
+    void testDsmeRestart() {
+        int registrations = simulator->registrations();
+        simulator->dropClients();
+
+        SIM_TRY_VERIFY(simulator->registrations() >= registrations + 1, 5000);
+        int pongs = simulator->pongs();
+        SIM_TRY_VERIFY(simulator->pongs() >= pongs + 2, 4 * PING_INTERVAL);
+    }
+
+    void testStop() {
+        QVERIFY(watchdog->stop());
+        SIM_TRY_VERIFY(simulator->unregistrations() >= 1, 1000);
+
+        int count = simulator->pings();
+        QTest::qWait(3 * PING_INTERVAL);
+        QCOMPARE(simulator->pings(), count);
+    }
+
+    void testAutomaticPong() {
+        answer = false;
+        QVERIFY(watchdog->setAutomaticPong(true, 500));
+        int registrations = simulator->registrations();
+        int missed = simulator->missedPongs();
+
+        QVERIFY(watchdog->start());
+        SIM_TRY_VERIFY(simulator->registrations() >= registrations + 1, 1000);
+        int pongs = simulator->pongs();
+        SIM_TRY_VERIFY(simulator->pongs() >= pongs + 3, 5 * PING_INTERVAL);
+        QCOMPARE(simulator->missedPongs(), missed);
+
+        QVERIFY(watchdog->stop());
+        QCOMPARE(watchdog->loopStatistics().stalls, 0);
+        QVERIFY(watchdog->setAutomaticPong(false));
+        answer = true;
+    }
+
+    void cleanupTestCase() {
+        delete watchdog;
+        simulator->stop();
+        qDebug() << simulator->summary();
+        delete simulator;
+    }
+};
+
+QTEST_MAIN(TestClass)
+#include "processwatchdog_sim.moc"
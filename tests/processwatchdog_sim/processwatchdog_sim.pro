@@ -0,0 +1,13 @@
+QT -= gui
+SOURCES += processwatchdog_sim.cpp \
+           ../dsmesim/dsmesimulator.cpp
+HEADERS += ../dsmesim/dsmesimulator.h
+INCLUDEPATH += ../dsmesim
+include(../common/simserver.pri)
+
+CONFIG += link_pkgconfig
+PKGCONFIG += dsme
+LIBS += -lrt
+TARGET = processwatchdog-sim-test
+
+include(../common-install.pri)
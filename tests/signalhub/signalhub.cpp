@@ -0,0 +1,227 @@
+/**
+ * @file signalhub.cpp
+ * @brief QmSignalHub tests
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QObject>
+#include <QTest>
+#include <QThread>
+
+#include "qmsignalhub_p.h"
+
+/* Sent by the test itself, the bus routes them back to the sender too */
+#define TEST_PATH "/com/nokia/qmsystem/signalhubtest"
+#define TEST_IF   "com.nokia.qmsystem.SignalHubTest"
+
+using namespace MeeGo;
+
+class Receiver : public QObject
+{
+    Q_OBJECT
+
+public:
+    Receiver() : calls(0), value(-1), thread(0) {}
+
+    int calls;
+    int value;
+    QThread *thread;
+
+public slots:
+    void changed(int newValue) {
+        calls++;
+        value = newValue;
+        thread = QThread::currentThread();
+    }
+
+    void noArguments() {
+        calls++;
+    }
+};
+
+/* Disconnects the victim from Changed when it gets Changed first */
+class Disconnector : public QObject
+{
+    Q_OBJECT
+
+public:
+    Disconnector(QObject *victim) : victim(victim) {}
+
+    QObject *victim;
+
+public slots:
+    void changed(int) {
+        QmSignalHub::disconnect("", TEST_PATH, TEST_IF, "Changed", victim, SLOT(changed(int)));
+    }
+};
+
+static void send(const char *name, int value)
+{
+    QDBusMessage signal = QDBusMessage::createSignal(TEST_PATH, TEST_IF, name);
+    signal << value;
+    QDBusConnection::systemBus().send(signal);
+}
+
+static bool connectTo(const char *name, QObject *receiver, const char *slot)
+{
+    return QmSignalHub::connect("", TEST_PATH, TEST_IF, name, receiver, slot);
+}
+
+static bool disconnectFrom(const char *name, QObject *receiver, const char *slot)
+{
+    return QmSignalHub::disconnect("", TEST_PATH, TEST_IF, name, receiver, slot);
+}
+
+/* Waits for the signals until the counter reaches the value */
+static bool waitFor(const int &counter, int value, int timeout = 3000)
+{
+    for (int waited = 0; counter < value && waited < timeout; waited += 10)
+        QTest::qWait(10);
+    return counter >= value;
+}
+
+class TestClass : public QObject
+{
+    Q_OBJECT
+
+private:
+    int base;
+
+private slots:
+    void initTestCase() {
+        QVERIFY(QDBusConnection::systemBus().isConnected());
+        base = QmSignalHub::subscriptionCount();
+    }
+
+    void testOneRelayPerSignal() {
+        Receiver first, second;
+        QVERIFY(connectTo("Changed", &first, SLOT(changed(int))));
+        QVERIFY(connectTo("Changed", &second, SLOT(changed(int))));
+        QCOMPARE(QmSignalHub::subscriptionCount(), base + 1);
+
+        /* A slot may take fewer arguments than the signal */
+        QVERIFY(connectTo("Changed", &second, SLOT(noArguments())));
+        QCOMPARE(QmSignalHub::subscriptionCount(), base + 1);
+
+        QVERIFY(connectTo("Other", &first, SLOT(changed(int))));
+        QCOMPARE(QmSignalHub::subscriptionCount(), base + 2);
+
+        send("Changed", 42);
+        QVERIFY(waitFor(first.calls, 1));
+        QVERIFY(waitFor(second.calls, 2));
+        QCOMPARE(first.value, 42);
+        QCOMPARE(second.value, 42);
+
+        QList<QVariant> arguments;
+        QVERIFY(QmSignalHub::cached("", TEST_PATH, TEST_IF, "Changed", arguments));
+        QCOMPARE(arguments.size(), 1);
+        QCOMPARE(arguments[0].toInt(), 42);
+        QVERIFY(!QmSignalHub::cached("", TEST_PATH, TEST_IF, "Other", arguments));
+    }
+
+    void testReceiversDestroyed() {
+        /* The receivers of the previous test are gone with their relays */
+        QCOMPARE(QmSignalHub::subscriptionCount(), base);
+
+        Receiver *first = new Receiver();
+        Receiver second;
+        QVERIFY(connectTo("Changed", first, SLOT(changed(int))));
+        QVERIFY(connectTo("Changed", &second, SLOT(changed(int))));
+
+        delete first;
+        QCOMPARE(QmSignalHub::subscriptionCount(), base + 1);
+
+        send("Changed", 7);
+        QVERIFY(waitFor(second.calls, 1));
+        QCOMPARE(second.value, 7);
+    }
+
+    void testDisconnect() {
+        Receiver first, second;
+        QVERIFY(connectTo("Changed", &first, SLOT(changed(int))));
+        QVERIFY(connectTo("Changed", &second, SLOT(changed(int))));
+
+        QVERIFY(disconnectFrom("Changed", &first, SLOT(changed(int))));
+        QVERIFY(!disconnectFrom("Changed", &first, SLOT(changed(int))));
+        QCOMPARE(QmSignalHub::subscriptionCount(), base + 1);
+
+        send("Changed", 1);
+        QVERIFY(waitFor(second.calls, 1));
+        QTest::qWait(100);
+        QCOMPARE(first.calls, 0);
+
+        /* The last one releases the bus subscription */
+        QVERIFY(disconnectFrom("Changed", &second, SLOT(changed(int))));
+        QCOMPARE(QmSignalHub::subscriptionCount(), base);
+        QList<QVariant> arguments;
+        QVERIFY(!QmSignalHub::cached("", TEST_PATH, TEST_IF, "Changed", arguments));
+    }
+
+    void testDisconnectedByEarlierSlot() {
+        /* Still subscribed to another signal, but not to this one any more */
+        Receiver victim;
+        Disconnector disconnector(&victim);
+        QVERIFY(connectTo("Changed", &disconnector, SLOT(changed(int))));
+        QVERIFY(connectTo("Changed", &victim, SLOT(changed(int))));
+        QVERIFY(connectTo("Other", &victim, SLOT(noArguments())));
+
+        send("Changed", 5);
+        send("Other", 0);
+        QVERIFY(waitFor(victim.calls, 1));
+        QTest::qWait(100);
+        QCOMPARE(victim.calls, 1);
+        QCOMPARE(victim.value, -1);
+    }
+
+    void testBadSlot() {
+        Receiver receiver;
+        QVERIFY(!connectTo("Changed", &receiver, SLOT(missing(int))));
+        QVERIFY(!connectTo("Changed", 0, SLOT(changed(int))));
+        QCOMPARE(QmSignalHub::subscriptionCount(), base);
+    }
+
+    void testReceiverThread() {
+        QThread worker;
+        worker.start();
+
+        Receiver *receiver = new Receiver();
+        receiver->moveToThread(&worker);
+        QVERIFY(connectTo("Changed", receiver, SLOT(changed(int))));
+
+        send("Changed", 3);
+        QVERIFY(waitFor(receiver->calls, 1));
+        QCOMPARE(receiver->value, 3);
+        QCOMPARE(receiver->thread, &worker);
+
+        /* Destroyed in its own thread, the subscription goes with it */
+        receiver->deleteLater();
+        for (int waited = 0; QmSignalHub::subscriptionCount() > base && waited < 3000; waited += 10)
+            QTest::qWait(10);
+        QCOMPARE(QmSignalHub::subscriptionCount(), base);
+
+        worker.quit();
+        worker.wait();
+    }
+};
+
+QTEST_MAIN(TestClass)
+#include "signalhub.moc"
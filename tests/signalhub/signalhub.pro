@@ -0,0 +1,7 @@
+QT += dbus
+QT -= gui
+
+TARGET = signalhub-test
+SOURCES += signalhub.cpp
+
+include(../common-install.pri)
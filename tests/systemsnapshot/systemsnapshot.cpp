@@ -0,0 +1,92 @@
+/**
+ * @file systemsnapshot.cpp
+ * @brief QmSystemSnapshot tests
+
+   <p>
+   Copyright (C) 2009-2011 Nokia Corporation
+
+   This file is part of SystemSW QtAPI.
+
+   SystemSW QtAPI is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   SystemSW QtAPI is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with SystemSW QtAPI.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include <QObject>
+#include <qmsystemsnapshot.h>
+#include <QTest>
+#include <QSignalSpy>
+#include <QTime>
+#include <QDebug>
+
+class TestClass : public QObject
+{
+    Q_OBJECT
+
+private:
+    MeeGo::QmSystemSnapshot *snapshot;
+
+    /* The states that do not change while the test runs */
+    void compareToGetters(const MeeGo::QmSystemSnapshot::Values &values) {
+        MeeGo::QmDisplayState displayState;
+        MeeGo::QmDeviceMode deviceMode;
+        MeeGo::QmLocks locks;
+        MeeGo::QmCallState callState;
+        MeeGo::QmCABC cabc;
+        MeeGo::QmThermal thermal;
+
+        QCOMPARE(values.displayState, displayState.get());
+        QCOMPARE(values.deviceMode, deviceMode.getMode());
+        QCOMPARE(values.psmState, deviceMode.getPSMState());
+        QCOMPARE(values.touchAndKeyboardLock, locks.getState(MeeGo::QmLocks::TouchAndKeyboard));
+        QCOMPARE(values.deviceLock, locks.getState(MeeGo::QmLocks::Device));
+        QCOMPARE(values.callState, callState.getState());
+        QCOMPARE(values.callType, callState.getType());
+        QCOMPARE(values.cabcMode, cabc.get());
+        QCOMPARE(values.thermalState, thermal.get());
+    }
+
+private slots:
+    void initTestCase() {
+        snapshot = new MeeGo::QmSystemSnapshot();
+        QVERIFY(snapshot);
+    }
+
+    void testFetch() {
+        QTime time;
+        time.start();
+        MeeGo::QmSystemSnapshot::Values values = MeeGo::QmSystemSnapshot::fetch();
+        qDebug() << "fetch took" << time.elapsed() << "ms";
+
+        compareToGetters(values);
+    }
+
+    void testFetchAsync() {
+        QSignalSpy spy(snapshot, SIGNAL(fetched()));
+
+        QVERIFY(snapshot->fetchAsync());
+        QVERIFY(!snapshot->fetchAsync());
+        QCOMPARE(spy.count(), 0);
+
+        QTest::qWait(2000);
+        QCOMPARE(spy.count(), 1);
+
+        compareToGetters(snapshot->values());
+    }
+
+    void cleanupTestCase() {
+        delete snapshot;
+    }
+};
+
+QTEST_MAIN(TestClass)
+#include "systemsnapshot.moc"
@@ -0,0 +1,6 @@
+QT -= gui
+SOURCES += systemsnapshot.cpp
+
+TARGET = systemsnapshot-test
+
+include(../common-install.pri)
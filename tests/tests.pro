@@ -10,16 +10,21 @@ SUBDIRS = accelerometer \
           devicemode \
           displaystate \
           heartbeat \
+          heartbeatscheduler \
           hw_keys \
+          ipcstatistics \
           led \
           locks \
           orientation \
           proximity \
           rotation \
           magnetometer \
+          magneticcalibration \
+          signalhub \
           system \
           systeminformation \
           systemsignals \
+          systemsnapshot \
           tap \
           time \
           manual_orientation \
@@ -32,7 +37,9 @@ SUBDIRS = accelerometer \
           manual_locks \
           manual_rotation \
           host_system \
+          dsmesim \
           processwatchdog \
+          processwatchdog_sim \
           manual_keys \
           manual_led \
           manual_proximity \
@@ -43,9 +50,28 @@ SUBDIRS = accelerometer \
 
 linux-g++-maemo {
     SUBDIRS += battery \
+               energymeter \
                thermal
 }
 
+# Built with the real battery backend, see system/system.pro
+linux-g++-maemo|bmesim {
+    SUBDIRS += batterymodel
+}
+
+# QmHeartbeat against the simulated iphbd, see system/system.pro
+iphbsim {
+    SUBDIRS += iphbsim \
+               heartbeat_sim
+}
+
+# The real battery backend against the simulated BME, see system/system.pro
+bmesim {
+    SUBDIRS += bmesim \
+               battery_sim \
+               energymeter_sim
+}
+
 # Test definition installation
 testdefinition.files = tests.xml
 testdefinition.path = /usr/share/qmsystem-tests
@@ -27,6 +27,7 @@
 #include <QObject>
 #include <qmthermal.h>
 #include <QTest>
+#include <QSignalSpy>
 #include <QDebug>
 #include <QFile>
 
@@ -174,6 +175,15 @@ private slots:
         (void)result;
     }
 
+    void testGetAsync() {
+        QSignalSpy spy(thermal, SIGNAL(thermalStateReceived(MeeGo::QmThermal::ThermalState)));
+        thermal->getAsync();
+        QCOMPARE(spy.count(), 0);
+
+        QTest::qWait(1000);
+        QCOMPARE(spy.count(), 1);
+    }
+
     void testSignals() {
         int temp = bme_get_battery_temperature();
         QVERIFY(temp > 0);
@@ -406,6 +406,113 @@ private slots:
         QCOMPARE(diff, 10800);
     }
 
+    void testRemoteTimeMatchesLibc() {
+        const char *zones[] = { "Europe/Helsinki", "America/New_York", "Australia/Sydney",
+                                "Asia/Kolkata", "America/Santiago", "UTC" };
+        time_t times[] = { 0, 946722896, 1238320800, 1301187600, 2147483647 };
+        setenv("TZ", "Europe/Helsinki", 1);
+
+        for (unsigned i = 0; i < sizeof(zones)/sizeof(*zones); i++) {
+            for (unsigned j = 0; j < sizeof(times)/sizeof(*times); j++) {
+                QDateTime dt;
+                struct tm ours, libc;
+                QVERIFY(time->remoteTime(zones[i], times[j], dt, &ours));
+                QCOMPARE(QString(getenv("TZ")), QString("Europe/Helsinki"));
+
+                setenv("TZ", zones[i], 1);
+                tzset();
+                localtime_r(&times[j], &libc);
+                setenv("TZ", "Europe/Helsinki", 1);
+                tzset();
+
+                QCOMPARE(ours.tm_gmtoff, libc.tm_gmtoff);
+                QCOMPARE(ours.tm_isdst, libc.tm_isdst);
+                QCOMPARE(ours.tm_hour, libc.tm_hour);
+                QCOMPARE(ours.tm_mday, libc.tm_mday);
+                QCOMPARE(QString(ours.tm_zone), QString(libc.tm_zone));
+            }
+        }
+        unsetenv("TZ");
+        tzset();
+    }
+
+    void testAsynchronousSettings() {
+        QVERIFY(MeeGo::QmTime::setSynchronizationPolicy(MeeGo::QmTime::Asynchronous));
+
+        /* Sent together as one request at the next event loop iteration */
+        signalDump.signalReceived = false;
+        QVERIFY(time->setTimezone("Europe/London"));
+        QVERIFY(time->setTimezone("Europe/Paris"));
+        QVERIFY(time->setAutoTimeZone(MeeGo::QmTime::AutoTimeZoneOff));
+        QVERIFY(!signalDump.signalReceived);
+
+        waitTwice(500);
+        QVERIFY(signalDump.signalReceived);
+        QString tz;
+        QVERIFY(time->getTimezone(tz));
+        QCOMPARE(tz, QString("Europe/Paris"));
+        QCOMPARE(time->autoTimeZone(), MeeGo::QmTime::AutoTimeZoneOff);
+
+        QVERIFY(MeeGo::QmTime::setSynchronizationPolicy(MeeGo::QmTime::SynchronizeOnWrite));
+    }
+
+    void testRemoteOffset() {
+        const char *zones[] = { "Europe/Helsinki", "America/New_York", "Australia/Sydney",
+                                "Asia/Kolkata", "EST5EDT", "" };
+        time_t times[] = { 0, 946722896, 1238320800, 1301187600, 2147483647 };
+
+        for (unsigned i = 0; i < sizeof(zones)/sizeof(*zones); i++) {
+            for (unsigned j = 0; j < sizeof(times)/sizeof(*times); j++) {
+                QDateTime dt;
+                struct tm tm;
+                QVERIFY(time->remoteTime(zones[i], times[j], dt, &tm));
+                QCOMPARE(time->remoteOffset(zones[i], times[j]), (int)tm.tm_gmtoff);
+                QCOMPARE(time->getTimeDiff(times[j], zones[i], "UTC"), (int)tm.tm_gmtoff);
+            }
+        }
+    }
+
+    void testRemoteTimesBulk() {
+        const char *zones[] = { "Europe/Helsinki", "America/New_York", "Australia/Sydney", "" };
+        QVector<time_t> times;
+        for (time_t t = 1300000000; t > 900000000; t -= 86400*7+3607)
+            times.append(t);
+
+        QVector<QPair<QString, time_t> > moments;
+        for (unsigned i = 0; i < sizeof(zones)/sizeof(*zones); i++) {
+            QVector<struct tm> tms;
+            QVector<int> offsets;
+            QVERIFY(time->remoteTimes(zones[i], times, tms));
+            QVERIFY(time->remoteOffsets(zones[i], times, offsets));
+            QCOMPARE(tms.size(), times.size());
+            QCOMPARE(offsets.size(), times.size());
+
+            for (int j = 0; j < times.size(); j++) {
+                QDateTime dt;
+                struct tm tm;
+                QVERIFY(time->remoteTime(zones[i], times[j], dt, &tm));
+                QCOMPARE((long)tms[j].tm_gmtoff, (long)tm.tm_gmtoff);
+                QCOMPARE(tms[j].tm_hour, tm.tm_hour);
+                QCOMPARE(tms[j].tm_isdst, tm.tm_isdst);
+                QCOMPARE(offsets[j], (int)tm.tm_gmtoff);
+                moments.append(qMakePair(QString(zones[i]), times[j]));
+            }
+        }
+
+        QVector<struct tm> tms;
+        QVector<int> offsets;
+        QVERIFY(time->remoteTimes(moments, tms));
+        QVERIFY(time->remoteOffsets(moments, offsets));
+        for (int k = 0; k < moments.size(); k++) {
+            QDateTime dt;
+            struct tm tm;
+            QVERIFY(time->remoteTime(moments[k].first, moments[k].second, dt, &tm));
+            QCOMPARE((long)tms[k].tm_gmtoff, (long)tm.tm_gmtoff);
+            QCOMPARE(tms[k].tm_mday, tm.tm_mday);
+            QCOMPARE(offsets[k], (int)tm.tm_gmtoff);
+        }
+    }
+
     void testAutosync120060() {
         QVERIFY (time->setAutoSystemTime(MeeGo::QmTime::AutoSystemTimeOff));
         QCOMPARE(time->autoSystemTime(), MeeGo::QmTime::AutoSystemTimeOff);